@@ -0,0 +1,125 @@
+/**
+Single-producer single-consumer byte stream for variable-length commands.
+Unlike CircularFifo, writes are not visible to the consumer until publish() is called,
+so a producer can append many small records and pay for a single release store.
+Records must be published whole, the consumer assumes a record it has started reading is complete.
+**/
+#ifndef COMMANDFIFO_HPP
+#define COMMANDFIFO_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+template<size_t Size>
+class CommandFifo
+{
+public:
+    static_assert((Size & (Size - 1)) == 0, "CommandFifo size must be a power of two");
+
+    CommandFifo() : _tail(0), _write_pos(0), _cached_head(0), _head(0), _read_pos(0), _cached_tail(0) {}
+
+    //Producer
+    bool write(const void* data, size_t len);
+    void publish();
+    size_t unpublished() const;
+
+    //Consumer
+    bool read(void* data, size_t len);
+    void consume();
+
+    bool was_empty() const;
+
+private:
+    void copy_in(size_t pos, const uint8_t* data, size_t len);
+    void copy_out(size_t pos, uint8_t* data, size_t len) const;
+
+    //Indices only ever increase and are masked on access
+    alignas(64) std::atomic<size_t> _tail;
+    size_t _write_pos;
+    size_t _cached_head;
+
+    alignas(64) std::atomic<size_t> _head;
+    size_t _read_pos;
+    size_t _cached_tail;
+
+    alignas(64) uint8_t _array[Size];
+};
+
+//Appends len bytes without making them visible. Returns false if there isn't room
+template<size_t Size>
+bool CommandFifo<Size>::write(const void* data, size_t len)
+{
+    if (_write_pos + len - _cached_head > Size)
+    {
+        _cached_head = _head.load(std::memory_order_acquire);
+        if (_write_pos + len - _cached_head > Size)
+            return false;
+    }
+
+    copy_in(_write_pos, (const uint8_t*)data, len);
+    _write_pos += len;
+    return true;
+}
+
+template<size_t Size>
+void CommandFifo<Size>::publish()
+{
+    _tail.store(_write_pos, std::memory_order_release);
+}
+
+template<size_t Size>
+size_t CommandFifo<Size>::unpublished() const
+{
+    return _write_pos - _tail.load(std::memory_order_relaxed);
+}
+
+//Reads len bytes of published data. Returns false, reading nothing, if not enough is available
+template<size_t Size>
+bool CommandFifo<Size>::read(void* data, size_t len)
+{
+    if (_cached_tail - _read_pos < len)
+    {
+        _cached_tail = _tail.load(std::memory_order_acquire);
+        if (_cached_tail - _read_pos < len)
+            return false;
+    }
+
+    copy_out(_read_pos, (uint8_t*)data, len);
+    _read_pos += len;
+    return true;
+}
+
+//Hands everything read so far back to the producer
+template<size_t Size>
+void CommandFifo<Size>::consume()
+{
+    _head.store(_read_pos, std::memory_order_release);
+}
+
+template<size_t Size>
+bool CommandFifo<Size>::was_empty() const
+{
+    return _head.load() == _tail.load();
+}
+
+template<size_t Size>
+void CommandFifo<Size>::copy_in(size_t pos, const uint8_t* data, size_t len)
+{
+    size_t offset = pos & (Size - 1);
+    size_t first = (len < Size - offset) ? len : Size - offset;
+    memcpy(&_array[offset], data, first);
+    memcpy(&_array[0], data + first, len - first);
+}
+
+template<size_t Size>
+void CommandFifo<Size>::copy_out(size_t pos, uint8_t* data, size_t len) const
+{
+    size_t offset = pos & (Size - 1);
+    size_t first = (len < Size - offset) ? len : Size - offset;
+    memcpy(data, &_array[offset], first);
+    memcpy(data + first, &_array[0], len - first);
+}
+
+#endif // COMMANDFIFO_HPP
@@ -2,6 +2,7 @@
 #include <cstring>
 #include "cop0.hpp"
 #include "dmac.hpp"
+#include "ee_fastmem.hpp"
 
 Cop0::Cop0(DMAC* dmac) : dmac(dmac)
 {
@@ -12,6 +13,7 @@ Cop0::Cop0(DMAC* dmac) : dmac(dmac)
     sup_vtlb = nullptr;
     user_vtlb = nullptr;
     vtlb_info = nullptr;
+    fastmem = nullptr;
 }
 
 Cop0::~Cop0()
@@ -85,6 +87,25 @@ void Cop0::init_mem_pointers(uint8_t *RDRAM, uint8_t *BIOS, uint8_t *spr)
     this->spr = spr;
 }
 
+void Cop0::set_fastmem(EEFastmem* fastmem)
+{
+    this->fastmem = fastmem;
+}
+
+uint8_t* Cop0::get_fastmem_base() const
+{
+    if (fastmem && fastmem->is_active())
+        return fastmem->get_base();
+    return nullptr;
+}
+
+//The fastmem view mirrors the kernel map, which is a superset of the supervisor and user maps
+void Cop0::update_fastmem(uint32_t first_page, uint32_t count)
+{
+    if (fastmem)
+        fastmem->map_pages(kernel_vtlb, first_page, count);
+}
+
 void Cop0::init_tlb()
 {
     if (!kernel_vtlb)
@@ -112,6 +133,8 @@ void Cop0::init_tlb()
         else
             vtlb_info[map_index].cache_mode = UNCACHED;
     }
+
+    update_fastmem(0, 1024 * 1024);
 }
 
 uint32_t Cop0::mfc(int index)
@@ -360,6 +383,7 @@ void Cop0::unmap_tlb(TLB_Entry *entry)
                 sup_vtlb[even_page + map_index] = nullptr;
                 user_vtlb[even_page + map_index] = nullptr;
             }
+            update_fastmem(even_page, (1024 * 16) / 4096);
         }
     }
     else
@@ -373,6 +397,7 @@ void Cop0::unmap_tlb(TLB_Entry *entry)
                 sup_vtlb[even_page + map_index] = nullptr;
                 user_vtlb[even_page + map_index] = nullptr;
             }
+            update_fastmem(even_page, entry->page_size / 4096);
         }
 
         if (entry->valid[1])
@@ -384,6 +409,7 @@ void Cop0::unmap_tlb(TLB_Entry *entry)
                 sup_vtlb[odd_page + map_index] = nullptr;
                 user_vtlb[odd_page + map_index] = nullptr;
             }
+            update_fastmem(odd_page, entry->page_size / 4096);
         }
     }
 }
@@ -412,6 +438,7 @@ void Cop0::map_tlb(TLB_Entry *entry)
                 user_vtlb[even_virt_page + map_index] = spr + i;
                 vtlb_info[even_virt_page + map_index].cache_mode = SPR;
             }
+            update_fastmem(even_virt_page, (1024 * 16) / 4096);
         }
     }
     else
@@ -434,6 +461,7 @@ void Cop0::map_tlb(TLB_Entry *entry)
 
                 vtlb_info[even_virt_page + map_index].cache_mode = entry->cache_mode[0];
             }
+            update_fastmem(even_virt_page, entry->page_size / 4096);
         }
 
         if (entry->valid[1])
@@ -454,6 +482,7 @@ void Cop0::map_tlb(TLB_Entry *entry)
 
                 vtlb_info[odd_virt_page + map_index].cache_mode = entry->cache_mode[1];
             }
+            update_fastmem(odd_virt_page, entry->page_size / 4096);
         }
     }
 }
@@ -74,6 +74,7 @@ struct VTLB_Info
 };
 
 class DMAC;
+class EEFastmem;
 
 extern "C" uint8_t* exec_block_ee(EE_JIT64& jit, EmotionEngine& ee);
 
@@ -91,6 +92,9 @@ class Cop0
 
         VTLB_Info* vtlb_info;
 
+        EEFastmem* fastmem;
+
+        void update_fastmem(uint32_t first_page, uint32_t count);
         void unmap_tlb(TLB_Entry* entry);
         void map_tlb(TLB_Entry* entry);
 
@@ -111,6 +115,8 @@ class Cop0
 
         void reset();
         void init_mem_pointers(uint8_t* RDRAM, uint8_t* BIOS, uint8_t* spr);
+        void set_fastmem(EEFastmem* fastmem);
+        uint8_t* get_fastmem_base() const;
         void init_tlb();
 
         uint32_t mfc(int index);
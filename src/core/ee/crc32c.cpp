@@ -0,0 +1,152 @@
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_SSE42
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SSE42_FUNC
+#else
+#define SSE42_FUNC __attribute__((target("sse4.2")))
+#endif
+#endif
+
+#include <cstring>
+#include "crc32c.hpp"
+
+constexpr static uint32_t POLY = 0x82F63B78;
+
+struct CRC32C_Tables
+{
+    //slicing[n][b] is the CRC of byte b followed by n zero bytes
+    uint32_t slicing[8][256];
+
+    //extend[n][b] is extend_1k of byte b shifted left by 8 * n bits
+    uint32_t extend[4][256];
+
+    bool use_sse42;
+
+    CRC32C_Tables();
+};
+
+static bool host_has_sse42()
+{
+#if defined(CRC32C_SSE42) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return info[2] & (1 << 20);
+#elif defined(CRC32C_SSE42)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return false;
+#endif
+}
+
+CRC32C_Tables::CRC32C_Tables()
+{
+    for (int i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; k++)
+            crc = crc & 1 ? (crc >> 1) ^ POLY : crc >> 1;
+        slicing[0][i] = crc;
+    }
+
+    for (int i = 0; i < 256; i++)
+    {
+        for (int n = 1; n < 8; n++)
+            slicing[n][i] = (slicing[n - 1][i] >> 8) ^ slicing[0][slicing[n - 1][i] & 0xFF];
+    }
+
+    //The shift is linear, so it only needs to be worked out for each bit and then combined
+    uint32_t bit_shift[32];
+    for (int bit = 0; bit < 32; bit++)
+    {
+        uint32_t crc = 1U << bit;
+        for (int i = 0; i < 1024; i++)
+            crc = (crc >> 8) ^ slicing[0][crc & 0xFF];
+        bit_shift[bit] = crc;
+    }
+
+    for (int n = 0; n < 4; n++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            uint32_t crc = 0;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                if (i & (1 << bit))
+                    crc ^= bit_shift[(n * 8) + bit];
+            }
+            extend[n][i] = crc;
+        }
+    }
+
+    use_sse42 = host_has_sse42();
+}
+
+static const CRC32C_Tables& tables()
+{
+    static CRC32C_Tables t;
+    return t;
+}
+
+#ifdef CRC32C_SSE42
+SSE42_FUNC static uint32_t update_sse42(uint32_t crc, const uint8_t* data, size_t len)
+{
+    for (; len && ((uintptr_t)data & 0x7); len--)
+        crc = _mm_crc32_u8(crc, *data++);
+
+    uint64_t crc64 = crc;
+    for (; len >= 8; len -= 8)
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+        data += 8;
+    }
+    crc = (uint32_t)crc64;
+
+    for (; len; len--)
+        crc = _mm_crc32_u8(crc, *data++);
+    return crc;
+}
+#endif
+
+static uint32_t update_slicing(const CRC32C_Tables& t, uint32_t crc, const uint8_t* data, size_t len)
+{
+    for (; len >= 8; len -= 8)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, data, sizeof(lo));
+        memcpy(&hi, data + 4, sizeof(hi));
+        lo ^= crc;
+
+        //Little-endian hosts only, which is all the JITs support anyway
+        crc = t.slicing[7][lo & 0xFF] ^ t.slicing[6][(lo >> 8) & 0xFF] ^
+              t.slicing[5][(lo >> 16) & 0xFF] ^ t.slicing[4][lo >> 24] ^
+              t.slicing[3][hi & 0xFF] ^ t.slicing[2][(hi >> 8) & 0xFF] ^
+              t.slicing[1][(hi >> 16) & 0xFF] ^ t.slicing[0][hi >> 24];
+        data += 8;
+    }
+
+    for (; len; len--)
+        crc = (crc >> 8) ^ t.slicing[0][(crc ^ *data++) & 0xFF];
+    return crc;
+}
+
+uint32_t CRC32C::update(uint32_t crc, const uint8_t* data, size_t len)
+{
+    const CRC32C_Tables& t = tables();
+#ifdef CRC32C_SSE42
+    if (t.use_sse42)
+        return update_sse42(crc, data, len);
+#endif
+    return update_slicing(t, crc, data, len);
+}
+
+uint32_t CRC32C::extend_1k(uint32_t crc)
+{
+    const CRC32C_Tables& t = tables();
+    return t.extend[0][crc & 0xFF] ^ t.extend[1][(crc >> 8) & 0xFF] ^
+           t.extend[2][(crc >> 16) & 0xFF] ^ t.extend[3][crc >> 24];
+}
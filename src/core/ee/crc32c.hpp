@@ -0,0 +1,21 @@
+#ifndef CRC32C_HPP
+#define CRC32C_HPP
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * CRC32C (Castagnoli), as used to identify VU microprograms.
+ *
+ * The SSE4.2 crc32 instruction is used when the host supports it, otherwise a slicing-by-8 table version.
+ * Neither function inverts the CRC before or after, so the usual CRC of a buffer is ~update(~0, data, len).
+ */
+namespace CRC32C
+{
+    uint32_t update(uint32_t crc, const uint8_t* data, size_t len);
+
+    //Same result as update() over 1 KB of zeroes. With it, the CRC of A followed by a 1 KB chunk B is
+    //extend_1k(crc of A) ^ update(0, B, 1024), so chunks can be rehashed independently
+    uint32_t extend_1k(uint32_t crc);
+};
+
+#endif // CRC32C_HPP
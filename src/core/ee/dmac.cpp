@@ -72,6 +72,7 @@ uint128_t DMAC::fetch128(uint32_t addr)
         {
             return vu0->read_mem<uint128_t>(addr);
         }
+        vu1->wait_for_thread();
         if (addr < 0x1100C000)
         {
             return vu1->read_instr<uint128_t>(addr);
@@ -104,6 +105,7 @@ void DMAC::store128(uint32_t addr, uint128_t data)
             vu0->write_mem<uint128_t>(addr, data);
             return;
         }
+        vu1->wait_for_thread();
         if (addr < 0x1100C000)
         {
             vu1->write_instr<uint128_t>(addr, data);
@@ -560,14 +562,18 @@ int DMAC::process_IPU_TO()
     {
         uint32_t max_qwc = 8 - ((channels[IPU_TO].address >> 4) & 0x7);
         int quads_to_transfer = std::min(channels[IPU_TO].quadword_count, max_qwc);
+        quads_to_transfer = std::min(quads_to_transfer, ipu->get_FIFO_space());
+
+        //Hand the whole burst to the IPU at once
+        uint128_t quads[IPU_FIFO::SIZE];
         while (count < quads_to_transfer)
         {
-            if (!ipu->can_write_FIFO())
-                break;
-            ipu->write_FIFO(fetch128(channels[IPU_TO].address));
+            quads[count] = fetch128(channels[IPU_TO].address);
             advance_source_dma(IPU_TO);
             count++;
         }
+        if (count)
+            ipu->write_FIFO(quads, count);
     }
     if (!channels[IPU_TO].quadword_count)
     {
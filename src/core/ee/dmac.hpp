@@ -142,6 +142,7 @@ class DMAC
              VectorInterface* vif0, VectorInterface* vif1, VectorUnit* vu0, VectorUnit* vu1);
         void reset(uint8_t* RDRAM, uint8_t* scratchpad);
         void run(int cycles);
+        bool is_idle();
         void start_DMA(int index);
 
         uint32_t read_master_disable();
@@ -161,4 +162,9 @@ class DMAC
         void save_state(std::ofstream& state);
 };
 
+inline bool DMAC::is_idle()
+{
+    return !active_channel;
+}
+
 #endif // DMAC_HPP
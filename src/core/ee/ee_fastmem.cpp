@@ -0,0 +1,168 @@
+#if defined(__linux__) && defined(__x86_64__)
+#define EE_FASTMEM_SUPPORTED
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include "ee_fastmem.hpp"
+#include "../errors.hpp"
+
+constexpr static size_t GUEST_SPACE_SIZE = 0x100000000ULL;
+constexpr static size_t GUARD_SIZE = 1024 * 64;
+
+//The signal handler has no way to reach the instance, so the active arena is kept here
+static uint8_t* arena_start = nullptr;
+static EEFastmem::FaultHandler fault_handler = nullptr;
+
+#ifdef EE_FASTMEM_SUPPORTED
+static struct sigaction old_segv_action;
+
+static void segv_handler(int sig, siginfo_t* info, void* raw_context)
+{
+    uint8_t* fault_addr = (uint8_t*)info->si_addr;
+    ucontext_t* context = (ucontext_t*)raw_context;
+
+    if (arena_start && fault_handler &&
+        fault_addr >= arena_start && fault_addr < arena_start + GUEST_SPACE_SIZE + GUARD_SIZE)
+    {
+        uint8_t* pc = (uint8_t*)context->uc_mcontext.gregs[REG_RIP];
+        if (fault_handler(pc))
+        {
+            context->uc_mcontext.gregs[REG_RIP] = (greg_t)pc;
+            return;
+        }
+    }
+
+    //Not a fastmem access. Put the old handler back and let the instruction fault again
+    sigaction(SIGSEGV, &old_segv_action, nullptr);
+}
+#endif
+
+EEFastmem::EEFastmem() : fd(-1), mem(nullptr), base(nullptr)
+{
+
+}
+
+EEFastmem::~EEFastmem()
+{
+#ifdef EE_FASTMEM_SUPPORTED
+    if (base)
+    {
+        sigaction(SIGSEGV, &old_segv_action, nullptr);
+        arena_start = nullptr;
+        munmap(base, GUEST_SPACE_SIZE + GUARD_SIZE);
+    }
+    if (mem)
+        munmap(mem, BACKING_SIZE);
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+bool EEFastmem::init()
+{
+#ifdef EE_FASTMEM_SUPPORTED
+    //Only one arena can own the fault handler
+    if (arena_start)
+        return false;
+
+    fd = memfd_create("ee_fastmem", MFD_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, BACKING_SIZE) < 0)
+        return false;
+
+    void* view = mmap(nullptr, BACKING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED)
+        return false;
+    mem = (uint8_t*)view;
+
+    void* reserve = mmap(nullptr, GUEST_SPACE_SIZE + GUARD_SIZE, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserve == MAP_FAILED)
+        return false;
+    base = (uint8_t*)reserve;
+
+    struct sigaction action = {};
+    action.sa_sigaction = segv_handler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGSEGV, &action, &old_segv_action) < 0)
+    {
+        munmap(base, GUEST_SPACE_SIZE + GUARD_SIZE);
+        base = nullptr;
+        return false;
+    }
+
+    arena_start = base;
+    return true;
+#else
+    return false;
+#endif
+}
+
+//Returns the offset into the backing file of a host pointer, or -1 if it points elsewhere (MMIO/unmapped)
+int64_t EEFastmem::get_offset(uint8_t* ptr) const
+{
+    if (ptr <= (uint8_t*)1 || ptr < mem || ptr >= mem + BACKING_SIZE)
+        return -1;
+    return ptr - mem;
+}
+
+void EEFastmem::map_range(uint32_t first_page, uint32_t count, int64_t offset)
+{
+#ifdef EE_FASTMEM_SUPPORTED
+    uint8_t* addr = base + (size_t)first_page * 4096;
+    size_t len = (size_t)count * 4096;
+    void* result;
+
+    if (offset >= 0)
+        result = mmap(addr, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, offset);
+    else
+        result = mmap(addr, len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+
+    if (result == MAP_FAILED)
+        Errors::die("[EE Fastmem] Failed to map pages $%05X-$%05X", first_page, first_page + count - 1);
+#endif
+}
+
+/**
+ * Brings the guest view of pages [first_page, first_page + count) in line with the given vtlb.
+ * Consecutive pages that are contiguous in the backing file are mapped with a single call, which keeps
+ * the number of host mappings low (the kernel segments alone would otherwise need 256k of them).
+ */
+void EEFastmem::map_pages(uint8_t** vtlb, uint32_t first_page, uint32_t count)
+{
+    if (!base)
+        return;
+
+    uint32_t end = first_page + count;
+    uint32_t run_start = first_page;
+    int64_t run_offset = get_offset(vtlb[first_page]);
+
+    for (uint32_t page = first_page + 1; page <= end; page++)
+    {
+        if (page < end)
+        {
+            int64_t offset = get_offset(vtlb[page]);
+            int64_t expected = (run_offset < 0) ? -1 : run_offset + (int64_t)(page - run_start) * 4096;
+            if (offset == expected)
+                continue;
+
+            map_range(run_start, page - run_start, run_offset);
+            run_start = page;
+            run_offset = offset;
+        }
+        else
+            map_range(run_start, page - run_start, run_offset);
+    }
+}
+
+void EEFastmem::set_fault_handler(FaultHandler handler)
+{
+    fault_handler = handler;
+}
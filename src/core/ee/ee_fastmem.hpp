@@ -0,0 +1,82 @@
+#ifndef EE_FASTMEM_HPP
+#define EE_FASTMEM_HPP
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Host mirror of the EE virtual address space, used by the JIT to access guest memory as [base + addr].
+ *
+ * RDRAM, BIOS, and the scratchpad share one backing file. Pages of the 4 GB guest view are mapped onto it
+ * following the kernel vtlb, and everything else (MMIO, unmapped pages) is left inaccessible.
+ * A recompiled access that touches an inaccessible page faults, and the registered handler redirects
+ * it to the regular read/write functions.
+ *
+ * Only available on x86-64 Linux. init() returns false elsewhere, and the JIT keeps calling into the EE.
+ */
+class EEFastmem
+{
+    public:
+        typedef bool (*FaultHandler)(uint8_t*& pc);
+
+        constexpr static size_t RDRAM_SIZE = 1024 * 1024 * 32;
+        constexpr static size_t BIOS_SIZE = 1024 * 1024 * 4;
+        constexpr static size_t SPR_SIZE = 1024 * 16;
+
+        constexpr static size_t RDRAM_OFFSET = 0;
+        constexpr static size_t BIOS_OFFSET = RDRAM_OFFSET + RDRAM_SIZE;
+        constexpr static size_t SPR_OFFSET = BIOS_OFFSET + BIOS_SIZE;
+        constexpr static size_t BACKING_SIZE = SPR_OFFSET + SPR_SIZE;
+    private:
+        int fd;
+
+        //Every region of the backing file mapped once, for use by the rest of the emulator
+        uint8_t* mem;
+
+        //4 GB guest view, plus a guard so that accesses near the top of the address space still fault
+        uint8_t* base;
+
+        int64_t get_offset(uint8_t* ptr) const;
+        void map_range(uint32_t first_page, uint32_t count, int64_t offset);
+    public:
+        EEFastmem();
+        ~EEFastmem();
+
+        bool init();
+        bool is_active() const;
+
+        uint8_t* get_base() const;
+        uint8_t* get_RDRAM() const;
+        uint8_t* get_BIOS() const;
+        uint8_t* get_scratchpad() const;
+
+        void map_pages(uint8_t** vtlb, uint32_t first_page, uint32_t count);
+
+        static void set_fault_handler(FaultHandler handler);
+};
+
+inline bool EEFastmem::is_active() const
+{
+    return base != nullptr;
+}
+
+inline uint8_t* EEFastmem::get_base() const
+{
+    return base;
+}
+
+inline uint8_t* EEFastmem::get_RDRAM() const
+{
+    return mem + RDRAM_OFFSET;
+}
+
+inline uint8_t* EEFastmem::get_BIOS() const
+{
+    return mem + BIOS_OFFSET;
+}
+
+inline uint8_t* EEFastmem::get_scratchpad() const
+{
+    return mem + SPR_OFFSET;
+}
+
+#endif // EE_FASTMEM_HPP
@@ -1,5 +1,6 @@
 #include "ee_jit.hpp"
 #include "ee_jit64.hpp"
+#include "ee_fastmem.hpp"
 #include "emotion.hpp"
 
 #include "ee_jittrans.hpp"
@@ -13,6 +14,11 @@ namespace EE_JIT
 
     EE_JIT64 jit64;
 
+    static bool handle_fastmem_fault(uint8_t*& pc)
+    {
+        return jit64.handle_fastmem_fault(pc);
+    }
+
     uint16_t run(EmotionEngine *ee)
     {
         return jit64.run(*ee);
@@ -20,6 +26,7 @@ namespace EE_JIT
 
     void reset(bool clear_cache)
     {
+        EEFastmem::set_fault_handler(handle_fastmem_fault);
         jit64.reset(clear_cache);
     }
     /*
@@ -32,8 +32,9 @@
  * https://en.wikipedia.org/wiki/X86_calling_conventions#x86-64_calling_conventions
  */
 
-EE_JIT64::EE_JIT64() : jit_block("EE"), emitter(&jit_block), prologue_block(nullptr)
+EE_JIT64::EE_JIT64() : jit_block("EE"), emitter(&jit_block), prologue_block(nullptr), fastmem_base(nullptr)
 {
+    use_avx = Emitter64::host_has_avx();
 }
 
 void EE_JIT64::reset(bool clear_cache)
@@ -116,9 +117,21 @@ uint16_t EE_JIT64::run(EmotionEngine& ee)
     return cycle_count;
 }
 
+//Called from the SIGSEGV handler when recompiled code touches an inaccessible page of the fastmem arena
+bool EE_JIT64::handle_fastmem_fault(uint8_t*& pc)
+{
+    uint8_t* slow_path = jit_heap.patch_fastmem_site(pc);
+    if (!slow_path)
+        return false;
+
+    pc = slow_path;
+    return true;
+}
+
 EEJitPrologue EE_JIT64::create_prologue_block()
 {
     jit_block.clear();
+    clear_block_exits();
 
     emit_prologue();
 
@@ -142,11 +155,63 @@ EEJitPrologue EE_JIT64::create_prologue_block()
 
 void EE_JIT64::emit_dispatcher()
 {
+    //Returns pop the return stack even when we are about to exit, so that it stays balanced.
+    //RDX = code of the predicted block, or 0 on a misprediction.
+    if (exit_returns)
+    {
+        emitter.load_addr((uint64_t)&jit_heap.return_stack, REG_64::RDX);
+        emitter.MOV32_FROM_MEM(REG_64::RDX, REG_64::RAX, offsetof(EEReturnStack, top));
+        emitter.MOV32_REG(REG_64::RAX, REG_64::RCX);
+        emitter.DEC32(REG_64::RCX);
+        emitter.AND32_REG_IMM(EEReturnStack::SIZE - 1, REG_64::RCX);
+        emitter.MOV32_TO_MEM(REG_64::RCX, REG_64::RDX, offsetof(EEReturnStack, top));
+        emitter.SHL32_REG_IMM(4, REG_64::RAX);
+        emitter.ADD64_REG(REG_64::RAX, REG_64::RDX);
+
+        emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RCX, offsetof(EmotionEngine, PC));
+        emitter.MOV32_FROM_MEM(REG_64::RDX, REG_64::RAX, offsetof(EEReturnStack::Entry, pc));
+        emitter.MOV64_FROM_MEM(REG_64::RDX, REG_64::RDX, offsetof(EEReturnStack::Entry, code));
+        emitter.CMP32_REG(REG_64::RCX, REG_64::RAX);
+        uint8_t* predicted = emitter.JCC_NEAR_DEFERRED(ConditionCode::E);
+        emitter.XOR32_REG(REG_64::RDX, REG_64::RDX);
+        emitter.set_jump_dest(predicted);
+    }
+
     //Check if cycles_to_run > 0 and VU0 wait and check interlock is false. When both are true, we execute another block.
     //Otherwise, we return.
     emitter.CMP32_IMM_MEM(0, REG_64::R15, offsetof(EmotionEngine, cycles_to_run));
     uint8_t* exit_cyclecount = emitter.JCC_NEAR_DEFERRED(ConditionCode::LE);
 
+    if (exit_returns)
+    {
+        emitter.CMP64_IMM(0, REG_64::RDX);
+        uint8_t* mispredicted = emitter.JCC_NEAR_DEFERRED(ConditionCode::E);
+        emitter.JMP_INDIR(REG_64::RDX);
+        emitter.set_jump_dest(mispredicted);
+    }
+
+    //Static exits are linked to their target block once it has been recompiled.
+    //Until then, the JMP falls through to the next test.
+    if (exit_targets.size())
+    {
+        emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RCX, offsetof(EmotionEngine, PC));
+        for (uint32_t target : exit_targets)
+        {
+            emitter.CMP32_IMM(target, REG_64::RCX);
+            uint8_t* next_exit = emitter.JCC_NEAR_DEFERRED(ConditionCode::NE);
+
+            EEBlockLink link;
+            link.target = target;
+            link.offset = emitter.JMP_NEAR_DEFERRED() - jit_block.get_code_start();
+            link.fallback = jit_block.get_code_pos() - jit_block.get_code_start();
+            link.absolute = false;
+            block_links.push_back(link);
+            emitter.set_jump_dest(jit_block.get_code_start() + link.offset);
+
+            emitter.set_jump_dest(next_exit);
+        }
+    }
+
     //Fetch pointer to index in cache
     //ptr = lookup_cache[(PC >> 2) & 0x7FFF]
     //lookup_cache is an array of size 8 elements, so we can skip shifting PC to the right
@@ -212,8 +277,11 @@ EEJitBlockRecord* EE_JIT64::recompile_block(EmotionEngine& ee, IR::Block& block)
     likely_branch = false;
     saved_int_regs = std::vector<REG_64>();
     saved_xmm_regs = std::vector<REG_64>();
+    fastmem_base = ee.cp0->get_fastmem_base();
+    fastmem_sites.clear();
 
     jit_block.clear();
+    clear_block_exits();
 
     //Create new stack frame
     emitter.PUSH(REG_64::RBP);
@@ -238,11 +306,14 @@ EEJitBlockRecord* EE_JIT64::recompile_block(EmotionEngine& ee, IR::Block& block)
     else
         cleanup_recompiler(ee, true, true, block.get_cycle_count());
 
-    return jit_heap.insert_block(ee.get_PC(), &jit_block);
+    return jit_heap.insert_block(ee.get_PC(), &jit_block, fastmem_sites, block_links);
 }
 
 void EE_JIT64::emit_instruction(EmotionEngine &ee, IR::Instruction &instr)
 {
+    if (instr.is_jump())
+        add_block_exits(instr);
+
     switch (instr.op)
     {
         case IR::Opcode::Null:
@@ -368,10 +439,16 @@ void EE_JIT64::emit_instruction(EmotionEngine &ee, IR::Instruction &instr)
             floating_point_divide(ee, instr);
             break;
         case IR::Opcode::FloatingPointMaximum:
-            floating_point_maximum(ee, instr);
+            if (use_avx)
+                floating_point_maximum_AVX(ee, instr);
+            else
+                floating_point_maximum(ee, instr);
             break;
         case IR::Opcode::FloatingPointMinimum:
-            floating_point_minimum(ee, instr);
+            if (use_avx)
+                floating_point_minimum_AVX(ee, instr);
+            else
+                floating_point_minimum(ee, instr);
             break;
         case IR::Opcode::FloatingPointMultiply:
             floating_point_multiply(ee, instr);
@@ -933,6 +1010,69 @@ void EE_JIT64::call_abi_func(uint64_t addr)
     abi_xmm_count = 0;
 }
 
+/**
+ * Fastmem accesses are laid out as follows:
+ *
+ * patch:     mov rax, fastmem_base
+ *            add rax, addr
+ * fault:     <access [rax]>
+ *            jmp done
+ * slow_path: <regular call to the EE read/write function>
+ * done:
+ *
+ * Accesses to MMIO or unmapped pages fault, and the fault handler overwrites patch with a jump to slow_path.
+ * Both paths must leave the register allocator in the same state, which is what end_fastmem_slow_path takes
+ * care of.
+ */
+bool EE_JIT64::begin_fastmem(REG_64 addr)
+{
+    if (!fastmem_base)
+        return false;
+
+    cur_fastmem_site.patch = jit_block.get_code_pos() - jit_block.get_code_start();
+    emitter.MOV64_OI((uint64_t)fastmem_base, REG_64::RAX);
+    emitter.ADD64_REG(addr, REG_64::RAX);
+    cur_fastmem_site.fault = jit_block.get_code_pos() - jit_block.get_code_start();
+    return true;
+}
+
+// Mirrors the set_tlb_modified call made by EE writes. Clobbers addr.
+void EE_JIT64::set_fastmem_modified(EmotionEngine& ee, REG_64 addr)
+{
+    emitter.SHR32_REG_IMM(12, addr);
+    emitter.MOV64_OI((uint64_t)&ee.cp0->vtlb_info[0].modified, REG_64::RAX);
+    static_assert(sizeof(VTLB_Info) == 2, "VTLB_Info is indexed with a scale of 2");
+    emitter.LEA64_REG(addr, REG_64::RAX, REG_64::RAX, 0, 1);
+    emitter.MOV8_IMM_MEM(1, REG_64::RAX);
+}
+
+void EE_JIT64::begin_fastmem_slow_path()
+{
+    fastmem_done = emitter.JMP_NEAR_DEFERRED();
+    cur_fastmem_site.slow_path = jit_block.get_code_pos() - jit_block.get_code_start();
+    fastmem_sites.push_back(cur_fastmem_site);
+
+    for (int i = 0; i < 16; i++)
+        fastmem_xmm_stored[i] = xmm_regs[i].stored;
+}
+
+void EE_JIT64::end_fastmem_slow_path()
+{
+    // The call spilled XMM registers that the fast path left alone. Reload them so both paths agree.
+    for (int i = 0; i < 16; i++)
+    {
+        if (xmm_regs[i].stored && !fastmem_xmm_stored[i])
+        {
+            // Note: The 0xA0 here is the xmm register array offset noted in recompile_block
+            // TODO: Store 0xA0 in some sort of constant
+            emitter.MOVAPS_FROM_MEM(REG_64::RSP, (REG_64)i, 0xA0 + i * 16);
+            xmm_regs[i].stored = false;
+        }
+    }
+
+    emitter.set_jump_dest(fastmem_done);
+}
+
 // Explicitly restore XMM registers when they are stored on the stack
 void EE_JIT64::restore_xmm_regs(const std::vector<REG_64>& regs, bool restore_values)
 {
@@ -1551,6 +1691,63 @@ void EE_JIT64::cleanup_recompiler(EmotionEngine& ee, bool clear_regs, bool dispa
         emit_epilogue();
 }
 
+void EE_JIT64::clear_block_exits()
+{
+    exit_targets.clear();
+    block_links.clear();
+    exit_returns = false;
+}
+
+void EE_JIT64::add_block_exits(IR::Instruction& instr)
+{
+    if (instr.op == IR::Opcode::JumpIndirect)
+    {
+        exit_returns |= !instr.get_is_link() && instr.get_source() == EE_NormalReg::ra;
+        return;
+    }
+
+    //Conditional branches may also fall through to the instruction after the delay slot
+    uint32_t targets[] = { instr.get_jump_dest(), instr.get_jump_fail_dest() };
+    for (uint32_t target : targets)
+    {
+        if (!target)
+            continue;
+        if (std::find(exit_targets.begin(), exit_targets.end(), target) == exit_targets.end())
+            exit_targets.push_back(target);
+    }
+}
+
+/**
+ * Emitted by calls. Pushes the return address onto the return stack together with the code of the block there,
+ * which is a link that gets filled in once that block is recompiled.
+ */
+void EE_JIT64::push_return_stack(EmotionEngine& ee, uint32_t return_addr)
+{
+    REG_64 entry = lalloc_int_reg(ee, 0, REG_TYPE::INTSCRATCHPAD, REG_STATE::SCRATCHPAD);
+    REG_64 code = lalloc_int_reg(ee, 0, REG_TYPE::INTSCRATCHPAD, REG_STATE::SCRATCHPAD);
+
+    emitter.load_addr((uint64_t)&jit_heap.return_stack, REG_64::RAX);
+    emitter.MOV32_FROM_MEM(REG_64::RAX, entry, offsetof(EEReturnStack, top));
+    emitter.ADD32_REG_IMM(1, entry);
+    emitter.AND32_REG_IMM(EEReturnStack::SIZE - 1, entry);
+    emitter.MOV32_TO_MEM(entry, REG_64::RAX, offsetof(EEReturnStack, top));
+    emitter.SHL32_REG_IMM(4, entry);
+    emitter.ADD64_REG(entry, REG_64::RAX);
+    emitter.MOV32_IMM_MEM(return_addr, REG_64::RAX, offsetof(EEReturnStack::Entry, pc));
+
+    emitter.MOV64_OI(0, code);
+    EEBlockLink link;
+    link.target = return_addr;
+    link.offset = jit_block.get_code_pos() - jit_block.get_code_start() - sizeof(uint64_t);
+    link.fallback = 0;
+    link.absolute = true;
+    block_links.push_back(link);
+    emitter.MOV64_TO_MEM(code, REG_64::RAX, offsetof(EEReturnStack::Entry, code));
+
+    free_int_reg(ee, entry);
+    free_int_reg(ee, code);
+}
+
 void EE_JIT64::emit_prologue()
 {
     emitter.PUSH(REG_64::RBX);
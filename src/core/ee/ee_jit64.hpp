@@ -92,6 +92,22 @@ private:
 
     bool should_update_mac;
 
+    //Chosen once at startup from CPUID
+    bool use_avx;
+
+    //Base of the EE fastmem arena, or nullptr when every access goes through the EE
+    uint8_t* fastmem_base;
+    std::vector<EEFastmemSite> fastmem_sites;
+    EEFastmemSite cur_fastmem_site;
+    uint8_t* fastmem_done;
+    bool fastmem_xmm_stored[16];
+
+    //Exits of the block being recompiled. Dispatchers test the PC against exit_targets and jump through
+    //patchable links, and a block that returns through $ra first checks the return stack.
+    std::vector<uint32_t> exit_targets;
+    std::vector<EEBlockLink> block_links;
+    bool exit_returns;
+
     //Pointer to the dispatcher prologue that begins execution of recompiled code
     EEJitPrologue prologue_block;
 
@@ -287,6 +303,17 @@ private:
     void restore_int_regs(const std::vector<REG_64>& regs, bool restore_values = true);
     void restore_xmm_regs(const std::vector<REG_64>& regs, bool restore_values = true);
 
+    // Fastmem
+    bool begin_fastmem(REG_64 addr);
+    void set_fastmem_modified(EmotionEngine& ee, REG_64 addr);
+    void begin_fastmem_slow_path();
+    void end_fastmem_slow_path();
+
+    // Block linking
+    void clear_block_exits();
+    void add_block_exits(IR::Instruction& instr);
+    void push_return_stack(EmotionEngine& ee, uint32_t return_addr);
+
     // Register alloc
     int search_for_register_priority(AllocReg *regs);
     int search_for_register_scratchpad(AllocReg *regs);
@@ -322,6 +349,7 @@ public:
 
     void reset(bool clear_cache = true);
     uint16_t run(EmotionEngine& ee);
+    bool handle_fastmem_fault(uint8_t*& pc);
 
     friend uint8_t* exec_block_ee(EE_JIT64& jit, EmotionEngine& ee);
 };
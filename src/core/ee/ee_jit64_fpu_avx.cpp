@@ -2,18 +2,28 @@
 #include <algorithm>
 #include "ee_jit64.hpp"
 
+//The integer compares match how the EE orders floats (no NaNs or denormals).
+//If both values are negative their sign bits are set in the mask and the integer result is flipped
 void EE_JIT64::floating_point_minimum_AVX(EmotionEngine& ee, IR::Instruction& instr)
 {
     REG_64 source = alloc_reg(ee, instr.get_source(), REG_TYPE::FPU, REG_STATE::READ);
     REG_64 source2 = alloc_reg(ee, instr.get_source2(), REG_TYPE::FPU, REG_STATE::READ);
     REG_64 dest = alloc_reg(ee, instr.get_dest(), REG_TYPE::FPU, REG_STATE::WRITE);
+    REG_64 mask = lalloc_xmm_reg(ee, 0, REG_TYPE::XMMSCRATCHPAD, REG_STATE::SCRATCHPAD);
+    REG_64 temp = lalloc_xmm_reg(ee, 0, REG_TYPE::XMMSCRATCHPAD, REG_STATE::SCRATCHPAD);
 
     emitter.load_addr((uint64_t)&ee.fpu->control.u, REG_64::RAX);
     emitter.MOV8_IMM_MEM(false, REG_64::RAX);
     emitter.load_addr((uint64_t)&ee.fpu->control.o, REG_64::RAX);
     emitter.MOV8_IMM_MEM(false, REG_64::RAX);
 
-    emitter.VMINPS(source, source2, dest);
+    emitter.VPAND(source, source2, mask);
+    emitter.VPMAXSD(source, source2, temp);
+    emitter.VPMINSD(source, source2, dest);
+    emitter.VBLENDVPS(mask, dest, temp, dest);
+
+    free_xmm_reg(ee, mask);
+    free_xmm_reg(ee, temp);
 }
 
 void EE_JIT64::floating_point_maximum_AVX(EmotionEngine& ee, IR::Instruction& instr)
@@ -21,11 +31,19 @@ void EE_JIT64::floating_point_maximum_AVX(EmotionEngine& ee, IR::Instruction& in
     REG_64 source = alloc_reg(ee, instr.get_source(), REG_TYPE::FPU, REG_STATE::READ);
     REG_64 source2 = alloc_reg(ee, instr.get_source2(), REG_TYPE::FPU, REG_STATE::READ);
     REG_64 dest = alloc_reg(ee, instr.get_dest(), REG_TYPE::FPU, REG_STATE::WRITE);
+    REG_64 mask = lalloc_xmm_reg(ee, 0, REG_TYPE::XMMSCRATCHPAD, REG_STATE::SCRATCHPAD);
+    REG_64 temp = lalloc_xmm_reg(ee, 0, REG_TYPE::XMMSCRATCHPAD, REG_STATE::SCRATCHPAD);
 
     emitter.load_addr((uint64_t)&ee.fpu->control.u, REG_64::RAX);
     emitter.MOV8_IMM_MEM(false, REG_64::RAX);
     emitter.load_addr((uint64_t)&ee.fpu->control.o, REG_64::RAX);
     emitter.MOV8_IMM_MEM(false, REG_64::RAX);
 
-    emitter.VMAXPS(source, source2, dest);
-}
\ No newline at end of file
+    emitter.VPAND(source, source2, mask);
+    emitter.VPMINSD(source, source2, temp);
+    emitter.VPMAXSD(source, source2, dest);
+    emitter.VBLENDVPS(mask, dest, temp, dest);
+
+    free_xmm_reg(ee, mask);
+    free_xmm_reg(ee, temp);
+}
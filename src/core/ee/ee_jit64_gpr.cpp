@@ -225,6 +225,7 @@ void EE_JIT64::branch_greater_than_or_equal_zero(EmotionEngine& ee, IR::Instruct
         // Set the link register
         REG_64 link = alloc_reg(ee, EE_NormalReg::ra, REG_TYPE::GPR, REG_STATE::WRITE);
         emitter.MOV32_REG_IMM(instr.get_return_addr(), link);
+        push_return_stack(ee, instr.get_return_addr());
     }
 
     // Conditionally move the success or failure destination into ee.PC
@@ -316,6 +317,7 @@ void EE_JIT64::branch_less_than_zero(EmotionEngine& ee, IR::Instruction &instr)
         // Set the link register
         REG_64 link = alloc_reg(ee, EE_NormalReg::ra, REG_TYPE::GPR, REG_STATE::WRITE);
         emitter.MOV32_REG_IMM(instr.get_return_addr(), link);
+        push_return_stack(ee, instr.get_return_addr());
     }
 
     // Conditionally move the success or failure destination into ee.PC
@@ -639,6 +641,7 @@ void EE_JIT64::jump(EmotionEngine& ee, IR::Instruction& instr)
         // Set the link register
         REG_64 link = alloc_reg(ee, EE_NormalReg::ra, REG_TYPE::GPR, REG_STATE::WRITE);
         emitter.MOV32_REG_IMM(instr.get_return_addr(), link);
+        push_return_stack(ee, instr.get_return_addr());
     }
 }
 
@@ -654,6 +657,7 @@ void EE_JIT64::jump_indirect(EmotionEngine& ee, IR::Instruction& instr)
         // Set the link register
         REG_64 link = alloc_reg(ee, instr.get_dest(), REG_TYPE::GPR, REG_STATE::WRITE);
         emitter.MOV32_REG_IMM(instr.get_return_addr(), link);
+        push_return_stack(ee, instr.get_return_addr());
     }
 }
 
@@ -669,10 +673,19 @@ void EE_JIT64::load_byte(EmotionEngine& ee, IR::Instruction &instr)
         emitter.LEA32_M(source, addr, offset);
     else
         emitter.MOV32_REG(source, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV8_FROM_MEM(REG_64::RAX, REG_64::RAX);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_read8);
+    if (fastmem)
+        end_fastmem_slow_path();
 
     emitter.MOVSX8_TO_64(REG_64::RAX, dest);
 }
@@ -689,10 +702,19 @@ void EE_JIT64::load_byte_unsigned(EmotionEngine& ee, IR::Instruction &instr)
         emitter.LEA32_M(source, addr, offset);
     else
         emitter.MOV32_REG(source, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV8_FROM_MEM(REG_64::RAX, REG_64::RAX);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_read8);
+    if (fastmem)
+        end_fastmem_slow_path();
 
     emitter.MOVZX8_TO_64(REG_64::RAX, dest);
 }
@@ -709,10 +731,19 @@ void EE_JIT64::load_doubleword(EmotionEngine& ee, IR::Instruction &instr)
         emitter.LEA32_M(source, addr, offset);
     else
         emitter.MOV32_REG(source, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV64_FROM_MEM(REG_64::RAX, REG_64::RAX);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_read64);
+    if (fastmem)
+        end_fastmem_slow_path();
 
     emitter.MOV64_MR(REG_64::RAX, dest);
 }
@@ -802,10 +833,19 @@ void EE_JIT64::load_halfword(EmotionEngine& ee, IR::Instruction &instr)
         emitter.LEA32_M(source, addr, offset);
     else
         emitter.MOV32_REG(source, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV16_FROM_MEM(REG_64::RAX, REG_64::RAX);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_read16);
+    if (fastmem)
+        end_fastmem_slow_path();
 
     emitter.MOVSX16_TO_64(REG_64::RAX, dest);
 }
@@ -822,10 +862,19 @@ void EE_JIT64::load_halfword_unsigned(EmotionEngine& ee, IR::Instruction &instr)
         emitter.LEA32_M(source, addr, offset);
     else
         emitter.MOV32_REG(source, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV16_FROM_MEM(REG_64::RAX, REG_64::RAX);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_read16);
+    if (fastmem)
+        end_fastmem_slow_path();
 
     emitter.MOVZX16_TO_64(REG_64::RAX, dest);
 }
@@ -851,10 +900,19 @@ void EE_JIT64::load_word(EmotionEngine& ee, IR::Instruction &instr)
         emitter.LEA32_M(source, addr, offset);
     else
         emitter.MOV32_REG(source, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV32_FROM_MEM(REG_64::RAX, REG_64::RAX);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_read32);
+    if (fastmem)
+        end_fastmem_slow_path();
 
     emitter.MOVSX32_TO_64(REG_64::RAX, dest);
 }
@@ -946,10 +1004,19 @@ void EE_JIT64::load_word_unsigned(EmotionEngine& ee, IR::Instruction &instr)
         emitter.LEA32_M(source, addr, offset);
     else
         emitter.MOV32_REG(source, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV32_FROM_MEM(REG_64::RAX, REG_64::RAX);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_read32);
+    if (fastmem)
+        end_fastmem_slow_path();
 
 
     emitter.MOV32_REG(REG_64::RAX, dest);
@@ -969,6 +1036,13 @@ void EE_JIT64::load_quadword(EmotionEngine& ee, IR::Instruction &instr)
         emitter.MOV32_REG(source, addr);
     emitter.AND32_REG_IMM(0xFFFFFFF0, addr);
 
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOVAPS_FROM_MEM(REG_64::RAX, dest);
+        begin_fastmem_slow_path();
+    }
+
     // Due to differences in how the uint128_t struct is returned on different platforms,
     // we simply allocate space for it on the stack, which the wrapper function will store the
     // result into.
@@ -982,6 +1056,8 @@ void EE_JIT64::load_quadword(EmotionEngine& ee, IR::Instruction &instr)
     restore_xmm_regs(std::vector<REG_64> {dest}, false);
 
     emitter.MOVAPS_FROM_MEM(REG_64::RSP, dest, 0x1A0);
+    if (fastmem)
+        end_fastmem_slow_path();
 }
 
 void EE_JIT64::move_conditional_on_not_zero(EmotionEngine& ee, IR::Instruction& instr)
@@ -1353,11 +1429,21 @@ void EE_JIT64::store_byte(EmotionEngine& ee, IR::Instruction& instr)
         emitter.LEA32_M(dest, addr, offset);
     else
         emitter.MOV32_REG(dest, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV8_TO_MEM(source, REG_64::RAX);
+        set_fastmem_modified(ee, addr);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     prepare_abi_reg(source);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_write8);
+    if (fastmem)
+        end_fastmem_slow_path();
 }
 
 void EE_JIT64::store_doubleword(EmotionEngine& ee, IR::Instruction& instr)
@@ -1371,11 +1457,21 @@ void EE_JIT64::store_doubleword(EmotionEngine& ee, IR::Instruction& instr)
         emitter.LEA32_M(dest, addr, offset);
     else
         emitter.MOV32_REG(dest, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV64_TO_MEM(source, REG_64::RAX);
+        set_fastmem_modified(ee, addr);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     prepare_abi_reg(source);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_write64);
+    if (fastmem)
+        end_fastmem_slow_path();
 }
 
 void EE_JIT64::store_doubleword_left(EmotionEngine& ee, IR::Instruction& instr)
@@ -1480,11 +1576,21 @@ void EE_JIT64::store_halfword(EmotionEngine& ee, IR::Instruction& instr)
         emitter.LEA32_M(dest, addr, offset);
     else
         emitter.MOV32_REG(dest, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV16_TO_MEM(source, REG_64::RAX);
+        set_fastmem_modified(ee, addr);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     prepare_abi_reg(source);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_write16);
+    if (fastmem)
+        end_fastmem_slow_path();
 }
 
 void EE_JIT64::store_word(EmotionEngine& ee, IR::Instruction& instr)
@@ -1498,11 +1604,21 @@ void EE_JIT64::store_word(EmotionEngine& ee, IR::Instruction& instr)
         emitter.LEA32_M(dest, addr, offset);
     else
         emitter.MOV32_REG(dest, addr);
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOV32_TO_MEM(source, REG_64::RAX);
+        set_fastmem_modified(ee, addr);
+        begin_fastmem_slow_path();
+    }
+
     prepare_abi((uint64_t)&ee);
     prepare_abi_reg(addr);
     prepare_abi_reg(source);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_write32);
+    if (fastmem)
+        end_fastmem_slow_path();
 }
 
 void EE_JIT64::store_word_left(EmotionEngine& ee, IR::Instruction& instr)
@@ -1609,6 +1725,14 @@ void EE_JIT64::store_quadword(EmotionEngine& ee, IR::Instruction &instr)
         emitter.MOV32_REG(dest, addr);
     emitter.AND32_REG_IMM(0xFFFFFFF0, addr);
 
+    bool fastmem = begin_fastmem(addr);
+    if (fastmem)
+    {
+        emitter.MOVAPS_TO_MEM(source, REG_64::RAX);
+        set_fastmem_modified(ee, addr);
+        begin_fastmem_slow_path();
+    }
+
     // Due to differences in how the uint128_t struct is passed as an argument on different platforms,
     // we simply allocate space for it on the stack and pass a pointer to our wrapper function.
     // Note: The 0x1A0 here is the SQ/LQ uint128_t offset noted in recompile_block
@@ -1619,6 +1743,8 @@ void EE_JIT64::store_quadword(EmotionEngine& ee, IR::Instruction &instr)
     prepare_abi_reg(REG_64::RSP, 0x1A0);
     free_int_reg(ee, addr);
     call_abi_func((uint64_t)ee_write128);
+    if (fastmem)
+        end_fastmem_slow_path();
 }
 
 void EE_JIT64::sub_doubleword_reg(EmotionEngine& ee, IR::Instruction &instr)
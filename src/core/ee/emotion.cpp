@@ -222,6 +222,110 @@ void EmotionEngine::run_interpreter()
     }
 }
 
+/**
+ * Same as run_interpreter, except that instructions come pre-decoded from block_cache instead of going through
+ * EmotionInterpreter::lookup every time they execute.
+ * Execution stays on a block for as long as PC keeps pointing at its next instruction; branches, exceptions,
+ * and the NOP pairing skip are all handled by looking up the block at the new PC.
+ */
+void EmotionEngine::run_cached_interpreter()
+{
+    //FlushCache(2) invalidates the icache, which also covers any code that was DMAed in
+    if (flush_jit_cache)
+    {
+        block_cache.flush();
+        flush_jit_cache = false;
+    }
+
+    EE_CachedBlock* block = nullptr;
+    size_t index = 0;
+    while (cycles_to_run > 0)
+    {
+        cycles_to_run--;
+        cycle_count++;
+
+        if (!block || block->pc + (index * 4) != PC || (index == block->instrs.size() && block->complete))
+        {
+            block = get_cached_block();
+            index = 0;
+        }
+
+        if (index == block->instrs.size())
+            block_cache.decode_next(*block);
+
+        EE_CachedInstr instr = block->instrs[index];
+        index++;
+
+        fetch_instr(PC);
+        uint32_t lastPC = PC;
+
+        if (can_disassemble)
+        {
+            std::string disasm = EmotionDisasm::disasm_instr(instr.instruction, PC);
+            printf("[$%08X] $%08X - %s\n", PC, instr.instruction, disasm.c_str());
+        }
+
+        instr.interpreter_fn(*this, instr.instruction);
+        set_PC(get_PC() + 4);
+
+        //Simulate dual-issue if both instructions are NOPs
+        if (!instr.instruction)
+        {
+            if (index < block->instrs.size() && block->pc + (index * 4) == PC)
+            {
+                if (!block->instrs[index].instruction)
+                {
+                    set_PC(get_PC() + 4);
+                    index++;
+                }
+            }
+            else if (!read32(PC))
+                set_PC(get_PC() + 4);
+        }
+
+        if (branch_on)
+        {
+            if (!delay_slot)
+            {
+                //If the PC == LastPC it means we've reversed it to handle COP2 sync, so don't branch yet
+                if (PC != lastPC)
+                {
+                    branch_on = false;
+                    if (!new_PC || (new_PC & 0x3))
+                    {
+                        Errors::die("[EE] Jump to invalid address $%08X from $%08X\n", new_PC, PC - 8);
+                    }
+                    set_PC(new_PC);
+                }
+            }
+            else
+                delay_slot--;
+        }
+    }
+}
+
+//Finds the decoded block at PC, throwing out the page's blocks first if the EE has written to it
+EE_CachedBlock* EmotionEngine::get_cached_block()
+{
+    uint32_t page = PC / 4096;
+    uint8_t* mem = tlb_map[page];
+    if (mem <= (uint8_t*)1)
+        Errors::die("[EE] Instruction read from invalid address $%08X, PC: $%08X", PC, PC);
+
+    if (cp0->get_tlb_modified(page))
+    {
+        block_cache.invalidate_page(page);
+        cp0->clear_tlb_modified(page);
+    }
+
+    return block_cache.find_block(PC, mem);
+}
+
+void EmotionEngine::flush_block_cache()
+{
+    block_cache.flush();
+}
+
 void EmotionEngine::run_jit()
 {
     //If FlushCache(2) has been executed, reset the JIT.
@@ -365,7 +469,8 @@ VectorUnit& EmotionEngine::get_VU0()
     return *vu0;
 }
 
-uint32_t EmotionEngine::read_instr(uint32_t address)
+//Charges the cycles of an instruction fetch, going through the icache where applicable
+void EmotionEngine::fetch_instr(uint32_t address)
 {
     if (cp0->is_cached(address))
     {
@@ -414,6 +519,12 @@ uint32_t EmotionEngine::read_instr(uint32_t address)
         //However, the EE loads two instructions at once. Since we only load a word, we divide the cycles in half.
         cycles_to_run -= 16;
     }
+}
+
+uint32_t EmotionEngine::read_instr(uint32_t address)
+{
+    fetch_instr(address);
+
     uint8_t* mem = tlb_map[address / 4096];
     if (mem > (uint8_t*)1)
         return *(uint32_t*)&mem[address & 4095];
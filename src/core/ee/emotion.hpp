@@ -6,6 +6,7 @@
 #include <list>
 #include "cop0.hpp"
 #include "cop1.hpp"
+#include "emotionblockcache.hpp"
 
 #include "../int128.hpp"
 
@@ -99,6 +100,9 @@ class EmotionEngine
 
         std::function<void(EmotionEngine&)> run_func;
 
+        EmotionBlockCache block_cache;
+        EE_CachedBlock* get_cached_block();
+
         uint32_t get_paddr(uint32_t vaddr);
         void handle_exception(uint32_t new_addr, uint8_t code);
         void deci2call(uint32_t func, uint32_t param);
@@ -112,7 +116,9 @@ class EmotionEngine
         void init_tlb();
         void run(int cycles);
         void run_interpreter();
+        void run_cached_interpreter();
         void run_jit();
+        void flush_block_cache();
         uint64_t get_cycle_count();
         uint64_t get_cycle_count_goal();
         void set_cycle_count(uint64_t value);
@@ -139,6 +145,7 @@ class EmotionEngine
         void clear_interlock();
         bool vu0_wait();
 
+        void fetch_instr(uint32_t address);
         uint32_t read_instr(uint32_t address);
 
         uint8_t read8(uint32_t address);
@@ -0,0 +1,88 @@
+#include <cstring>
+#include "emotionblockcache.hpp"
+#include "emotioninterpreter.hpp"
+#include "../errors.hpp"
+
+static void invalid_instr(EmotionEngine& cpu, uint32_t instruction)
+{
+    Errors::die("[EE Interpreter] Lookup returned nullptr interpreter_fn");
+}
+
+EmotionBlockCache::EmotionBlockCache()
+{
+    memset(lookup_cache, 0, sizeof(lookup_cache));
+}
+
+/**
+ * Returns the block starting at pc, creating an empty one if it hasn't been seen before or if the page
+ * has been remapped since it was decoded.
+ */
+EE_CachedBlock* EmotionBlockCache::find_block(uint32_t pc, uint8_t* mem)
+{
+    EE_CachedBlock*& cache_entry = lookup_cache[(pc >> 2) & (LOOKUP_CACHE_SIZE - 1)];
+    if (cache_entry && cache_entry->pc == pc && cache_entry->mem == mem)
+        return cache_entry;
+
+    auto result = blocks.emplace(pc, EE_CachedBlock());
+    EE_CachedBlock& block = result.first->second;
+    if (result.second)
+        page_blocks[pc / 4096].push_back(pc);
+
+    if (result.second || block.mem != mem)
+    {
+        block.pc = pc;
+        block.mem = mem;
+        block.complete = false;
+        block.branch_delay = false;
+        block.instrs.clear();
+    }
+
+    cache_entry = &block;
+    return &block;
+}
+
+/**
+ * Decodes the instruction following the last one in the block.
+ */
+void EmotionBlockCache::decode_next(EE_CachedBlock& block)
+{
+    uint32_t addr = block.pc + (block.instrs.size() * 4);
+    uint32_t instruction = *(uint32_t*)&block.mem[addr & 4095];
+
+    EE_InstrInfo info;
+    EmotionInterpreter::lookup(info, instruction);
+
+    //Defer the error until the instruction actually runs, like the regular interpreter
+    if (!info.interpreter_fn)
+        info.interpreter_fn = &invalid_instr;
+
+    block.instrs.push_back({ info.interpreter_fn, instruction });
+
+    if (block.branch_delay || (addr & 4095) == 4092 || block.instrs.size() == MAX_BLOCK_SIZE)
+        block.complete = true;
+    else if ((uint16_t)info.pipeline & (uint16_t)EE_InstrInfo::Pipeline::Branch)
+        block.branch_delay = true;
+}
+
+void EmotionBlockCache::invalidate_page(uint32_t page)
+{
+    auto kv = page_blocks.find(page);
+    if (kv == page_blocks.end())
+        return;
+
+    for (uint32_t pc : kv->second)
+    {
+        EE_CachedBlock*& cache_entry = lookup_cache[(pc >> 2) & (LOOKUP_CACHE_SIZE - 1)];
+        if (cache_entry && cache_entry->pc == pc)
+            cache_entry = nullptr;
+        blocks.erase(pc);
+    }
+    page_blocks.erase(kv);
+}
+
+void EmotionBlockCache::flush()
+{
+    memset(lookup_cache, 0, sizeof(lookup_cache));
+    blocks.clear();
+    page_blocks.clear();
+}
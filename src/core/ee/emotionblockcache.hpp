@@ -0,0 +1,55 @@
+#ifndef EMOTIONBLOCKCACHE_HPP
+#define EMOTIONBLOCKCACHE_HPP
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class EmotionEngine;
+
+struct EE_CachedInstr
+{
+    void(*interpreter_fn)(EmotionEngine&, uint32_t);
+    uint32_t instruction;
+};
+
+/**
+ * A run of instructions decoded by the cached interpreter, starting at pc and ending after a branch delay slot
+ * or at the end of the page.
+ * Instructions are decoded the first time they execute, so that data following a block is never looked up.
+ */
+struct EE_CachedBlock
+{
+    uint32_t pc;
+
+    //Host page the block was decoded from. A different mapping at pc means the block is stale.
+    uint8_t* mem;
+
+    bool complete;
+    bool branch_delay;
+    std::vector<EE_CachedInstr> instrs;
+};
+
+/**
+ * Decoded instructions for EmotionEngine::run_cached_interpreter, keyed by PC.
+ * Blocks never cross a page, so a page can be thrown out with all of its blocks when the EE writes to it.
+ */
+class EmotionBlockCache
+{
+    private:
+        constexpr static int LOOKUP_CACHE_SIZE = 1024 * 16;
+        constexpr static size_t MAX_BLOCK_SIZE = 256;
+
+        std::unordered_map<uint32_t, EE_CachedBlock> blocks;
+        std::unordered_map<uint32_t, std::vector<uint32_t>> page_blocks;
+        EE_CachedBlock* lookup_cache[LOOKUP_CACHE_SIZE];
+    public:
+        EmotionBlockCache();
+
+        EE_CachedBlock* find_block(uint32_t pc, uint8_t* mem);
+        void decode_next(EE_CachedBlock& block);
+
+        void invalidate_page(uint32_t page);
+        void flush();
+};
+
+#endif // EMOTIONBLOCKCACHE_HPP
@@ -0,0 +1,282 @@
+#if defined(__SSE2__) || defined(_M_X64)
+#define IDCT_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "idct.hpp"
+
+//Adapted from the fast IDCT in mpeg2decode
+//Copyright (C) 1996, MPEG Software Simulation Group. All Rights Reserved.
+
+//2048 * sqrt(2) * cos(n * pi / 16)
+constexpr static int W1 = 2841;
+constexpr static int W2 = 2676;
+constexpr static int W3 = 2408;
+constexpr static int W5 = 1609;
+constexpr static int W6 = 1108;
+constexpr static int W7 = 565;
+
+/**
+ * The row pass keeps 11 fractional bits and rounds at the end. The column pass works on values that
+ * are already 8x larger, so the butterflies are rounded down by 3 bits and the final shift removes the rest.
+ * Each pair of butterfly stages from the original code is folded into a single dot product:
+ * x4' = W7 * (x4 + x5) + (W1 - W7) * x4 = W1 * x4 + W7 * x5, and so on.
+ */
+struct RowPass
+{
+    constexpr static int DC_SCALE = 2048;
+    constexpr static int DC_BIAS = 128;
+    constexpr static int ROTATE_SHIFT = 0;
+    constexpr static int OUT_SHIFT = 8;
+};
+
+struct ColumnPass
+{
+    constexpr static int DC_SCALE = 256;
+    constexpr static int DC_BIAS = 8192;
+    constexpr static int ROTATE_SHIFT = 3;
+    constexpr static int OUT_SHIFT = 14;
+};
+
+//(181 * x + 128) >> 8, split as x = 256 * hi + lo so the product can't overflow. 256 * 181 * hi shifts out exactly
+static inline int scale_sqrt_half(int x)
+{
+    return 181 * (x >> 8) + ((181 * (x & 0xFF) + 128) >> 8);
+}
+
+static inline int16_t saturate(int value)
+{
+    if (value > 32767)
+        return 32767;
+    if (value < -32768)
+        return -32768;
+    return (int16_t)value;
+}
+
+template <typename Pass>
+static inline int rotate(int a, int b, int coeff_a, int coeff_b)
+{
+    int result = a * coeff_a + b * coeff_b;
+    if (Pass::ROTATE_SHIFT)
+        result = (result + (1 << (Pass::ROTATE_SHIFT - 1))) >> Pass::ROTATE_SHIFT;
+    return result;
+}
+
+template <typename Pass, typename In>
+static void idct_1d(const In* in, int* out, int stride)
+{
+    int b0 = in[0], b1 = in[stride], b2 = in[stride * 2], b3 = in[stride * 3];
+    int b4 = in[stride * 4], b5 = in[stride * 5], b6 = in[stride * 6], b7 = in[stride * 7];
+
+    int x8 = (b0 + b4) * Pass::DC_SCALE + Pass::DC_BIAS;
+    int x0 = (b0 - b4) * Pass::DC_SCALE + Pass::DC_BIAS;
+
+    //First stage
+    int x4 = rotate<Pass>(b1, b7, W1, W7);
+    int x5 = rotate<Pass>(b1, b7, W7, -W1);
+    int x6 = rotate<Pass>(b5, b3, W5, W3);
+    int x7 = rotate<Pass>(b5, b3, W3, -W5);
+
+    //Second stage
+    int x2 = rotate<Pass>(b2, b6, W6, -W2);
+    int x3 = rotate<Pass>(b2, b6, W2, W6);
+    int x1 = x4 + x6;
+    x4 -= x6;
+    x6 = x5 + x7;
+    x5 -= x7;
+
+    //Third stage
+    x7 = x8 + x3;
+    x8 -= x3;
+    x3 = x0 + x2;
+    x0 -= x2;
+    x2 = scale_sqrt_half(x4 + x5);
+    x4 = scale_sqrt_half(x4 - x5);
+
+    //Fourth stage
+    out[0] = (x7 + x1) >> Pass::OUT_SHIFT;
+    out[stride] = (x3 + x2) >> Pass::OUT_SHIFT;
+    out[stride * 2] = (x0 + x4) >> Pass::OUT_SHIFT;
+    out[stride * 3] = (x8 + x6) >> Pass::OUT_SHIFT;
+    out[stride * 4] = (x8 - x6) >> Pass::OUT_SHIFT;
+    out[stride * 5] = (x0 - x4) >> Pass::OUT_SHIFT;
+    out[stride * 6] = (x3 - x2) >> Pass::OUT_SHIFT;
+    out[stride * 7] = (x7 - x1) >> Pass::OUT_SHIFT;
+}
+
+//Row results are kept at 32 bits. With 12-bit coefficients they can go past int16_t, which the SSE2 version can't hold
+static void chen_wang_scalar(const int16_t* in, int16_t* out)
+{
+    int rows[64], columns[64];
+    for (int i = 0; i < 8; i++)
+        idct_1d<RowPass>(in + (i * 8), rows + (i * 8), 1);
+    for (int i = 0; i < 8; i++)
+        idct_1d<ColumnPass>(rows + i, columns + i, 8);
+
+    //Clamped the same way as the SSE2 pack
+    for (int i = 0; i < 64; i++)
+        out[i] = saturate(columns[i]);
+}
+
+#ifdef IDCT_SSE2
+
+static inline __m128i pair(int a, int b)
+{
+    return _mm_setr_epi16((int16_t)a, (int16_t)b, (int16_t)a, (int16_t)b,
+                          (int16_t)a, (int16_t)b, (int16_t)a, (int16_t)b);
+}
+
+template <typename Pass>
+static inline __m128i rotate(__m128i pairs, __m128i coeffs)
+{
+    __m128i result = _mm_madd_epi16(pairs, coeffs);
+    if (Pass::ROTATE_SHIFT)
+    {
+        result = _mm_add_epi32(result, _mm_set1_epi32(1 << (Pass::ROTATE_SHIFT - 1)));
+        result = _mm_srai_epi32(result, Pass::ROTATE_SHIFT);
+    }
+    return result;
+}
+
+//Same result as the scalar scale_sqrt_half. Each product is taken as unsigned 64-bit, two lanes at a time,
+//and the 181 << 32 that a negative x adds to it is removed again after the shift (181 << 24)
+static inline __m128i scale_sqrt_half(__m128i x)
+{
+    const __m128i factor = _mm_set1_epi32(181);
+    const __m128i round = _mm_setr_epi32(128, 0, 128, 0);
+    const __m128i low_half = _mm_setr_epi32(-1, 0, -1, 0);
+
+    __m128i even = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(x, factor), round), 8);
+    __m128i odd = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), factor), round), 8);
+    __m128i result = _mm_or_si128(_mm_and_si128(even, low_half), _mm_slli_epi64(odd, 32));
+    return _mm_sub_epi32(result, _mm_and_si128(_mm_srai_epi32(x, 31), _mm_set1_epi32((int)0xB5000000)));
+}
+
+static inline void transpose(__m128i* v)
+{
+    __m128i a0 = _mm_unpacklo_epi16(v[0], v[1]);
+    __m128i a1 = _mm_unpackhi_epi16(v[0], v[1]);
+    __m128i a2 = _mm_unpacklo_epi16(v[2], v[3]);
+    __m128i a3 = _mm_unpackhi_epi16(v[2], v[3]);
+    __m128i a4 = _mm_unpacklo_epi16(v[4], v[5]);
+    __m128i a5 = _mm_unpackhi_epi16(v[4], v[5]);
+    __m128i a6 = _mm_unpacklo_epi16(v[6], v[7]);
+    __m128i a7 = _mm_unpackhi_epi16(v[6], v[7]);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    v[0] = _mm_unpacklo_epi64(b0, b4);
+    v[1] = _mm_unpackhi_epi64(b0, b4);
+    v[2] = _mm_unpacklo_epi64(b1, b5);
+    v[3] = _mm_unpackhi_epi64(b1, b5);
+    v[4] = _mm_unpacklo_epi64(b2, b6);
+    v[5] = _mm_unpackhi_epi64(b2, b6);
+    v[6] = _mm_unpacklo_epi64(b3, b7);
+    v[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+//Four 1D transforms, on 32-bit lanes. p04 etc. hold interleaved pairs of the inputs named
+template <typename Pass>
+static inline void idct_half(__m128i p04, __m128i p17, __m128i p53, __m128i p26, __m128i* out)
+{
+    const __m128i bias = _mm_set1_epi32(Pass::DC_BIAS);
+
+    __m128i x8 = _mm_add_epi32(_mm_madd_epi16(p04, pair(Pass::DC_SCALE, Pass::DC_SCALE)), bias);
+    __m128i x0 = _mm_add_epi32(_mm_madd_epi16(p04, pair(Pass::DC_SCALE, -Pass::DC_SCALE)), bias);
+
+    //First stage
+    __m128i x4 = rotate<Pass>(p17, pair(W1, W7));
+    __m128i x5 = rotate<Pass>(p17, pair(W7, -W1));
+    __m128i x6 = rotate<Pass>(p53, pair(W5, W3));
+    __m128i x7 = rotate<Pass>(p53, pair(W3, -W5));
+
+    //Second stage
+    __m128i x2 = rotate<Pass>(p26, pair(W6, -W2));
+    __m128i x3 = rotate<Pass>(p26, pair(W2, W6));
+    __m128i x1 = _mm_add_epi32(x4, x6);
+    x4 = _mm_sub_epi32(x4, x6);
+    x6 = _mm_add_epi32(x5, x7);
+    x5 = _mm_sub_epi32(x5, x7);
+
+    //Third stage
+    x7 = _mm_add_epi32(x8, x3);
+    x8 = _mm_sub_epi32(x8, x3);
+    x3 = _mm_add_epi32(x0, x2);
+    x0 = _mm_sub_epi32(x0, x2);
+    x2 = scale_sqrt_half(_mm_add_epi32(x4, x5));
+    x4 = scale_sqrt_half(_mm_sub_epi32(x4, x5));
+
+    //Fourth stage
+    out[0] = _mm_srai_epi32(_mm_add_epi32(x7, x1), Pass::OUT_SHIFT);
+    out[1] = _mm_srai_epi32(_mm_add_epi32(x3, x2), Pass::OUT_SHIFT);
+    out[2] = _mm_srai_epi32(_mm_add_epi32(x0, x4), Pass::OUT_SHIFT);
+    out[3] = _mm_srai_epi32(_mm_add_epi32(x8, x6), Pass::OUT_SHIFT);
+    out[4] = _mm_srai_epi32(_mm_sub_epi32(x8, x6), Pass::OUT_SHIFT);
+    out[5] = _mm_srai_epi32(_mm_sub_epi32(x0, x4), Pass::OUT_SHIFT);
+    out[6] = _mm_srai_epi32(_mm_sub_epi32(x3, x2), Pass::OUT_SHIFT);
+    out[7] = _mm_srai_epi32(_mm_sub_epi32(x7, x1), Pass::OUT_SHIFT);
+}
+
+//v[k] holds coefficient k of eight independent transforms. Replaced with output k of each.
+//Returns false if an output didn't fit in int16_t and was saturated
+template <typename Pass>
+static inline bool idct_pass(__m128i* v)
+{
+    __m128i lo[8], hi[8];
+    idct_half<Pass>(_mm_unpacklo_epi16(v[0], v[4]), _mm_unpacklo_epi16(v[1], v[7]),
+                    _mm_unpacklo_epi16(v[5], v[3]), _mm_unpacklo_epi16(v[2], v[6]), lo);
+    idct_half<Pass>(_mm_unpackhi_epi16(v[0], v[4]), _mm_unpackhi_epi16(v[1], v[7]),
+                    _mm_unpackhi_epi16(v[5], v[3]), _mm_unpackhi_epi16(v[2], v[6]), hi);
+
+    __m128i clamped = _mm_setzero_si128();
+    for (int i = 0; i < 8; i++)
+    {
+        v[i] = _mm_packs_epi32(lo[i], hi[i]);
+
+        //Sign extending the packed values back gives the originals unless they were saturated
+        __m128i lo_back = _mm_srai_epi32(_mm_unpacklo_epi16(v[i], v[i]), 16);
+        __m128i hi_back = _mm_srai_epi32(_mm_unpackhi_epi16(v[i], v[i]), 16);
+        clamped = _mm_or_si128(clamped, _mm_xor_si128(lo_back, lo[i]));
+        clamped = _mm_or_si128(clamped, _mm_xor_si128(hi_back, hi[i]));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(clamped, _mm_setzero_si128())) == 0xFFFF;
+}
+
+void IDCT::chen_wang(const int16_t* in, int16_t* out)
+{
+    __m128i v[8];
+    for (int i = 0; i < 8; i++)
+        v[i] = _mm_loadu_si128((const __m128i*)(in + (i * 8)));
+
+    //Rows
+    transpose(v);
+    if (!idct_pass<RowPass>(v))
+    {
+        //Only extreme coefficients get here, which the wider scalar version handles
+        chen_wang_scalar(in, out);
+        return;
+    }
+
+    //Columns
+    transpose(v);
+    idct_pass<ColumnPass>(v);
+
+    for (int i = 0; i < 8; i++)
+        _mm_storeu_si128((__m128i*)(out + (i * 8)), v[i]);
+}
+
+#else
+
+void IDCT::chen_wang(const int16_t* in, int16_t* out)
+{
+    chen_wang_scalar(in, out);
+}
+
+#endif
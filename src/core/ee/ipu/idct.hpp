@@ -0,0 +1,19 @@
+#ifndef IDCT_HPP
+#define IDCT_HPP
+#include <cstdint>
+
+/**
+ * Integer 8x8 IDCT, using the Chen-Wang algorithm from mpeg2decode (IEEE-1180 conformant).
+ *
+ * On x86-64 all eight rows (and then all eight columns) are transformed at once in SSE2 registers.
+ * The scalar version is kept for other hosts, and both produce identical results. It also keeps the row
+ * results at 32 bits, so the SSE2 version hands it the blocks where they don't fit in 16 bits.
+ * Coefficients are expected in the 12-bit range the IPU saturates them to.
+ * in and out may point to the same block.
+ */
+namespace IDCT
+{
+    void chen_wang(const int16_t* in, int16_t* out);
+};
+
+#endif // IDCT_HPP
@@ -3,6 +3,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include "idct.hpp"
 #include "ipu.hpp"
 #include "../dmac.hpp"
 #include "../intc.hpp"
@@ -76,6 +77,8 @@ ImageProcessingUnit::ImageProcessingUnit(INTC* intc, DMAC* dmac) : intc(intc), d
         }
     }
 
+    reference_IDCT = false;
+
     //I'm assuming the dithering process rounds down so I've rounded the matrix values down
     dither_mtx[0][0] = -4;
     dither_mtx[0][1] = 0;
@@ -100,7 +103,7 @@ void ImageProcessingUnit::reset()
     dct_coeff = nullptr;
     VDEC_table = nullptr;
     in_FIFO.reset();
-    out_FIFO.reset();
+    out_FIFO.clear();
     prepare_IDCT();
 
     ctrl.error_code = false;
@@ -116,6 +119,11 @@ void ImageProcessingUnit::reset()
     command_decoding = false;
 }
 
+void ImageProcessingUnit::set_reference_IDCT(bool enabled)
+{
+    reference_IDCT = enabled;
+}
+
 void ImageProcessingUnit::run()
 {
     if (ctrl.busy)
@@ -125,25 +133,25 @@ void ImageProcessingUnit::run()
             switch (command)
             {
                 case 0x01:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                     {
                         if (process_IDEC())
                             finish_command();
                     }
                     break;
                 case 0x02:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                     {
                         if (process_BDEC())
                             finish_command();
                     }
                     break;
                 case 0x03:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                         process_VDEC();
                     break;
                 case 0x04:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                         process_FDEC();
                     break;
                 case 0x05:
@@ -154,7 +162,7 @@ void ImageProcessingUnit::run()
 
                         setiq_state = SETIQ_STATE::POPULATE_TABLE;
                     }
-                    while (bytes_left && in_FIFO.f.size())
+                    while (bytes_left && in_FIFO.size())
                     {
                         uint32_t value;
                         if (!in_FIFO.get_bits(value, 8))
@@ -171,10 +179,9 @@ void ImageProcessingUnit::run()
                         ctrl.busy = false;
                     break;
                 case 0x06:
-                    while (bytes_left && in_FIFO.f.size())
+                    while (bytes_left && in_FIFO.size())
                     {
-                        uint128_t quad = in_FIFO.f.front();
-                        in_FIFO.f.pop_front();
+                        uint128_t quad = in_FIFO.pop();
                         for (int i = 0; i < 8; i++)
                         {
                             int index = (32 - bytes_left) >> 1;
@@ -186,14 +193,14 @@ void ImageProcessingUnit::run()
                         ctrl.busy = false;
                     break;
                 case 0x07:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                     {
                         if (process_CSC())
                             finish_command();
                     }
                     break;
                 case 0x08:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                     {
                         if (process_PACK())
                             finish_command();
@@ -287,8 +294,8 @@ bool ImageProcessingUnit::process_IDEC()
                 printf("[IPU] Init CSC\n");
                 for (int i = 0; i < RAW_BLOCK_SIZE / 8; i++)
                 {
-                    uint128_t quad = idec.temp_fifo.f.front();
-                    idec.temp_fifo.f.pop_front();
+                    uint128_t quad = idec.temp_fifo.front();
+                    idec.temp_fifo.pop_front();
 
                     int offset = i * 8;
 
@@ -473,29 +480,29 @@ bool ImageProcessingUnit::process_BDEC()
                 for (int i = 0; i < 8; i++)
                 {
                     memcpy(quad._u8, bdec.blocks[0] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push_back(quad);
+                    bdec.out_fifo->push_back(quad);
                     memcpy(quad._u8, bdec.blocks[1] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push_back(quad);
+                    bdec.out_fifo->push_back(quad);
                 }
 
                 for (int i = 0; i < 8; i++)
                 {
                     memcpy(quad._u8, bdec.blocks[2] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push_back(quad);
+                    bdec.out_fifo->push_back(quad);
                     memcpy(quad._u8, bdec.blocks[3] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push_back(quad);
+                    bdec.out_fifo->push_back(quad);
                 }
 
                 for (int i = 0; i < 8; i++)
                 {
                     memcpy(quad._u8, bdec.blocks[4] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push_back(quad);
+                    bdec.out_fifo->push_back(quad);
                 }
 
                 for (int i = 0; i < 8; i++)
                 {
                     memcpy(quad._u8, bdec.blocks[5] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push_back(quad);
+                    bdec.out_fifo->push_back(quad);
                 }
 
                 if (bdec.check_start_code)
@@ -656,6 +663,14 @@ void ImageProcessingUnit::prepare_IDCT()
 }
 
 void ImageProcessingUnit::perform_IDCT(const int16_t* pUV, int16_t* pXY)
+{
+    if (reference_IDCT)
+        perform_reference_IDCT(pUV, pXY);
+    else
+        IDCT::chen_wang(pUV, pXY);
+}
+
+void ImageProcessingUnit::perform_reference_IDCT(const int16_t* pUV, int16_t* pXY)
 {
     int i, j, k, v;
     double partial_product;
@@ -1009,7 +1024,7 @@ bool ImageProcessingUnit::process_CSC()
                         {
                             quad._u16[j] = rgb16[j + (i * 8)];
                         }
-                        out_FIFO.f.push_back(quad);
+                        out_FIFO.push_back(quad);
                     }
                 }
                 else
@@ -1026,7 +1041,7 @@ bool ImageProcessingUnit::process_CSC()
                             uint32_t color = r | g << 8 | b << 16 | a << 24;
                             quad._u32[j] = color;
                         }
-                        out_FIFO.f.push_back(quad);
+                        out_FIFO.push_back(quad);
                     }
                 }
                 dmac->set_DMA_request(IPU_FROM);
@@ -1084,7 +1099,7 @@ bool ImageProcessingUnit::process_PACK()
                         {
                             quad._u16[j] = rgb16[j + (i * 8)];
                         }
-                        out_FIFO.f.push_back(quad);
+                        out_FIFO.push_back(quad);
                     }
                 }
                 else
@@ -1133,7 +1148,7 @@ bool ImageProcessingUnit::process_PACK()
                             const uint16_t color16_high = rgb16[index + 1];
                             quad._u8[j] = closest_index(color16_high) << 4 | closest_index(color16_low);
                         }
-                        out_FIFO.f.push_back(quad);
+                        out_FIFO.push_back(quad);
                     }
                 }
                 dmac->set_DMA_request(IPU_FROM);
@@ -1159,7 +1174,7 @@ uint64_t ImageProcessingUnit::read_command()
 uint32_t ImageProcessingUnit::read_control()
 {
     uint32_t reg = 0;
-    reg |= in_FIFO.f.size();
+    reg |= in_FIFO.size();
     reg |= (ctrl.coded_block_pattern & 0x3F) << 8;
     reg |= ctrl.error_code << 14;
     reg |= ctrl.start_code << 15;
@@ -1176,7 +1191,7 @@ uint32_t ImageProcessingUnit::read_control()
 uint32_t ImageProcessingUnit::read_BP()
 {
     uint32_t reg = 0;
-    uint8_t fifo_size = in_FIFO.f.size();
+    uint8_t fifo_size = in_FIFO.size();
 
     //Check for FP bit
     if (in_FIFO.bit_pointer && fifo_size)
@@ -1193,7 +1208,7 @@ uint32_t ImageProcessingUnit::read_BP()
 uint64_t ImageProcessingUnit::read_top()
 {
     uint64_t reg = 0;
-    int max_bits = (in_FIFO.f.size() * 128) - in_FIFO.bit_pointer;
+    int max_bits = (in_FIFO.size() * 128) - in_FIFO.bit_pointer;
     if (max_bits > 32)
         max_bits = 32;
     uint32_t next_data;
@@ -1315,50 +1330,48 @@ void ImageProcessingUnit::write_control(uint32_t value)
         command_decoding = false;
         command = 0;
         in_FIFO.reset();
-        out_FIFO.reset();
+        out_FIFO.clear();
     }
 }
 
 bool ImageProcessingUnit::can_read_FIFO()
 {
-    return out_FIFO.f.size() > 0;
+    return out_FIFO.size() > 0;
 }
 
 bool ImageProcessingUnit::can_write_FIFO()
 {
-    return in_FIFO.f.size() < 8;
+    return in_FIFO.size() < IPU_FIFO::SIZE;
+}
+
+int ImageProcessingUnit::get_FIFO_space()
+{
+    return IPU_FIFO::SIZE - in_FIFO.size();
 }
 
 uint128_t ImageProcessingUnit::read_FIFO()
 {
-    uint128_t quad = out_FIFO.f.front();
-    out_FIFO.f.pop_front();
-    if (!out_FIFO.f.size())
+    uint128_t quad = out_FIFO.front();
+    out_FIFO.pop_front();
+    if (!out_FIFO.size())
         dmac->clear_DMA_request(IPU_FROM);
     return quad;
 }
 
-void ImageProcessingUnit::write_FIFO(uint128_t quad)
+void ImageProcessingUnit::write_FIFO(const uint128_t* quads, int count)
 {
-    printf("[IPU] Write FIFO: $%08X_%08X_%08X_%08X\n", quad._u32[3], quad._u32[2], quad._u32[1], quad._u32[0]);
-    
+    printf("[IPU] Write FIFO: %d quads\n", count);
 
     //Certain games (Theme Park, Neo Contra, etc) read command output without sending a command.
     //They expect to read the first word of a newly started IPU_TO transfer.
-    if (in_FIFO.f.size() == 0 && !ctrl.busy)
+    if (in_FIFO.size() == 0 && !ctrl.busy)
     {
-        command_output = quad._u32[0];
+        command_output = quads[0]._u32[0];
         command_output = (command_output >> 24) | (((command_output >> 16) & 0xFF) << 8) |
                          (((command_output >> 8) & 0xFF) << 16) | (command_output << 24);
     }
-    if (in_FIFO.f.size() == 7)
-    {
+
+    in_FIFO.push(quads, count);
+    if (in_FIFO.size() == IPU_FIFO::SIZE)
         dmac->clear_DMA_request(IPU_TO);
-    }
-    if (in_FIFO.f.size() >= 8)
-    {
-        Errors::die("[IPU] Error: data sent to IPU exceeding FIFO limit!\n");
-    }
-    in_FIFO.f.push_back(quad);
-    in_FIFO.bit_cache_dirty = true;
 }
@@ -82,7 +82,7 @@ struct IDEC_Command
     bool decodes_dct;
     uint32_t qsc;
 
-    IPU_FIFO temp_fifo;
+    std::deque<uint128_t> temp_fifo;
 
     int blocks_decoded;
 };
@@ -90,7 +90,7 @@ struct IDEC_Command
 struct BDEC_Command
 {
     BDEC_STATE state;
-    IPU_FIFO* out_fifo;
+    std::deque<uint128_t>* out_fifo;
     bool intra;
     bool reset_dc;
     bool check_start_code;
@@ -185,7 +185,8 @@ class ImageProcessingUnit
         Macroblock_BPic macroblock_B_pic;
         MotionCode motioncode;
         VLC_Table* VDEC_table;
-        IPU_FIFO in_FIFO, out_FIFO;
+        IPU_FIFO in_FIFO;
+        std::deque<uint128_t> out_FIFO;
 
         int8_t dither_mtx[4][4];
 
@@ -215,6 +216,8 @@ class ImageProcessingUnit
         SETIQ_STATE setiq_state;
         PACK_Command pack;
 
+        //The double-precision IDCT is much slower, but kept around to verify the integer one against
+        bool reference_IDCT;
         double IDCT_table[8][8];
 
         void finish_command();
@@ -226,6 +229,7 @@ class ImageProcessingUnit
         void dequantize(int16_t* block);
         void prepare_IDCT();
         void perform_IDCT(const int16_t* pUV, int16_t* pXY);
+        void perform_reference_IDCT(const int16_t* pUV, int16_t* pXY);
         bool BDEC_read_coeffs();
         bool BDEC_read_diff();
 
@@ -239,6 +243,9 @@ class ImageProcessingUnit
 
         void reset();
         void run();
+        bool is_idle();
+
+        void set_reference_IDCT(bool enabled);
 
         uint64_t read_command();
         uint32_t read_control();
@@ -251,7 +258,13 @@ class ImageProcessingUnit
         bool can_read_FIFO();
         bool can_write_FIFO();
         uint128_t read_FIFO();
-        void write_FIFO(uint128_t quad);
+        int get_FIFO_space();
+        void write_FIFO(const uint128_t* quads, int count);
 };
 
+inline bool ImageProcessingUnit::is_idle()
+{
+    return !ctrl.busy && out_FIFO.empty();
+}
+
 #endif // IPU_HPP
@@ -3,76 +3,46 @@
 #include "ipu_fifo.hpp"
 #include "../../errors.hpp"
 
-bool IPU_FIFO::get_bits(uint32_t &data, int bits)
+bool IPU_FIFO::advance_stream(uint8_t amount)
 {
-    int bits_available = (f.size() * 128) - bit_pointer;
+    if (amount > 32)
+        amount = 32;
 
-    if (bits_available < bits || bits_available == 0)
-    {
-        data = 0;
+    if (amount > bits_available())
         return false;
-    }
-
-    if (bit_cache_dirty)
-    {
-        uint8_t temp[32];
-        *(uint128_t*)&temp[0] = f[0];
-        if (f.size() > 1)
-            *(uint128_t*)&temp[16] = f[1];
-
-        uint8_t blorp[8];
-        int index = (bit_pointer & ~0x1F) / 8;
-
-        //MPEG is big-endian...
-        for (int i = 0; i < 8; i++)
-        {
-            int fifo_index = index + i;
-            blorp[7 - i] = temp[fifo_index];
-        }
-        bit_cache_dirty = false;
-        cached_bits = *(uint64_t*)&blorp[0];
-    }
-    int shift = 64 - (bit_pointer % 32) - bits;
-    uint64_t mask = ~0x0ULL >> (64 - bits);
-    data = (cached_bits >> shift) & mask;
 
+    skip(amount);
     return true;
 }
 
-bool IPU_FIFO::advance_stream(uint8_t amount)
+void IPU_FIFO::push(const uint128_t* quads, int quad_count)
 {
-    if (amount > 32)
-        amount = 32;
-    
-    //printf("Advance stream: %d + %d = %d\n", bit_pointer - amount, amount, bit_pointer);
+    if (count + quad_count > SIZE)
+        Errors::die("[IPU] Error: data sent to IPU exceeding FIFO limit!\n");
 
-    if ((bit_pointer + amount) > (f.size() * 128))
+    for (int i = 0; i < quad_count; i++)
     {
-       // Errors::die("[IPU] Bit pointer exceeds FIFO size!\n");
-        return false;
+        int index = (head + count + i) & (SIZE - 1);
+        data[index] = quads[i];
+        data[index + SIZE] = quads[i];
     }
+    count += quad_count;
+}
 
-    uint32_t old_words = bit_pointer / 32;
-    uint32_t new_words = (bit_pointer + amount) / 32;
-    bit_cache_dirty |= (old_words != new_words);
-    bit_pointer += amount;
-
-    while (bit_pointer >= 128)
-    {
-        bit_pointer -= 128;
-        f.pop_front();
-        bit_cache_dirty = true;
-    }
-    return true;
+uint128_t IPU_FIFO::pop()
+{
+    uint128_t quad = data[head];
+    head = (head + 1) & (SIZE - 1);
+    count--;
+    return quad;
 }
 
 void IPU_FIFO::reset()
 {
-    std::deque<uint128_t> empty;
-    f.swap(empty);
+    memset(data, 0, sizeof(data));
+    head = 0;
+    count = 0;
     bit_pointer = 0;
-    cached_bits = 0;
-    bit_cache_dirty = true;
 }
 
 void IPU_FIFO::byte_align()
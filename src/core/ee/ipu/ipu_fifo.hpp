@@ -1,21 +1,84 @@
 #ifndef IPU_FIFO_HPP
 #define IPU_FIFO_HPP
 #include <cstdint>
-#include <queue>
+#include <cstring>
 
 #include "../../int128.hpp"
 
+/**
+ * The IPU input FIFO, read as an MPEG bitstream.
+ *
+ * Quadwords are kept in a fixed ring, with each one also stored SIZE entries further on, so that the
+ * 64 bits following any position can be fetched with a single unaligned load regardless of wrapping.
+ * bit_pointer is relative to the oldest quadword, matching what IPU_BP reports.
+ */
 struct IPU_FIFO
 {
-    std::deque<uint128_t> f;
+    constexpr static int SIZE = 8;
+
+    uint128_t data[SIZE * 2];
+    int head, count;
     int bit_pointer;
-    uint64_t cached_bits;
-    bool bit_cache_dirty;
+
+    int size() const;
+    int bits_available() const;
+    uint32_t peek(int bits) const;
+    void skip(int bits);
+
     bool get_bits(uint32_t& data, int bits);
     bool advance_stream(uint8_t amount);
 
+    void push(const uint128_t* quads, int quad_count);
+    uint128_t pop();
+
     void reset();
     void byte_align();
 };
 
+inline int IPU_FIFO::size() const
+{
+    return count;
+}
+
+inline int IPU_FIFO::bits_available() const
+{
+    return (count * 128) - bit_pointer;
+}
+
+//Returns the next 1-32 bits without checking that they are there
+inline uint32_t IPU_FIFO::peek(int bits) const
+{
+    int pos = (head * 128) + bit_pointer;
+    uint64_t window;
+    memcpy(&window, (const uint8_t*)data + (pos >> 3), sizeof(window));
+
+    //MPEG is big-endian...
+    window = (window >> 56) | ((window >> 40) & 0xFF00) | ((window >> 24) & 0xFF0000) |
+             ((window >> 8) & 0xFF000000) | ((window << 8) & 0xFF00000000ULL) |
+             ((window << 24) & 0xFF0000000000ULL) | ((window << 40) & 0xFF000000000000ULL) | (window << 56);
+    return (uint32_t)((window << (pos & 0x7)) >> (64 - bits));
+}
+
+//Consumes bits without checking that they are there, dropping any quadwords that were fully read
+inline void IPU_FIFO::skip(int bits)
+{
+    bit_pointer += bits;
+    head = (head + (bit_pointer >> 7)) & (SIZE - 1);
+    count -= bit_pointer >> 7;
+    bit_pointer &= 0x7F;
+}
+
+inline bool IPU_FIFO::get_bits(uint32_t &data, int bits)
+{
+    int available = bits_available();
+    if (available < bits || available == 0)
+    {
+        data = 0;
+        return false;
+    }
+
+    data = peek(bits);
+    return true;
+}
+
 #endif // IPU_FIFO_HPP
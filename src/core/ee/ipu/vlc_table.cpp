@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdlib>
 #include <cstdio>
 #include "vlc_table.hpp"
@@ -6,29 +7,85 @@
 VLC_Table::VLC_Table(VLC_Entry* table, int table_size, int max_bits, unsigned int* index_table) :
     table(table), table_size(table_size), max_bits(max_bits), index_table(index_table)
 {
-
+    build_lookup();
 }
 
-bool VLC_Table::peek_symbol(IPU_FIFO &FIFO, VLC_Entry &entry)
+void VLC_Table::build_lookup()
 {
-    uint32_t key;
+    first_level_bits = std::min(max_bits, FIRST_LEVEL_BITS);
+    second_level_bits = max_bits - first_level_bits;
+
+    lookup.assign(1 << first_level_bits, {VLC_Slot::EMPTY, 0});
+
+    //Entries of each length are found the same way a bit-by-bit search would, so that where two codes
+    //overlap, the shorter (or earlier) one wins
     for (int i = 0; i < max_bits; i++)
     {
         int bits = i + 1;
-        if (!FIFO.get_bits(key, bits))
-            return false;
         for (int j = index_table[i]; j < table_size; j++)
         {
             if (bits != table[j].bits)
                 break;
 
-            if (key == table[j].key)
+            uint32_t key = table[j].key;
+            if (bits <= first_level_bits)
             {
-                entry = table[j];
-                return true;
+                int shift = first_level_bits - bits;
+                for (uint32_t k = key << shift; k < (key + 1) << shift; k++)
+                {
+                    if (lookup[k].type == VLC_Slot::EMPTY)
+                        lookup[k] = {VLC_Slot::ENTRY, (uint16_t)j};
+                }
+                continue;
+            }
+
+            uint32_t prefix = key >> (bits - first_level_bits);
+            if (lookup[prefix].type == VLC_Slot::ENTRY)
+                continue;
+
+            if (lookup[prefix].type == VLC_Slot::EMPTY)
+            {
+                lookup[prefix] = {VLC_Slot::SUBTABLE, (uint16_t)lookup.size()};
+                lookup.resize(lookup.size() + (1 << second_level_bits), {VLC_Slot::EMPTY, 0});
+            }
+
+            int shift = max_bits - bits;
+            uint32_t suffix = key & ((1 << (bits - first_level_bits)) - 1);
+            uint32_t base = lookup[prefix].index;
+            for (uint32_t k = suffix << shift; k < (suffix + 1) << shift; k++)
+            {
+                if (lookup[base + k].type == VLC_Slot::EMPTY)
+                    lookup[base + k] = {VLC_Slot::ENTRY, (uint16_t)j};
             }
         }
     }
+}
+
+bool VLC_Table::peek_symbol(IPU_FIFO &FIFO, VLC_Entry &entry)
+{
+    //Near the end of the FIFO, peek what is there and treat the rest as zeroes.
+    //A code is only accepted if it fits in the bits that were really available
+    int bits = std::min(max_bits, FIFO.bits_available());
+    if (!bits)
+        return false;
+
+    uint32_t key;
+    FIFO.get_bits(key, bits);
+    key <<= max_bits - bits;
+
+    VLC_Slot slot = lookup[key >> second_level_bits];
+    if (slot.type == VLC_Slot::SUBTABLE)
+        slot = lookup[slot.index + (key & ((1 << second_level_bits) - 1))];
+
+    if (slot.type == VLC_Slot::ENTRY && table[slot.index].bits <= bits)
+    {
+        entry = table[slot.index];
+        return true;
+    }
+
+    if (bits < max_bits)
+        return false;
+
     throw VLC_Error("VLC symbol not found");
     return false;
 }
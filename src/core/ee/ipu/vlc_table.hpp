@@ -3,6 +3,7 @@
 #include <stdexcept>
 #include <cstdint>
 #include <queue>
+#include <vector>
 #include "ipu_fifo.hpp"
 
 struct VLC_Entry
@@ -17,12 +18,39 @@ class VLC_Error : public std::runtime_error
     using std::runtime_error::runtime_error;
 };
 
+//A slot in the decoding lookup, indexed by the next bits of the stream
+struct VLC_Slot
+{
+    enum TYPE : uint8_t
+    {
+        EMPTY,
+        ENTRY,
+        SUBTABLE
+    };
+
+    TYPE type;
+
+    //Index into the entry table, or the start of the second level in the lookup
+    uint16_t index;
+};
+
 class VLC_Table
 {
     private:
+        constexpr static int FIRST_LEVEL_BITS = 8;
+
         VLC_Entry* table;
         int table_size, max_bits;
         unsigned int* index_table;
+
+        /**
+         * Codes of up to first_level_bits resolve with a single read of the first level. Longer codes
+         * share a second level per prefix, indexed by the remaining max_bits - first_level_bits bits.
+         */
+        std::vector<VLC_Slot> lookup;
+        int first_level_bits, second_level_bits;
+
+        void build_lookup();
     protected:
         VLC_Table(VLC_Entry* table, int table_size, int max_bits, unsigned int* index_table);
     public:
@@ -238,6 +238,7 @@ bool VectorInterface::process_data_word(uint32_t value)
                 break;
             case 0x4A:
                 //MPG
+                vu->wait_for_thread();
                 vu->write_instr(mpg.addr, value);
                 mpg.addr += 4;
                 if (command_len <= 1)
@@ -472,6 +473,8 @@ void VectorInterface::MSCAL(uint32_t addr, uint32_t cycles)
 {
     vu->start_program(addr, cycles);
 
+    //A threaded VU1 reads these while running
+    vu->wait_for_thread();
     ITOP = ITOPS & mem_mask;
 
     if (vu->get_id())
@@ -912,6 +915,8 @@ void VectorInterface::handle_UNPACK()
 
 void VectorInterface::process_UNPACK_quad(uint128_t &quad)
 {
+    //Keeps a threaded VU1 parked until the VU is next updated, after this batch of data
+    vu->wait_for_thread();
     handle_UNPACK_masking(quad);
     handle_UNPACK_mode(quad);
 
@@ -125,6 +125,7 @@ class VectorInterface
 
         void reset();
         void update(int cycles);
+        bool is_idle();
         bool transfer_word(uint32_t value);
         bool transfer_DMAtag(uint128_t tag);
         bool feed_DMA(uint128_t quad);
@@ -151,4 +152,10 @@ inline int VectorInterface::get_id()
 {
     return id;
 }
+
+inline bool VectorInterface::is_idle()
+{
+    return !fifo_reverse && !vif_stalled && !stall_condition_active && vif_cmd_status == VIF_IDLE &&
+           FIFO.empty() && internal_FIFO.empty();
+}
 #endif // VIF_HPP
@@ -1,3 +1,4 @@
+#include <cfenv>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -5,6 +6,7 @@
 #include <fstream>
 #include <iomanip>
 #include <algorithm>
+#include "crc32c.hpp"
 #include "vu.hpp"
 #include "vu_interpreter.hpp"
 #include "vu_jit.hpp"
@@ -147,11 +149,32 @@ VectorUnit::VectorUnit(int id, Emulator* e, INTC* intc, EmotionEngine* cpu, Vect
     else
         mem_mask = 0x3FFF;
 
+    decoded_instrs = new VU_DecodedInstr[(mem_mask + 1) / 8]();
+
     VIF_TOP = nullptr;
     VIF_ITOP = nullptr;
 
     MAC_flags = &MAC_pipeline[3];
     CLIP_flags = &CLIP_pipeline[3];
+
+    threaded = false;
+    thread_has_work = false;
+    thread_quit = false;
+    thread_use_jit = false;
+    thread_pause = false;
+    thread_cycle_limit = 0;
+    thread_interrupt = false;
+    XGKICK_queued = 0;
+    XGKICK_packet_pos = 0;
+    XGKICK_cycle_count = 0;
+
+    set_micromem_dirty();
+}
+
+VectorUnit::~VectorUnit()
+{
+    set_threaded(false);
+    delete[] decoded_instrs;
 }
 
 void VectorUnit::reset()
@@ -159,7 +182,7 @@ void VectorUnit::reset()
     soft_reset();
 
     VU_JIT::reset(this);
-    vumem_is_dirty = true; //assume we don't know the contents on reset
+    set_micromem_dirty(); //assume we don't know the contents on reset
 
     PC = 0;
     finish_DIV_event = 0;
@@ -178,6 +201,13 @@ void VectorUnit::reset()
     transferring_GIF = false;
     XGKICK_stall = false;
 
+    XGKICK_queue.clear();
+    XGKICK_queued = 0;
+    XGKICK_packet.clear();
+    XGKICK_packet_pos = 0;
+    XGKICK_cycle_count = eecpu->get_cycle_count();
+    thread_interrupt = false;
+
     for (int i = 1; i < 32; i++)
     {
         gpr[i].f[0] = 0.0;
@@ -195,6 +225,9 @@ void VectorUnit::reset()
 //Soft reset only clears out the control registers and stops the VU, everything else is preserved
 void VectorUnit::soft_reset()
 {
+    //Stop the program thread before pulling its state out from under it
+    wait_for_thread();
+
     status = 0;
     status_pipe = 0;
     clip_flags = 0;
@@ -310,6 +343,12 @@ void VectorUnit::flush_pipes()
 
 void VectorUnit::run()
 {
+    if (threaded)
+    {
+        update_thread(false);
+        return;
+    }
+
     uint32_t cycles_this_op = 0;
 
     int cycles_to_run = (eecpu->get_cycle_count() - cycle_count);
@@ -331,69 +370,12 @@ void VectorUnit::run()
         {
             decoder.reset();
             cycle_count += cycles_to_run - 1;
-            for (int i = cycles_to_run - 1; i > 0; i--)
-            {
-                update_mac_pipeline();
-                update_DIV_EFU_pipes();
-                int_branch_pipeline.update();
-            }
+            advance_pipelines(cycles_to_run - 1);
+            update_DIV_EFU_pipes();
             break;
         }
 
-        uint32_t upper_instr = *(uint32_t*)&instr_mem.m[(PC + 4) & mem_mask];
-        uint32_t lower_instr = *(uint32_t*)&instr_mem.m[PC & mem_mask];
-        //printf("[$%08X] $%08X:$%08X\n", PC, upper_instr, lower_instr);
-        VU_Interpreter::interpret(*this, upper_instr, lower_instr);
-
-        PC += 8;
-
-        if (branch_on)
-        {
-            if (!branch_delay_slot)
-            {
-                PC = new_PC;
-                if (second_branch_pending)
-                {
-                    new_PC = secondbranch_PC;
-                    second_branch_pending = false;
-                }
-                else
-                    branch_on = false;
-            }
-            else
-                branch_delay_slot--;
-        }
-        if (finish_on)
-        {
-            if (!ebit_delay_slot)
-            {
-                //printf("[VU%d] Ended execution at PC %x!\n", id, PC);
-                running = false;
-                finish_on = false;
-                flush_pipes();
-            }
-            else
-                ebit_delay_slot--;
-        }
-        if (upper_instr & (1 << 27))
-        {
-            if (read_fbrst() & (1 << (3 + (get_id() * 8))))
-            {
-                if (!get_id())
-                {
-                    intc->assert_IRQ((int)Interrupt::VU0);
-                }
-                else
-                {
-                    intc->assert_IRQ((int)Interrupt::VU1);
-                }
-                tbit_stop = true;
-                running = false;
-                finish_on = false;
-                flush_pipes();
-                //Errors::die("VU%d Using T-Bit\n", get_id());
-            }
-        }
+        execute_instruction();
 
         cycles_this_op = cycle_count - cycles_this_op;
         XGKICK_cycles += cycles_this_op;
@@ -456,6 +438,63 @@ void VectorUnit::run()
     }
 }
 
+void VectorUnit::execute_instruction()
+{
+    uint32_t upper_instr = *(uint32_t*)&instr_mem.m[(PC + 4) & mem_mask];
+    uint32_t lower_instr = *(uint32_t*)&instr_mem.m[PC & mem_mask];
+    //printf("[$%08X] $%08X:$%08X\n", PC, upper_instr, lower_instr);
+
+    //Entries are checked against the words in memory, so uploads never need to invalidate them
+    VU_DecodedInstr& decoded = decoded_instrs[(PC & mem_mask) >> 3];
+    if (!(decoded.flags & VU_DecodedInstr::VALID) || decoded.upper_instr != upper_instr ||
+            decoded.lower_instr != lower_instr)
+        VU_Interpreter::decode(*this, decoded, upper_instr, lower_instr);
+    VU_Interpreter::interpret(*this, decoded);
+
+    PC += 8;
+
+    if (branch_on)
+    {
+        if (!branch_delay_slot)
+        {
+            PC = new_PC;
+            if (second_branch_pending)
+            {
+                new_PC = secondbranch_PC;
+                second_branch_pending = false;
+            }
+            else
+                branch_on = false;
+        }
+        else
+            branch_delay_slot--;
+    }
+    if (finish_on)
+    {
+        if (!ebit_delay_slot)
+        {
+            //printf("[VU%d] Ended execution at PC %x!\n", id, PC);
+            running = false;
+            finish_on = false;
+            flush_pipes();
+        }
+        else
+            ebit_delay_slot--;
+    }
+    if (upper_instr & (1 << 27))
+    {
+        if (read_fbrst() & (1 << (3 + (get_id() * 8))))
+        {
+            raise_interrupt();
+            tbit_stop = true;
+            running = false;
+            finish_on = false;
+            flush_pipes();
+            //Errors::die("VU%d Using T-Bit\n", get_id());
+        }
+    }
+}
+
 void VectorUnit::correct_jit_pipeline(int cycles)
 {
     uint64_t stall_pipe[4];
@@ -564,6 +603,12 @@ void VectorUnit::update_XGKick()
 
 void VectorUnit::run_jit()
 {
+    if (threaded)
+    {
+        update_thread(true);
+        return;
+    }
+
     if (running == true)
     {
         update_XGKick();
@@ -620,6 +665,7 @@ void VectorUnit::handle_XGKICK()
 //VU0 can access VU1 registers through the addresses (anded with 0x7FFF) 0x4000-0x4400
 uint32_t VectorUnit::read_reg(uint32_t addr)
 {
+    wait_for_thread();
     addr &= 0x3FF;
     if (addr < 0x0200)
         return get_gpr_u(addr / 0x10, (addr & 0xC) / 4);
@@ -658,6 +704,7 @@ uint32_t VectorUnit::read_reg(uint32_t addr)
 
 void VectorUnit::write_reg(uint32_t addr, uint32_t data)
 {
+    wait_for_thread();
     addr &= 0x3FF;
     if (addr < 0x0200)
         set_gpr_u(addr / 0x10, (addr & 0xC) / 4, data);
@@ -933,20 +980,21 @@ void VectorUnit::disasm_micromem()
     file.close();
 }
 
-#define POLY 0x82f63b78
-
 uint32_t VectorUnit::crc_microprogram()
 {
-    uint32_t crc = 0;
-    int len = (get_id()) ? 0x4000 : 0x1000;
-    int addr = 0x0000;
+    const int chunk_size = 1 << MICROMEM_CHUNK_SHIFT;
+    int chunks = (mem_mask + 1) / chunk_size;
 
-    crc = ~crc;
-    while (len--) {
-        crc ^= read_instr<uint8_t>(addr++);
-        for (int k = 0; k < 8; k++)
-            crc = crc & 1 ? (crc >> 1) ^ POLY : crc >> 1;
+    for (int i = 0; i < chunks; i++)
+    {
+        if (micromem_dirty_chunks & (1 << i))
+            micromem_chunk_crc[i] = CRC32C::update(0, &instr_mem.m[i * chunk_size], chunk_size);
     }
+    micromem_dirty_chunks = 0;
+
+    uint32_t crc = ~0U;
+    for (int i = 0; i < chunks; i++)
+        crc = CRC32C::extend_1k(crc) ^ micromem_chunk_crc[i];
     return ~crc;
 }
 
@@ -955,6 +1003,14 @@ void VectorUnit::start_program(uint32_t addr, uint32_t cycle_delay)
     uint32_t new_addr = addr & mem_mask;
     //printf("[VU%d] CallMS Starting execution at $%08X! Cur PC %x\n", get_id(), new_addr, PC);
 
+    if (threaded)
+    {
+        //A start while running is ignored, so leave the JIT alone. Otherwise make sure the thread is parked
+        if (running)
+            return;
+        wait_for_thread();
+    }
+
     //Enable this if disabling micromem disasm
     if (is_dirty())
     {
@@ -970,6 +1026,8 @@ void VectorUnit::start_program(uint32_t addr, uint32_t cycle_delay)
         //printf("[VU%d] Starting execution at PC %x!\n", id, PC);
         cycle_count = eecpu->get_cycle_count() - cycle_delay;
         flush_pipes();
+
+        //In threaded mode, the thread picks it up the next time the VU is updated, so VIF1 can finish MSCAL first
     }
     //disasm_micromem();
 }
@@ -989,8 +1047,19 @@ void VectorUnit::stop()
 void VectorUnit::stop_by_tbit()
 {
     tbit_stop = true;
+    raise_interrupt();
     running = false;
     flush_pipes();
+}
+
+void VectorUnit::raise_interrupt()
+{
+    //The INTC belongs to the EE thread
+    if (threaded)
+    {
+        thread_interrupt = true;
+        return;
+    }
 
     if (!get_id())
     {
@@ -1002,6 +1071,211 @@ void VectorUnit::stop_by_tbit()
     }
 }
 
+void VectorUnit::set_threaded(bool enabled)
+{
+    if (id != 1 || enabled == threaded)
+        return;
+
+    if (enabled)
+    {
+        thread_has_work = false;
+        thread_quit = false;
+        thread_pause = false;
+        thread_interrupt = false;
+        XGKICK_cycle_count = eecpu->get_cycle_count();
+        threaded = true;
+        program_thread = std::thread(&VectorUnit::thread_loop, this);
+    }
+    else
+    {
+        wait_for_thread();
+        {
+            std::lock_guard<std::mutex> lock(thread_mutex);
+            thread_quit = true;
+        }
+        thread_notifier.notify_all();
+        program_thread.join();
+        threaded = false;
+    }
+
+    //XGKICK is compiled differently in each mode
+    VU_JIT::reset(this);
+}
+
+/**
+ * Parks the program thread so the caller owns the VU until the next update_thread.
+ * The thread checks for this after every instruction or JIT block, so the wait is short even when the program
+ * is stuck waiting for something the EE has yet to do.
+ */
+void VectorUnit::pause_thread()
+{
+    std::unique_lock<std::mutex> lock(thread_mutex);
+    if (!thread_has_work)
+        return;
+
+    thread_pause = true;
+    thread_notifier.wait(lock, [this] { return !thread_has_work; });
+    thread_pause = false;
+}
+
+bool VectorUnit::thread_can_run()
+{
+    return running && !thread_pause && (int64_t)(cycle_count - thread_cycle_limit) < 0;
+}
+
+void VectorUnit::thread_loop()
+{
+    //Rounding mode is per-thread
+    fesetround(FE_TOWARDZERO);
+
+    std::unique_lock<std::mutex> lock(thread_mutex);
+    while (true)
+    {
+        thread_notifier.wait(lock, [this] { return thread_has_work || thread_quit; });
+        if (thread_quit)
+            return;
+        lock.unlock();
+
+        if (thread_use_jit)
+        {
+            while (thread_can_run())
+                cycle_count += VU_JIT::run(this);
+        }
+        else
+        {
+            while (thread_can_run())
+            {
+                cycle_count++;
+                update_mac_pipeline();
+                update_DIV_EFU_pipes();
+                int_branch_pipeline.update();
+                execute_instruction();
+            }
+        }
+
+        lock.lock();
+        thread_has_work = false;
+        thread_notifier.notify_all();
+    }
+}
+
+//Runs on the EE thread in place of the usual lockstep update
+void VectorUnit::update_thread(bool jit)
+{
+    thread_cycle_limit = eecpu->get_cycle_count() + THREAD_RUN_AHEAD;
+
+    {
+        //Picks up new programs as well as ones that were paused or ran out of cycles
+        std::lock_guard<std::mutex> lock(thread_mutex);
+        if (running && !thread_has_work)
+        {
+            thread_use_jit = jit;
+            thread_has_work = true;
+            thread_notifier.notify_all();
+        }
+    }
+
+    if (thread_interrupt.exchange(false))
+        intc->assert_IRQ((int)Interrupt::VU1);
+
+    feed_queued_XGKICK();
+}
+
+//Copies out a whole GIF packet, as the program is free to overwrite the buffer once the transfer is queued
+void VectorUnit::queue_XGKICK(uint16_t addr)
+{
+    std::vector<uint128_t> packet;
+    bool end_of_packet = false;
+    const size_t max_quads = (mem_mask + 1) / 16;
+
+    while (!end_of_packet && packet.size() < max_quads)
+    {
+        uint128_t tag = read_mem<uint128_t>(addr);
+        addr = (addr + 16) & mem_mask;
+        packet.push_back(tag);
+
+        uint64_t nloop = tag._u64[0] & 0x7FFF;
+        end_of_packet = tag._u64[0] & (1 << 15);
+        uint8_t format = (tag._u64[0] >> 58) & 0x3;
+        uint64_t nregs = tag._u64[0] >> 60;
+        if (!nregs)
+            nregs = 16;
+
+        uint64_t quads;
+        switch (format)
+        {
+            case 0:
+                quads = nloop * nregs;
+                break;
+            case 1:
+                quads = (nloop * nregs + 1) / 2;
+                break;
+            default:
+                quads = nloop;
+                break;
+        }
+
+        while (quads-- && packet.size() < max_quads)
+        {
+            packet.push_back(read_mem<uint128_t>(addr));
+            addr = (addr + 16) & mem_mask;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(XGKICK_mutex);
+    XGKICK_queue.push_back(std::move(packet));
+    XGKICK_queued++;
+}
+
+void VectorUnit::feed_queued_XGKICK()
+{
+    uint64_t now = eecpu->get_cycle_count();
+    int cycles = now - XGKICK_cycle_count;
+    XGKICK_cycle_count = now;
+
+    while (true)
+    {
+        if (!transferring_GIF)
+        {
+            if (!XGKICK_queued)
+                return;
+
+            {
+                std::lock_guard<std::mutex> lock(XGKICK_mutex);
+                XGKICK_packet = std::move(XGKICK_queue.front());
+                XGKICK_queue.pop_front();
+            }
+            XGKICK_queued--;
+            XGKICK_packet_pos = 0;
+            transferring_GIF = true;
+        }
+
+        gif->request_PATH(1, true);
+        XGKICK_cycles += cycles;
+        cycles = 0;
+        while (XGKICK_cycles >= 2)
+        {
+            if (!gif->path_active(1, true))
+            {
+                XGKICK_cycles = 0;
+                return;
+            }
+
+            XGKICK_cycles -= 2;
+            bool done = gif->send_PATH1(XGKICK_packet[XGKICK_packet_pos++]);
+            if (done || XGKICK_packet_pos == XGKICK_packet.size())
+            {
+                gif->deactivate_PATH(1);
+                transferring_GIF = false;
+                break;
+            }
+        }
+
+        if (transferring_GIF)
+            return;
+    }
+}
+
 float VectorUnit::update_mac_flags(float value, int index)
 {
     uint32_t value_u = *(uint32_t*)&value;
@@ -1119,6 +1393,30 @@ void VectorUnit::update_DIV_EFU_pipes()
     }
 }
 
+//Steps the pipelines over cycles in which no instruction enters them. Their inputs don't change meanwhile,
+//so they settle after a few cycles and only the status delay is left to count down
+void VectorUnit::advance_pipelines(int cycles)
+{
+    int settle_cycles = std::min(cycles, (int)VuIntBranchPipeline::length);
+    for (int i = 0; i < settle_cycles; i++)
+    {
+        update_mac_pipeline();
+        int_branch_pipeline.update();
+    }
+
+    int idle_cycles = cycles - settle_cycles;
+    if (status_pipe > 0 && idle_cycles > 0)
+    {
+        if (idle_cycles >= status_pipe)
+        {
+            status_pipe = 0;
+            status = (status & 0x3F) | (status_value & 0xFFF);
+        }
+        else
+            status_pipe -= idle_cycles;
+    }
+}
+
 void VectorUnit::start_DIV_unit(int latency)
 {
     finish_DIV_event = cycle_count + latency;
@@ -3202,11 +3500,10 @@ void VectorUnit::waitp(uint32_t instr)
         return;
     //Stalls actually release 1 cycle before writeback, but should be safe to write back early if we are stalling
     finish_EFU_event -= 1;
-    while (cycle_count < finish_EFU_event)
+    if (cycle_count < finish_EFU_event)
     {
-        cycle_count++;
-        update_mac_pipeline();
-        int_branch_pipeline.update();
+        advance_pipelines(finish_EFU_event - cycle_count);
+        cycle_count = finish_EFU_event;
     }
     update_DIV_EFU_pipes();
 }
@@ -3216,11 +3513,10 @@ void VectorUnit::waitq(uint32_t instr)
     if (!DIV_event_started)
         return;
 
-    while (cycle_count < finish_DIV_event)
+    if (cycle_count < finish_DIV_event)
     {
-        cycle_count++;
-        update_mac_pipeline();
-        int_branch_pipeline.update();
+        advance_pipelines(finish_DIV_event - cycle_count);
+        cycle_count = finish_DIV_event;
     }
     update_DIV_EFU_pipes();
 }
@@ -3234,6 +3530,12 @@ void VectorUnit::xgkick(uint32_t instr)
     }
     printf("[VU1] XGKICK: Addr $%08X\n", (int_gpr[_is_].u & 0x3ff) * 16);
 
+    if (threaded)
+    {
+        queue_XGKICK((int_gpr[_is_].u & 0x3ff) * 16);
+        return;
+    }
+
     //If an XGKICK transfer is ongoing, completely stall the VU until the first transfer has finished.
     //Note: a real VU executes for one or two more cycles before stalling due to pipelining.
     if (transferring_GIF)
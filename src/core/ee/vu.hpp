@@ -1,9 +1,15 @@
 #ifndef VU_HPP
 #define VU_HPP
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdio>
+#include <deque>
 #include <fstream>
+#include <mutex>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 #include "emotion.hpp"
 #include "../int128.hpp"
 
@@ -79,6 +85,7 @@ class GraphicsInterface;
 class Emulator;
 class VU_JIT64;
 class VectorUnit;
+struct VU_DecodedInstr;
 class INTC;
 class EmotionEngine;
 
@@ -105,9 +112,17 @@ class VectorUnit
 
         std::unordered_set<uint32_t> seen_microprogram_crcs;
 
-        bool running;
+        std::atomic<bool> running;
         bool tbit_stop;
         bool vumem_is_dirty;
+
+        //The microprogram CRC is kept for each 1 KB chunk of micro memory, so only rewritten chunks are rehashed
+        constexpr static int MICROMEM_CHUNK_SHIFT = 10;
+        uint32_t micromem_chunk_crc[16];
+        uint16_t micromem_dirty_chunks;
+
+        //Interpreter decode cache, one entry per doubleword of micro memory
+        VU_DecodedInstr* decoded_instrs;
         uint16_t PC, new_PC, secondbranch_PC;
         bool branch_on, branch_on_delay;
         bool finish_on;
@@ -120,6 +135,36 @@ class VectorUnit
         uint16_t stalled_GIF_addr;
         int XGKICK_cycles;
 
+        /**
+         * Threaded mode (VU1 only). Programs started by the EE or VIF1 run to completion on a separate host
+         * thread, without being held back by EE cycles. The thread only owns the VU while running is set.
+         *
+         * XGKICK copies the whole packet out of VU memory when it is kicked, and the EE thread feeds the
+         * queued packets to PATH1 in order at the usual rate. Interrupts are also raised from the EE thread.
+         *
+         * Before the EE, DMAC or VIF1 touch VU1 memory or registers, wait_for_thread pauses the program at
+         * the next instruction (or JIT block), so a program waiting on the EE can't hold it up. Every update
+         * from the EE thread hands the program back to the thread, which may then run up to
+         * THREAD_RUN_AHEAD cycles past the EE before it parks and waits for the next one.
+         */
+        constexpr static int THREAD_RUN_AHEAD = 1 << 16;
+
+        bool threaded;
+        std::thread program_thread;
+        std::mutex thread_mutex;
+        std::condition_variable thread_notifier;
+        bool thread_has_work, thread_quit, thread_use_jit;
+        std::atomic<bool> thread_pause;
+        std::atomic<uint64_t> thread_cycle_limit;
+        std::atomic<bool> thread_interrupt;
+
+        std::mutex XGKICK_mutex;
+        std::deque<std::vector<uint128_t>> XGKICK_queue;
+        std::atomic<int> XGKICK_queued;
+        std::vector<uint128_t> XGKICK_packet;
+        size_t XGKICK_packet_pos;
+        uint64_t XGKICK_cycle_count;
+
         //GPR
         VU_GPR backup_newgpr;
         VU_GPR backup_oldgpr;
@@ -177,8 +222,19 @@ class VectorUnit
         void update_status();
         void advance_r();
         void print_vectors(uint8_t a, uint8_t b);
+
+        void execute_instruction();
+        void raise_interrupt();
+
+        void thread_loop();
+        bool thread_can_run();
+        void pause_thread();
+        void queue_XGKICK(uint16_t addr);
+        void feed_queued_XGKICK();
+        void update_thread(bool jit);
     public:
         VectorUnit(int id, Emulator* e, INTC* intc, EmotionEngine* eecpu, VectorUnit* other_vu);
+        ~VectorUnit();
 
         DecodedRegs decoder;
 
@@ -191,6 +247,7 @@ class VectorUnit
 
         void update_mac_pipeline();
         void update_DIV_EFU_pipes();
+        void advance_pipelines(int cycles);
         void check_for_FMAC_stall();
         void check_for_COP2_FMAC_stall();
         void flush_pipes();
@@ -203,6 +260,8 @@ class VectorUnit
         void update_XGKick();
         void handle_XGKICK();
         void start_program(uint32_t addr, uint32_t cycle_delay);
+        void set_threaded(bool enabled);
+        void wait_for_thread();
         void end_execution();
         void stop();
         void stop_by_tbit();
@@ -232,6 +291,7 @@ class VectorUnit
         bool stopped_by_tbit();
         bool is_dirty();
         void clear_dirty();
+        void set_micromem_dirty();
         uint16_t get_PC();
         void set_PC(uint32_t newPC);
         uint32_t get_gpr_u(int index, int field);
@@ -395,6 +455,7 @@ class VectorUnit
         friend class EE_JitTranslator;
 
         friend void vu_update_xgkick(VectorUnit& vu, int cycles);
+        friend void vu_queue_xgkick(VectorUnit& vu);
         friend void vu_update_pipelines(VectorUnit& vu, int cycles);
         friend uint8_t* exec_block_vu(VU_JIT64& jit, VectorUnit& vu);
         friend uint8_t* exec_block_ee(EE_JIT64& jit, EmotionEngine& ee);
@@ -427,6 +488,7 @@ inline void VectorUnit::write_instr(uint32_t addr, T data)
 {
     *(T*)&instr_mem.m[addr & mem_mask] = data;
     vumem_is_dirty = true;
+    micromem_dirty_chunks |= 1 << ((addr & mem_mask) >> MICROMEM_CHUNK_SHIFT);
 }
 
 template <typename T>
@@ -448,9 +510,18 @@ inline void VectorUnit::write_mem(uint32_t addr, T data)
 
 inline bool VectorUnit::is_running()
 {
+    //Packets that haven't started on PATH1 yet still belong to the program
+    if (threaded)
+        return running || XGKICK_queued;
     return running || (eecpu->get_cycle_count() < cycle_count);
 }
 
+inline void VectorUnit::wait_for_thread()
+{
+    if (threaded)
+        pause_thread();
+}
+
 inline bool VectorUnit::stopped_by_tbit()
 {
     return tbit_stop;
@@ -466,6 +537,12 @@ inline void VectorUnit::clear_dirty()
     vumem_is_dirty = false;
 }
 
+inline void VectorUnit::set_micromem_dirty()
+{
+    vumem_is_dirty = true;
+    micromem_dirty_chunks = 0xFFFF;
+}
+
 inline int VectorUnit::get_id()
 {
     return id;
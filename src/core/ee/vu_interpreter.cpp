@@ -19,7 +19,9 @@
 namespace VU_Interpreter
 {
 typedef void(VectorUnit::*vu_op)(uint32_t);
-vu_op upper_op, lower_op;
+
+//Thread local as VU1 may be interpreted or translated on its own thread
+thread_local vu_op upper_op, lower_op;
 
 void call_upper(VectorUnit &vu, uint32_t instr)
 {
@@ -33,61 +35,99 @@ void call_lower(VectorUnit &vu, uint32_t instr)
 
 void interpret(VectorUnit &vu, uint32_t upper_instr, uint32_t lower_instr)
 {
+    VU_DecodedInstr entry;
+    decode(vu, entry, upper_instr, lower_instr);
+    interpret(vu, entry);
+}
+
+void decode(VectorUnit &vu, VU_DecodedInstr &entry, uint32_t upper_instr, uint32_t lower_instr)
+{
+    //The decoder state still belongs to the previous instruction until this one executes
+    DecodedRegs prev_regs = vu.decoder;
+
+    entry.upper_instr = upper_instr;
+    entry.lower_instr = lower_instr;
+    entry.flags = VU_DecodedInstr::VALID;
+
     //WaitQ, DIV, RSQRT, SQRT
     if (((lower_instr & 0x800007FC) == 0x800003BC))
-    {
-        vu.waitq(0);
-    }
+        entry.flags |= VU_DecodedInstr::WAITQ;
 
     if ((lower_instr & (1 << 31)) && ((lower_instr >> 2) & 0x1CF) == 0x1CF)
-    {
-        vu.waitp(0);
-    }
+        entry.flags |= VU_DecodedInstr::WAITP;
 
     vu.decoder.reset();
 
     //Get upper op
     upper(vu, upper_instr);
+    entry.upper_op = upper_op;
+    entry.lower_op = nullptr;
 
     //Get lower op
-    if (!(upper_instr & (1 << 31)))
+    if (upper_instr & (1 << 31))
+        entry.flags |= VU_DecodedInstr::LOI;
+    else
+    {
         lower(vu, lower_instr);
+        entry.lower_op = lower_op;
+    }
+
+    DecodedRegs& regs = vu.decoder;
+    if (regs.vf_read0[0] || regs.vf_read0[1] || regs.vf_read1[0] || regs.vf_read1[1] ||
+            regs.vi_read0 || regs.vi_read1)
+        entry.flags |= VU_DecodedInstr::READS_REGS;
+
+    //If the upper op is writing to a reg the lower op is reading from, the lower op executes first
+    //Also used to handle if upper and lower write to the same register, upper gets priority
+    int write = regs.vf_write[0];
+    if (write && (write == regs.vf_read0[1] || write == regs.vf_read1[1] || write == regs.vf_write[1]))
+        entry.flags |= VU_DecodedInstr::LOWER_FIRST;
+
+    entry.regs = regs;
+    vu.decoder = prev_regs;
+}
+
+void interpret(VectorUnit &vu, const VU_DecodedInstr &entry)
+{
+    uint32_t upper_instr = entry.upper_instr;
+    uint32_t lower_instr = entry.lower_instr;
+
+    if (entry.flags & VU_DecodedInstr::WAITQ)
+        vu.waitq(0);
+
+    if (entry.flags & VU_DecodedInstr::WAITP)
+        vu.waitp(0);
+
+    vu.decoder = entry.regs;
 
     // check for stalls before execution
-    vu.check_for_FMAC_stall();
-    
+    if (entry.flags & VU_DecodedInstr::READS_REGS)
+        vu.check_for_FMAC_stall();
+
     //LOI - upper op always executes first
-    if (upper_instr & (1 << 31))
+    if (entry.flags & VU_DecodedInstr::LOI)
     {
-        (vu.*upper_op)(upper_instr);
+        (vu.*entry.upper_op)(upper_instr);
         vu.set_I(lower_instr);
     }
+    else if (entry.flags & VU_DecodedInstr::LOWER_FIRST)
+    {
+        int write = entry.regs.vf_write[0];
+        vu.backup_vf(false, write);
+
+        (vu.*entry.upper_op)(upper_instr);
+
+        vu.backup_vf(true, write);
+        vu.restore_vf(false, write);
+
+        (vu.*entry.lower_op)(lower_instr);
+
+        vu.restore_vf(true, write);
+    }
     else
     {
-        //If the upper op is writing to a reg the lower op is reading from, the lower op executes first
-        //Also used to handle if upper and lower write to the same register, upper gets priority
-        int write = vu.decoder.vf_write[0];
-        int write1 = vu.decoder.vf_write[1];
-        int read0 = vu.decoder.vf_read0[1];
-        int read1 = vu.decoder.vf_read1[1];
-        if (write && ((write == read0 || write == read1) || (write == write1)))
-        {
-            vu.backup_vf(false, write);
-
-            (vu.*upper_op)(upper_instr);
-
-            vu.backup_vf(true, write);
-            vu.restore_vf(false, write);
-
-            (vu.*lower_op)(lower_instr);
-
-            vu.restore_vf(true, write);
-        }
-        else
-        {
-            (vu.*upper_op)(upper_instr);
-            (vu.*lower_op)(lower_instr);
-        }
+        (vu.*entry.upper_op)(upper_instr);
+        (vu.*entry.lower_op)(lower_instr);
     }
 
     if (upper_instr & (1 << 29) && vu.get_id() == 0)
@@ -2,10 +2,36 @@
 #define VU_INTERPRETER_HPP
 #include "vu.hpp"
 
+/**
+ * An upper/lower instruction pair with its handlers and register usage already worked out.
+ * The raw words are kept so that a stale entry is noticed however micro memory was rewritten.
+ */
+struct VU_DecodedInstr
+{
+    enum Flags : uint8_t
+    {
+        VALID = 1 << 0,
+        WAITQ = 1 << 1,
+        WAITP = 1 << 2,
+        LOI = 1 << 3,
+        READS_REGS = 1 << 4, //Skip the FMAC stall check when nothing is read
+        LOWER_FIRST = 1 << 5 //Upper writes a register the lower op uses
+    };
+
+    uint32_t upper_instr, lower_instr;
+    void (VectorUnit::*upper_op)(uint32_t);
+    void (VectorUnit::*lower_op)(uint32_t);
+    DecodedRegs regs;
+    uint8_t flags;
+};
+
 namespace VU_Interpreter
 {
     void interpret(VectorUnit& vu, uint32_t upper_instr, uint32_t lower_instr);
 
+    void decode(VectorUnit& vu, VU_DecodedInstr& entry, uint32_t upper_instr, uint32_t lower_instr);
+    void interpret(VectorUnit& vu, const VU_DecodedInstr& entry);
+
     void call_upper(VectorUnit& vu, uint32_t instr);
     void call_lower(VectorUnit& vu, uint32_t instr);
 
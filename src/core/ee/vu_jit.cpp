@@ -25,7 +25,12 @@ void reset(VectorUnit *vu)
 
 void set_current_program(uint32_t crc, VectorUnit *vu)
 {
-    jit64[vu->get_id()].set_current_program(crc);
+    jit64[vu->get_id()].set_current_program(crc, *vu);
+}
+
+void set_disk_cache_directory(const std::string& directory, VectorUnit *vu)
+{
+    jit64[vu->get_id()].set_disk_cache_directory(directory, vu->get_id());
 }
 
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef VU_JIT_HPP
 #define VU_JIT_HPP
 #include <cstdint>
+#include <string>
 
 class VectorUnit;
 
@@ -10,6 +11,7 @@ namespace VU_JIT
 uint16_t run(VectorUnit* vu);
 void reset(VectorUnit *vu);
 void set_current_program(uint32_t crc, VectorUnit *vu);
+void set_disk_cache_directory(const std::string& directory, VectorUnit *vu);
 
 };
 
@@ -34,6 +34,8 @@
 VU_JIT64::VU_JIT64() : jit_block("VU"), emitter(&jit_block)
 {
     prologue_block = nullptr;
+    use_avx = Emitter64::host_has_avx();
+    use_avx2 = use_avx && Emitter64::host_has_avx2();
     for (int i = 0; i < 4; i++)
     {
         ftoi_table[0].f[i] = pow(2, 0);
@@ -154,6 +156,11 @@ void vu_update_xgkick(VectorUnit& vu, int cycles)
     }
 }
 
+void vu_queue_xgkick(VectorUnit& vu)
+{
+    vu.queue_XGKICK(vu.GIF_addr);
+}
+
 void interpreter_upper(VectorUnit& vu, uint32_t instr)
 {
     VU_Interpreter::upper(vu, instr);
@@ -197,6 +204,7 @@ void VU_JIT64::reset(bool clear_cache)
 
     if (clear_cache)
     {
+        disk_cache.flush();
         jit_heap.flush_all_blocks();
         create_prologue_block();
     }
@@ -206,12 +214,40 @@ void VU_JIT64::reset(bool clear_cache)
     should_update_mac = false;
     prev_pc = 0xFFFFFFFF;
     current_program = 0;
+    jit_heap.set_current_program(0);
 }
 
-void VU_JIT64::set_current_program(uint32_t crc)
+void VU_JIT64::set_current_program(uint32_t crc, VectorUnit& vu)
 {
+    //Blocks found during the last program are queued for writing now, rather than while it's running
+    disk_cache.flush();
+
+    //Blocks compiled for the program earlier are still on the heap unless it was evicted
     reset(false);
     current_program = crc;
+    jit_heap.set_current_program(crc);
+    preload_program(vu);
+}
+
+void VU_JIT64::set_disk_cache_directory(const std::string &directory, int vu_id)
+{
+    disk_cache.set_directory(directory, vu_id);
+}
+
+//Compiles every block of the current program seen in earlier sessions, so they don't hitch the first time they run
+void VU_JIT64::preload_program(VectorUnit &vu)
+{
+    if (!disk_cache.is_enabled() || !current_program)
+        return;
+
+    for (const VU_CachedBlock& cached : disk_cache.get_program(current_program))
+    {
+        if (!jit_heap.find_block(cached.state))
+        {
+            IR::Block block = cached.to_block();
+            recompile_block(vu, block, cached.state);
+        }
+    }
 }
 
 uint64_t VU_JIT64::get_vf_addr(VectorUnit &vu, int index)
@@ -237,6 +273,21 @@ uint64_t VU_JIT64::get_vf_addr(VectorUnit &vu, int index)
     return 0;
 }
 
+//Copies lane bc of source to all four lanes of dest. bc is the expanded SHUFPS immediate
+void VU_JIT64::broadcast_bc(uint8_t bc, REG_64 source, REG_64 dest)
+{
+    if (use_avx2 && !bc)
+        emitter.VPBROADCASTD(source, dest);
+    else if (use_avx)
+        emitter.VPERMILPS(bc, source, dest);
+    else
+    {
+        if (source != dest)
+            emitter.MOVAPS_REG(source, dest);
+        emitter.SHUFPS(bc, dest, dest);
+    }
+}
+
 void VU_JIT64::clamp_vfreg(uint8_t field, REG_64 xmm_reg)
 {
     if (needs_clamping(xmm_reg, field))
@@ -251,14 +302,26 @@ void VU_JIT64::clamp_vfreg(uint8_t field, REG_64 xmm_reg)
             if (xmm_reg == temp_reg)
                 temp_reg = REG_64::XMM0;
 
-            emitter.MOVAPS_REG(xmm_reg, temp_reg);
-            //reg = min_signed(reg, 0x7F7FFFFF)
-            emitter.PMINSD_XMM_FROM_MEM(REG_64::RAX, temp_reg);
+            if (use_avx)
+            {
+                emitter.VPMINSD_FROM_MEM(xmm_reg, REG_64::RAX, temp_reg);
+                emitter.VPMINUD_FROM_MEM(temp_reg, REG_64::R15, temp_reg);
+            }
+            else
+            {
+                emitter.MOVAPS_REG(xmm_reg, temp_reg);
+                //reg = min_signed(reg, 0x7F7FFFFF)
+                emitter.PMINSD_XMM_FROM_MEM(REG_64::RAX, temp_reg);
 
-            //reg = min_unsigned(reg, 0xFF7FFFFF)
-            emitter.PMINUD_XMM_FROM_MEM(REG_64::R15, temp_reg);
+                //reg = min_unsigned(reg, 0xFF7FFFFF)
+                emitter.PMINUD_XMM_FROM_MEM(REG_64::R15, temp_reg);
+            }
 
-            emitter.BLENDPS(field, temp_reg, xmm_reg);
+            //The clamp is done on integers, so stay in the integer domain for the blend
+            if (use_avx2)
+                emitter.VPBLENDD(field, xmm_reg, temp_reg, xmm_reg);
+            else
+                emitter.BLENDPS(field, temp_reg, xmm_reg);
             set_clamping(xmm_reg, false, field);
         }
         else
@@ -479,7 +542,7 @@ void VU_JIT64::store_int(VectorUnit &vu, IR::Instruction &instr)
     emitter.MOVZX16_TO_64(source, REG_64::RAX);
     //Move to XMM and populate all 4 vectors
     emitter.MOVD_TO_XMM(REG_64::RAX, temp2);
-    emitter.SHUFPS(0, temp2, temp2);
+    broadcast_bc(0, temp2, temp2);
     //Combine it with the original memory and put it back
     emitter.BLENDPS(field, temp2, temp);
     emitter.MOVAPS_TO_MEM(temp, REG_64::R15);
@@ -1231,8 +1294,7 @@ void VU_JIT64::max_vector_by_scalar(VectorUnit &vu, IR::Instruction &instr)
     emitter.MOVAPS_REG(source, temp2);
     emitter.MOVAPS_REG(bc_reg, temp3);
 
-    emitter.MOVAPS_REG(bc_reg, temp);
-    emitter.SHUFPS(bc, temp, temp);
+    broadcast_bc(bc, bc_reg, temp);
 
     emitter.PMAXSD_XMM(source, temp);
     emitter.BLENDPS(field, temp, dest);
@@ -1296,8 +1358,7 @@ void VU_JIT64::min_vector_by_scalar(VectorUnit &vu, IR::Instruction &instr)
 
     emitter.MOVAPS_REG(source, temp2);
     emitter.MOVAPS_REG(bc_reg, temp3);
-    emitter.MOVAPS_REG(bc_reg, temp);
-    emitter.SHUFPS(bc, temp, temp);
+    broadcast_bc(bc, bc_reg, temp);
 
     emitter.PMINSD_XMM(source, temp);
     emitter.BLENDPS(field, temp, dest);
@@ -1352,14 +1413,19 @@ void VU_JIT64::add_vectors(VectorUnit &vu, IR::Instruction &instr)
     REG_64 op1 = alloc_sse_reg(vu, instr.get_source(), REG_STATE::READ);
     REG_64 op2 = alloc_sse_reg(vu, instr.get_source2(), REG_STATE::READ);
     REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
-    REG_64 temp = (field != 0xF || dest == op2 || !instr.get_dest()) ? REG_64::XMM0 : dest;
+    REG_64 temp = (field != 0xF || (dest == op2 && !use_avx) || !instr.get_dest()) ? REG_64::XMM0 : dest;
 
     clamp_vfreg(field, op1);
     clamp_vfreg(field, op2);
 
-    if (op1 != temp)
-        emitter.MOVAPS_REG(op1, temp);
-    emitter.ADDPS(op2, temp);
+    if (use_avx)
+        emitter.VADDPS(op1, op2, temp);
+    else
+    {
+        if (op1 != temp)
+            emitter.MOVAPS_REG(op1, temp);
+        emitter.ADDPS(op2, temp);
+    }
 
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
@@ -1386,9 +1452,7 @@ void VU_JIT64::add_vector_by_scalar(VectorUnit &vu, IR::Instruction &instr)
     bc |= (bc << 6) | (bc << 4) | (bc << 2);
 
     REG_64 temp = (field != 0xF || dest == source || !instr.get_dest()) ? REG_64::XMM0 : dest;
-    if (bc_reg != temp)
-        emitter.MOVAPS_REG(bc_reg, temp);
-    emitter.SHUFPS(bc, temp, temp);
+    broadcast_bc(bc, bc_reg, temp);
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
 
@@ -1412,14 +1476,19 @@ void VU_JIT64::sub_vectors(VectorUnit &vu, IR::Instruction &instr)
     REG_64 op1 = alloc_sse_reg(vu, instr.get_source(), REG_STATE::READ);
     REG_64 op2 = alloc_sse_reg(vu, instr.get_source2(), REG_STATE::READ);
     REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
-    REG_64 temp = (field != 0xF || dest == op2 || !instr.get_dest()) ? REG_64::XMM0 : dest;
+    REG_64 temp = (field != 0xF || (dest == op2 && !use_avx) || !instr.get_dest()) ? REG_64::XMM0 : dest;
 
     clamp_vfreg(field, op1);
     clamp_vfreg(field, op2);
 
-    if (op1 != temp)
-        emitter.MOVAPS_REG(op1, temp);
-    emitter.SUBPS(op2, temp);
+    if (use_avx)
+        emitter.VSUBPS(op1, op2, temp);
+    else
+    {
+        if (op1 != temp)
+            emitter.MOVAPS_REG(op1, temp);
+        emitter.SUBPS(op2, temp);
+    }
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
 
@@ -1446,8 +1515,7 @@ void VU_JIT64::sub_vector_by_scalar(VectorUnit &vu, IR::Instruction &instr)
 
     REG_64 temp = REG_64::XMM0;
     REG_64 temp2 = (field != 0xF || !instr.get_dest()) ? REG_64::XMM1 : dest;
-    emitter.MOVAPS_REG(bc_reg, temp);
-    emitter.SHUFPS(bc, temp, temp);
+    broadcast_bc(bc, bc_reg, temp);
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
 
@@ -1472,14 +1540,19 @@ void VU_JIT64::mul_vectors(VectorUnit &vu, IR::Instruction &instr)
     REG_64 op1 = alloc_sse_reg(vu, instr.get_source(), REG_STATE::READ);
     REG_64 op2 = alloc_sse_reg(vu, instr.get_source2(), REG_STATE::READ);
     REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
-    REG_64 temp = (field != 0xF || !instr.get_dest() || dest == op2) ? REG_64::XMM0 : dest;
+    REG_64 temp = (field != 0xF || !instr.get_dest() || (dest == op2 && !use_avx)) ? REG_64::XMM0 : dest;
 
     clamp_vfreg(field, op1);
     clamp_vfreg(field, op2);
 
-    if (op1 != temp)
-        emitter.MOVAPS_REG(op1, temp);
-    emitter.MULPS(op2, temp);
+    if (use_avx)
+        emitter.VMULPS(op1, op2, temp);
+    else
+    {
+        if (op1 != temp)
+            emitter.MOVAPS_REG(op1, temp);
+        emitter.MULPS(op2, temp);
+    }
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
 
@@ -1506,9 +1579,7 @@ void VU_JIT64::mul_vector_by_scalar(VectorUnit &vu, IR::Instruction &instr)
 
     REG_64 temp = (field != 0xF || !instr.get_dest() || dest == source) ? REG_64::XMM0 : dest;
 
-    if (bc_reg != temp)
-        emitter.MOVAPS_REG(bc_reg, temp);
-    emitter.SHUFPS(bc, temp, temp);
+    broadcast_bc(bc, bc_reg, temp);
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
 
@@ -1532,16 +1603,24 @@ void VU_JIT64::madd_vectors(VectorUnit &vu, IR::Instruction &instr)
     REG_64 op2 = alloc_sse_reg(vu, instr.get_source2(), REG_STATE::READ);
     REG_64 acc = alloc_sse_reg(vu, VU_SpecialReg::ACC, REG_STATE::READ);
     REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
-    REG_64 temp = (field != 0xF || !instr.get_dest() || dest == op2) ? REG_64::XMM0 : dest;
+    REG_64 temp = (field != 0xF || !instr.get_dest() || (dest == op2 && !use_avx)) ? REG_64::XMM0 : dest;
 
     clamp_vfreg(field, op1);
     clamp_vfreg(field, op2);
     clamp_vfreg(field, acc);
 
-    if (op1 != temp)
-        emitter.MOVAPS_REG(op1, temp);
-    emitter.MULPS(op2, temp);
-    emitter.ADDPS(acc, temp);
+    if (use_avx)
+    {
+        emitter.VMULPS(op1, op2, temp);
+        emitter.VADDPS(temp, acc, temp);
+    }
+    else
+    {
+        if (op1 != temp)
+            emitter.MOVAPS_REG(op1, temp);
+        emitter.MULPS(op2, temp);
+        emitter.ADDPS(acc, temp);
+    }
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
 
@@ -1609,9 +1688,7 @@ void VU_JIT64::madd_vector_by_scalar(VectorUnit &vu, IR::Instruction &instr)
 
     bc |= (bc << 6) | (bc << 4) | (bc << 2);
 
-    if (bc_reg != temp)
-        emitter.MOVAPS_REG(bc_reg, temp);
-    emitter.SHUFPS(bc, temp, temp);
+    broadcast_bc(bc, bc_reg, temp);
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
 
@@ -1644,8 +1721,7 @@ void VU_JIT64::madd_acc_by_scalar(VectorUnit &vu, IR::Instruction &instr)
 
     bc |= (bc << 6) | (bc << 4) | (bc << 2);
 
-    emitter.MOVAPS_REG(bc_reg, temp);
-    emitter.SHUFPS(bc, temp, temp);
+    broadcast_bc(bc, bc_reg, temp);
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
 
@@ -1721,8 +1797,7 @@ void VU_JIT64::msub_vector_by_scalar(VectorUnit &vu, IR::Instruction &instr)
 
     bc |= (bc << 6) | (bc << 4) | (bc << 2);
 
-    emitter.MOVAPS_REG(bc_reg, temp);
-    emitter.SHUFPS(bc, temp, temp);
+    broadcast_bc(bc, bc_reg, temp);
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
 
@@ -1760,8 +1835,7 @@ void VU_JIT64::msub_acc_by_scalar(VectorUnit &vu, IR::Instruction &instr)
 
     bc |= (bc << 6) | (bc << 4) | (bc << 2);
 
-    emitter.MOVAPS_REG(bc_reg, temp);
-    emitter.SHUFPS(bc, temp, temp);
+    broadcast_bc(bc, bc_reg, temp);
     set_clamping(temp, true, field);
     clamp_vfreg(field, temp);
 
@@ -2042,7 +2116,7 @@ void VU_JIT64::move_from_int(VectorUnit &vu, IR::Instruction &instr)
     //The 16-bit integer must be sign extended
     emitter.MOVSX16_TO_64(source, REG_64::RAX);
     emitter.MOVD_TO_XMM(REG_64::RAX, temp);
-    emitter.SHUFPS(0, temp, temp);
+    broadcast_bc(0, temp, temp);
     emitter.BLENDPS(field, temp, dest);
     set_clamping(dest, true, field);
 }
@@ -2188,8 +2262,7 @@ void VU_JIT64::move_from_p(VectorUnit &vu, IR::Instruction &instr)
     REG_64 p_reg = alloc_sse_reg(vu, VU_SpecialReg::P, REG_STATE::READ);
 
     REG_64 temp = REG_64::XMM0;
-    emitter.MOVAPS_REG(p_reg, temp);
-    emitter.SHUFPS(0, temp, temp);
+    broadcast_bc(0, p_reg, temp);
     emitter.BLENDPS(field, temp, dest);
     set_clamping(dest, true, field);
 }
@@ -2390,6 +2463,29 @@ void VU_JIT64::xgkick(VectorUnit &vu, IR::Instruction &instr)
         return;
     REG_64 base = alloc_int_reg(vu, instr.get_base(), REG_STATE::READ);
 
+    //On the VU thread, the packet is copied out and queued for the EE thread to send instead
+    if (vu.threaded)
+    {
+        emitter.MOV32_REG(base, REG_64::RAX);
+        emitter.SHL32_REG_IMM(4, REG_64::RAX);
+        emitter.AND32_EAX(vu.mem_mask);
+
+        emitter.load_addr((uint64_t)&vu.GIF_addr, REG_64::R15);
+        emitter.MOV16_TO_MEM(REG_64::RAX, REG_64::R15);
+
+        flush_regs(vu);
+        for (int i = 0; i < 16; i++)
+        {
+            xmm_regs[i].used = false;
+            xmm_regs[i].age = 0;
+            int_regs[i].used = false;
+            int_regs[i].age = 0;
+        }
+        prepare_abi(vu, (uint64_t)&vu);
+        call_abi_func((uint64_t)vu_queue_xgkick);
+        return;
+    }
+
     //Check if we're already transferring, and stall the VU if we are
     emitter.load_addr((uint64_t)&vu.transferring_GIF, REG_64::R15);
     emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX);
@@ -2450,7 +2546,7 @@ void VU_JIT64::xgkick(VectorUnit &vu, IR::Instruction &instr)
 
 void VU_JIT64::update_xgkick(VectorUnit &vu, IR::Instruction &instr)
 {
-    if (vu.get_id() == 0)
+    if (vu.get_id() == 0 || vu.threaded)
         return;
     flush_regs(vu);
     for (int i = 0; i < 16; i++)
@@ -2867,7 +2963,7 @@ void VU_JIT64::create_prologue_block()
 
     jit_block.print_block();
 
-    prologue_block = (VUJitPrologue)jit_heap.insert_block(state, &jit_block)->code_start;
+    prologue_block = (VUJitPrologue)jit_heap.insert_resident_block(state, &jit_block)->code_start;
 }
 
 void VU_JIT64::emit_prologue()
@@ -3184,7 +3280,7 @@ void VU_JIT64::emit_instruction(VectorUnit &vu, IR::Instruction &instr)
     }
 }
 
-VUJitBlockRecord* VU_JIT64::recompile_block(VectorUnit& vu, IR::Block& block)
+VUJitBlockRecord* VU_JIT64::recompile_block(VectorUnit& vu, IR::Block& block, const VUBlockState& state)
 {
     jit_block.clear();
 
@@ -3207,7 +3303,7 @@ VUJitBlockRecord* VU_JIT64::recompile_block(VectorUnit& vu, IR::Block& block)
     else
         cleanup_recompiler(vu, true);
 
-    return jit_heap.insert_block(VUBlockState{vu.get_PC(), prev_pc, current_program, vu.pipeline_state[0], vu.pipeline_state[1]}, &jit_block);
+    return jit_heap.insert_block(state, &jit_block);
 }
 
 void VU_JIT64::cleanup_recompiler(VectorUnit& vu, bool clear_regs)
@@ -3359,30 +3455,34 @@ extern "C"
 uint8_t* exec_block_vu(VU_JIT64& jit, VectorUnit& vu)
 {
     //fprintf(stderr, "[VU_JIT64] Executing block at $%04X, Prev PC $%04X Current Program %08X: recompiling\n", vu.PC, jit.prev_pc, jit.current_program);
-    VUJitBlockRecord* found_block = jit.jit_heap.find_block(VUBlockState
-        { vu.get_PC(), jit.prev_pc, jit.current_program, vu.pipeline_state[0], vu.pipeline_state[1] });
+    VUBlockState state{ vu.get_PC(), jit.prev_pc, jit.current_program, vu.pipeline_state[0], vu.pipeline_state[1] };
+    VUJitBlockRecord* found_block = jit.jit_heap.find_block(state);
 
     if (!found_block)
     {
         //fprintf(stderr, "[VU_JIT64] Block not found at $%04X, Prev PC $%04X Current Program %08X: recompiling\n", vu.PC, jit.prev_pc, jit.current_program);
-        IR::Block block = jit.ir.translate(vu, vu.get_instr_mem(), jit.prev_pc);
-        found_block = jit.recompile_block(vu, block);
+        bool use_disk_cache = jit.disk_cache.is_enabled() && jit.current_program;
+        const VU_CachedBlock* cached = use_disk_cache ? jit.disk_cache.find_block(state) : nullptr;
+
+        if (cached)
+        {
+            IR::Block block = cached->to_block();
+            found_block = jit.recompile_block(vu, block, state);
+        }
+        else
+        {
+            IR::Block block = jit.ir.translate(vu, vu.get_instr_mem(), jit.prev_pc);
+            if (use_disk_cache)
+                jit.disk_cache.add_block(state, block);
+            found_block = jit.recompile_block(vu, block, state);
+        }
     }
     return (uint8_t*)found_block->code_start;
 }
 
 uint16_t VU_JIT64::run(VectorUnit& vu)
 {
-    //Need to check we have space on the heap before running any recompiled code
-    //Resetting the heap during recompilation wipes out the prologue/epilogue!
-    //Checks for maximum 5mb block size of space before continuing
-    if (jit_heap.heap_is_full())
-    {
-        printf("[VU JIT] Not enough room for new blocks, clearing cache\n");
-        jit_heap.flush_all_blocks();
-        create_prologue_block();
-    }
-
+    //The prologue is resident, so running out of room while recompiling only evicts other programs' blocks
     prologue_block(*this, vu);
 
     return cycle_count;
@@ -2,6 +2,7 @@
 #define VU_JIT64_HPP
 #include "../jitcommon/emitter64.hpp"
 #include "../jitcommon/ir_block.hpp"
+#include "vu_jitdisk.hpp"
 #include "vu_jittrans.hpp"
 #include "vu.hpp"
 
@@ -39,6 +40,7 @@ class VU_JIT64
         AllocReg int_regs[16];
         JitBlock jit_block;
         VUJitHeap jit_heap;
+        VU_JitDiskCache disk_cache;
         Emitter64 emitter;
         VU_JitTranslator ir;
         VUJitPrologue prologue_block;
@@ -60,12 +62,19 @@ class VU_JIT64
         uint32_t prev_pc;
         bool should_update_mac;
 
+        //Three-operand VEX forms save the copies that preserve sources with legacy SSE
+        bool use_avx;
+
+        //Selects the AVX2 integer blends and broadcasts
+        bool use_avx2;
+
         bool vu_branch;
         bool end_of_program;
         uint16_t vu_branch_dest, vu_branch_fail_dest;
         uint16_t vu_branch_delay_dest, vu_branch_delay_fail_dest;
         uint16_t cycle_count;
 
+        void broadcast_bc(uint8_t bc, REG_64 source, REG_64 dest);
         void clamp_vfreg(uint8_t field, REG_64 xmm_reg);
         void sse_abs(REG_64 source, REG_64 dest);
         void sse_div_check(REG_64 num, REG_64 denom, VU_R& dest);
@@ -193,7 +202,8 @@ class VU_JIT64
         void create_prologue_block();
         void emit_prologue();
         void emit_instruction(VectorUnit& vu, IR::Instruction& instr);
-        VUJitBlockRecord* recompile_block(VectorUnit& vu, IR::Block& block);
+        VUJitBlockRecord* recompile_block(VectorUnit& vu, IR::Block& block, const VUBlockState& state);
+        void preload_program(VectorUnit& vu);
         void cleanup_recompiler(VectorUnit& vu, bool clear_regs);
         void emit_epilogue();
 
@@ -204,7 +214,8 @@ class VU_JIT64
         VU_JIT64();
 
         void reset(bool clear_cache = true);
-        void set_current_program(uint32_t crc);
+        void set_current_program(uint32_t crc, VectorUnit& vu);
+        void set_disk_cache_directory(const std::string& directory, int vu_id);
         uint16_t run(VectorUnit& vu);
 
         friend uint8_t* exec_block_vu(VU_JIT64& jit, VectorUnit& vu);
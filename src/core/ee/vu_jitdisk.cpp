@@ -0,0 +1,339 @@
+#include <cstdio>
+#include "vu_jitdisk.hpp"
+
+#include "../errors.hpp"
+
+using namespace std;
+
+//Set by the CMake build to a hash of the sources that shape the cached IR, so a changed translator discards old files.
+//Other builds use a fixed version, which has to be bumped by hand
+#ifndef VU_JIT_CACHE_VERSION
+#define VU_JIT_CACHE_VERSION 1
+#endif
+
+static const uint32_t VERSION = VU_JIT_CACHE_VERSION;
+
+IR::Block VU_CachedBlock::to_block() const
+{
+    IR::Block block;
+    for (IR::Instruction instr : instrs)
+        block.add_instr(instr);
+    block.set_cycle_count(cycle_count);
+    return block;
+}
+
+template <typename T>
+static void write_value(vector<char>& data, T value)
+{
+    data.insert(data.end(), (char*)&value, (char*)&value + sizeof(T));
+}
+
+template <typename T>
+static T read_value(ifstream& file)
+{
+    T value = T();
+    file.read((char*)&value, sizeof(T));
+    return value;
+}
+
+//The interpreter fallback pointer is only used by the EE and is not stored
+static void write_instr(vector<char>& data, const IR::Instruction& instr)
+{
+    write_value<uint32_t>(data, instr.op);
+    write_value<uint32_t>(data, instr.get_jump_dest());
+    write_value<uint32_t>(data, instr.get_jump_fail_dest());
+    write_value<uint32_t>(data, instr.get_return_addr());
+    write_value<int32_t>(data, instr.get_dest());
+    write_value<int32_t>(data, instr.get_base());
+    write_value<uint64_t>(data, instr.get_source());
+    write_value<uint64_t>(data, instr.get_source2());
+    write_value<uint16_t>(data, instr.get_cycle_count());
+    write_value<uint8_t>(data, instr.get_bc());
+    write_value<uint8_t>(data, instr.get_field());
+    write_value<uint8_t>(data, instr.get_field2());
+    write_value<uint8_t>(data, instr.get_is_likely());
+    write_value<uint8_t>(data, instr.get_is_link());
+    write_value<uint32_t>(data, instr.get_opcode());
+}
+
+static IR::Instruction read_instr(ifstream& file)
+{
+    IR::Instruction instr((IR::Opcode)read_value<uint32_t>(file));
+    instr.set_jump_dest(read_value<uint32_t>(file));
+    instr.set_jump_fail_dest(read_value<uint32_t>(file));
+    instr.set_return_addr(read_value<uint32_t>(file));
+    instr.set_dest(read_value<int32_t>(file));
+    instr.set_base(read_value<int32_t>(file));
+    instr.set_source(read_value<uint64_t>(file));
+    instr.set_source2(read_value<uint64_t>(file));
+    instr.set_cycle_count(read_value<uint16_t>(file));
+    instr.set_bc(read_value<uint8_t>(file));
+    instr.set_field(read_value<uint8_t>(file));
+    instr.set_field2(read_value<uint8_t>(file));
+    instr.set_is_likely(read_value<uint8_t>(file));
+    instr.set_is_link(read_value<uint8_t>(file));
+    instr.set_opcode(read_value<uint32_t>(file));
+    return instr;
+}
+
+VU_JitDiskCache::VU_JitDiskCache() : vu_id(0), writer_exit(false)
+{
+
+}
+
+VU_JitDiskCache::~VU_JitDiskCache()
+{
+    flush();
+    finish_writes();
+}
+
+void VU_JitDiskCache::set_directory(const string &directory, int vu_id)
+{
+    flush();
+    finish_writes();
+    programs.clear();
+    this->directory = directory;
+    this->vu_id = vu_id;
+
+    if (is_enabled())
+        load_directory();
+}
+
+string VU_JitDiskCache::get_file_name(uint32_t crc)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/vu%d_%08X.bin", vu_id, crc);
+    return directory + name;
+}
+
+string VU_JitDiskCache::get_index_file_name()
+{
+    return directory + "/vu" + to_string(vu_id) + "_index.bin";
+}
+
+//Programs missing from the index are new, the index being read when the directory is set
+VU_JitDiskCache::Program& VU_JitDiskCache::get_or_create(uint32_t crc)
+{
+    auto it = programs.find(crc);
+    if (it != programs.end())
+        return it->second;
+
+    Program& program = programs[crc];
+    program.dirty = false;
+    program.on_disk = false;
+    return program;
+}
+
+void VU_JitDiskCache::load_directory()
+{
+    ifstream index(get_index_file_name(), ios::binary);
+    if (!index.is_open())
+        return;
+
+    if (read_value<uint32_t>(index) != INDEX_MAGIC || read_value<uint32_t>(index) != VERSION)
+    {
+        //Every program file is stale too, and each is rewritten as the program is seen again
+        Errors::print_warning("[VU JIT] Ignoring cache index from an older version\n");
+        return;
+    }
+
+    uint32_t program_count = read_value<uint32_t>(index);
+    for (uint32_t i = 0; i < program_count && index.good(); i++)
+    {
+        uint32_t crc = read_value<uint32_t>(index);
+        if (!index.good())
+            break;
+
+        Program& program = get_or_create(crc);
+        ifstream file(get_file_name(crc), ios::binary);
+        if (file.is_open() && read_program(file, crc, program))
+        {
+            program.on_disk = true;
+        }
+        else
+        {
+            //Stale or damaged, the file will be rewritten from scratch
+            Errors::print_warning("[VU JIT] Ignoring invalid cache file for program $%08X\n", crc);
+            program.blocks.clear();
+            program.lookup.clear();
+        }
+    }
+}
+
+bool VU_JitDiskCache::read_program(ifstream &file, uint32_t crc, Program &program)
+{
+    if (read_value<uint32_t>(file) != MAGIC || read_value<uint32_t>(file) != VERSION)
+        return false;
+    if (read_value<uint32_t>(file) != crc)
+        return false;
+
+    uint32_t block_count = read_value<uint32_t>(file);
+    for (uint32_t i = 0; i < block_count && file.good(); i++)
+    {
+        VU_CachedBlock block;
+        block.state.pc = read_value<uint32_t>(file);
+        block.state.prev_pc = read_value<uint32_t>(file);
+        block.state.program = crc;
+        block.state.param1 = read_value<uint64_t>(file);
+        block.state.param2 = read_value<uint64_t>(file);
+        block.cycle_count = read_value<int32_t>(file);
+
+        uint32_t instr_count = read_value<uint32_t>(file);
+        for (uint32_t j = 0; j < instr_count && file.good(); j++)
+            block.instrs.push_back(read_instr(file));
+
+        program.lookup[block.state] = program.blocks.size();
+        program.blocks.push_back(std::move(block));
+    }
+
+    return file.good();
+}
+
+void VU_JitDiskCache::write_program(uint32_t crc, Program &program, vector<char>& data)
+{
+    write_value<uint32_t>(data, MAGIC);
+    write_value<uint32_t>(data, VERSION);
+    write_value<uint32_t>(data, crc);
+    write_value<uint32_t>(data, program.blocks.size());
+
+    for (VU_CachedBlock& block : program.blocks)
+    {
+        write_value<uint32_t>(data, block.state.pc);
+        write_value<uint32_t>(data, block.state.prev_pc);
+        write_value<uint64_t>(data, block.state.param1);
+        write_value<uint64_t>(data, block.state.param2);
+        write_value<int32_t>(data, block.cycle_count);
+
+        write_value<uint32_t>(data, block.instrs.size());
+        for (IR::Instruction& instr : block.instrs)
+            write_instr(data, instr);
+    }
+}
+
+void VU_JitDiskCache::write_index(vector<char> &data)
+{
+    uint32_t program_count = 0;
+    for (auto& program : programs)
+        program_count += program.second.on_disk;
+
+    write_value<uint32_t>(data, INDEX_MAGIC);
+    write_value<uint32_t>(data, VERSION);
+    write_value<uint32_t>(data, program_count);
+    for (auto& program : programs)
+    {
+        if (program.second.on_disk)
+            write_value<uint32_t>(data, program.first);
+    }
+}
+
+void VU_JitDiskCache::queue_write(string file_name, vector<char> data)
+{
+    lock_guard<mutex> lock(writer_mutex);
+    if (!writer.joinable())
+    {
+        writer_exit = false;
+        writer = thread(&VU_JitDiskCache::writer_loop, this);
+    }
+
+    pending_writes.push_back({std::move(file_name), std::move(data)});
+    writer_notify.notify_one();
+}
+
+//Waits for every queued file to be written and stops the writer
+void VU_JitDiskCache::finish_writes()
+{
+    {
+        lock_guard<mutex> lock(writer_mutex);
+        if (!writer.joinable())
+            return;
+        writer_exit = true;
+        writer_notify.notify_one();
+    }
+    writer.join();
+}
+
+void VU_JitDiskCache::writer_loop()
+{
+    unique_lock<mutex> lock(writer_mutex);
+    while (true)
+    {
+        writer_notify.wait(lock, [this]() { return writer_exit || !pending_writes.empty(); });
+        if (pending_writes.empty())
+            return;
+
+        PendingWrite write = std::move(pending_writes.front());
+        pending_writes.pop_front();
+
+        lock.unlock();
+        ofstream file(write.file_name, ios::binary | ios::trunc);
+        if (file.is_open())
+            file.write(write.data.data(), write.data.size());
+        if (!file.is_open() || !file.good())
+            Errors::print_warning("[VU JIT] Failed to write cache file %s\n", write.file_name.c_str());
+        lock.lock();
+    }
+}
+
+const vector<VU_CachedBlock>& VU_JitDiskCache::get_program(uint32_t crc)
+{
+    return get_or_create(crc).blocks;
+}
+
+const VU_CachedBlock* VU_JitDiskCache::find_block(const VUBlockState &state)
+{
+    Program& program = get_or_create(state.program);
+    auto it = program.lookup.find(state);
+    if (it == program.lookup.end())
+        return nullptr;
+    return &program.blocks[it->second];
+}
+
+void VU_JitDiskCache::add_block(const VUBlockState &state, IR::Block block)
+{
+    Program& program = get_or_create(state.program);
+    if (program.lookup.find(state) != program.lookup.end())
+        return;
+
+    VU_CachedBlock cached;
+    cached.state = state;
+    cached.cycle_count = block.get_cycle_count();
+    while (block.get_instruction_count() > 0)
+        cached.instrs.push_back(block.get_next_instr());
+
+    program.lookup[state] = program.blocks.size();
+    program.blocks.push_back(std::move(cached));
+    program.dirty = true;
+}
+
+//Only serializes dirty programs to memory, the files themselves are written by the writer thread
+void VU_JitDiskCache::flush()
+{
+    if (!is_enabled())
+        return;
+
+    bool index_dirty = false;
+    for (auto& program : programs)
+    {
+        if (!program.second.dirty)
+            continue;
+
+        vector<char> data;
+        write_program(program.first, program.second, data);
+        queue_write(get_file_name(program.first), std::move(data));
+
+        program.second.dirty = false;
+        if (!program.second.on_disk)
+        {
+            program.second.on_disk = true;
+            index_dirty = true;
+        }
+    }
+
+    //The index goes after the program files, so it never lists one that hasn't been written
+    if (index_dirty)
+    {
+        vector<char> data;
+        write_index(data);
+        queue_write(get_index_file_name(), std::move(data));
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef VU_JITDISK_HPP
+#define VU_JITDISK_HPP
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../jitcommon/ir_block.hpp"
+#include "../jitcommon/jitcache.hpp"
+
+struct VU_CachedBlock
+{
+    VUBlockState state;
+    int cycle_count;
+    std::vector<IR::Instruction> instrs;
+
+    IR::Block to_block() const;
+};
+
+/**
+ * On-disk cache of translated VU microprograms, one file per program CRC and VU.
+ *
+ * Recompiled code is full of host addresses, so the IR of each block is stored rather than the code itself.
+ * Reloading it skips the translator's analysis passes, and a known program can be compiled all at once when it
+ * is uploaded instead of one block at a time while it runs.
+ *
+ * An index file lists the programs in the directory, and all of them are loaded when the directory is set, so
+ * switching programs never reads from disk. Files are written by a background thread.
+ * The version stored in every file is a hash of the translator and IR sources, computed by the build.
+ */
+class VU_JitDiskCache
+{
+    private:
+        constexpr static uint32_t MAGIC = 0x55565344; //"DSVU"
+        constexpr static uint32_t INDEX_MAGIC = 0x58565344; //"DSVX"
+
+        struct Program
+        {
+            std::vector<VU_CachedBlock> blocks;
+            std::unordered_map<VUBlockState, size_t, VUBlockStateHash> lookup;
+            bool dirty;
+            bool on_disk;
+        };
+
+        struct PendingWrite
+        {
+            std::string file_name;
+            std::vector<char> data;
+        };
+
+        std::string directory;
+        int vu_id;
+        std::unordered_map<uint32_t, Program> programs;
+
+        std::thread writer;
+        std::mutex writer_mutex;
+        std::condition_variable writer_notify;
+        std::deque<PendingWrite> pending_writes;
+        bool writer_exit;
+
+        std::string get_file_name(uint32_t crc);
+        std::string get_index_file_name();
+        Program& get_or_create(uint32_t crc);
+        void load_directory();
+        bool read_program(std::ifstream& file, uint32_t crc, Program& program);
+        void write_program(uint32_t crc, Program& program, std::vector<char>& data);
+        void write_index(std::vector<char>& data);
+        void queue_write(std::string file_name, std::vector<char> data);
+        void finish_writes();
+        void writer_loop();
+    public:
+        VU_JitDiskCache();
+        ~VU_JitDiskCache();
+
+        void set_directory(const std::string& directory, int vu_id);
+        bool is_enabled() const;
+
+        const std::vector<VU_CachedBlock>& get_program(uint32_t crc);
+        const VU_CachedBlock* find_block(const VUBlockState& state);
+        void add_block(const VUBlockState& state, IR::Block block);
+        void flush();
+};
+
+inline bool VU_JitDiskCache::is_enabled() const
+{
+    return !directory.empty();
+}
+
+#endif // VU_JITDISK_HPP
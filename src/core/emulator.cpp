@@ -8,6 +8,7 @@
 
 #include "ee/vu_jit.hpp"
 #include "ee/ee_jit.hpp"
+#include "iop/iop_jit.hpp"
 
 /* Notes of timings from PS2*/
 /*
@@ -65,24 +66,44 @@ Emulator::Emulator() :
 {
     BIOS = nullptr;
     RDRAM = nullptr;
+    scratchpad = nullptr;
     IOP_RAM = nullptr;
     SPU_RAM = nullptr;
     ELF_file = nullptr;
     ELF_size = 0;
     gsdump_single_frame = false;
+    max_timeslice = Scheduler::DEFAULT_RUN_CYCLES;
+    vu1_threaded = false;
     ee_log.open("ee_log.txt", std::ios::out);
+
+    //With fastmem, EE memory lives in the arena so that the JIT can address it directly
+    if (ee_fastmem.init())
+    {
+        RDRAM = ee_fastmem.get_RDRAM();
+        BIOS = ee_fastmem.get_BIOS();
+        scratchpad = ee_fastmem.get_scratchpad();
+        cp0.set_fastmem(&ee_fastmem);
+    }
+
     set_ee_mode(CPU_MODE::DONT_CARE);
     set_vu0_mode(CPU_MODE::DONT_CARE);
     set_vu1_mode(CPU_MODE::DONT_CARE);
+    set_iop_mode(CPU_MODE::DONT_CARE);
 }
 
 Emulator::~Emulator()
 {
+    //Writes out whatever the VU JIT disk cache still has queued
+    set_vu_jit_cache_directory("");
     if (ee_log.is_open())
         ee_log.close();
-    delete[] RDRAM;
+    if (!ee_fastmem.is_active())
+    {
+        delete[] RDRAM;
+        delete[] BIOS;
+        delete[] scratchpad;
+    }
     delete[] IOP_RAM;
-    delete[] BIOS;
     delete[] SPU_RAM;
     delete[] ELF_file;
 }
@@ -124,9 +145,10 @@ void Emulator::run()
     scheduler.add_event(vblank_start_id, VBLANK_START_CYCLES);
     scheduler.add_event(vblank_end_id, CYCLES_PER_FRAME);
     
+    bool long_timeslice = scheduler.get_max_run_cycles() > Scheduler::DEFAULT_RUN_CYCLES;
     while (!frame_ended)
     {
-        int ee_cycles = scheduler.calculate_run_cycles();
+        int ee_cycles = scheduler.calculate_run_cycles(long_timeslice && subsystems_idle());
         int bus_cycles = scheduler.get_bus_run_cycles();
         int iop_cycles = scheduler.get_iop_run_cycles();
         scheduler.update_cycle_counts();
@@ -150,6 +172,21 @@ void Emulator::run()
     fesetround(originalRounding);
 }
 
+bool Emulator::subsystems_idle()
+{
+    return dmac.is_idle() && ipu.is_idle() && vif0.is_idle() && vif1.is_idle() && gif.is_idle() &&
+           !vu0.is_running() && !vu1.is_running() && iop_dma.is_idle();
+}
+
+void Emulator::update_timeslice()
+{
+    auto game = game_timeslices.find(disc_serial);
+    if (game != game_timeslices.end())
+        scheduler.set_max_run_cycles(game->second);
+    else
+        scheduler.set_max_run_cycles(max_timeslice);
+}
+
 void Emulator::reset()
 {
     save_requested = false;
@@ -164,6 +201,8 @@ void Emulator::reset()
         IOP_RAM = new uint8_t[1024 * 1024 * 2];
     if (!BIOS)
         BIOS = new uint8_t[1024 * 1024 * 4];
+    if (!scratchpad)
+        scratchpad = new uint8_t[1024 * 16];
     if (!SPU_RAM)
         SPU_RAM = new uint8_t[1024 * 1024 * 2];
 
@@ -174,16 +213,16 @@ void Emulator::reset()
 
     cdvd.reset();
     cp0.reset();
-    cp0.init_mem_pointers(RDRAM, BIOS, (uint8_t*)&scratchpad);
+    cp0.init_mem_pointers(RDRAM, BIOS, scratchpad);
     cpu.reset();
     cpu.init_tlb();
-    dmac.reset(RDRAM, (uint8_t*)&scratchpad);
+    dmac.reset(RDRAM, scratchpad);
     firewire.reset();
     fpu.reset();
     gs.reset();
     gif.reset();
     iop.reset();
-    iop_dma.reset(IOP_RAM);
+    iop_dma.reset(IOP_RAM, IOP_RAM_modified);
     iop_intc.reset();
     iop_timers.reset();
     intc.reset();
@@ -197,10 +236,12 @@ void Emulator::reset()
     vif0.reset();
     vif1.reset();
     vu0.reset();
+    vu1.set_threaded(vu1_threaded);
     vu1.reset();
     VU_JIT::reset(&vu0);
     VU_JIT::reset(&vu1);
     EE_JIT::reset(true);
+    IOP_JIT::reset();
 
     MCH_DRD = 0;
     MCH_RICM = 0;
@@ -210,6 +251,7 @@ void Emulator::reset()
 
     // HLE method to zero out IOP memory
     memset(IOP_RAM, 0, 0x00200000);
+    memset(IOP_RAM_modified, 1, sizeof(IOP_RAM_modified));
 
     iop_scratchpad_start = 0x1F800000;
 
@@ -345,6 +387,9 @@ void Emulator::set_ee_mode(CPU_MODE mode)
         case CPU_MODE::INTERPRETER:
             cpu.set_run_func(&EmotionEngine::run_interpreter);
             break;
+        case CPU_MODE::CACHED_INTERPRETER:
+            cpu.set_run_func(&EmotionEngine::run_cached_interpreter);
+            break;
         case CPU_MODE::JIT:
         default:
             cpu.set_run_func(&EmotionEngine::run_jit);
@@ -352,6 +397,7 @@ void Emulator::set_ee_mode(CPU_MODE mode)
     }
 
     EE_JIT::reset(true);
+    cpu.flush_block_cache();
 }
 
 void Emulator::set_vu0_mode(CPU_MODE mode)
@@ -386,6 +432,66 @@ void Emulator::set_vu1_mode(CPU_MODE mode)
     VU_JIT::reset(&vu1);
 }
 
+//Takes effect on the next reset, as XGKICK transfers in flight can't be carried from one mode to the other
+void Emulator::set_vu1_threaded(bool enabled)
+{
+    vu1_threaded = enabled;
+}
+
+//Compiled VU microprograms are kept here between sessions. An empty path disables the cache
+void Emulator::set_vu_jit_cache_directory(const std::string& directory)
+{
+    VU_JIT::set_disk_cache_directory(directory, &vu0);
+    VU_JIT::set_disk_cache_directory(directory, &vu1);
+}
+
+void Emulator::set_iop_mode(CPU_MODE mode)
+{
+    switch (mode)
+    {
+        case CPU_MODE::JIT:
+            iop.run_func = &IOP::run_jit;
+            break;
+        case CPU_MODE::INTERPRETER:
+        default:
+            iop.run_func = &IOP::run_interpreter;
+            break;
+    }
+
+    IOP_JIT::reset();
+}
+
+void Emulator::set_gs_render_threads(int count)
+{
+    gs.set_render_threads(count);
+}
+
+void Emulator::set_reference_IDCT(bool enabled)
+{
+    ipu.set_reference_IDCT(enabled);
+}
+
+//Anything above Scheduler::DEFAULT_RUN_CYCLES lets the EE and IOP run up to that many EE cycles at a time while
+//the other subsystems are idle, instead of stepping everything every 32 cycles
+void Emulator::set_max_timeslice(int cycles)
+{
+    max_timeslice = cycles;
+    update_timeslice();
+}
+
+//Per-game limit, for games that break with long timeslices. Applies once a disc with that serial is loaded.
+void Emulator::set_game_timeslice(const std::string& serial, int cycles)
+{
+    game_timeslices[serial] = cycles;
+    update_timeslice();
+}
+
+void Emulator::clear_game_timeslice(const std::string& serial)
+{
+    game_timeslices.erase(serial);
+    update_timeslice();
+}
+
 void Emulator::load_BIOS(const uint8_t *BIOS_file)
 {
     if (!BIOS)
@@ -410,7 +516,10 @@ void Emulator::load_ELF(const uint8_t *ELF, uint32_t size)
 
 bool Emulator::load_CDVD(const char *name, CDVD_CONTAINER type)
 {
-    return cdvd.load_disc(name, type);
+    bool loaded = cdvd.load_disc(name, type);
+    disc_serial = loaded ? cdvd.get_serial() : "";
+    update_timeslice();
+    return loaded;
 }
 
 void Emulator::load_memcard(int port, const char *name)
@@ -516,10 +625,13 @@ uint8_t Emulator::read8(uint32_t address)
         return vu0.read_instr<uint8_t>(address);
     if (address >= 0x11004000 && address < 0x11008000)
         return vu0.read_mem<uint8_t>(address);
-    if (address >= 0x11008000 && address < 0x1100C000)
-        return vu1.read_instr<uint8_t>(address);
-    if (address >= 0x1100C000 && address < 0x11010000)
+    if (address >= 0x11008000 && address < 0x11010000)
+    {
+        vu1.wait_for_thread();
+        if (address < 0x1100C000)
+            return vu1.read_instr<uint8_t>(address);
         return vu1.read_mem<uint8_t>(address);
+    }
     switch (address)
     {
         case 0x1F40200F:
@@ -545,10 +657,13 @@ uint16_t Emulator::read16(uint32_t address)
         return vu0.read_instr<uint16_t>(address);
     if (address >= 0x11004000 && address < 0x11008000)
         return vu0.read_mem<uint16_t>(address);
-    if (address >= 0x11008000 && address < 0x1100C000)
-        return vu1.read_instr<uint16_t>(address);
-    if (address >= 0x1100C000 && address < 0x11010000)
+    if (address >= 0x11008000 && address < 0x11010000)
+    {
+        vu1.wait_for_thread();
+        if (address < 0x1100C000)
+            return vu1.read_instr<uint16_t>(address);
         return vu1.read_mem<uint16_t>(address);
+    }
     switch (address)
     {
         case 0x10003C30:
@@ -574,10 +689,13 @@ uint32_t Emulator::read32(uint32_t address)
         return vu0.read_instr<uint32_t>(address);
     if (address >= 0x11004000 && address < 0x11008000)
         return vu0.read_mem<uint32_t>(address);
-    if (address >= 0x11008000 && address < 0x1100C000)
-        return vu1.read_instr<uint32_t>(address);
-    if (address >= 0x1100C000 && address < 0x11010000)
+    if (address >= 0x11008000 && address < 0x11010000)
+    {
+        vu1.wait_for_thread();
+        if (address < 0x1100C000)
+            return vu1.read_instr<uint32_t>(address);
         return vu1.read_mem<uint32_t>(address);
+    }
     switch (address)
     {
         case 0x10002000:
@@ -702,10 +820,13 @@ uint128_t Emulator::read128(uint32_t address)
         return vu0.read_instr<uint128_t>(address);
     if (address >= 0x11004000 && address < 0x11008000)
         return vu0.read_mem<uint128_t>(address);
-    if (address >= 0x11008000 && address < 0x1100C000)
-        return vu1.read_instr<uint128_t>(address);
-    if (address >= 0x1100C000 && address < 0x11010000)
+    if (address >= 0x11008000 && address < 0x11010000)
+    {
+        vu1.wait_for_thread();
+        if (address < 0x1100C000)
+            return vu1.read_instr<uint128_t>(address);
         return vu1.read_mem<uint128_t>(address);
+    }
 
     printf("Unrecognized read128 at physical addr $%08X\n", address);
     return uint128_t::from_u32(0);
@@ -721,6 +842,7 @@ void Emulator::write8(uint32_t address, uint8_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         IOP_RAM[address & 0x1FFFFF] = value;
+        IOP_RAM_modified[(address & 0x1FFFFF) >> 12] = 1;
         return;
     }
     if (address >= 0x11000000 && address < 0x11004000)
@@ -735,11 +857,13 @@ void Emulator::write8(uint32_t address, uint8_t value)
     }
     if (address >= 0x11008000 && address < 0x1100C000)
     {
+        vu1.wait_for_thread();
         vu1.write_instr<uint8_t>(address, value);
         return;
     }
     if (address >= 0x1100C000 && address < 0x11010000)
     {
+        vu1.wait_for_thread();
         vu1.write_mem<uint8_t>(address, value);
         return;
     }
@@ -763,6 +887,7 @@ void Emulator::write16(uint32_t address, uint16_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         *(uint16_t*)&IOP_RAM[address & 0x1FFFFF] = value;
+        IOP_RAM_modified[(address & 0x1FFFFF) >> 12] = 1;
         return;
     }
     if (address >= 0x11000000 && address < 0x11004000)
@@ -777,11 +902,13 @@ void Emulator::write16(uint32_t address, uint16_t value)
     }
     if (address >= 0x11008000 && address < 0x1100C000)
     {
+        vu1.wait_for_thread();
         vu1.write_instr<uint16_t>(address, value);
         return;
     }
     if (address >= 0x1100C000 && address < 0x11010000)
     {
+        vu1.wait_for_thread();
         vu1.write_mem<uint16_t>(address, value);
         return;
     }
@@ -798,6 +925,7 @@ void Emulator::write32(uint32_t address, uint32_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         *(uint32_t*)&IOP_RAM[address & 0x1FFFFF] = value;
+        IOP_RAM_modified[(address & 0x1FFFFF) >> 12] = 1;
         return;
     }
     if (address >= 0x10000000 && address < 0x10002000)
@@ -833,11 +961,13 @@ void Emulator::write32(uint32_t address, uint32_t value)
     }
     if (address >= 0x11008000 && address < 0x1100C000)
     {
+        vu1.wait_for_thread();
         vu1.write_instr<uint32_t>(address, value);
         return;
     }
     if (address >= 0x1100C000 && address < 0x11010000)
     {
+        vu1.wait_for_thread();
         vu1.write_mem<uint32_t>(address, value);
         return;
     }
@@ -931,6 +1061,7 @@ void Emulator::write64(uint32_t address, uint64_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         *(uint64_t*)&IOP_RAM[address & 0x1FFFFF] = value;
+        IOP_RAM_modified[(address & 0x1FFFFF) >> 12] = 1;
         return;
     }
     if (address >= 0x10000000 && address < 0x10002000)
@@ -961,11 +1092,13 @@ void Emulator::write64(uint32_t address, uint64_t value)
     }
     if (address >= 0x11008000 && address < 0x1100C000)
     {
+        vu1.wait_for_thread();
         vu1.write_instr<uint64_t>(address, value);
         return;
     }
     if (address >= 0x1100C000 && address < 0x11010000)
     {
+        vu1.wait_for_thread();
         vu1.write_mem<uint64_t>(address, value);
         return;
     }
@@ -988,9 +1121,11 @@ void Emulator::write128(uint32_t address, uint128_t value)
         }
         if (address < 0x1100C000)
         {
+            vu1.wait_for_thread();
             vu1.write_instr<uint128_t>(address, value);
             return;
         }
+        vu1.wait_for_thread();
         vu1.write_mem<uint128_t>(address, value);
         return;
     }
@@ -1006,7 +1141,7 @@ void Emulator::write128(uint32_t address, uint128_t value)
             gif.send_PATH3_FIFO(value);
             return;
         case 0x10007010:
-            ipu.write_FIFO(value);
+            ipu.write_FIFO(&value, 1);
             return;
     }
     Errors::print_warning("Unrecognized write128 at physical addr $%08X of $%08X_%08X_%08X_%08X\n", address,
@@ -1289,6 +1424,7 @@ void Emulator::iop_write8(uint32_t address, uint8_t value)
     {
         //printf("[IOP] Write to $%08X of $%02X\n", address, value);
         IOP_RAM[address] = value;
+        IOP_RAM_modified[address >> 12] = 1;
         return;
     }
     switch (address)
@@ -1341,6 +1477,7 @@ void Emulator::iop_write16(uint32_t address, uint16_t value)
     {
         //printf("[IOP] Write16 to $%08X of $%08X\n", address, value);
         *(uint16_t*)&IOP_RAM[address] = value;
+        IOP_RAM_modified[address >> 12] = 1;
         return;
     }
     if ((address >= 0x1F900000 && address < 0x1F900400) || (address >= 0x1F900760 && address < 0x1F900788))
@@ -1469,6 +1606,7 @@ void Emulator::iop_write32(uint32_t address, uint32_t value)
     {
         //printf("[IOP] Write to $%08X of $%08X\n", address, value);
         *(uint32_t*)&IOP_RAM[address] = value;
+        IOP_RAM_modified[address >> 12] = 1;
         return;
     }
     //SIO2 send buffers
@@ -1778,6 +1916,16 @@ GraphicsSynthesizer& Emulator::get_gs()
     return gs;
 }
 
+uint8_t* Emulator::get_IOP_RAM()
+{
+    return IOP_RAM;
+}
+
+uint8_t* Emulator::get_IOP_RAM_modified()
+{
+    return IOP_RAM_modified;
+}
+
 void Emulator::set_wav_output(bool state)
 {
     spu2.wav_output = state;
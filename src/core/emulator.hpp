@@ -2,8 +2,11 @@
 #define EMULATOR_HPP
 #include <fstream>
 #include <functional>
+#include <string>
+#include <unordered_map>
 
 #include "ee/dmac.hpp"
+#include "ee/ee_fastmem.hpp"
 #include "ee/emotion.hpp"
 #include "ee/intc.hpp"
 #include "ee/ipu/ipu.hpp"
@@ -39,7 +42,8 @@ enum CPU_MODE
 {
     DONT_CARE,
     JIT,
-    INTERPRETER
+    INTERPRETER,
+    CACHED_INTERPRETER
 };
 
 class Emulator
@@ -48,6 +52,7 @@ class Emulator
         std::atomic_bool save_requested, load_requested, gsdump_requested, gsdump_single_frame, gsdump_running;
         std::string save_state_path;
         int frames;
+        EEFastmem ee_fastmem;
         Cop0 cp0;
         Cop1 fpu;
         CDVD_Drive cdvd;
@@ -81,10 +86,12 @@ class Emulator
 
         uint8_t* RDRAM;
         uint8_t* IOP_RAM;
+        //One flag per 4 KB page of IOP RAM, set on every write and cleared by the IOP JIT
+        uint8_t IOP_RAM_modified[0x200];
         uint8_t* BIOS;
         uint8_t* SPU_RAM;
 
-        uint8_t scratchpad[1024 * 16];
+        uint8_t* scratchpad;
         uint8_t iop_scratchpad[1024];
 
         uint32_t iop_scratchpad_start;
@@ -105,6 +112,18 @@ class Emulator
         void start_sound_sample_event();
 
         bool frame_ended;
+
+        //Longest EE timeslice while the DMAC, IPU, VIFs, GIF, VUs and IOP DMA are all idle.
+        //Games listed in game_timeslices use their own limit instead.
+        int max_timeslice;
+        std::unordered_map<std::string, int> game_timeslices;
+        std::string disc_serial;
+
+        //Applied to VU1 on reset
+        bool vu1_threaded;
+
+        bool subsystems_idle();
+        void update_timeslice();
     public:
         Emulator();
         ~Emulator();
@@ -120,6 +139,14 @@ class Emulator
         void set_ee_mode(CPU_MODE mode);
         void set_vu0_mode(CPU_MODE mode);
         void set_vu1_mode(CPU_MODE mode);
+        void set_vu1_threaded(bool enabled);
+        void set_vu_jit_cache_directory(const std::string& directory);
+        void set_iop_mode(CPU_MODE mode);
+        void set_gs_render_threads(int count);
+        void set_reference_IDCT(bool enabled);
+        void set_max_timeslice(int cycles);
+        void set_game_timeslice(const std::string& serial, int cycles);
+        void clear_game_timeslice(const std::string& serial);
         void load_BIOS(const uint8_t* BIOS);
         void load_ELF(const uint8_t* ELF, uint32_t size);
         bool load_CDVD(const char* name, CDVD_CONTAINER type);
@@ -172,7 +199,10 @@ class Emulator
         void iop_puts();
 
         void test_iop();
+        void test_scheduler();
         GraphicsSynthesizer& get_gs();//used for gs dumps
+        uint8_t* get_IOP_RAM();
+        uint8_t* get_IOP_RAM_modified();
 
         void set_wav_output(bool state);
 };
@@ -107,7 +107,8 @@ void GraphicsInterface::process_PACKED(uint128_t data)
             uint8_t g = (data1 >> 32) & 0xFF;
             uint8_t b = data2 & 0xFF;
             uint8_t a = (data2 >> 32) & 0xFF;
-            gs->set_RGBA(r, g, b, a, internal_Q);
+            uint32_t q = *(uint32_t*)&internal_Q;
+            gs->write64(0x1, r | (g << 8) | (b << 16) | ((uint64_t)a << 24) | ((uint64_t)q << 32));
         }
             break;
         case 0x2:
@@ -126,7 +127,7 @@ void GraphicsInterface::process_PACKED(uint128_t data)
             if ((q & 0x7F800000) == 0x7F800000)
                 q = (q & 0x80000000) | 0x7F7FFFFF;
             internal_Q = *(float*)&q;
-            gs->set_ST(s, t);
+            gs->write64(0x2, s | ((uint64_t)t << 32));
         }
             break;
         case 0x3:
@@ -134,7 +135,7 @@ void GraphicsInterface::process_PACKED(uint128_t data)
         {
             uint16_t u = data1 & 0x3FFF;
             uint16_t v = (data1 >> 32) & 0x3FFF;
-            gs->set_UV(u, v);
+            gs->write64(0x3, u | (v << 16));
         }
             break;
         case 0x4:
@@ -144,8 +145,9 @@ void GraphicsInterface::process_PACKED(uint128_t data)
             uint32_t y = (data1 >> 32) & 0xFFFF;
             uint32_t z = (data2 >> 4) & 0xFFFFFF;
             bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
-            uint8_t fog = (data2 >> (100 - 64)) & 0xFF;
-            gs->set_XYZF(x, y, z, fog, !disable_drawing);
+            uint64_t fog = (data2 >> (100 - 64)) & 0xFF;
+            //XYZF3 is XYZF2 without the drawing kick
+            gs->write64(disable_drawing ? 0xC : 0x4, x | (y << 16) | ((uint64_t)z << 32) | (fog << 56));
         }
             break;
         case 0x5:
@@ -155,7 +157,8 @@ void GraphicsInterface::process_PACKED(uint128_t data)
             uint32_t y = (data1 >> 32) & 0xFFFF;
             uint32_t z = data2 & 0xFFFFFFFF;
             bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
-            gs->set_XYZ(x, y, z, !disable_drawing);
+            //XYZ3 is XYZ2 without the drawing kick
+            gs->write64(disable_drawing ? 0xD : 0x5, x | (y << 16) | ((uint64_t)z << 32));
         }
             break;
         case 0xA:
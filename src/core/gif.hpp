@@ -60,6 +60,7 @@ class GraphicsInterface
         GraphicsInterface(GraphicsSynthesizer* gs, DMAC* dmac);
         void reset();
         void run(int cycles);
+        bool is_idle();
 
         bool fifo_full();
         bool fifo_empty();
@@ -97,6 +98,11 @@ class GraphicsInterface
         void save_state(std::ofstream& state);
 };
 
+inline bool GraphicsInterface::is_idle()
+{
+    return FIFO.empty() && !active_path && !path_queue;
+}
+
 inline int GraphicsInterface::get_active_path()
 {
     return active_path;
@@ -3,6 +3,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <thread>
 #include "ee/intc.hpp"
 #include "gs.hpp"
 #include "errors.hpp"
@@ -15,7 +16,7 @@ registers.
 
 GraphicsSynthesizer::GraphicsSynthesizer(INTC* intc) 
     : intc(intc), frame_complete(false),
-    output_buffer1(nullptr), output_buffer2(nullptr)
+    output_buffer1(nullptr), output_buffer2(nullptr), render_threads(0)
 {
 }
 
@@ -42,6 +43,7 @@ void GraphicsSynthesizer::reset()
     frame_count = 0;
     set_CRT(false, 0x2, false);
     reg.reset(false);
+    set_render_threads(render_threads);
 }
 
 void GraphicsSynthesizer::start_frame()
@@ -64,6 +66,32 @@ void GraphicsSynthesizer::set_CRT(bool interlaced, int mode, bool frame_mode)
     gs_thread.send_message({ GSCommand::set_crt_t, payload });
 }
 
+//Cores left over after the EE, GS and UI threads, up to the point where the GS thread becomes the bottleneck
+static int default_render_threads()
+{
+    int cores = (int)std::thread::hardware_concurrency();
+    return std::min(std::max(cores - 3, 0), 4);
+}
+
+//0, the default, draws everything on the GS thread, otherwise primitives are binned across count worker threads.
+//A negative count picks one based on the number of host cores.
+void GraphicsSynthesizer::set_render_threads(int count)
+{
+    render_threads = count;
+    if (count < 0)
+        count = default_render_threads();
+
+    //No GS thread before the first reset, which forwards the count itself
+    if (!output_buffer1)
+        return;
+
+    GSMessagePayload payload;
+    payload.render_threads_payload = { count };
+
+    gs_thread.send_message({ GSCommand::set_render_threads_t, payload });
+    gs_thread.wake_thread();
+}
+
 uint32_t* GraphicsSynthesizer::get_framebuffer()
 {
     uint32_t* out;
@@ -200,10 +228,7 @@ void GraphicsSynthesizer::get_inner_resolution(int &w, int &h)
 
 void GraphicsSynthesizer::write64(uint32_t addr, uint64_t value)
 {
-    GSMessagePayload payload;
-    payload.write64_payload = { addr, value };
-    
-    gs_thread.send_message({ GSCommand::write64_t, payload });
+    gs_thread.send_write64(addr, value);
 
     //Check for interrupt pre-processing
     reg.write64(addr, value);
@@ -271,46 +296,6 @@ uint64_t GraphicsSynthesizer::read64_privileged(uint32_t addr)
     return reg.read64_privileged(addr);
 }
 
-void GraphicsSynthesizer::set_RGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a, float q)
-{
-    GSMessagePayload payload;
-    payload.rgba_payload = { r, g, b, a, q};
-    
-    gs_thread.send_message({ GSCommand::set_rgba_t, payload });
-}
-
-void GraphicsSynthesizer::set_ST(uint32_t s, uint32_t t)
-{
-    GSMessagePayload payload;
-    payload.st_payload = { s, t };
-    
-    gs_thread.send_message({ GSCommand::set_st_t, payload });
-}
-
-void GraphicsSynthesizer::set_UV(uint16_t u, uint16_t v)
-{
-    GSMessagePayload payload;
-    payload.uv_payload = { u, v };
-    
-    gs_thread.send_message({ GSCommand::set_uv_t, payload });
-}
-
-void GraphicsSynthesizer::set_XYZ(uint32_t x, uint32_t y, uint32_t z, bool drawing_kick)
-{
-    GSMessagePayload payload;
-    payload.xyz_payload = { x, y, z, drawing_kick };
-    
-    gs_thread.send_message({ GSCommand::set_xyz_t, payload });
-}
-
-void GraphicsSynthesizer::set_XYZF(uint32_t x, uint32_t y, uint32_t z, uint8_t fog, bool drawing_kick)
-{
-    GSMessagePayload payload;
-    payload.xyzf_payload = { x, y, z, fog, drawing_kick };
-
-    gs_thread.send_message({ GSCommand::set_xyzf_t, payload });
-}
-
 void GraphicsSynthesizer::load_state(std::ifstream &state)
 {
     GSMessagePayload payload;
@@ -22,6 +22,8 @@ class GraphicsSynthesizer
 
         GS_REGISTERS reg;
 
+        int render_threads;
+
         GraphicsSynthesizerThread gs_thread;
     public:
         GraphicsSynthesizer(INTC* intc);
@@ -44,6 +46,7 @@ class GraphicsSynthesizer
         void assert_VSYNC();
 
         void set_CRT(bool interlaced, int mode, bool frame_mode);
+        void set_render_threads(int count);
 
         uint32_t get_busdir();
         uint32_t read32_privileged(uint32_t addr);
@@ -52,12 +55,6 @@ class GraphicsSynthesizer
         void write64_privileged(uint32_t addr, uint64_t value);
         void write64(uint32_t addr, uint64_t value);
 
-        void set_RGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a, float q);
-        void set_ST(uint32_t s, uint32_t t);
-        void set_UV(uint16_t u, uint16_t v);
-        void set_XYZ(uint32_t x, uint32_t y, uint32_t z, bool drawing_kick);
-        void set_XYZF(uint32_t x, uint32_t y, uint32_t z, uint8_t fog, bool drawing_kick);
-
         void load_state(std::ifstream& state);
         void save_state(std::ofstream& state);
         void send_dump_request();
@@ -1,13 +1,21 @@
 #include <algorithm>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
 #include <fstream>
+#include <bitset>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define GS_SSE2
+#include <emmintrin.h>
+#endif
 
 #include "gsthread.hpp"
 #include "gsmem.hpp"
 #include "errors.hpp"
+#include "ee/crc32c.hpp"
 
 using namespace std;
 
@@ -199,16 +207,269 @@ void GraphicsSynthesizerThread::wait_for_return(GSReturn type, GSReturnMessage &
     }
 }
 
+/**
+  * Messages are stored as a type byte followed by a payload packed to what that type needs.
+  * Vertex data and register writes make up nearly all of the traffic, so they get compact layouts.
+  * Anything rare just copies the whole union.
+  **/
+static size_t encode_message(const GSMessage& message, uint8_t* out)
+{
+    const GSMessagePayload& p = message.payload;
+    uint8_t* ptr = out;
+    *ptr++ = message.type;
+
+    switch (message.type)
+    {
+        case write64_t:
+        {
+            uint8_t addr = p.write64_payload.addr;
+            *ptr++ = addr;
+            memcpy(ptr, &p.write64_payload.value, 8); ptr += 8;
+            break;
+        }
+        case write64_privileged_t:
+            memcpy(ptr, &p.write64_payload.addr, 4); ptr += 4;
+            memcpy(ptr, &p.write64_payload.value, 8); ptr += 8;
+            break;
+        case write32_privileged_t:
+            memcpy(ptr, &p.write32_payload.addr, 4); ptr += 4;
+            memcpy(ptr, &p.write32_payload.value, 4); ptr += 4;
+            break;
+        case set_rgba_t:
+            *ptr++ = p.rgba_payload.r;
+            *ptr++ = p.rgba_payload.g;
+            *ptr++ = p.rgba_payload.b;
+            *ptr++ = p.rgba_payload.a;
+            memcpy(ptr, &p.rgba_payload.q, 4); ptr += 4;
+            break;
+        case set_st_t:
+            memcpy(ptr, &p.st_payload.s, 4); ptr += 4;
+            memcpy(ptr, &p.st_payload.t, 4); ptr += 4;
+            break;
+        case set_uv_t:
+            memcpy(ptr, &p.uv_payload.u, 2); ptr += 2;
+            memcpy(ptr, &p.uv_payload.v, 2); ptr += 2;
+            break;
+        case set_xyz_t:
+        {
+            //X and Y are 16-bit on the GIF side
+            uint16_t x = p.xyz_payload.x, y = p.xyz_payload.y;
+            memcpy(ptr, &x, 2); ptr += 2;
+            memcpy(ptr, &y, 2); ptr += 2;
+            memcpy(ptr, &p.xyz_payload.z, 4); ptr += 4;
+            *ptr++ = p.xyz_payload.drawing_kick;
+            break;
+        }
+        case set_xyzf_t:
+        {
+            uint16_t x = p.xyzf_payload.x, y = p.xyzf_payload.y;
+            memcpy(ptr, &x, 2); ptr += 2;
+            memcpy(ptr, &y, 2); ptr += 2;
+            memcpy(ptr, &p.xyzf_payload.z, 4); ptr += 4;
+            *ptr++ = p.xyzf_payload.fog;
+            *ptr++ = p.xyzf_payload.drawing_kick;
+            break;
+        }
+        default:
+            memcpy(ptr, &p, sizeof(p)); ptr += sizeof(p);
+            break;
+    }
+    return ptr - out;
+}
+
+//Payload size of each message type as laid out by encode_message
+static size_t message_payload_size(uint8_t type)
+{
+    switch (type)
+    {
+        case write64_t:
+            return 9;
+        case write64_privileged_t:
+            return 12;
+        case write32_privileged_t:
+        case set_rgba_t:
+        case set_st_t:
+            return 8;
+        case set_uv_t:
+            return 4;
+        case set_xyz_t:
+            return 9;
+        case set_xyzf_t:
+            return 10;
+        case write64_batch_t:
+            //Only the count, the entries are read one by one
+            return 2;
+        default:
+            return sizeof(GSMessagePayload);
+    }
+}
+
+static void decode_message(uint8_t type, const uint8_t* ptr, GSMessage& message)
+{
+    GSMessagePayload& p = message.payload;
+    message.type = (GSCommand)type;
+
+    switch (type)
+    {
+        case write64_t:
+            p.write64_payload.addr = *ptr++;
+            memcpy(&p.write64_payload.value, ptr, 8);
+            break;
+        case write64_privileged_t:
+            memcpy(&p.write64_payload.addr, ptr, 4);
+            memcpy(&p.write64_payload.value, ptr + 4, 8);
+            break;
+        case write32_privileged_t:
+            memcpy(&p.write32_payload.addr, ptr, 4);
+            memcpy(&p.write32_payload.value, ptr + 4, 4);
+            break;
+        case set_rgba_t:
+            p.rgba_payload.r = ptr[0];
+            p.rgba_payload.g = ptr[1];
+            p.rgba_payload.b = ptr[2];
+            p.rgba_payload.a = ptr[3];
+            memcpy(&p.rgba_payload.q, ptr + 4, 4);
+            break;
+        case set_st_t:
+            memcpy(&p.st_payload.s, ptr, 4);
+            memcpy(&p.st_payload.t, ptr + 4, 4);
+            break;
+        case set_uv_t:
+            memcpy(&p.uv_payload.u, ptr, 2);
+            memcpy(&p.uv_payload.v, ptr + 2, 2);
+            break;
+        case set_xyz_t:
+        {
+            uint16_t x, y;
+            memcpy(&x, ptr, 2);
+            memcpy(&y, ptr + 2, 2);
+            p.xyz_payload.x = x;
+            p.xyz_payload.y = y;
+            memcpy(&p.xyz_payload.z, ptr + 4, 4);
+            p.xyz_payload.drawing_kick = ptr[8];
+            break;
+        }
+        case set_xyzf_t:
+        {
+            uint16_t x, y;
+            memcpy(&x, ptr, 2);
+            memcpy(&y, ptr + 2, 2);
+            p.xyzf_payload.x = x;
+            p.xyzf_payload.y = y;
+            memcpy(&p.xyzf_payload.z, ptr + 4, 4);
+            p.xyzf_payload.fog = ptr[8];
+            p.xyzf_payload.drawing_kick = ptr[9];
+            break;
+        }
+        case write64_batch_t:
+            memcpy(&p.write64_batch_payload.count, ptr, 2);
+            break;
+        default:
+            memcpy(&p, ptr, sizeof(p));
+            break;
+    }
+}
+
 void GraphicsSynthesizerThread::send_message(GSMessage message)
 {
-    //printf("[GS] Notifying gs thread of new data\n");
-    message_queue->push(message);
+    //Keep everything in the order it was sent
+    flush_write64_batch();
+
+    uint8_t record[GS_MAX_MESSAGE_SIZE];
+    size_t size = encode_message(message, record);
+    push_record(record, size);
+}
+
+/**
+  * Queues a write to a GS register. Writes are gathered and handed over as a single
+  * write64_batch_t, which the GS thread runs through in one go.
+  **/
+void GraphicsSynthesizerThread::send_write64(uint32_t addr, uint64_t value)
+{
+    uint8_t* entry = &write64_batch[GS_WRITE64_BATCH_HEADER_SIZE + write64_batch_count * GS_WRITE64_BATCH_ENTRY_SIZE];
+    entry[0] = addr;
+    memcpy(&entry[1], &value, 8);
+
+    write64_batch_count++;
+    if (write64_batch_count == GS_WRITE64_BATCH_MAX)
+        flush_write64_batch();
+}
+
+void GraphicsSynthesizerThread::flush_write64_batch()
+{
+    if (!write64_batch_count)
+        return;
+
+    write64_batch[0] = write64_batch_t;
+    memcpy(&write64_batch[1], &write64_batch_count, 2);
+    push_record(write64_batch, GS_WRITE64_BATCH_HEADER_SIZE + write64_batch_count * GS_WRITE64_BATCH_ENTRY_SIZE);
+    write64_batch_count = 0;
+}
+
+void GraphicsSynthesizerThread::push_record(const uint8_t* record, size_t size)
+{
+    while (!message_queue->write(record, size))
+    {
+        //Queue is full, let the GS thread catch up instead of dropping anything
+        if (thread_exited)
+        {
+            if (!return_queue->was_empty())
+            {
+                GSReturnMessage data;
+                wait_for_return(death_error_t, data);
+            }
+            Errors::die("[GS] Message queue full with no GS thread running");
+        }
+        publish_messages();
+        {
+            std::unique_lock<std::mutex> lk(data_mutex);
+            notifier.notify_one();
+        }
+        std::this_thread::yield();
+    }
+
+    if (message_queue->unpublished() >= GS_PUBLISH_THRESHOLD)
+        publish_messages();
+}
+
+//Makes everything sent so far visible to the GS thread
+void GraphicsSynthesizerThread::publish_messages()
+{
+    message_queue->publish();
     send_data = true;
 }
 
+bool GraphicsSynthesizerThread::read_message(GSMessage& message)
+{
+    uint8_t type;
+    if (!message_queue->read(&type, 1))
+        return false;
+
+    //Messages are only ever published whole
+    uint8_t payload[sizeof(GSMessagePayload)];
+    message_queue->read(payload, message_payload_size(type));
+    message_queue->consume();
+
+    decode_message(type, payload, message);
+    return true;
+}
+
+//Reads the next entry of a write64_batch_t whose header has already been read
+void GraphicsSynthesizerThread::read_batched_write64(GSMessage& message)
+{
+    uint8_t entry[GS_WRITE64_BATCH_ENTRY_SIZE];
+    message_queue->read(entry, GS_WRITE64_BATCH_ENTRY_SIZE);
+
+    message.type = write64_t;
+    message.payload.write64_payload.addr = entry[0];
+    memcpy(&message.payload.write64_payload.value, &entry[1], 8);
+}
+
 void GraphicsSynthesizerThread::wake_thread()
 {
     printf("[GS] Waking GS Thread\n");
+    flush_write64_batch();
+    publish_messages();
     std::unique_lock<std::mutex> lk(data_mutex);
     notifier.notify_one();
 }
@@ -235,15 +496,29 @@ void GraphicsSynthesizerThread::event_loop()
 
     try
     {
+        if (render_thread_count)
+            start_render_workers(render_thread_count);
+
         while (true)
         {
             GSMessage data;
 
-            if (message_queue->pop(data))
+            if (read_message(data))
             {
-                if (gsdump_recording)
+                //Batches are recorded as the writes they contain
+                if (gsdump_recording && data.type != write64_batch_t)
                     gsdump_file.write((char*)&data, sizeof(data));
 
+                //Vertex data and register writes handle the render workers themselves.
+                //Everything else may read or replace state they are using.
+                if (data.type == write64_privileged_t || data.type == write32_privileged_t ||
+                    (data.type > set_xyzf_t && data.type != write64_batch_t))
+                    flush_render_workers();
+
+                //Buffered image data must land before anything else can observe local memory
+                if (data.type != write64_t && data.type != write64_batch_t)
+                    flush_HWREG_buffer();
+
                 switch (data.type)
                 {
                     case write64_t:
@@ -357,6 +632,8 @@ void GraphicsSynthesizerThread::event_loop()
                         break;
                     }
                     case die_t:
+                        stop_render_workers();
+                        thread_exited = true;
                         return;
                     case load_state_t:
                     {
@@ -400,6 +677,25 @@ void GraphicsSynthesizerThread::event_loop()
                         }
                         break;
                     }
+                    case set_render_threads_t:
+                        //Every settings reload resends the count, keep the running workers if it didn't change
+                        if (data.payload.render_threads_payload.count != render_thread_count)
+                            start_render_workers(data.payload.render_threads_payload.count);
+                        break;
+                    case write64_batch_t:
+                    {
+                        uint16_t count = data.payload.write64_batch_payload.count;
+                        for (uint16_t i = 0; i < count; i++)
+                        {
+                            GSMessage write;
+                            read_batched_write64(write);
+                            if (gsdump_recording)
+                                gsdump_file.write((char*)&write, sizeof(write));
+                            write64(write.payload.write64_payload.addr, write.payload.write64_payload.value);
+                        }
+                        message_queue->consume();
+                        break;
+                    }
                     case request_local_host_tx:
                     {
                         GSReturnMessagePayload return_payload;
@@ -426,11 +722,13 @@ void GraphicsSynthesizerThread::event_loop()
     }
     catch (Emulation_error &e)
     {
+        stop_render_workers();
         GSReturnMessagePayload return_payload;
         char* copied_string = new char[ERROR_STRING_MAX_LENGTH];
         strncpy(copied_string, e.what(), ERROR_STRING_MAX_LENGTH);
         return_payload.death_error_payload.error_str = { copied_string };
         return_queue->push({ GSReturn::death_error_t, return_payload });
+        thread_exited = true;
         recieve_data = true;
         notifier.notify_one();
     }
@@ -463,6 +761,8 @@ void GraphicsSynthesizerThread::reset()
     jit_draw_pixel_func = nullptr;
     jit_tex_lookup_func = nullptr;
     jit_draw_pixel_prologue = nullptr;
+    jit_draw_span_prologue = nullptr;
+    jit_draw_span_func = nullptr;
     jit_tex_lookup_prologue = nullptr;
 
     jit_tex_lookup_heap.flush_all_blocks();
@@ -470,14 +770,441 @@ void GraphicsSynthesizerThread::reset()
 
     recompile_tex_lookup_prologue();
     recompile_draw_pixel_prologue();
+    recompile_draw_span_prologue();
+
+    invalidate_tex_cache();
+    crt_write_pages.set();
+    render_hazard_dirty = true;
+    hwreg_bulk = false;
+    hwreg_buffer_used = 0;
 
     memset(screen_buffer, 0, sizeof(screen_buffer));
 
     message_queue = std::make_unique<gs_fifo>();
     return_queue = std::make_unique<gs_return_fifo>();
+    thread_exited = false;
+    write64_batch_count = 0;
     thread = std::thread(&GraphicsSynthesizerThread::event_loop, this);
 }
 
+void GraphicsSynthesizerThread::start_render_workers(int count)
+{
+    stop_render_workers();
+
+#ifdef GS_JIT
+    //The interpreted draw_pixel keeps per-pixel state in the class, so only the JIT path can be threaded
+    render_thread_count = std::min(std::max(count, 0), GS_RENDER_MAX_THREADS);
+#else
+    render_thread_count = 0;
+#endif
+    if (!render_thread_count)
+        return;
+
+    render_workers = std::make_unique<GSRenderWorker[]>(render_thread_count);
+    for (int i = 0; i < render_thread_count; i++)
+    {
+        render_workers[i].queue = std::make_unique<gs_render_fifo>();
+        render_workers[i].thread = std::thread(&GraphicsSynthesizerThread::render_worker_loop, this, i);
+    }
+    render_hazard_dirty = true;
+}
+
+void GraphicsSynthesizerThread::stop_render_workers()
+{
+    if (!render_workers)
+        return;
+
+    for (int i = 0; i < render_thread_count; i++)
+    {
+        GSRenderWorker& worker = render_workers[i];
+        {
+            std::lock_guard<std::mutex> lk(worker.mutex);
+            worker.quit = true;
+        }
+        worker.notifier.notify_all();
+        worker.thread.join();
+    }
+    render_workers.reset();
+    render_workers_busy = false;
+}
+
+/**
+  * Blocks until every queued primitive has been rasterized.
+  * Must be called before anything the workers read (GS state, JIT code, local memory) is modified
+  * or before local memory is read back.
+  **/
+void GraphicsSynthesizerThread::flush_render_workers()
+{
+    if (!render_workers_busy)
+        return;
+
+    for (int i = 0; i < render_thread_count; i++)
+    {
+        GSRenderWorker& worker = render_workers[i];
+        std::unique_lock<std::mutex> lk(worker.mutex);
+        worker.notifier.notify_all();
+        worker.notifier.wait(lk, [&worker] { return !worker.pending.load(); });
+    }
+    render_workers_busy = false;
+
+    for (int i = 0; i < render_thread_count; i++)
+    {
+        if (!render_workers[i].error.empty())
+        {
+            std::string error = render_workers[i].error;
+            render_workers[i].error.clear();
+            Errors::die("%s", error.c_str());
+        }
+    }
+}
+
+void GraphicsSynthesizerThread::render_worker_loop(int index)
+{
+    GSRenderWorker& worker = render_workers[index];
+    GSRenderBand band = { index, render_thread_count };
+    GSRenderCommand cmd;
+
+    while (true)
+    {
+        if (worker.queue->pop(cmd))
+        {
+            if (worker.error.empty())
+            {
+                try
+                {
+                    rasterize(cmd.prim_type, cmd.vtx, band);
+                }
+                catch (Emulation_error &e)
+                {
+                    worker.error = e.what();
+                }
+            }
+
+            if (worker.pending.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lk(worker.mutex);
+                worker.notifier.notify_all();
+            }
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lk(worker.mutex);
+            worker.sleeping = true;
+            worker.notifier.wait(lk, [&worker] { return worker.quit || !worker.queue->was_empty(); });
+            worker.sleeping = false;
+            if (worker.quit && worker.queue->was_empty())
+                return;
+        }
+    }
+}
+
+//Hands the primitive in vtx_queue to every worker owning a band it may cover
+void GraphicsSynthesizerThread::dispatch_primitive()
+{
+    GSRenderCommand cmd;
+    unsigned int count = max_vertices[prim_type];
+    for (unsigned int i = 0; i < count; i++)
+        cmd.vtx[i] = vtx_queue[i];
+    cmd.prim_type = prim_type;
+
+    int32_t min_y = vtx_queue[0].y, max_y = vtx_queue[0].y;
+    for (unsigned int i = 1; i < count; i++)
+    {
+        min_y = std::min(min_y, vtx_queue[i].y);
+        max_y = std::max(max_y, vtx_queue[i].y);
+    }
+
+    //Positions are 12.4 fixed point. Pad by a pixel either side to cover rounding
+    min_y = std::max(min_y - current_ctx->xyoffset.y, (int32_t)current_ctx->scissor.y1) >> 4;
+    max_y = std::min(max_y - current_ctx->xyoffset.y, (int32_t)current_ctx->scissor.y2) >> 4;
+    min_y = std::max(min_y - 1, 0);
+    max_y += 1;
+
+    if (max_y < min_y)
+        return;
+
+    int first_band = min_y >> GS_RENDER_BAND_SHIFT;
+    int last_band = max_y >> GS_RENDER_BAND_SHIFT;
+    if (last_band - first_band >= render_thread_count)
+    {
+        first_band = 0;
+        last_band = render_thread_count - 1;
+    }
+
+    for (int b = first_band; b <= last_band; b++)
+    {
+        GSRenderWorker& worker = render_workers[b % render_thread_count];
+
+        //Producer side of the worker queue: wait for room instead of overflowing
+        while (worker.queue->was_full())
+            std::this_thread::yield();
+
+        worker.pending++;
+        worker.queue->push(cmd);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (worker.sleeping)
+        {
+            std::lock_guard<std::mutex> lk(worker.mutex);
+            worker.notifier.notify_all();
+        }
+    }
+    render_workers_busy = true;
+}
+
+static void mark_pages(std::bitset<512>& pages, uint32_t base, uint32_t width, uint8_t format,
+                       uint32_t width_px, uint32_t height_px)
+{
+    //Page dimensions in pixels for each PSM
+    uint32_t page_w, page_h;
+    switch (format)
+    {
+        case 0x00:
+        case 0x01:
+        case 0x1B:
+        case 0x24:
+        case 0x2C:
+        case 0x30:
+        case 0x31:
+            page_w = 64; page_h = 32;
+            break;
+        case 0x02:
+        case 0x0A:
+        case 0x32:
+        case 0x3A:
+            page_w = 64; page_h = 64;
+            break;
+        case 0x13:
+            page_w = 128; page_h = 64;
+            break;
+        case 0x14:
+            page_w = 128; page_h = 128;
+            break;
+        default:
+            //Unknown format, assume the worst
+            pages.set();
+            return;
+    }
+
+    uint32_t pages_per_row = std::max(width / page_w, 1U);
+    uint32_t rows = (height_px + page_h - 1) / page_h;
+    uint32_t cols = std::max((width_px + page_w - 1) / page_w, pages_per_row);
+    uint32_t count = (rows ? rows - 1 : 0) * pages_per_row + cols;
+    if (count >= 512)
+    {
+        pages.set();
+        return;
+    }
+
+    uint32_t start = base / 8192;
+    for (uint32_t i = 0; i < count; i++)
+        pages.set((start + i) & 511);
+}
+
+/**
+  * Returns true if the current primitive must be drawn serially.
+  * Bands only partition pixels of a single buffer. If the texture or the other buffer aliases
+  * the frame/z pages, a pixel in one band can observe a write from another band.
+  **/
+bool GraphicsSynthesizerThread::check_render_hazard()
+{
+    if (!render_hazard_dirty)
+        return render_hazard;
+
+    render_hazard_dirty = false;
+
+    uint32_t width_px = (current_ctx->scissor.x2 >> 4) + 1;
+    uint32_t height_px = (current_ctx->scissor.y2 >> 4) + 1;
+
+    std::bitset<512> frame_pages, z_pages, tex_pages;
+    mark_pages(frame_pages, current_ctx->frame.base_pointer, current_ctx->frame.width,
+               current_ctx->frame.format, width_px, height_px);
+
+    bool use_z = current_ctx->test.depth_test && current_ctx->test.depth_method > 1;
+    if (use_z || !current_ctx->zbuf.no_update)
+        mark_pages(z_pages, current_ctx->zbuf.base_pointer, current_ctx->frame.width,
+                   current_ctx->zbuf.format, width_px, height_px);
+
+    if (current_PRMODE->texture_mapping)
+    {
+        TEX0& tex0 = current_ctx->tex0;
+        TEX1& tex1 = current_ctx->tex1;
+        mark_pages(tex_pages, tex0.texture_base, tex0.width, tex0.format, tex0.tex_width, tex0.tex_height);
+        if (tex1.max_MIP_level && tex1.filter_smaller >= 2)
+        {
+            for (int i = 0; i < tex1.max_MIP_level && i < 6; i++)
+            {
+                if (tex1.MTBA)
+                {
+                    //Automatic MIP bases follow level 0 contiguously, so level 0 doubled covers them
+                    mark_pages(tex_pages, tex0.texture_base, tex0.width, tex0.format,
+                               tex0.tex_width, tex0.tex_height * 2);
+                    break;
+                }
+                mark_pages(tex_pages, current_ctx->miptbl.texture_base[i], current_ctx->miptbl.width[i],
+                           tex0.format, tex0.tex_width >> (i + 1), tex0.tex_height >> (i + 1));
+            }
+        }
+    }
+
+    draw_pages = frame_pages | z_pages;
+    tex_feedback = (tex_pages & draw_pages).any();
+    render_hazard = tex_feedback || (frame_pages & z_pages).any();
+    return render_hazard;
+}
+
+//Bounding box of the primitive in vtx_queue, clipped to the scissor, in pixels
+uint64_t GraphicsSynthesizerThread::primitive_area()
+{
+    unsigned int count = max_vertices[prim_type];
+    int32_t min_x = vtx_queue[0].x, max_x = vtx_queue[0].x;
+    int32_t min_y = vtx_queue[0].y, max_y = vtx_queue[0].y;
+    for (unsigned int i = 1; i < count; i++)
+    {
+        min_x = std::min(min_x, vtx_queue[i].x);
+        max_x = std::max(max_x, vtx_queue[i].x);
+        min_y = std::min(min_y, vtx_queue[i].y);
+        max_y = std::max(max_y, vtx_queue[i].y);
+    }
+
+    min_x = std::max(min_x - current_ctx->xyoffset.x, (int32_t)current_ctx->scissor.x1) >> 4;
+    max_x = std::min(max_x - current_ctx->xyoffset.x, (int32_t)current_ctx->scissor.x2) >> 4;
+    min_y = std::max(min_y - current_ctx->xyoffset.y, (int32_t)current_ctx->scissor.y1) >> 4;
+    max_y = std::min(max_y - current_ctx->xyoffset.y, (int32_t)current_ctx->scissor.y2) >> 4;
+    if (max_x < min_x || max_y < min_y)
+        return 0;
+    return (uint64_t)(max_x - min_x + 1) * (max_y - min_y + 1);
+}
+
+void GraphicsSynthesizerThread::invalidate_tex_cache()
+{
+    flush_render_workers();
+    for (int i = 0; i < GS_TEX_CACHE_ENTRIES; i++)
+    {
+        tex_cache[i].valid = false;
+        tex_cache[i].decoded = false;
+    }
+    pending_write_pages.reset();
+    transfer_pages.reset();
+    tex_cache_texels = nullptr;
+    tex_cache_width_shift = 0;
+}
+
+//Drops every cached texture that overlaps a page written since the last check
+void GraphicsSynthesizerThread::commit_tex_cache_writes()
+{
+    if (pending_write_pages.none())
+        return;
+
+    for (int i = 0; i < GS_TEX_CACHE_ENTRIES; i++)
+    {
+        GSTextureCacheEntry& entry = tex_cache[i];
+        if (entry.valid && (entry.pages & pending_write_pages).any())
+        {
+            entry.decoded = false;
+            entry.drawn_area = 0;
+        }
+    }
+    pending_write_pages.reset();
+}
+
+/**
+  * Points the texture lookup at the decoded copy of the current texture, decoding it once enough has been
+  * drawn with it. Textures aliasing the frame or z buffer are always read from local memory.
+  **/
+void GraphicsSynthesizerThread::bind_tex_cache(uint64_t area)
+{
+    commit_tex_cache_writes();
+
+    const uint32_t* texels = nullptr;
+    uint32_t width_shift = 0;
+    if (!tex_feedback)
+    {
+        TEX0& tex0 = current_ctx->tex0;
+        bool paletted = tex0.format == 0x13 || tex0.format == 0x14 || tex0.format == 0x1B ||
+                        tex0.format == 0x24 || tex0.format == 0x2C;
+
+        GSTextureCacheKey key;
+        key.tex = (uint64_t)tex0.texture_base | ((uint64_t)tex0.width << 22) | ((uint64_t)tex0.format << 34) |
+                  ((uint64_t)tex0.tex_width << 40) | ((uint64_t)tex0.tex_height << 51);
+        key.clut = TEXA.alpha0 | (TEXA.alpha1 << 8) | ((uint64_t)TEXA.trans_black << 16);
+        if (paletted)
+        {
+            key.clut |= ((uint64_t)tex0.CLUT_format << 17) | ((uint64_t)tex0.use_CSM2 << 23) |
+                        ((uint64_t)tex0.CLUT_offset << 24);
+        }
+        key.clut_crc = paletted ? clut_crc : 0;
+
+        GSTextureCacheEntry* entry = nullptr;
+        GSTextureCacheEntry* oldest = &tex_cache[0];
+        for (int i = 0; i < GS_TEX_CACHE_ENTRIES; i++)
+        {
+            if (tex_cache[i].valid && tex_cache[i].key == key)
+            {
+                entry = &tex_cache[i];
+                break;
+            }
+            if (!tex_cache[i].valid || (oldest->valid && tex_cache[i].last_used < oldest->last_used))
+                oldest = &tex_cache[i];
+        }
+
+        if (!entry)
+        {
+            entry = oldest;
+            entry->key = key;
+            entry->valid = true;
+            entry->decoded = false;
+            entry->drawn_area = 0;
+            entry->width = tex0.tex_width;
+            entry->height = tex0.tex_height;
+            entry->width_shift = 0;
+            while ((1U << entry->width_shift) < entry->width)
+                entry->width_shift++;
+            entry->pages.reset();
+            mark_pages(entry->pages, tex0.texture_base, tex0.width, tex0.format, tex0.tex_width, tex0.tex_height);
+        }
+        entry->last_used = ++tex_cache_clock;
+
+        if (!entry->decoded)
+        {
+            entry->drawn_area += area;
+            if (entry->drawn_area >= (uint64_t)entry->width * entry->height)
+            {
+                //The workers may still be reading the texels of an entry that is being reused
+                flush_render_workers();
+                decode_texture(*entry);
+            }
+        }
+
+        if (entry->decoded)
+        {
+            texels = entry->texels.data();
+            width_shift = entry->width_shift;
+        }
+    }
+
+    if (texels != tex_cache_texels || width_shift != tex_cache_width_shift)
+    {
+        flush_render_workers();
+        tex_cache_texels = texels;
+        tex_cache_width_shift = width_shift;
+    }
+}
+
+void GraphicsSynthesizerThread::decode_texture(GSTextureCacheEntry& entry)
+{
+    TEX0& tex0 = current_ctx->tex0;
+    entry.texels.resize(entry.width * entry.height);
+
+    uint32_t* texel = entry.texels.data();
+    for (uint32_t v = 0; v < entry.height; v++)
+    {
+        for (uint32_t u = 0; u < entry.width; u++)
+            *texel++ = read_texel(tex0.texture_base, tex0.width, u, v);
+    }
+    entry.decoded = true;
+}
+
 void GraphicsSynthesizerThread::soft_reset()
 {
     COLCLAMP = true;
@@ -499,6 +1226,13 @@ void GraphicsSynthesizerThread::soft_reset()
 
 void GraphicsSynthesizerThread::memdump(uint32_t* target, uint16_t& width, uint16_t& height)
 {
+    //The partial frame overwrites whatever render_CRT left in the target
+    for (int i = 0; i < 2; i++)
+    {
+        if (crt_outputs[i].target == target)
+            crt_outputs[i].target = nullptr;
+    }
+
     SCISSOR s = current_ctx->scissor;
     width = min(static_cast<uint16_t>(s.x2 - s.x1), (uint16_t)current_ctx->frame.width);
     height = min(static_cast<uint16_t>(s.y2 - s.y1), (uint16_t)480);
@@ -536,6 +1270,34 @@ uint16_t convert_color_down(uint32_t col)
     return (r | (g << 5) | (b << 10) | (a << 15));
 }
 
+//Byte address of the 256-byte block holding pixel (x, y), or -1 if the format has no plain block layout
+static int32_t block_address(uint8_t format, uint32_t base, uint32_t width, uint32_t x, uint32_t y)
+{
+    switch (format)
+    {
+        case 0x00:
+        case 0x01:
+            return addr_PSMCT32(base / 256, width / 64, x, y) & ~0xFF;
+        case 0x02:
+            return addr_PSMCT16(base / 256, width / 64, x, y) & ~0xFF;
+        case 0x0A:
+            return addr_PSMCT16S(base / 256, width / 64, x, y) & ~0xFF;
+        case 0x13:
+            return addr_PSMCT8(base / 256, width / 64, x, y) & ~0xFF;
+        case 0x14:
+            return (addr_PSMCT4(base / 256, width / 64, x, y) >> 1) & ~0xFF;
+        case 0x30:
+        case 0x31:
+            return addr_PSMCT32Z(base / 256, width / 64, x, y) & ~0xFF;
+        case 0x32:
+            return addr_PSMCT16Z(base / 256, width / 64, x, y) & ~0xFF;
+        case 0x3A:
+            return addr_PSMCT16SZ(base / 256, width / 64, x, y) & ~0xFF;
+        default:
+            return -1;
+    }
+}
+
 //Calculates DISPLAY bounding box
 bool GraphicsSynthesizerThread::is_in_display(DISPLAY &display, int32_t x_start, int32_t y_start, int32_t x, int32_t y)
 {
@@ -569,6 +1331,218 @@ uint32_t GraphicsSynthesizerThread::get_CRT_color(DISPFB &dispfb, int32_t x, int
     }
 }
 
+bool GSCRTState::operator==(const GSCRTState& other) const
+{
+    auto same_dispfb = [](const DISPFB& a, const DISPFB& b)
+    {
+        return a.frame_base == b.frame_base && a.width == b.width && a.format == b.format && a.x == b.x && a.y == b.y;
+    };
+    auto same_display = [](const DISPLAY& a, const DISPLAY& b)
+    {
+        return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+    };
+
+    return PMODE.circuit1 == other.PMODE.circuit1 && PMODE.circuit2 == other.PMODE.circuit2 &&
+           PMODE.use_ALP == other.PMODE.use_ALP && PMODE.blend_with_bg == other.PMODE.blend_with_bg &&
+           PMODE.ALP == other.PMODE.ALP &&
+           SMODE2.interlaced == other.SMODE2.interlaced && SMODE2.frame_mode == other.SMODE2.frame_mode &&
+           same_dispfb(DISPFB1, other.DISPFB1) && same_dispfb(DISPFB2, other.DISPFB2) &&
+           same_display(DISPLAY1, other.DISPLAY1) && same_display(DISPLAY2, other.DISPLAY2) &&
+           BGCOLOR == other.BGCOLOR && deinterlace_method == other.deinterlace_method;
+}
+
+#ifdef GS_SSE2
+static inline __m128i convert_color_up_sse2(__m128i color)
+{
+    __m128i r = _mm_and_si128(_mm_slli_epi32(color, 3), _mm_set1_epi32(0xF8));
+    __m128i g = _mm_and_si128(_mm_slli_epi32(color, 6), _mm_set1_epi32(0xF800));
+    __m128i b = _mm_and_si128(_mm_slli_epi32(color, 9), _mm_set1_epi32(0xF80000));
+    __m128i a = _mm_and_si128(_mm_slli_epi32(color, 16), _mm_set1_epi32(0x80000000));
+    return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, a));
+}
+#endif
+
+//Reads count pixels of a framebuffer scanline, de-swizzling a whole block row at a time where possible
+void GraphicsSynthesizerThread::read_CRT_line(DISPFB& dispfb, int32_t x, int32_t y, int32_t count, uint32_t* out)
+{
+    int32_t i = 0;
+#ifdef GS_SSE2
+    int32_t block_w;
+    switch (dispfb.format)
+    {
+        case 0x0:
+        case 0x1:
+            block_w = 8;
+            break;
+        case 0x2:
+        case 0xA:
+            block_w = 16;
+            break;
+        default:
+            block_w = 0;
+            break;
+    }
+
+    if (block_w)
+    {
+        for (; i < count && ((x + i) & (block_w - 1)); i++)
+            out[i] = get_CRT_color(dispfb, x + i, y);
+
+        for (; i + block_w <= count; i += block_w)
+        {
+            const uint8_t* block = &local_mem[block_address(dispfb.format, dispfb.frame_base * 4, dispfb.width, x + i, y)];
+
+            //Rows are stored in pairs with their 64-bit halves interleaved
+            const __m128i* pair = (const __m128i*)(block + (y & 0x6) * 32);
+            __m128i v0 = _mm_loadu_si128(pair);
+            __m128i v1 = _mm_loadu_si128(pair + 1);
+            __m128i v2 = _mm_loadu_si128(pair + 2);
+            __m128i v3 = _mm_loadu_si128(pair + 3);
+            __m128i row_lo, row_hi;
+            if (y & 0x1)
+            {
+                row_lo = _mm_unpackhi_epi64(v0, v1);
+                row_hi = _mm_unpackhi_epi64(v2, v3);
+            }
+            else
+            {
+                row_lo = _mm_unpacklo_epi64(v0, v1);
+                row_hi = _mm_unpacklo_epi64(v2, v3);
+            }
+
+            if (block_w == 8)
+            {
+                if (dispfb.format == 0x1)
+                {
+                    __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+                    __m128i alpha = _mm_set1_epi32(0x80000000);
+                    row_lo = _mm_or_si128(_mm_and_si128(row_lo, rgb_mask), alpha);
+                    row_hi = _mm_or_si128(_mm_and_si128(row_hi, rgb_mask), alpha);
+                }
+                _mm_storeu_si128((__m128i*)&out[i], row_lo);
+                _mm_storeu_si128((__m128i*)&out[i + 4], row_hi);
+            }
+            else
+            {
+                //Pixels x and x + 8 are stored next to each other, so the row is deinterleaved first
+                __m128i t0 = _mm_unpacklo_epi16(row_lo, row_hi);
+                __m128i t1 = _mm_unpackhi_epi16(row_lo, row_hi);
+                __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+                __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+                __m128i pixels_lo = _mm_unpacklo_epi16(u0, u1);
+                __m128i pixels_hi = _mm_unpackhi_epi16(u0, u1);
+
+                __m128i zero = _mm_setzero_si128();
+                _mm_storeu_si128((__m128i*)&out[i], convert_color_up_sse2(_mm_unpacklo_epi16(pixels_lo, zero)));
+                _mm_storeu_si128((__m128i*)&out[i + 4], convert_color_up_sse2(_mm_unpackhi_epi16(pixels_lo, zero)));
+                _mm_storeu_si128((__m128i*)&out[i + 8], convert_color_up_sse2(_mm_unpacklo_epi16(pixels_hi, zero)));
+                _mm_storeu_si128((__m128i*)&out[i + 12], convert_color_up_sse2(_mm_unpackhi_epi16(pixels_hi, zero)));
+            }
+        }
+    }
+#endif
+    for (; i < count; i++)
+        out[i] = get_CRT_color(dispfb, x + i, y);
+}
+
+//Merges the outputs of both read circuits where circuit 1 is enabled
+static void blend_CRT_pixels(uint32_t* out, const uint32_t* color1, const uint32_t* color2, int32_t count,
+                             bool use_ALP, uint8_t ALP)
+{
+    int32_t i = 0;
+#ifdef GS_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i max_alpha = _mm_set1_epi16(0xFF);
+    __m128i opaque = _mm_set1_epi32(0xFF000000);
+    __m128i fixed_alpha = _mm_set1_epi16(ALP);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i c1 = _mm_loadu_si128((const __m128i*)&color1[i]);
+        __m128i c2 = _mm_loadu_si128((const __m128i*)&color2[i]);
+
+        //One alpha per 16-bit channel lane, two pixels per register
+        __m128i alpha_lo = fixed_alpha, alpha_hi = fixed_alpha;
+        if (!use_ALP)
+        {
+            __m128i alpha = _mm_slli_epi32(_mm_srli_epi32(c1, 24), 1);
+            alpha = _mm_min_epi16(_mm_packs_epi32(alpha, alpha), max_alpha);
+            alpha = _mm_unpacklo_epi16(alpha, alpha);
+            alpha_lo = _mm_unpacklo_epi32(alpha, alpha);
+            alpha_hi = _mm_unpackhi_epi32(alpha, alpha);
+        }
+
+        //(c1 * alpha + c2 * (0xFF - alpha)) >> 8 never exceeds 0xFF, so the sum fits in 16 bits
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(c1, zero), alpha_lo),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(c2, zero), _mm_sub_epi16(max_alpha, alpha_lo)));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(c1, zero), alpha_hi),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(c2, zero), _mm_sub_epi16(max_alpha, alpha_hi)));
+        __m128i color = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+        _mm_storeu_si128((__m128i*)&out[i], _mm_or_si128(color, opaque));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        uint32_t alpha = use_ALP ? ALP : std::min((color1[i] >> 24) * 2, 0xFFU);
+
+        uint32_t r = (((color1[i] & 0xFF) * alpha) + ((color2[i] & 0xFF) * (0xFF - alpha))) >> 8;
+        uint32_t g = ((((color1[i] >> 8) & 0xFF) * alpha) + (((color2[i] >> 8) & 0xFF) * (0xFF - alpha))) >> 8;
+        uint32_t b = ((((color1[i] >> 16) & 0xFF) * alpha) + (((color2[i] >> 16) & 0xFF) * (0xFF - alpha))) >> 8;
+        out[i] = 0xFF000000 | r | (g << 8) | (b << 16);
+    }
+}
+
+/**
+  * Returns true if target still holds the frame that is about to be rendered.
+  * The displayed frame only changes when the CRT registers change or a page the read circuits
+  * fetch from is written, so paused games and static menus don't need to be merged again.
+  */
+bool GraphicsSynthesizerThread::CRT_output_current(uint32_t* target, bool weave)
+{
+    GSCRTState state;
+    state.PMODE = reg.PMODE;
+    state.SMODE2 = reg.SMODE2;
+    state.DISPFB1 = reg.DISPFB1;
+    state.DISPFB2 = reg.DISPFB2;
+    state.DISPLAY1 = reg.DISPLAY1;
+    state.DISPLAY2 = reg.DISPLAY2;
+    state.BGCOLOR = reg.BGCOLOR;
+    state.deinterlace_method = reg.deinterlace_method;
+
+    //Field offsets can read up to twice the display height below DISPFB
+    std::bitset<512> display_pages;
+    if (reg.PMODE.circuit1)
+        mark_pages(display_pages, reg.DISPFB1.frame_base * 4, reg.DISPFB1.width, reg.DISPFB1.format,
+                   reg.DISPFB1.x + reg.DISPLAY1.width, reg.DISPFB1.y + reg.DISPLAY1.height * 2 + 1);
+    if (reg.PMODE.circuit2)
+        mark_pages(display_pages, reg.DISPFB2.frame_base * 4, reg.DISPFB2.width, reg.DISPFB2.format,
+                   reg.DISPFB2.x + reg.DISPLAY2.width, reg.DISPFB2.y + reg.DISPLAY2.height * 2 + 1);
+
+    if (!(state == crt_state) || (crt_write_pages & display_pages).any())
+    {
+        crt_state = state;
+        crt_generation++;
+    }
+    crt_write_pages.reset();
+
+    GSCRTOutput* output = &crt_outputs[0];
+    if (crt_outputs[0].target != target &&
+            (crt_outputs[1].target == target || crt_outputs[1].generation < crt_outputs[0].generation))
+        output = &crt_outputs[1];
+
+    int field = reg.CSR.is_odd_frame;
+    bool current = output->target == target && output->generation == crt_generation;
+    if (weave)
+        current = current && output->odd_frame == (bool)field && output->other_field_generation == crt_generation;
+
+    output->target = target;
+    output->generation = crt_generation;
+    output->odd_frame = field;
+    output->other_field_generation = crt_field_generation[!field];
+    if (weave)
+        crt_field_generation[field] = crt_generation;
+    return current;
+}
+
 void GraphicsSynthesizerThread::render_CRT(uint32_t* target)
 {
     int32_t width;
@@ -581,8 +1555,6 @@ void GraphicsSynthesizerThread::render_CRT(uint32_t* target)
     int32_t display1_xoffset = 0;
     int32_t display2_yoffset = 0;
     int32_t display2_xoffset = 0;
-    bool enable_circuit1 = true;
-    bool enable_circuit2 = true;
 
     //Get overall picture height, largest will likely cover whole screen
     if (reg.PMODE.circuit1 && reg.PMODE.circuit2)
@@ -646,124 +1618,125 @@ void GraphicsSynthesizerThread::render_CRT(uint32_t* target)
         }
     }
 
+    bool weave = reg.SMODE2.interlaced && reg.deinterlace_method != BOB_DEINTERLACE;
+    if (CRT_output_current(target, weave))
+        return;
+
+    if (crt_row.size() < (size_t)width)
+    {
+        crt_line1.resize(width);
+        crt_line2.resize(width);
+        crt_row.resize(width);
+    }
+    uint32_t* line1 = crt_line1.data();
+    uint32_t* line2 = crt_line2.data();
+    uint32_t* row = crt_row.data();
+    size_t row_size = width * sizeof(uint32_t);
+
     for (int y = start_scanline; y < height; y += y_increment)
     {
-        for (int x = 0; x < width; x++)
+        //Outputs are disabled outside of their display bounding box
+        int32_t x1_start = 0, x1_end = 0;
+        int32_t x2_start = 0, x2_end = 0;
+        if (reg.PMODE.circuit1 && y >= display1_yoffset && y < display1_yoffset + reg.DISPLAY1.height)
         {
-            int32_t pixel_x = x;
-            int32_t pixel_y = y;
-            int32_t pixel_x_disp1 = pixel_x - display1_xoffset;
-            int32_t pixel_x_disp2 = pixel_x - display2_xoffset;
-            int32_t pixel_y_disp1 = pixel_y - display1_yoffset;
-            int32_t pixel_y_disp2 = pixel_y - display2_yoffset;
-
-            //Calculate Frame buffer Coordinates
-            int32_t scaled_x1 = (int32_t)reg.DISPFB1.x + pixel_x_disp1;
-            int32_t scaled_x2 = (int32_t)reg.DISPFB2.x + pixel_x_disp2;
-            int32_t scaled_y1 = (int32_t)reg.DISPFB1.y + fb_offset + ((pixel_y_disp1 >> (y_increment - 1)) << (frame_line_increment - 1));
-            int32_t scaled_y2 = (int32_t)reg.DISPFB2.y + fb_offset + ((pixel_y_disp2 >> (y_increment - 1)) << (frame_line_increment - 1));
-
-            //Disable the outputs if the x, y are not in the display bounding box
-            enable_circuit1 = reg.PMODE.circuit1 && is_in_display(reg.DISPLAY1, display1_xoffset, display1_yoffset, pixel_x, pixel_y);
-            enable_circuit2 = reg.PMODE.circuit2 && is_in_display(reg.DISPLAY2, display2_xoffset, display2_yoffset, pixel_x, pixel_y);
-
-            uint32_t output1 = enable_circuit1 ? get_CRT_color(reg.DISPFB1, scaled_x1, scaled_y1) : 0;
-            uint32_t output2 = enable_circuit2 ? get_CRT_color(reg.DISPFB2, scaled_x2, scaled_y2) : reg.BGCOLOR;
-
-            if (reg.PMODE.blend_with_bg)
-                output2 = reg.BGCOLOR;
-
-            uint32_t r = 0, g = 0, b = 0;
-            uint32_t r1, g1, b1, r2, g2, b2;
-            uint32_t final_color;
-
-            //If Circuit 1 is disabled, we can skip alpha blending on Circuit 2
-            //Some games (like Devil May Cry) will use Circuit 2 with an ALP of 255, making it effectively blank.
-            //However we think that on real hardware it will either skip the blending or duplicate Circuit 2 in the Circuit 1 output
-            //which effectively means output2 is outputted at full alpha
-            //Downhill Domination also has a dark screen if you do not follow this behaviour.  ALP 128 only circuit 2
-            if (enable_circuit1)
-            {
-                uint32_t alpha;
-
-                if (reg.PMODE.use_ALP)
-                    alpha = reg.PMODE.ALP;
-                else
-                    alpha = (output1 >> 24) * 2;
-
-                if (alpha > 0xFF)
-                    alpha = 0xFF;
-
-                r1 = output1 & 0xFF; r2 = output2 & 0xFF;
-                g1 = (output1 >> 8) & 0xFF; g2 = (output2 >> 8) & 0xFF;
-                b1 = (output1 >> 16) & 0xFF; b2 = (output2 >> 16) & 0xFF;
-
-                r = ((r1 * alpha) + (r2 * (0xFF - alpha))) >> 8;
-                if (r > 0xFF)
-                    r = 0xFF;
-
-                g = ((g1 * alpha) + (g2 * (0xFF - alpha))) >> 8;
-                if (g > 0xFF)
-                    g = 0xFF;
-
-                b = ((b1 * alpha) + (b2 * (0xFF - alpha))) >> 8;
-                if (b > 0xFF)
-                    b = 0xFF;
-            }
-            else if(enable_circuit2)
-            {
-                r = output2 & 0xFF;
-                g = (output2 >> 8) & 0xFF;
-                b = (output2 >> 16) & 0xFF;
-            }
-
-            final_color = 0xFF000000 | r | (g << 8) | (b << 16);
+            x1_start = display1_xoffset;
+            x1_end = std::max(std::min(display1_xoffset + reg.DISPLAY1.width, width), x1_start);
+        }
+        if (reg.PMODE.circuit2 && y >= display2_yoffset && y < display2_yoffset + reg.DISPLAY2.height)
+        {
+            x2_start = display2_xoffset;
+            x2_end = std::max(std::min(display2_xoffset + reg.DISPLAY2.width, width), x2_start);
+        }
 
-            if (reg.SMODE2.interlaced)
+        //Calculate Frame buffer Coordinates
+        int32_t scaled_y1 = (int32_t)reg.DISPFB1.y + fb_offset + (((y - display1_yoffset) >> (y_increment - 1)) << (frame_line_increment - 1));
+        int32_t scaled_y2 = (int32_t)reg.DISPFB2.y + fb_offset + (((y - display2_yoffset) >> (y_increment - 1)) << (frame_line_increment - 1));
+
+        if (x1_start < x1_end)
+            read_CRT_line(reg.DISPFB1, (int32_t)reg.DISPFB1.x + x1_start - display1_xoffset, scaled_y1,
+                          x1_end - x1_start, line1 + x1_start);
+
+        std::fill(line2, line2 + width, reg.BGCOLOR);
+        if (x2_start < x2_end && !reg.PMODE.blend_with_bg)
+            read_CRT_line(reg.DISPFB2, (int32_t)reg.DISPFB2.x + x2_start - display2_xoffset, scaled_y2,
+                          x2_end - x2_start, line2 + x2_start);
+
+        //If Circuit 1 is disabled, we can skip alpha blending on Circuit 2
+        //Some games (like Devil May Cry) will use Circuit 2 with an ALP of 255, making it effectively blank.
+        //However we think that on real hardware it will either skip the blending or duplicate Circuit 2 in the Circuit 1 output
+        //which effectively means output2 is outputted at full alpha
+        //Downhill Domination also has a dark screen if you do not follow this behaviour.  ALP 128 only circuit 2
+        std::fill(row, row + width, 0xFF000000);
+        for (int32_t x = x2_start; x < x2_end; x++)
+            row[x] = line2[x] | 0xFF000000;
+        if (x1_start < x1_end)
+            blend_CRT_pixels(row + x1_start, line1 + x1_start, line2 + x1_start, x1_end - x1_start,
+                             reg.PMODE.use_ALP, reg.PMODE.ALP);
+
+        if (reg.SMODE2.interlaced)
+        {
+            switch (reg.deinterlace_method)
             {
-                switch (reg.deinterlace_method)
+                case BOB_DEINTERLACE:
                 {
-                    case BOB_DEINTERLACE:
+                    if (reg.SMODE2.frame_mode)
                     {
-                        if (reg.SMODE2.frame_mode)
-                        {
-                            pixel_y *= 2;
-                            target[pixel_x + (pixel_y * width)] = final_color;
-                            target[pixel_x + ((pixel_y + 1)* width)] = final_color;
-                        }
-                        else
-                        {
-                            target[pixel_x + (pixel_y * width)] = final_color;
-                        }
-                        break;
+                        memcpy(target + (y * 2 * width), row, row_size);
+                        memcpy(target + ((y * 2 + 1) * width), row, row_size);
                     }
-                    default: //No Deinterlacing
+                    else
                     {
-                        screen_buffer[pixel_x + (pixel_y * width)] = final_color;
+                        memcpy(target + (y * width), row, row_size);
+                    }
+                    break;
+                }
+                default: //No Deinterlacing
+                {
+                    memcpy(screen_buffer + (y * width), row, row_size);
 
-                        target[pixel_x + (pixel_y * width)] = final_color;
+                    memcpy(target + (y * width), row, row_size);
 
-                        if (reg.SMODE2.interlaced)
-                        {
-                            if (reg.CSR.is_odd_frame)
-                                target[pixel_x + ((pixel_y + 1) * width)] = screen_buffer[pixel_x + ((pixel_y + 1) * width)];
-                            else if (pixel_y > 0)
-                                target[pixel_x + ((pixel_y - 1) * width)] = screen_buffer[pixel_x + ((pixel_y - 1) * width)];
-                        }
-                        break;
-                    }
+                    if (reg.CSR.is_odd_frame)
+                        memcpy(target + ((y + 1) * width), screen_buffer + ((y + 1) * width), row_size);
+                    else if (y > 0)
+                        memcpy(target + ((y - 1) * width), screen_buffer + ((y - 1) * width), row_size);
+                    break;
                 }
             }
-            else
-            {
-                target[pixel_x + (pixel_y * width)] = final_color;
-            }
+        }
+        else
+        {
+            memcpy(target + (y * width), row, row_size);
         }
     }
 }
 
 void GraphicsSynthesizerThread::write64(uint32_t addr, uint64_t value)
 {
+    if ((addr & 0x7F) != 0x0054)
+        flush_HWREG_buffer();
+
+    switch (addr & 0x7F)
+    {
+        case 0x0001:
+        case 0x0002:
+        case 0x0003:
+        case 0x0004:
+        case 0x0005:
+        case 0x000A:
+        case 0x000C:
+        case 0x000D:
+        case 0x0011:
+            //Vertex data is copied into each queued primitive
+            break;
+        default:
+            //Everything else can change state the render workers are reading
+            flush_render_workers();
+            render_hazard_dirty = true;
+            break;
+    }
+
     if (reg.write64(addr, value))
         return;
 
@@ -1111,7 +2084,19 @@ void GraphicsSynthesizerThread::write64(uint32_t addr, uint64_t value)
                 TRXPOS.int_source_y = TRXPOS.source_y;
                 PSMCT24_unpacked_count = 0;
                 PSMCT24_color = 0;
+
+                //Host->local and local->local transfers overwrite textures the cache may hold
+                transfer_pages.reset();
+                if (TRXDIR != 1)
+                {
+                    mark_pages(transfer_pages, BITBLTBUF.dest_base, BITBLTBUF.dest_width, BITBLTBUF.dest_format,
+                               TRXPOS.dest_x + TRXREG.width, TRXPOS.dest_y + TRXREG.height);
+                    pending_write_pages |= transfer_pages;
+                    crt_write_pages |= transfer_pages;
+                }
                 //printf("Transfer addr: $%08X\n", transfer_addr);
+                if (TRXDIR == 0)
+                    start_HWREG_transfer();
                 if (TRXDIR == 2)
                 {
                     //VRAM-to-VRAM transfer
@@ -1463,28 +2448,72 @@ void GraphicsSynthesizerThread::render_primitive()
     if (current_ctx->scissor.empty())
         return;
 
+    bool hazard = check_render_hazard();
+
 #ifdef GS_JIT
-    jit_draw_pixel_func = get_jitted_draw_pixel(draw_pixel_state);
+    //Workers call through the current JIT functions, so they must be idle before these change
+    uint8_t* draw_pixel_func = get_jitted_draw_pixel(draw_pixel_state);
+    if (draw_pixel_func != jit_draw_pixel_func)
+    {
+        flush_render_workers();
+        jit_draw_pixel_func = draw_pixel_func;
+    }
+    //The span JIT reads the zbuffer and framebuffer of four pixels before writing any of them back,
+    //so spans go through the pixel JIT when the two overlap
+    GSDrawSpanPrologue draw_span_func = nullptr;
+    if (!hazard)
+        draw_span_func = (GSDrawSpanPrologue)get_jitted_draw_span(draw_pixel_state);
+    if (draw_span_func != jit_draw_span_func)
+    {
+        flush_render_workers();
+        jit_draw_span_func = draw_span_func;
+    }
     //No need to recompile tex_lookup if texture mapping is disabled. TEX0 can contain bad data
-    if(current_PRMODE->texture_mapping)
-        jit_tex_lookup_func = get_jitted_tex_lookup(tex_lookup_state);
+    if (current_PRMODE->texture_mapping)
+    {
+        uint8_t* tex_lookup_func = get_jitted_tex_lookup(tex_lookup_state);
+        if (tex_lookup_func != jit_tex_lookup_func)
+        {
+            flush_render_workers();
+            jit_tex_lookup_func = tex_lookup_func;
+        }
+    }
 #endif
-    switch (prim_type)
+
+    if (current_PRMODE->texture_mapping)
+        bind_tex_cache(primitive_area());
+    pending_write_pages |= draw_pages;
+    crt_write_pages |= draw_pages;
+
+#ifdef GS_JIT
+    if (render_thread_count && !hazard)
+    {
+        dispatch_primitive();
+        return;
+    }
+#endif
+    flush_render_workers();
+    rasterize(prim_type, vtx_queue, { 0, 1 });
+}
+
+void GraphicsSynthesizerThread::rasterize(uint8_t prim, const Vertex* vtx, const GSRenderBand& band)
+{
+    switch (prim)
     {
         case 0:
-            render_point();
+            render_point(vtx, band);
             break;
         case 1:
         case 2:
-            render_line();
+            render_line(vtx, band);
             break;
         case 3:
         case 4:
         case 5:
-            render_triangle2();
+            render_triangle2(vtx, band);
             break;
         case 6:
-            render_sprite();
+            render_sprite(vtx, band);
             break;
     }
 }
@@ -1927,7 +2956,48 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
     }
 }
 
-void GraphicsSynthesizerThread::recompile_draw_pixel_prologue()
+void GraphicsSynthesizerThread::recompile_draw_pixel_prologue()
+{
+    jit_draw_pixel_block.clear();
+
+    emitter_dp.PUSH(REG_64::RBP);
+    emitter_dp.MOV64_MR(REG_64::RSP, REG_64::RBP);
+    emitter_dp.PUSH(REG_64::R12);
+    emitter_dp.PUSH(REG_64::R13);
+    emitter_dp.PUSH(REG_64::R14);
+    emitter_dp.PUSH(REG_64::R15);
+
+#ifdef _WIN32
+    emitter_dp.MOV32_REG(REG_64::RCX, REG_64::R12);
+    emitter_dp.MOV32_REG(REG_64::RDX, REG_64::R13);
+    emitter_dp.MOV32_REG(REG_64::R8, REG_64::R14);
+    emitter_dp.MOV64_FROM_MEM(REG_64::R9, REG_64::R15);
+#else
+    emitter_dp.MOV32_REG(REG_64::RDI, REG_64::R12);
+    emitter_dp.MOV32_REG(REG_64::RSI, REG_64::R13);
+    emitter_dp.MOV32_REG(REG_64::RDX, REG_64::R14);
+    emitter_dp.MOV64_FROM_MEM(REG_64::RCX, REG_64::R15);
+#endif
+
+    emitter_dp.SUB64_REG_IMM(0x20, REG_64::RSP);
+    emitter_dp.load_addr((uint64_t)&jit_draw_pixel_func, REG_64::RAX);
+    emitter_dp.MOV64_FROM_MEM(REG_64::RAX, REG_64::RAX);
+    emitter_dp.CALL_INDIR(REG_64::RAX);
+    emitter_dp.ADD64_REG_IMM(0x20, REG_64::RSP);
+
+    emitter_dp.POP(REG_64::R15);
+    emitter_dp.POP(REG_64::R14);
+    emitter_dp.POP(REG_64::R13);
+    emitter_dp.POP(REG_64::R12);
+    emitter_dp.POP(REG_64::RBP);
+    emitter_dp.RET();
+
+    jit_draw_pixel_prologue = (GSDrawPixelPrologue)jit_draw_pixel_heap.
+            insert_block(~0ULL, &jit_draw_pixel_block)->code_start;
+}
+
+//Calls the pixel JIT for each pixel of a span, saving the prologue's register setup and ABI overhead per pixel
+void GraphicsSynthesizerThread::recompile_draw_span_prologue()
 {
     jit_draw_pixel_block.clear();
 
@@ -1937,25 +3007,47 @@ void GraphicsSynthesizerThread::recompile_draw_pixel_prologue()
     emitter_dp.PUSH(REG_64::R13);
     emitter_dp.PUSH(REG_64::R14);
     emitter_dp.PUSH(REG_64::R15);
+    emitter_dp.PUSH(REG_64::RBX);
+    emitter_dp.PUSH(REG_64::RSI);
+    emitter_dp.PUSH(REG_64::RDI);
 
+    //RDI = y  RBX = current pixel  RSI = end of span
+    //The draw pixel function preserves all three
 #ifdef _WIN32
-    emitter_dp.MOV32_REG(REG_64::RCX, REG_64::R12);
-    emitter_dp.MOV32_REG(REG_64::RDX, REG_64::R13);
-    emitter_dp.MOV32_REG(REG_64::R8, REG_64::R14);
-    emitter_dp.MOV64_FROM_MEM(REG_64::R9, REG_64::R15);
+    emitter_dp.MOV32_REG(REG_64::RCX, REG_64::RDI);
+    emitter_dp.MOV64_MR(REG_64::RDX, REG_64::RBX);
+    emitter_dp.MOV64_MR(REG_64::R8, REG_64::RSI);
 #else
-    emitter_dp.MOV32_REG(REG_64::RDI, REG_64::R12);
-    emitter_dp.MOV32_REG(REG_64::RSI, REG_64::R13);
-    emitter_dp.MOV32_REG(REG_64::RDX, REG_64::R14);
-    emitter_dp.MOV64_FROM_MEM(REG_64::RCX, REG_64::R15);
+    emitter_dp.MOV64_MR(REG_64::RSI, REG_64::RBX);
+    emitter_dp.MOV64_MR(REG_64::RDX, REG_64::RSI);
 #endif
 
-    emitter_dp.SUB64_REG_IMM(0x20, REG_64::RSP);
+    //Eight pushes and the return address leave the stack 8 bytes off alignment
+    emitter_dp.SUB64_REG_IMM(0x28, REG_64::RSP);
+
+    emitter_dp.CMP64_REG(REG_64::RSI, REG_64::RBX);
+    uint8_t* empty_span = emitter_dp.JCC_NEAR_DEFERRED(ConditionCode::AE);
+
+    uint8_t* loop_start = jit_draw_pixel_block.get_code_pos();
+    emitter_dp.MOV32_FROM_MEM(REG_64::RBX, REG_64::R12, offsetof(GSSpanPixel, x));
+    emitter_dp.MOV32_REG(REG_64::RDI, REG_64::R13);
+    emitter_dp.MOV32_FROM_MEM(REG_64::RBX, REG_64::R14, offsetof(GSSpanPixel, z));
+    emitter_dp.MOV64_FROM_MEM(REG_64::RBX, REG_64::R15, offsetof(GSSpanPixel, color));
+
     emitter_dp.load_addr((uint64_t)&jit_draw_pixel_func, REG_64::RAX);
     emitter_dp.MOV64_FROM_MEM(REG_64::RAX, REG_64::RAX);
     emitter_dp.CALL_INDIR(REG_64::RAX);
-    emitter_dp.ADD64_REG_IMM(0x20, REG_64::RSP);
 
+    emitter_dp.ADD64_REG_IMM(sizeof(GSSpanPixel), REG_64::RBX);
+    emitter_dp.CMP64_REG(REG_64::RSI, REG_64::RBX);
+    emitter_dp.set_jump_dest(emitter_dp.JCC_NEAR_DEFERRED(ConditionCode::B), loop_start);
+
+    emitter_dp.set_jump_dest(empty_span);
+    emitter_dp.ADD64_REG_IMM(0x28, REG_64::RSP);
+
+    emitter_dp.POP(REG_64::RDI);
+    emitter_dp.POP(REG_64::RSI);
+    emitter_dp.POP(REG_64::RBX);
     emitter_dp.POP(REG_64::R15);
     emitter_dp.POP(REG_64::R14);
     emitter_dp.POP(REG_64::R13);
@@ -1963,16 +3055,55 @@ void GraphicsSynthesizerThread::recompile_draw_pixel_prologue()
     emitter_dp.POP(REG_64::RBP);
     emitter_dp.RET();
 
-    jit_draw_pixel_prologue = (GSDrawPixelPrologue)jit_draw_pixel_heap.
-            insert_block(~0ULL, &jit_draw_pixel_block)->code_start;
+    jit_draw_span_prologue = (GSDrawSpanPrologue)jit_draw_pixel_heap.
+            insert_block(~1ULL, &jit_draw_pixel_block)->code_start;
+}
+
+void GraphicsSynthesizerThread::begin_span(GSSpan& span, int32_t y)
+{
+    span.y = y;
+    span.count = 0;
 }
 
-void GraphicsSynthesizerThread::render_point()
+void GraphicsSynthesizerThread::add_span_pixel(GSSpan& span, int32_t x, uint32_t z, const RGBAQ_REG& color)
 {
-    Vertex v1 = vtx_queue[0]; v1.to_relative(current_ctx->xyoffset);
+    GSSpanPixel& pixel = span.pixels[span.count];
+    pixel.x = x;
+    pixel.z = z;
+    pixel.color = color;
+
+    span.count++;
+
+    //The texels of a whole span are fetched before any of its pixels are drawn. A primitive reading a texture
+    //it draws over must see its own earlier pixels, so it can't be batched.
+    if (span.count == GSSpan::MAX_PIXELS || tex_feedback)
+        draw_span(span);
+}
+
+void GraphicsSynthesizerThread::draw_span(GSSpan& span)
+{
+    if (!span.count)
+        return;
+#ifdef GS_JIT
+    if (jit_draw_span_func)
+        jit_draw_span_func(span.y, span.pixels, span.pixels + span.count);
+    else
+        jit_draw_span_prologue(span.y, span.pixels, span.pixels + span.count);
+#else
+    for (int i = 0; i < span.count; i++)
+        draw_pixel(span.pixels[i].x, span.y, span.pixels[i].z, span.pixels[i].color);
+#endif
+    span.count = 0;
+}
+
+void GraphicsSynthesizerThread::render_point(const Vertex* vtx, const GSRenderBand& band)
+{
+    Vertex v1 = vtx[0]; v1.to_relative(current_ctx->xyoffset);
     if (v1.x < current_ctx->scissor.x1 || v1.x > current_ctx->scissor.x2 ||
         v1.y < current_ctx->scissor.y1 || v1.y > current_ctx->scissor.y2)
         return;
+    if (!band.owns(v1.y >> 4))
+        return;
     printf("[GS_t] Rendering point!\n");
     printf("Coords: (%d, %d, %d)\n", v1.x >> 4, v1.y >> 4, v1.z);
     TexLookupInfo tex_info;
@@ -2022,11 +3153,11 @@ void GraphicsSynthesizerThread::render_point()
     }
 }
 
-void GraphicsSynthesizerThread::render_line()
+void GraphicsSynthesizerThread::render_line(const Vertex* vtx, const GSRenderBand& band)
 {
     printf("[GS_t] Rendering line!\n");
-    Vertex v1 = vtx_queue[1]; v1.to_relative(current_ctx->xyoffset);
-    Vertex v2 = vtx_queue[0]; v2.to_relative(current_ctx->xyoffset);
+    Vertex v1 = vtx[1]; v1.to_relative(current_ctx->xyoffset);
+    Vertex v2 = vtx[0]; v2.to_relative(current_ctx->xyoffset);
 
     int32_t min_y = ((std::max(std::min(v1.y, v2.y), (int32_t)current_ctx->scissor.y1) + 8) >> 4) << 4;
     int32_t min_x = ((std::max(std::min(v1.x, v2.x), (int32_t)current_ctx->scissor.x1) + 8) >> 4) << 4;
@@ -2054,12 +3185,12 @@ void GraphicsSynthesizerThread::render_line()
 
     TexLookupInfo tex_info;
     tex_info.new_lookup = true;
-    tex_info.vtx_color = vtx_queue[0].rgbaq;
+    tex_info.vtx_color = vtx[0].rgbaq;
     tex_info.tex_base = current_ctx->tex0.texture_base;
     tex_info.buffer_width = current_ctx->tex0.width;
     tex_info.tex_width = current_ctx->tex0.tex_width;
     tex_info.tex_height = current_ctx->tex0.tex_height;
-    float q = vtx_queue[0].rgbaq.q;
+    float q = vtx[0].rgbaq.q;
 
     printf("Coords: (%d, %d, %d) (%d, %d, %d)\n", v1.x >> 4, v1.y >> 4, v1.z, v2.x >> 4, v2.y >> 4, v2.z);
 
@@ -2121,6 +3252,9 @@ void GraphicsSynthesizerThread::render_line()
 #endif
             tex_info.vtx_color = tex_info.tex_color;
         }
+        //The color carries over between pixels when texturing, so only the draw itself can be skipped
+        if (!band.owns((is_steep ? x : y) >> 4))
+            continue;
 #ifdef GS_JIT
         if (is_steep)
             jit_draw_pixel_prologue(y, x, z, tex_info.vtx_color);
@@ -2185,7 +3319,7 @@ static void order3(int32_t a, int32_t b, int32_t c, uint8_t* order)
     }
 }
 
-void GraphicsSynthesizerThread::render_triangle2() {
+void GraphicsSynthesizerThread::render_triangle2(const Vertex* vtx, const GSRenderBand& band) {
     // This is a "scanline" algorithm which reduces flops/pixel
     //  at the cost of a longer setup time.
 
@@ -2215,9 +3349,9 @@ void GraphicsSynthesizerThread::render_triangle2() {
 
 
     Vertex unsortedVerts[3]; // vertices in the order they were sent to GS
-    unsortedVerts[0] = vtx_queue[2]; unsortedVerts[0].to_relative(current_ctx->xyoffset);
-    unsortedVerts[1] = vtx_queue[1]; unsortedVerts[1].to_relative(current_ctx->xyoffset);
-    unsortedVerts[2] = vtx_queue[0]; unsortedVerts[2].to_relative(current_ctx->xyoffset);
+    unsortedVerts[0] = vtx[2]; unsortedVerts[0].to_relative(current_ctx->xyoffset);
+    unsortedVerts[1] = vtx[1]; unsortedVerts[1].to_relative(current_ctx->xyoffset);
+    unsortedVerts[2] = vtx[0]; unsortedVerts[2].to_relative(current_ctx->xyoffset);
 
     if (!current_PRMODE->gourand_shading)
     {
@@ -2387,7 +3521,8 @@ void GraphicsSynthesizerThread::render_triangle2() {
                                  lowerRightEdgeStep,  // slope of right edge
                                  scissorX1,        // x scissor (integer pixels, do draw this px)
                                  scissorX2,        // x scissor (integer pixels, don't draw this px)
-                                 tex_info);        // texture
+                                 tex_info,         // texture
+                                 band);            // scanlines we are allowed to draw
         }
     }
     else
@@ -2405,7 +3540,7 @@ void GraphicsSynthesizerThread::render_triangle2() {
                                  v0,                  // interpolate from this vertex
                                  upperLeftEdgeStep, upperRightEdgeStep, // slopes
                                  scissorX1, scissorX2,  // integer x scissor
-                                 tex_info);
+                                 tex_info, band);
         }
 
         if(lowerTop < lowerBot)
@@ -2419,7 +3554,7 @@ void GraphicsSynthesizerThread::render_triangle2() {
             render_half_triangle(v0.x + upperLeftEdgeStep * e10.y, // one of our upper edge vertices isn't v0,v1,v2, but we don't know which. todo is this faster than branch?
                                  v0.x + upperRightEdgeStep * e10.y,
                                  lowerTop, lowerBot, dvdx, dvdy, v1,
-                                 lowerLeftEdgeStep, lowerRightEdgeStep, scissorX1, scissorX2, tex_info);
+                                 lowerLeftEdgeStep, lowerRightEdgeStep, scissorX1, scissorX2, tex_info, band);
         }
 
     }
@@ -2440,16 +3575,22 @@ void GraphicsSynthesizerThread::render_triangle2() {
  * @param scx1    - left x scissor (fp px)
  * @param scx2    - right x scissor (fp px)
  * @param tex_info - texture data
+ * @param band    - scanlines owned by the caller, every scanline is interpolated from init so skipping is exact
  */
 void GraphicsSynthesizerThread::render_half_triangle(float x0, float x1, int y0, int y1, VertexF &x_step,
                                                      VertexF &y_step, VertexF &init, float step_x0, float step_x1,
-                                                     float scx1, float scx2, TexLookupInfo& tex_info) {
+                                                     float scx1, float scx2, TexLookupInfo& tex_info,
+                                                     const GSRenderBand& band) {
 
     bool tmp_tex = current_PRMODE->texture_mapping;
     bool tmp_uv = !current_PRMODE->use_UV;
+    GSSpan span;
 
     for(int y = y0; y < y1; y++) // loop over scanlines of triangle
     {
+        if (!band.owns(y))
+            continue;
+
         float height = y - init.y; // how far down we've made it
         VertexF vtx = init + y_step * height;       // interpolate to point (x_init, y)
         float x0l = x0 + step_x0 * height;          // start x coordinates of scanline from interpolation
@@ -2463,6 +3604,7 @@ void GraphicsSynthesizerThread::render_half_triangle(float x0, float x1, int y0,
 
         vtx += (x_step * (x0l - init.x));           // interpolate to point (x0l, y)
 
+        begin_span(span, y * 16);
         for(int x = x0l; x < xStop; x++)            // loop over x pixels of scanline
         {
             //vtx = init + y_step * height + (x_step * (x - init.x));
@@ -2496,24 +3638,17 @@ void GraphicsSynthesizerThread::render_half_triangle(float x0, float x1, int y0,
                 }
 #ifdef GS_JIT
                 jit_tex_lookup_prologue(u, v, &tex_info);
-                jit_draw_pixel_prologue(x * 16, y * 16, (uint32_t)vtx.z, tex_info.tex_color);
 #else
                 tex_lookup(u, v, tex_info);
-                draw_pixel(x * 16, y * 16, (uint32_t)vtx.z, tex_info.tex_color);
 #endif
-
+                add_span_pixel(span, x * 16, (uint32_t)vtx.z, tex_info.tex_color);
             }
             else
-            {
-#ifdef GS_JIT
-                jit_draw_pixel_prologue(x * 16, y * 16, (uint32_t)vtx.z, tex_info.vtx_color);
-#else
-                draw_pixel(x * 16, y * 16, (uint32_t)vtx.z, tex_info.vtx_color);
-#endif
-            }
+                add_span_pixel(span, x * 16, (uint32_t)vtx.z, tex_info.vtx_color);
 
             vtx += x_step;                       // get values for the adjacent pixel
         }
+        draw_span(span);
     }
 
 }
@@ -2600,6 +3735,7 @@ void GraphicsSynthesizerThread::render_triangle()
 
 
     TexLookupInfo tex_info;
+    GSSpan span;
     tex_info.new_lookup = true;
     tex_info.tex_base = current_ctx->tex0.texture_base;
     tex_info.buffer_width = current_ctx->tex0.width;
@@ -2671,6 +3807,7 @@ void GraphicsSynthesizerThread::render_triangle()
                     int32_t w1 = w1_row;
                     int32_t w2 = w2_row;
                     int32_t w3 = w3_row;
+                    begin_span(span, y);
                     for (int32_t x = x_block; x < x_block + BLOCKSIZE; x += 0x10)
                     {
                         //Is inside triangle?
@@ -2723,20 +3860,13 @@ void GraphicsSynthesizerThread::render_triangle()
                                 }
 #ifdef GS_JIT
                                 jit_tex_lookup_prologue(u, v, &tex_info);
-                                jit_draw_pixel_prologue(x, y, (uint32_t)z, tex_info.tex_color);
 #else
                                 tex_lookup(u, v, tex_info);
-                                draw_pixel(x, y, (uint32_t)z, tex_info.tex_color);
 #endif
+                                add_span_pixel(span, x, (uint32_t)z, tex_info.tex_color);
                             }
                             else
-                            {
-#ifdef GS_JIT
-                                jit_draw_pixel_prologue(x, y, (uint32_t)z, tex_info.vtx_color);
-#else
-                                draw_pixel(x, y, (uint32_t)z, tex_info.vtx_color);
-#endif
-                            }
+                                add_span_pixel(span, x, (uint32_t)z, tex_info.vtx_color);
                         }
                         else
                             break;
@@ -2745,6 +3875,7 @@ void GraphicsSynthesizerThread::render_triangle()
                         w2 += A31 << 4;
                         w3 += A12 << 4;
                     }
+                    draw_span(span);
                     //Vertical step
                     w1_row += B23 << 4;
                     w2_row += B31 << 4;
@@ -2752,108 +3883,573 @@ void GraphicsSynthesizerThread::render_triangle()
                 }
             }
 
-            w1_block += BLOCKSIZE * A23;
-            w2_block += BLOCKSIZE * A31;
-            w3_block += BLOCKSIZE * A12;
+            w1_block += BLOCKSIZE * A23;
+            w2_block += BLOCKSIZE * A31;
+            w3_block += BLOCKSIZE * A12;
+
+        }
+        w1_row_block += BLOCKSIZE * B23;
+        w2_row_block += BLOCKSIZE * B31;
+        w3_row_block += BLOCKSIZE * B12;
+    }
+
+}
+
+/**
+  * Returns true if every pixel of an untextured sprite would be written with the same value,
+  * i.e. nothing in the pixel pipeline depends on what is already in the frame or z buffer.
+  */
+bool GraphicsSynthesizerThread::sprite_is_fill(const RGBAQ_REG& color)
+{
+    if (current_PRMODE->texture_mapping || DTHE || SCANMSK >= 2 || current_ctx->frame.mask)
+        return false;
+
+    if (current_PRMODE->alpha_blend && (!PABE || (color.a & 0x80)))
+        return false;
+
+    const TEST& test = current_ctx->test;
+    if (test.alpha_test && test.alpha_method != 1)
+        return false;
+    if (test.depth_test && (test.depth_method != 1 || !current_ctx->zbuf.no_update))
+        return false;
+    if (test.dest_alpha_test && !(current_ctx->frame.format & 0x1))
+        return false;
+
+    switch (current_ctx->frame.format)
+    {
+        case 0x00:
+        case 0x01:
+        case 0x02:
+        case 0x0A:
+        case 0x30:
+        case 0x31:
+        case 0x32:
+        case 0x3A:
+            return true;
+        default:
+            return false;
+    }
+}
+
+//Fills whole blocks with a repeated value, edge pixels go through the regular block writes
+void GraphicsSynthesizerThread::fill_sprite(const RGBAQ_REG& color, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2,
+                                            const GSRenderBand& band)
+{
+    //Bands must not split a block row
+    static_assert(GS_RENDER_BAND_SHIFT >= 3, "GS render bands are smaller than a block");
+
+    uint8_t format = current_ctx->frame.format;
+    uint32_t base = current_ctx->frame.base_pointer;
+    uint32_t width = current_ctx->frame.width;
+
+    uint32_t final_color = ((uint32_t)color.a << 24) | (color.b << 16) | (color.g << 8) | color.r;
+    final_color |= (uint32_t)current_ctx->FBA << 31;
+
+    bool is_16bit = (format & 0x2) != 0;
+    bool is_24bit = format == 0x01 || format == 0x31;
+    uint16_t color16 = convert_color_down(final_color);
+    uint32_t pattern = is_16bit ? (color16 | (color16 << 16)) : final_color;
+    uint32_t block_w = is_16bit ? 16 : 8;
+
+    auto fill_pixels = [&](uint32_t px1, uint32_t px2, uint32_t py1, uint32_t py2)
+    {
+        for (uint32_t y = py1; y < py2; y++)
+        {
+            for (uint32_t x = px1; x < px2; x++)
+            {
+                switch (format)
+                {
+                    case 0x00:
+                        write_PSMCT32_block(base, width, x, y, final_color);
+                        break;
+                    case 0x01:
+                        write_PSMCT24_block(base, width, x, y, final_color);
+                        break;
+                    case 0x02:
+                        write_PSMCT16_block(base, width, x, y, color16);
+                        break;
+                    case 0x0A:
+                        write_PSMCT16S_block(base, width, x, y, color16);
+                        break;
+                    case 0x30:
+                        write_PSMCT32Z_block(base, width, x, y, final_color);
+                        break;
+                    case 0x31:
+                        write_PSMCT24Z_block(base, width, x, y, final_color);
+                        break;
+                    case 0x32:
+                        write_PSMCT16Z_block(base, width, x, y, color16);
+                        break;
+                    case 0x3A:
+                        write_PSMCT16SZ_block(base, width, x, y, color16);
+                        break;
+                }
+            }
+        }
+    };
+
+    uint32_t y = y1;
+    while (y < y2)
+    {
+        uint32_t block_y = y & ~0x7;
+        uint32_t next_y = std::min(block_y + 8, y2);
+        if (!band.owns(y))
+        {
+            y = next_y;
+            continue;
+        }
+
+        uint32_t fill_x1 = (x1 + block_w - 1) & ~(block_w - 1);
+        uint32_t fill_x2 = x2 & ~(block_w - 1);
+        if (y != block_y || next_y != block_y + 8 || fill_x1 >= fill_x2)
+        {
+            fill_pixels(x1, x2, y, next_y);
+            y = next_y;
+            continue;
+        }
+
+        fill_pixels(x1, fill_x1, y, next_y);
+        for (uint32_t x = fill_x1; x < fill_x2; x += block_w)
+        {
+            uint32_t* block = (uint32_t*)&local_mem[block_address(format, base, width, x, y)];
+            if (is_24bit)
+            {
+                for (int i = 0; i < 64; i++)
+                    block[i] = (block[i] & 0xFF000000) | (pattern & 0xFFFFFF);
+            }
+            else
+                std::fill(block, block + 64, pattern);
+        }
+        fill_pixels(fill_x2, x2, y, next_y);
+        y = next_y;
+    }
+}
+
+void GraphicsSynthesizerThread::render_sprite(const Vertex* vtx, const GSRenderBand& band)
+{
+    printf("[GS_t] Rendering sprite!\n");
+    Vertex v1 = vtx[1]; v1.to_relative(current_ctx->xyoffset);
+    Vertex v2 = vtx[0]; v2.to_relative(current_ctx->xyoffset);
+    TexLookupInfo tex_info;
+    GSSpan span;
+    tex_info.new_lookup = true;
+
+    tex_info.vtx_color = vtx[0].rgbaq;
+    tex_info.tex_base = current_ctx->tex0.texture_base;
+    tex_info.buffer_width = current_ctx->tex0.width;
+    tex_info.tex_width = current_ctx->tex0.tex_width;
+    tex_info.tex_height = current_ctx->tex0.tex_height;
+
+    calculate_LOD(tex_info);
+
+    //Automatic scissoring test
+    const int32_t min_y = ((std::max(std::min(v1.y, v2.y), (int32_t)current_ctx->scissor.y1) + 8) >> 4) << 4;
+    const int32_t min_x = ((std::max(std::min(v1.x, v2.x), (int32_t)current_ctx->scissor.x1) + 8) >> 4) << 4;
+    const int32_t max_y = ((std::min(std::max(v1.y, v2.y), (int32_t)current_ctx->scissor.y2 + 0x10) + 8) >> 4) << 4;
+    const int32_t max_x = ((std::min(std::max(v1.x, v2.x), (int32_t)current_ctx->scissor.x2 + 0x10) + 8) >> 4) << 4;
+
+    printf("Coords: (%d, %d) (%d, %d)\n", min_x >> 4, min_y >> 4, max_x >> 4, max_y >> 4);
+
+    if (sprite_is_fill(tex_info.vtx_color))
+    {
+        if (min_x < max_x && min_y < max_y)
+            fill_sprite(tex_info.vtx_color, min_x >> 4, min_y >> 4, max_x >> 4, max_y >> 4, band);
+        return;
+    }
+
+    float pix_t = interpolate_f(min_y, v1.t, v1.y, v2.t, v2.y);
+    int32_t pix_v = (int32_t)interpolate(min_y, v1.uv.v, v1.y, v2.uv.v, v2.y) << 16;
+    float pix_s_init = interpolate_f(min_x, v1.s, v1.x, v2.s, v2.x);
+    int32_t pix_u_init = (int32_t)interpolate(min_x, v1.uv.u, v1.x, v2.uv.u, v2.x) << 16;
+
+    float pix_t_step = stepsize(v1.t, v1.y, v2.t, v2.y, 0x10);
+    int32_t pix_v_step = stepsize((int32_t)v1.uv.v, v1.y, (int32_t)v2.uv.v, v2.y, 0x100000);
+    float pix_s_step = stepsize(v1.s, v1.x, v2.s, v2.x, 0x10);
+    int32_t pix_u_step = stepsize((int32_t)v1.uv.u, v1.x, (int32_t)v2.uv.u, v2.x, 0x100000);
+
+    bool tmp_tex = current_PRMODE->texture_mapping;
+    bool tmp_st = !current_PRMODE->use_UV;//allow for loop unswitching
+
+    for (int32_t y = min_y; y < max_y; y += 0x10)
+    {
+        //Scanlines owned by other workers still have to step t/v to stay bit-exact
+        if (!band.owns(y >> 4))
+        {
+            pix_t += pix_t_step;
+            pix_v += pix_v_step;
+            continue;
+        }
+
+        float pix_s = pix_s_init;
+        uint32_t pix_u = pix_u_init;
+        begin_span(span, y);
+        for (int32_t x = min_x; x < max_x; x += 0x10)
+        {
+            if (tmp_tex)
+            {
+                tex_info.fog = v2.fog;
+                if (tmp_st)
+                {
+                    pix_v = ((pix_t / v2.rgbaq.q) * tex_info.tex_height) * 16.0;
+                    pix_u = ((pix_s / v2.rgbaq.q) * tex_info.tex_width) * 16.0;
+#ifdef GS_JIT
+                    jit_tex_lookup_prologue(pix_u, pix_v, &tex_info);
+#else
+                    tex_lookup(pix_u, pix_v, tex_info);
+#endif
+                }
+                else
+                {
+#ifdef GS_JIT
+                    jit_tex_lookup_prologue(pix_u >> 16, pix_v >> 16, &tex_info);
+#else
+                    tex_lookup(pix_u >> 16, pix_v >> 16, tex_info);
+#endif
+                }
+                add_span_pixel(span, x, v2.z, tex_info.tex_color);
+            }
+            else
+                add_span_pixel(span, x, v2.z, tex_info.vtx_color);
+            pix_s += pix_s_step;
+            pix_u += pix_u_step;
+        }
+        draw_span(span);
+        pix_t += pix_t_step;
+        pix_v += pix_v_step;
+    }
+}
+
+//Block dimensions and bits per pixel of the formats with a whole-block upload kernel
+static bool get_HWREG_block_format(uint8_t format, int& bpp, int& block_w, int& block_h)
+{
+    switch (format)
+    {
+        case 0x00:
+            bpp = 32; block_w = 8; block_h = 8;
+            return true;
+        case 0x01:
+            bpp = 24; block_w = 8; block_h = 8;
+            return true;
+        case 0x02:
+        case 0x0A:
+            bpp = 16; block_w = 16; block_h = 8;
+            return true;
+        case 0x13:
+            bpp = 8; block_w = 16; block_h = 16;
+            return true;
+        case 0x14:
+            bpp = 4; block_w = 32; block_h = 16;
+            return true;
+        case 0x1B:
+            bpp = 8; block_w = 8; block_h = 8;
+            return true;
+        default:
+            return false;
+    }
+}
+
+//The swizzle kernels take a linear block of pixels (pitch bytes per row) and write one 256-byte GS block.
+//Within a block, 32 and 16-bit pixels are stored as pairs of rows whose 64-bit halves are interleaved.
+static void swizzle_block_PSMCT32(uint8_t* dest, const uint8_t* src, uint32_t pitch)
+{
+#ifdef GS_SSE2
+    for (int y = 0; y < 8; y += 2)
+    {
+        const uint8_t* row0 = src + y * pitch;
+        const uint8_t* row1 = row0 + pitch;
+        __m128i a = _mm_loadu_si128((const __m128i*)row0);
+        __m128i b = _mm_loadu_si128((const __m128i*)(row0 + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)row1);
+        __m128i d = _mm_loadu_si128((const __m128i*)(row1 + 16));
+
+        __m128i* out = (__m128i*)(dest + y * 32);
+        _mm_storeu_si128(out, _mm_unpacklo_epi64(a, c));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi64(a, c));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi64(b, d));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi64(b, d));
+    }
+#else
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+            *(uint32_t*)&dest[columnTable32[y][x] << 2] = *(const uint32_t*)&src[y * pitch + (x << 2)];
+    }
+#endif
+}
+
+//PSMCT24 keeps the upper 8 bits of each word, which may belong to a PSMT8H/PSMT4HL/PSMT4HH texture
+static void swizzle_block_PSMCT24(uint8_t* dest, const uint8_t* src, uint32_t pitch)
+{
+    uint32_t colors[64];
+    for (int y = 0; y < 8; y++)
+    {
+        const uint8_t* row = src + y * pitch;
+        for (int x = 0; x < 8; x++)
+            colors[(y << 3) + x] = row[x * 3] | (row[x * 3 + 1] << 8) | (row[x * 3 + 2] << 16);
+    }
+
+    uint32_t block[64];
+    swizzle_block_PSMCT32((uint8_t*)block, (const uint8_t*)colors, 32);
+
+    uint32_t* out = (uint32_t*)dest;
+#ifdef GS_SSE2
+    __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    for (int i = 0; i < 64; i += 4)
+    {
+        __m128i old_mem = _mm_loadu_si128((const __m128i*)&out[i]);
+        __m128i color = _mm_loadu_si128((const __m128i*)&block[i]);
+        color = _mm_or_si128(_mm_and_si128(color, rgb_mask), _mm_andnot_si128(rgb_mask, old_mem));
+        _mm_storeu_si128((__m128i*)&out[i], color);
+    }
+#else
+    for (int i = 0; i < 64; i++)
+        out[i] = (out[i] & 0xFF000000) | block[i];
+#endif
+}
+
+static void swizzle_block_PSMCT16(uint8_t* dest, const uint8_t* src, uint32_t pitch)
+{
+#ifdef GS_SSE2
+    for (int y = 0; y < 8; y += 2)
+    {
+        const uint8_t* row0 = src + y * pitch;
+        const uint8_t* row1 = row0 + pitch;
+
+        //Pixels x and x + 8 of a row are stored next to each other
+        __m128i row0_lo = _mm_loadu_si128((const __m128i*)row0);
+        __m128i row0_hi = _mm_loadu_si128((const __m128i*)(row0 + 16));
+        __m128i row1_lo = _mm_loadu_si128((const __m128i*)row1);
+        __m128i row1_hi = _mm_loadu_si128((const __m128i*)(row1 + 16));
+        __m128i a0 = _mm_unpacklo_epi16(row0_lo, row0_hi);
+        __m128i a1 = _mm_unpackhi_epi16(row0_lo, row0_hi);
+        __m128i b0 = _mm_unpacklo_epi16(row1_lo, row1_hi);
+        __m128i b1 = _mm_unpackhi_epi16(row1_lo, row1_hi);
+
+        __m128i* out = (__m128i*)(dest + y * 32);
+        _mm_storeu_si128(out, _mm_unpacklo_epi64(a0, b0));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi64(a0, b0));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi64(a1, b1));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi64(a1, b1));
+    }
+#else
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 16; x++)
+            *(uint16_t*)&dest[columnTable16[y][x] << 1] = *(const uint16_t*)&src[y * pitch + (x << 1)];
+    }
+#endif
+}
+
+static void swizzle_block_PSMCT8(uint8_t* dest, const uint8_t* src, uint32_t pitch)
+{
+    for (int y = 0; y < 16; y++)
+    {
+        const uint8_t* row = src + y * pitch;
+        for (int x = 0; x < 16; x++)
+            dest[columnTable8[y][x]] = row[x];
+    }
+}
 
+static void swizzle_block_PSMCT4(uint8_t* dest, const uint8_t* src, uint32_t pitch)
+{
+    uint8_t block[256];
+    memset(block, 0, sizeof(block));
+    for (int y = 0; y < 16; y++)
+    {
+        const uint8_t* row = src + y * pitch;
+        for (int x = 0; x < 32; x++)
+        {
+            uint32_t addr = columnTable4[y][x];
+            uint8_t value = (row[x >> 1] >> ((x & 1) << 2)) & 0xF;
+            block[addr >> 1] |= value << ((addr & 1) << 2);
         }
-        w1_row_block += BLOCKSIZE * B23;
-        w2_row_block += BLOCKSIZE * B31;
-        w3_row_block += BLOCKSIZE * B12;
     }
-
+    memcpy(dest, block, sizeof(block));
 }
 
-void GraphicsSynthesizerThread::render_sprite()
+static void swizzle_block_PSMT8H(uint8_t* dest, const uint8_t* src, uint32_t pitch)
 {
-    printf("[GS_t] Rendering sprite!\n");
-    Vertex v1 = vtx_queue[1]; v1.to_relative(current_ctx->xyoffset);
-    Vertex v2 = vtx_queue[0]; v2.to_relative(current_ctx->xyoffset);
-    TexLookupInfo tex_info;
-    tex_info.new_lookup = true;
+    for (int y = 0; y < 8; y++)
+    {
+        const uint8_t* row = src + y * pitch;
+        for (int x = 0; x < 8; x++)
+            dest[(columnTable32[y][x] << 2) + 3] = row[x];
+    }
+}
 
-    tex_info.vtx_color = vtx_queue[0].rgbaq;
-    tex_info.tex_base = current_ctx->tex0.texture_base;
-    tex_info.buffer_width = current_ctx->tex0.width;
-    tex_info.tex_width = current_ctx->tex0.tex_width;
-    tex_info.tex_height = current_ctx->tex0.tex_height;
+/**
+  * Decides whether a new host->local transfer can go through the block buffer.
+  * Every row has to start on a doubleword so that the buffered stream splits cleanly into rows,
+  * and the rectangle must not wrap around the 2048x2048 address space.
+  **/
+void GraphicsSynthesizerThread::start_HWREG_transfer()
+{
+    hwreg_bulk = false;
+    hwreg_buffer_used = 0;
 
-    calculate_LOD(tex_info);
+    int bpp, block_w, block_h;
+    if (!get_HWREG_block_format(BITBLTBUF.dest_format, bpp, block_w, block_h))
+        return;
+    if (!TRXREG.width || !TRXREG.height || (TRXREG.width * bpp) % 64)
+        return;
+    if (TRXPOS.dest_x + TRXREG.width > 2048 || TRXPOS.dest_y + TRXREG.height > 2048)
+        return;
 
-    //Automatic scissoring test
-    const int32_t min_y = ((std::max(std::min(v1.y, v2.y), (int32_t)current_ctx->scissor.y1) + 8) >> 4) << 4;
-    const int32_t min_x = ((std::max(std::min(v1.x, v2.x), (int32_t)current_ctx->scissor.x1) + 8) >> 4) << 4;
-    const int32_t max_y = ((std::min(std::max(v1.y, v2.y), (int32_t)current_ctx->scissor.y2 + 0x10) + 8) >> 4) << 4;
-    const int32_t max_x = ((std::min(std::max(v1.x, v2.x), (int32_t)current_ctx->scissor.x2 + 0x10) + 8) >> 4) << 4;
+    //4-bit pixels pick their nibble from the destination x, so the stream only lines up with even x
+    if (bpp == 4 && (TRXPOS.dest_x & 0x1))
+        return;
 
-    printf("Coords: (%d, %d) (%d, %d)\n", min_x >> 4, min_y >> 4, max_x >> 4, max_y >> 4);
+    hwreg_bulk = true;
+    hwreg_row_bytes = (TRXREG.width * bpp) / 8;
 
-    float pix_t = interpolate_f(min_y, v1.t, v1.y, v2.t, v2.y);
-    int32_t pix_v = (int32_t)interpolate(min_y, v1.uv.v, v1.y, v2.uv.v, v2.y) << 16;
-    float pix_s_init = interpolate_f(min_x, v1.s, v1.x, v2.s, v2.x);
-    int32_t pix_u_init = (int32_t)interpolate(min_x, v1.uv.u, v1.x, v2.uv.u, v2.x) << 16;
+    uint32_t rows = std::min((uint32_t)(block_h - (TRXPOS.dest_y % block_h)), (uint32_t)TRXREG.height);
+    hwreg_buffer_target = rows * hwreg_row_bytes;
+    hwreg_buffer.resize(block_h * hwreg_row_bytes);
+}
 
-    float pix_t_step = stepsize(v1.t, v1.y, v2.t, v2.y, 0x10);
-    int32_t pix_v_step = stepsize((int32_t)v1.uv.v, v1.y, (int32_t)v2.uv.v, v2.y, 0x100000);
-    float pix_s_step = stepsize(v1.s, v1.x, v2.s, v2.x, 0x10);
-    int32_t pix_u_step = stepsize((int32_t)v1.uv.u, v1.x, (int32_t)v2.uv.u, v2.x, 0x100000);
+//Replays buffered image data through the per-pixel path. The rest of the transfer stays on that path
+void GraphicsSynthesizerThread::flush_HWREG_buffer()
+{
+    if (!hwreg_buffer_used)
+        return;
 
-    bool tmp_tex = current_PRMODE->texture_mapping;
-    bool tmp_st = !current_PRMODE->use_UV;//allow for loop unswitching
+    hwreg_bulk = false;
+    for (uint32_t i = 0; i < hwreg_buffer_used; i += 8)
+    {
+        uint64_t data;
+        memcpy(&data, &hwreg_buffer[i], 8);
+        write_HWREG_pixels(data);
+    }
+    hwreg_buffer_used = 0;
+}
 
-    for (int32_t y = min_y; y < max_y; y += 0x10)
+void GraphicsSynthesizerThread::write_HWREG_pixel(uint32_t x, uint32_t y, const uint8_t* row, uint32_t index)
+{
+    uint32_t base = BITBLTBUF.dest_base;
+    uint32_t width = BITBLTBUF.dest_width;
+    switch (BITBLTBUF.dest_format)
     {
-        float pix_s = pix_s_init;
-        uint32_t pix_u = pix_u_init;
-        for (int32_t x = min_x; x < max_x; x += 0x10)
+        case 0x00:
+            write_PSMCT32_block(base, width, x, y, *(const uint32_t*)&row[index << 2]);
+            break;
+        case 0x01:
         {
-            if (tmp_tex)
-            {
-                tex_info.fog = v2.fog;
-                if (tmp_st)
-                {
-                    pix_v = ((pix_t / v2.rgbaq.q) * tex_info.tex_height) * 16.0;
-                    pix_u = ((pix_s / v2.rgbaq.q) * tex_info.tex_width) * 16.0;
-#ifdef GS_JIT
-                    jit_tex_lookup_prologue(pix_u, pix_v, &tex_info);
-#else
-                    tex_lookup(pix_u, pix_v, tex_info);
-#endif
-                }
-                else
-                {
-#ifdef GS_JIT
-                    jit_tex_lookup_prologue(pix_u >> 16, pix_v >> 16, &tex_info);
-#else
-                    tex_lookup(pix_u >> 16, pix_v >> 16, tex_info);
-#endif
-                }
-
-#ifdef GS_JIT
-                jit_draw_pixel_prologue(x, y, v2.z, tex_info.tex_color);
-#else
-                draw_pixel(x, y, v2.z, tex_info.tex_color);
-#endif
-            }
+            const uint8_t* color = &row[index * 3];
+            write_PSMCT24_block(base, width, x, y, color[0] | (color[1] << 8) | (color[2] << 16));
+        }
+            break;
+        case 0x02:
+            write_PSMCT16_block(base, width, x, y, *(const uint16_t*)&row[index << 1]);
+            break;
+        case 0x0A:
+            write_PSMCT16S_block(base, width, x, y, *(const uint16_t*)&row[index << 1]);
+            break;
+        case 0x13:
+            write_PSMCT8_block(base, width, x, y, row[index]);
+            break;
+        case 0x14:
+        {
+            uint8_t value = row[index >> 1];
+            if (x & 0x1)
+                value >>= 4;
             else
-            {
-#ifdef GS_JIT
-                jit_draw_pixel_prologue(x, y, v2.z, tex_info.vtx_color);
-#else
-                draw_pixel(x, y, v2.z, tex_info.vtx_color);
-#endif
-            }
-            pix_s += pix_s_step;
-            pix_u += pix_u_step;
+                value &= 0xF;
+            write_PSMCT4_block(base, width, x, y, value);
         }
-        pix_t += pix_t_step;
-        pix_v += pix_v_step;
+            break;
+        case 0x1B:
+        {
+            uint32_t value = (uint32_t)row[index] << 24;
+            value |= read_PSMCT32_block(base, width, x, y) & 0x00FFFFFF;
+            write_PSMCT32_block(base, width, x, y, value);
+        }
+            break;
+    }
+}
+
+//Writes the buffered rows, which end on a block boundary or at the end of the transfer
+void GraphicsSynthesizerThread::write_HWREG_rows()
+{
+    int bpp, block_w, block_h;
+    if (!get_HWREG_block_format(BITBLTBUF.dest_format, bpp, block_w, block_h))
+        Errors::die("[GS_t] Buffered HWREG transfer with unsupported format $%02X\n", BITBLTBUF.dest_format);
+
+    uint32_t rows = hwreg_buffer_target / hwreg_row_bytes;
+    uint32_t y = TRXPOS.int_dest_y;
+    uint32_t start_x = TRXPOS.dest_x;
+    uint32_t end_x = start_x + TRXREG.width;
+
+    //Only a full row of blocks can use the kernels. Ragged columns and rows go pixel by pixel
+    uint32_t block_start = end_x, block_end = end_x;
+    if (rows == (uint32_t)block_h && !(y % block_h))
+    {
+        block_start = (start_x + block_w - 1) & ~(block_w - 1);
+        block_end = std::max(end_x & ~(block_w - 1), block_start);
+    }
+
+    for (uint32_t row = 0; row < rows; row++)
+    {
+        const uint8_t* src = &hwreg_buffer[row * hwreg_row_bytes];
+        for (uint32_t x = start_x; x < block_start; x++)
+            write_HWREG_pixel(x, y + row, src, x - start_x);
+        for (uint32_t x = block_end; x < end_x; x++)
+            write_HWREG_pixel(x, y + row, src, x - start_x);
     }
+
+    uint32_t base = BITBLTBUF.dest_base / 256;
+    uint32_t width = BITBLTBUF.dest_width / 64;
+    for (uint32_t x = block_start; x < block_end; x += block_w)
+    {
+        const uint8_t* src = &hwreg_buffer[((x - start_x) * bpp) / 8];
+        switch (BITBLTBUF.dest_format)
+        {
+            case 0x00:
+                swizzle_block_PSMCT32(&local_mem[addr_PSMCT32(base, width, x, y) & ~0xFF], src, hwreg_row_bytes);
+                break;
+            case 0x01:
+                swizzle_block_PSMCT24(&local_mem[addr_PSMCT32(base, width, x, y) & ~0xFF], src, hwreg_row_bytes);
+                break;
+            case 0x02:
+                swizzle_block_PSMCT16(&local_mem[addr_PSMCT16(base, width, x, y) & ~0xFF], src, hwreg_row_bytes);
+                break;
+            case 0x0A:
+                swizzle_block_PSMCT16(&local_mem[addr_PSMCT16S(base, width, x, y) & ~0xFF], src, hwreg_row_bytes);
+                break;
+            case 0x13:
+                swizzle_block_PSMCT8(&local_mem[addr_PSMCT8(base, width, x, y) & ~0xFF], src, hwreg_row_bytes);
+                break;
+            case 0x14:
+                swizzle_block_PSMCT4(&local_mem[(addr_PSMCT4(base, width, x, y) >> 1) & ~0xFF], src, hwreg_row_bytes);
+                break;
+            case 0x1B:
+                swizzle_block_PSMT8H(&local_mem[addr_PSMCT32(base, width, x, y) & ~0xFF], src, hwreg_row_bytes);
+                break;
+        }
+    }
+
+    TRXPOS.int_dest_y += rows;
+    pixels_transferred += rows * TRXREG.width;
+    hwreg_buffer_used = 0;
+
+    int max_pixels = TRXREG.width * TRXREG.height;
+    if (pixels_transferred >= max_pixels)
+    {
+        printf("[GS_t] HWREG transfer ended\n");
+        TRXDIR = 3;
+        pixels_transferred = 0;
+        hwreg_bulk = false;
+        return;
+    }
+
+    rows = std::min((uint32_t)block_h, (uint32_t)(TRXREG.height - (TRXPOS.int_dest_y - TRXPOS.dest_y)));
+    hwreg_buffer_target = rows * hwreg_row_bytes;
 }
 
 void GraphicsSynthesizerThread::write_HWREG(uint64_t data)
 {
-    int ppd = 0; //pixels per doubleword (64-bits)
+    //The texture cache and CRT may have been checked since the transfer started
+    pending_write_pages |= transfer_pages;
+    crt_write_pages |= transfer_pages;
 
     //Invalid transfer if no height/width has been set
     if (TRXREG.width == 0 || TRXREG.height == 0)
@@ -2863,6 +4459,22 @@ void GraphicsSynthesizerThread::write_HWREG(uint64_t data)
         return;
     }
 
+    if (hwreg_bulk)
+    {
+        memcpy(&hwreg_buffer[hwreg_buffer_used], &data, 8);
+        hwreg_buffer_used += 8;
+        if (hwreg_buffer_used == hwreg_buffer_target)
+            write_HWREG_rows();
+        return;
+    }
+
+    write_HWREG_pixels(data);
+}
+
+void GraphicsSynthesizerThread::write_HWREG_pixels(uint64_t data)
+{
+    int ppd = 0; //pixels per doubleword (64-bits)
+
     switch (BITBLTBUF.dest_format)
     {
         //PSMCT32
@@ -3338,6 +4950,20 @@ void GraphicsSynthesizerThread::local_to_local()
             Errors::die("[GS_t] Unrecognized local-to-local transmission order $%02X", TRXPOS.trans_order);
     }
 
+    if (local_to_local_blocks())
+    {
+        //Leave the internal positions where the pixel loop would have
+        TRXPOS.int_source_x = src_start_x;
+        TRXPOS.int_dest_x = dest_start_x;
+        TRXPOS.int_source_y += TRXREG.height * y_step;
+        TRXPOS.int_dest_y += TRXREG.height * y_step;
+        TRXPOS.int_source_y %= 2048;
+        TRXPOS.int_dest_y %= 2048;
+        pixels_transferred = 0;
+        TRXDIR = 3;
+        return;
+    }
+
     while (pixels_transferred < max_pixels)
     {
         uint32_t data;
@@ -3463,6 +5089,113 @@ void GraphicsSynthesizerThread::local_to_local()
     TRXDIR = 3;
 }
 
+/**
+  * Copies a transfer a block at a time when source and destination share a block layout.
+  * Blocks of the same PSM have identical contents regardless of where they are placed, so whole
+  * blocks can be moved with memcpy. Transfer order only matters when the rectangles overlap,
+  * which is left to the pixel loop. Returns false if the transfer has to be done per pixel.
+  */
+bool GraphicsSynthesizerThread::local_to_local_blocks()
+{
+    uint8_t source_format = BITBLTBUF.source_format;
+    uint8_t dest_format = BITBLTBUF.dest_format;
+    bool merge_24 = false;
+    switch (dest_format)
+    {
+        case 0x00:
+        case 0x01:
+            if (source_format != 0x00 && source_format != 0x01)
+                return false;
+            merge_24 = dest_format == 0x01;
+            break;
+        case 0x30:
+        case 0x31:
+            if (source_format != 0x30 && source_format != 0x31)
+                return false;
+            merge_24 = dest_format == 0x31;
+            break;
+        case 0x02:
+        case 0x0A:
+        case 0x13:
+        case 0x14:
+            if (source_format != dest_format)
+                return false;
+            break;
+        default:
+            return false;
+    }
+
+    uint32_t block_w, block_h;
+    switch (dest_format)
+    {
+        case 0x02:
+        case 0x0A:
+            block_w = 16; block_h = 8;
+            break;
+        case 0x13:
+            block_w = 16; block_h = 16;
+            break;
+        case 0x14:
+            block_w = 32; block_h = 16;
+            break;
+        default:
+            block_w = 8; block_h = 8;
+            break;
+    }
+
+    uint32_t width = TRXREG.width;
+    uint32_t height = TRXREG.height;
+    if (pixels_transferred || (width | TRXPOS.source_x | TRXPOS.dest_x) & (block_w - 1) ||
+            (height | TRXPOS.source_y | TRXPOS.dest_y) & (block_h - 1))
+        return false;
+
+    if (TRXPOS.source_x + width > 2048 || TRXPOS.dest_x + width > 2048 ||
+            TRXPOS.source_y + height > 2048 || TRXPOS.dest_y + height > 2048)
+        return false;
+
+    //Any block written before it is read, or written twice because the rectangle is wider than the
+    //buffer, would make the result depend on the transfer order
+    std::bitset<16384> source_blocks, dest_blocks;
+    for (uint32_t y = 0; y < height; y += block_h)
+    {
+        for (uint32_t x = 0; x < width; x += block_w)
+        {
+            source_blocks.set(block_address(source_format, BITBLTBUF.source_base, BITBLTBUF.source_width,
+                                            TRXPOS.source_x + x, TRXPOS.source_y + y) >> 8);
+        }
+    }
+    for (uint32_t y = 0; y < height; y += block_h)
+    {
+        for (uint32_t x = 0; x < width; x += block_w)
+        {
+            uint32_t block = block_address(dest_format, BITBLTBUF.dest_base, BITBLTBUF.dest_width,
+                                           TRXPOS.dest_x + x, TRXPOS.dest_y + y) >> 8;
+            if (source_blocks.test(block) || dest_blocks.test(block))
+                return false;
+            dest_blocks.set(block);
+        }
+    }
+
+    for (uint32_t y = 0; y < height; y += block_h)
+    {
+        for (uint32_t x = 0; x < width; x += block_w)
+        {
+            const uint32_t* source = (const uint32_t*)&local_mem[block_address(source_format, BITBLTBUF.source_base,
+                    BITBLTBUF.source_width, TRXPOS.source_x + x, TRXPOS.source_y + y)];
+            uint32_t* dest = (uint32_t*)&local_mem[block_address(dest_format, BITBLTBUF.dest_base,
+                    BITBLTBUF.dest_width, TRXPOS.dest_x + x, TRXPOS.dest_y + y)];
+            if (merge_24)
+            {
+                for (int i = 0; i < 64; i++)
+                    dest[i] = (dest[i] & 0xFF000000) | (source[i] & 0xFFFFFF);
+            }
+            else
+                memcpy(dest, source, 256);
+        }
+    }
+    return true;
+}
+
 uint8_t GraphicsSynthesizerThread::get_16bit_alpha(uint16_t color)
 {
     if (color & (1 << 15))
@@ -3752,145 +5485,97 @@ void GraphicsSynthesizerThread::tex_lookup_int(int16_t u, int16_t v, TexLookupIn
     info.lastv = v;
     info.new_lookup = forced_lookup; //If we're forcing a lookup, it's bilinear filtering, so the src will get polluted
 
-    uint32_t tex_base = info.tex_base;
-    uint32_t width = info.buffer_width;
+    uint32_t color;
+    if (tex_cache_texels && !info.mipmap_level && (uint16_t)u < info.tex_width && (uint16_t)v < info.tex_height)
+        color = tex_cache_texels[((uint16_t)v << tex_cache_width_shift) + (uint16_t)u];
+    else
+        color = read_texel(info.tex_base, info.buffer_width, u, v);
+
+    info.srctex_color.r = color & 0xFF;
+    info.srctex_color.g = (color >> 8) & 0xFF;
+    info.srctex_color.b = (color >> 16) & 0xFF;
+    info.srctex_color.a = color >> 24;
+}
+
+//Reads a texel of the current texture and expands it to RGBA8888
+uint32_t GraphicsSynthesizerThread::read_texel(uint32_t tex_base, uint32_t width, uint32_t u, uint32_t v)
+{
+    uint8_t entry;
     switch (current_ctx->tex0.format)
     {
         case 0x00:
-        {
-            uint32_t color = read_PSMCT32_block(tex_base, width, u, v);
-            info.srctex_color.r = color & 0xFF;
-            info.srctex_color.g = (color >> 8) & 0xFF;
-            info.srctex_color.b = (color >> 16) & 0xFF;
-            info.srctex_color.a = color >> 24;
-        }
-            break;
+            return read_PSMCT32_block(tex_base, width, u, v);
         case 0x01:
         {
-            uint32_t color = read_PSMCT32_block(tex_base, width, u, v);
-            info.srctex_color.r = color & 0xFF;
-            info.srctex_color.g = (color >> 8) & 0xFF;
-            info.srctex_color.b = (color >> 16) & 0xFF;
-
-            if (!(color & 0xFFFFFF) && TEXA.trans_black)
-                info.srctex_color.a = 0;
-            else
-                info.srctex_color.a = TEXA.alpha0;
+            uint32_t color = read_PSMCT32_block(tex_base, width, u, v) & 0xFFFFFF;
+            if (!color && TEXA.trans_black)
+                return 0;
+            return color | ((uint32_t)TEXA.alpha0 << 24);
         }
-            break;
         case 0x02:
         {
             uint16_t color = read_PSMCT16_block(tex_base, width, u, v);
-            info.srctex_color.r = (color & 0x1F) << 3;
-            info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-            info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-            info.srctex_color.a = get_16bit_alpha(color);
+            return convert_16bit_tex(color);
         }
-            break;
         case 0x09: //Invalid format??? FFX uses it
-            info.srctex_color.r = 0;
-            info.srctex_color.g = 0;
-            info.srctex_color.b = 0;
-            info.srctex_color.a = 0;
-            break;
+            return 0;
         case 0x0A:
         {
             uint16_t color = read_PSMCT16S_block(tex_base, width, u, v);
-            info.srctex_color.r = (color & 0x1F) << 3;
-            info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-            info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-            info.srctex_color.a = get_16bit_alpha(color);
+            return convert_16bit_tex(color);
         }
-            break;
         case 0x13:
-        {
-            uint8_t entry = read_PSMCT8_block(tex_base, width, u, v);
-            if (current_ctx->tex0.use_CSM2)
-                clut_CSM2_lookup(entry, info.srctex_color);
-            else
-                clut_lookup(entry, info.srctex_color);
-        }
-            break;
-        case 0x14:
-        {
-            uint8_t entry = read_PSMCT4_block(tex_base, width, u, v);
-            if (current_ctx->tex0.use_CSM2)
-                clut_CSM2_lookup(entry, info.srctex_color);
-            else
-                clut_lookup(entry, info.srctex_color);
-        }
+            entry = read_PSMCT8_block(tex_base, width, u, v);
             break;
-        case 0x1B:
-        {
-            uint8_t entry = read_PSMCT32_block(tex_base, width, u, v) >> 24;
-            if (current_ctx->tex0.use_CSM2)
-                clut_CSM2_lookup(entry, info.srctex_color);
-            else
-                clut_lookup(entry, info.srctex_color);
-        }
+        case 0x14:
+            entry = read_PSMCT4_block(tex_base, width, u, v);
             break;
-        case 0x24:
-        {
-            //printf("[GS_t] Format $24: Read from $%08X\n", tex_base + (coord << 2));
-            uint8_t entry = (read_PSMCT32_block(tex_base, width, u, v) >> 24) & 0xF;
-            if (current_ctx->tex0.use_CSM2)
-                clut_CSM2_lookup(entry, info.srctex_color);
-            else
-                clut_lookup(entry, info.srctex_color);
+        case 0x1B:
+            entry = read_PSMCT32_block(tex_base, width, u, v) >> 24;
             break;
-        }
+        case 0x24:
+            entry = (read_PSMCT32_block(tex_base, width, u, v) >> 24) & 0xF;
             break;
         case 0x2C:
-        {
-            uint8_t entry = read_PSMCT32_block(tex_base, width, u, v) >> 28;
-            if (current_ctx->tex0.use_CSM2)
-                clut_CSM2_lookup(entry, info.srctex_color);
-            else
-                clut_lookup(entry, info.srctex_color);
-        }
+            entry = read_PSMCT32_block(tex_base, width, u, v) >> 28;
             break;
         case 0x30:
-        {
-            uint32_t color = read_PSMCT32Z_block(tex_base, width, u, v);
-            info.srctex_color.r = color & 0xFF;
-            info.srctex_color.g = (color >> 8) & 0xFF;
-            info.srctex_color.b = (color >> 16) & 0xFF;
-            info.srctex_color.a = color >> 24;
-        }
-            break;
+            return read_PSMCT32Z_block(tex_base, width, u, v);
         case 0x31:
         {
-            uint32_t color = read_PSMCT32Z_block(tex_base, width, u, v);
-            info.srctex_color.r = color & 0xFF;
-            info.srctex_color.g = (color >> 8) & 0xFF;
-            info.srctex_color.b = (color >> 16) & 0xFF;
-            if (!(color & 0xFFFFFF) && TEXA.trans_black)
-                info.srctex_color.a = 0;
-            else
-                info.srctex_color.a = TEXA.alpha0;
+            uint32_t color = read_PSMCT32Z_block(tex_base, width, u, v) & 0xFFFFFF;
+            if (!color && TEXA.trans_black)
+                return 0;
+            return color | ((uint32_t)TEXA.alpha0 << 24);
         }
-            break;
         case 0x32:
         {
             uint16_t color = read_PSMCT16Z_block(tex_base, width, u, v);
-            info.srctex_color.r = (color & 0x1F) << 3;
-            info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-            info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-            info.srctex_color.a = get_16bit_alpha(color);
+            return convert_16bit_tex(color);
         }
-            break;
         case 0x3A:
         {
             uint16_t color = read_PSMCT16SZ_block(tex_base, width, u, v);
-            info.srctex_color.r = (color & 0x1F) << 3;
-            info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-            info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-            info.srctex_color.a = get_16bit_alpha(color);
+            return convert_16bit_tex(color);
         }
-            break;
         default:
             Errors::die("[GS_t] Unrecognized texture format $%02X\n", current_ctx->tex0.format);
     }
+
+    RGBAQ_REG color;
+    if (current_ctx->tex0.use_CSM2)
+        clut_CSM2_lookup(entry, color);
+    else
+        clut_lookup(entry, color);
+    return color.r | (color.g << 8) | (color.b << 16) | ((uint32_t)color.a << 24);
+}
+
+uint32_t GraphicsSynthesizerThread::convert_16bit_tex(uint16_t color)
+{
+    uint32_t r = (color & 0x1F) << 3;
+    uint32_t g = ((color >> 5) & 0x1F) << 3;
+    uint32_t b = ((color >> 10) & 0x1F) << 3;
+    return r | (g << 8) | (b << 16) | ((uint32_t)get_16bit_alpha(color) << 24);
 }
 
 void GraphicsSynthesizerThread::recompile_tex_lookup_prologue()
@@ -4094,6 +5779,9 @@ void GraphicsSynthesizerThread::reload_clut(GSContext& context)
 
             cache_addr &= 0x3FF;
         }
+
+        //Decoded paletted textures are keyed on this, so reloading an identical CLUT keeps them
+        clut_crc = CRC32C::update(~0U, clut_cache, sizeof(clut_cache));
     }
 }
 
@@ -4804,6 +6492,672 @@ void GraphicsSynthesizerThread::recompile_alpha_blend()
         emitter_dp.set_jump_dest(pabe_fail_end);
 }
 
+//Swizzle table of a frame/Z format, for the span JIT's inline address calculation
+static uint32_t* span_page_table(uint32_t format)
+{
+    switch (format)
+    {
+        case 0x00:
+        case 0x01:
+            return page_PSMCT32.data;
+        case 0x02:
+            return page_PSMCT16.data;
+        case 0x0A:
+            return page_PSMCT16S.data;
+        case 0x30:
+        case 0x31:
+            return page_PSMCT32Z.data;
+        case 0x32:
+            return page_PSMCT16Z.data;
+        case 0x3A:
+            return page_PSMCT16SZ.data;
+        default:
+            Errors::die("[GS_t] Unrecognized format $%02X in recompile_draw_span", format);
+    }
+    return nullptr;
+}
+
+uint8_t* GraphicsSynthesizerThread::get_jitted_draw_span(uint64_t state)
+{
+    //Span blocks share the pixel JIT heap, keyed apart from the pixel blocks by the top bit
+    state |= 1ULL << 63;
+    GSPixelJitBlockRecord* found_block = jit_draw_pixel_heap.find_block(state);
+    if (!found_block)
+    {
+        printf("[GS_t] RECOMPILING DRAW SPAN %llX\n", state);
+        found_block = recompile_draw_span(state);
+    }
+    return (uint8_t*)found_block->code_start;
+}
+
+/**
+  * Lane-parallel version of recompile_draw_pixel for GSSpans.
+  * Four pixels go through each stage together, and the early returns of the pixel JIT become lane masks.
+  * Only the swizzled addresses and the memory accesses themselves are handled one lane at a time.
+  * The results match the pixel JIT exactly, down to its 16-bit wraparound in alpha blending.
+  * A group reads all of its Z and frame pixels before writing any, so the two buffers must not overlap.
+  **/
+GSPixelJitBlockRecord* GraphicsSynthesizerThread::recompile_draw_span(uint64_t state)
+{
+    jit_draw_pixel_block.clear();
+
+    TEST& test = current_ctx->test;
+    uint32_t frame_format = current_ctx->frame.format;
+    uint32_t z_format = current_ctx->zbuf.format;
+
+    emitter_dp.PUSH(RBX);
+    emitter_dp.PUSH(RBP);
+    emitter_dp.PUSH(RSI);
+    emitter_dp.PUSH(RDI);
+    emitter_dp.PUSH(R12);
+    emitter_dp.PUSH(R13);
+    emitter_dp.PUSH(R14);
+    emitter_dp.PUSH(R15);
+
+    //Eight pushes and the return address leave the stack 8 bytes off alignment
+    //[RBP + 0xA0] = framebuffer pointers of the four lanes, [RBP + 0xC0] = zbuffer pointers
+    emitter_dp.SUB64_REG_IMM(0x108, RSP);
+    emitter_dp.MOV64_MR(RSP, RBP);
+#ifdef _WIN32
+    for (int i = 0; i < 10; i++)
+        emitter_dp.MOVAPS_TO_MEM((REG_64)(XMM6 + i), RBP, i * 0x10);
+#endif
+
+    //RBX = y  RSI = current pixel  RDI = end of span  R8 = local memory
+    emitter_dp.MOV32_REG(abi_args[0], RBX);
+    emitter_dp.MOV64_MR(abi_args[1], RSI);
+    emitter_dp.MOV64_MR(abi_args[2], RDI);
+    emitter_dp.SAR32_REG_IMM(4, RBX);
+    emitter_dp.load_addr((uint64_t)local_mem, R8);
+
+    //SCANMSK test - every pixel of a span shares its y coordinate
+    uint8_t* scanmsk_fail = nullptr;
+    if (SCANMSK >= 2)
+    {
+        emitter_dp.TEST8_REG_IMM(0x1, RBX);
+        if (SCANMSK == 2) //Fail if even
+            scanmsk_fail = emitter_dp.JCC_NEAR_DEFERRED(ConditionCode::E);
+        else //Fail if odd
+            scanmsk_fail = emitter_dp.JCC_NEAR_DEFERRED(ConditionCode::NE);
+    }
+
+    //A depth test of NEVER draws nothing at all
+    if (!test.depth_test || test.depth_method != 0)
+    {
+        //R12/R13 = page and swizzle table row of the framebuffer, R14/R15 = the same for the zbuffer
+        recompile_span_row(frame_format, &current_ctx->frame.base_pointer, R12, R13);
+        if (test.depth_test)
+            recompile_span_row(z_format, &current_ctx->zbuf.base_pointer, R14, R15);
+
+        uint8_t* loop_start = jit_draw_pixel_block.get_code_pos();
+
+        //XMM0 = lanes still being drawn, starting with the lanes that hold a pixel of the span
+        alignas(16) const static uint32_t lane_offsets[] =
+        {
+            0, sizeof(GSSpanPixel), 2 * sizeof(GSSpanPixel), 3 * sizeof(GSSpanPixel)
+        };
+        emitter_dp.MOV64_MR(RDI, RAX);
+        emitter_dp.SUB64_REG(RSI, RAX);
+        emitter_dp.MOVD_TO_XMM(RAX, XMM0);
+        emitter_dp.PSHUFD(0, XMM0, XMM0);
+        emitter_dp.load_addr((uint64_t)&lane_offsets, RAX);
+        emitter_dp.MOVAPS_FROM_MEM(RAX, XMM10);
+        emitter_dp.PCMPGTD_XMM(XMM10, XMM0);
+
+        //XMM1 = z, XMM10-XMM13 = RGBA of each lane, sign extended to 32 bits
+        for (int lane = 0; lane < 4; lane++)
+        {
+            REG_64 row = (REG_64)(XMM10 + lane);
+            emitter_dp.MOV32_FROM_MEM(RSI, RAX, lane * sizeof(GSSpanPixel) + offsetof(GSSpanPixel, z));
+            emitter_dp.PINSRD_XMM(lane, RAX, XMM1);
+            emitter_dp.MOV64_FROM_MEM(RSI, RAX, lane * sizeof(GSSpanPixel) + offsetof(GSSpanPixel, color));
+            emitter_dp.MOVQ_TO_XMM(RAX, row);
+            emitter_dp.PMOVSX16_TO_32(row, row);
+        }
+
+        //Transpose into XMM2-XMM5 = R, G, B, A of all four lanes
+        emitter_dp.MOVAPS_REG(XMM10, XMM14);
+        emitter_dp.SHUFPS(0x44, XMM11, XMM14);
+        emitter_dp.MOVAPS_REG(XMM10, XMM15);
+        emitter_dp.SHUFPS(0xEE, XMM11, XMM15);
+        emitter_dp.MOVAPS_REG(XMM12, XMM10);
+        emitter_dp.SHUFPS(0x44, XMM13, XMM10);
+        emitter_dp.SHUFPS(0xEE, XMM13, XMM12);
+        emitter_dp.MOVAPS_REG(XMM14, XMM2);
+        emitter_dp.SHUFPS(0x88, XMM10, XMM2);
+        emitter_dp.MOVAPS_REG(XMM14, XMM3);
+        emitter_dp.SHUFPS(0xDD, XMM10, XMM3);
+        emitter_dp.MOVAPS_REG(XMM15, XMM4);
+        emitter_dp.SHUFPS(0x88, XMM12, XMM4);
+        emitter_dp.MOVAPS_REG(XMM15, XMM5);
+        emitter_dp.SHUFPS(0xDD, XMM12, XMM5);
+
+        //XMM6/XMM7/XMM8 = lanes that must not update z, the frame, or the frame's alpha.
+        //These are the bits of RBX in the pixel JIT.
+        emitter_dp.PXOR_XMM(XMM6, XMM6);
+        emitter_dp.PXOR_XMM(XMM7, XMM7);
+        if (frame_format & 0x1)
+            emitter_dp.PCMPEQD_XMM(XMM8, XMM8);
+        else
+            emitter_dp.PXOR_XMM(XMM8, XMM8);
+
+        //Alpha test - XMM11 = lanes that fail
+        bool alpha_tested = test.alpha_test && test.alpha_method != 1;
+        if (alpha_tested)
+        {
+            if (test.alpha_method == 0)
+                emitter_dp.PCMPEQD_XMM(XMM11, XMM11);
+            else
+            {
+                jit_broadcast_imm(test.alpha_ref, XMM10);
+                //LESS, GREATER and EQUAL compute the lanes that pass and invert them
+                switch (test.alpha_method)
+                {
+                    case 2: //LESS
+                    case 5: //GEQUAL - fails if REF > alpha
+                        emitter_dp.MOVAPS_REG(XMM10, XMM11);
+                        emitter_dp.PCMPGTD_XMM(XMM5, XMM11);
+                        break;
+                    case 3: //LEQUAL - fails if alpha > REF
+                    case 6: //GREATER
+                        emitter_dp.MOVAPS_REG(XMM5, XMM11);
+                        emitter_dp.PCMPGTD_XMM(XMM10, XMM11);
+                        break;
+                    case 4: //EQUAL
+                    case 7: //NOTEQUAL - fails if alpha == REF
+                        emitter_dp.MOVAPS_REG(XMM5, XMM11);
+                        emitter_dp.PCMPEQD_XMM(XMM10, XMM11);
+                        break;
+                }
+                bool invert = test.alpha_method == 2 || test.alpha_method == 4 || test.alpha_method == 6;
+                if (invert)
+                {
+                    emitter_dp.PCMPEQD_XMM(XMM12, XMM12);
+                    emitter_dp.PXOR_XMM(XMM12, XMM11);
+                }
+            }
+
+            switch (test.alpha_fail_method)
+            {
+                case 0: //KEEP - Update nothing
+                    emitter_dp.PANDN_XMM(XMM0, XMM11);
+                    emitter_dp.MOVAPS_REG(XMM11, XMM0);
+                    break;
+                case 1: //FB_ONLY - Only update framebuffer
+                    emitter_dp.POR_XMM(XMM11, XMM6);
+                    break;
+                case 2: //ZB_ONLY - Only update z-buffer
+                    emitter_dp.POR_XMM(XMM11, XMM7);
+                    emitter_dp.POR_XMM(XMM11, XMM8);
+                    break;
+                case 3: //RGB_ONLY - Same as FB_ONLY, but ignore alpha
+                    emitter_dp.POR_XMM(XMM11, XMM6);
+                    emitter_dp.POR_XMM(XMM11, XMM8);
+                    break;
+            }
+        }
+
+        //Depth test - XMM10 = zbuffer contents
+        if (test.depth_test)
+        {
+            recompile_span_gather(z_format, R14, R15, 0xC0, XMM10);
+
+            if (z_format & 0x2)
+            {
+                jit_broadcast_imm(0xFFFF, XMM11);
+                emitter_dp.PMINSD_XMM(XMM11, XMM1);
+            }
+            else if (z_format & 0x1)
+            {
+                jit_broadcast_imm(0xFFFFFF, XMM11);
+                emitter_dp.PMINSD_XMM(XMM11, XMM1);
+            }
+
+            if (test.depth_method != 1)
+            {
+                //Unsigned compare, by flipping the sign bit of both sides
+                emitter_dp.MOVAPS_REG(XMM10, XMM11);
+                if ((z_format & 0x3) == 0x1)
+                {
+                    jit_broadcast_imm(0xFFFFFF, XMM12);
+                    emitter_dp.PAND_XMM(XMM12, XMM11);
+                }
+                jit_broadcast_imm(0x80000000, XMM12);
+                emitter_dp.PXOR_XMM(XMM12, XMM11);
+                emitter_dp.MOVAPS_REG(XMM1, XMM13);
+                emitter_dp.PXOR_XMM(XMM12, XMM13);
+
+                if (test.depth_method == 2)
+                {
+                    //GEQUAL - fails if zbuffer > z
+                    emitter_dp.PCMPGTD_XMM(XMM13, XMM11);
+                    emitter_dp.PANDN_XMM(XMM0, XMM11);
+                    emitter_dp.MOVAPS_REG(XMM11, XMM0);
+                }
+                else
+                {
+                    //GREATER
+                    emitter_dp.PCMPGTD_XMM(XMM11, XMM13);
+                    emitter_dp.PAND_XMM(XMM13, XMM0);
+                }
+            }
+
+            //Update zbuffer. As in the pixel JIT, this happens before the destination alpha test.
+            if (!current_ctx->zbuf.no_update)
+            {
+                REG_64 new_z = XMM1;
+                if ((z_format & 0x3) == 0x1)
+                {
+                    //24-bit formats keep the top byte of the zbuffer
+                    jit_broadcast_imm(0xFFFFFF, XMM12);
+                    emitter_dp.MOVAPS_REG(XMM1, XMM11);
+                    emitter_dp.PAND_XMM(XMM12, XMM11);
+                    emitter_dp.PANDN_XMM(XMM10, XMM12);
+                    emitter_dp.POR_XMM(XMM12, XMM11);
+                    new_z = XMM11;
+                }
+
+                emitter_dp.MOVAPS_REG(XMM6, XMM12);
+                emitter_dp.PANDN_XMM(XMM0, XMM12);
+                emitter_dp.MOVMSKPS(XMM12, RDX);
+                recompile_span_scatter(z_format, 0xC0, new_z, RDX);
+            }
+        }
+
+        //XMM15 = lanes that write the framebuffer. Move on if there are none.
+        emitter_dp.MOVAPS_REG(XMM7, XMM15);
+        emitter_dp.PANDN_XMM(XMM0, XMM15);
+        emitter_dp.MOVMSKPS(XMM15, RAX);
+        emitter_dp.TEST32_REG(RAX, RAX);
+        uint8_t* nothing_to_draw = emitter_dp.JCC_NEAR_DEFERRED(ConditionCode::E);
+
+        //XMM9 = framebuffer colour, with 16-bit formats expanded like in the pixel JIT
+        recompile_span_gather(frame_format, R12, R13, 0xA0, XMM9);
+        if (frame_format & 0x2)
+        {
+            emitter_dp.MOVAPS_REG(XMM9, XMM10);
+            jit_broadcast_imm(0x1F, XMM12);
+            emitter_dp.PAND_XMM(XMM12, XMM10);
+            emitter_dp.PSLLD(3, XMM10);
+
+            emitter_dp.MOVAPS_REG(XMM9, XMM11);
+            jit_broadcast_imm(0x1F << 5, XMM12);
+            emitter_dp.PAND_XMM(XMM12, XMM11);
+            emitter_dp.PSLLD(6, XMM11);
+            emitter_dp.POR_XMM(XMM11, XMM10);
+
+            emitter_dp.MOVAPS_REG(XMM9, XMM11);
+            jit_broadcast_imm(0x1F << 10, XMM12);
+            emitter_dp.PAND_XMM(XMM12, XMM11);
+            emitter_dp.PSLLD(9, XMM11);
+            emitter_dp.POR_XMM(XMM11, XMM10);
+
+            jit_broadcast_imm(1 << 15, XMM12);
+            emitter_dp.PAND_XMM(XMM12, XMM9);
+            emitter_dp.PSLLD(16, XMM9);
+            emitter_dp.POR_XMM(XMM10, XMM9);
+        }
+
+        //Dest alpha test
+        if (test.dest_alpha_test && !(frame_format & 0x1))
+        {
+            emitter_dp.MOVAPS_REG(XMM9, XMM10);
+            emitter_dp.PSRAD(31, XMM10);
+            if (test.dest_alpha_method)
+                emitter_dp.PAND_XMM(XMM10, XMM15);
+            else
+            {
+                emitter_dp.PANDN_XMM(XMM15, XMM10);
+                emitter_dp.MOVAPS_REG(XMM10, XMM15);
+            }
+        }
+
+        //XMM13 = 0xFF, XMM14 = 0. XMM1, XMM6 and XMM7 are free from here on.
+        jit_broadcast_imm(0xFF, XMM13);
+        emitter_dp.PXOR_XMM(XMM14, XMM14);
+
+        //XMM10 = unblended colour. Like PACKUSWB in the pixel JIT, all four channels saturate to 0-0xFF.
+        bool alpha_blend = current_PRMODE->alpha_blend;
+        if (!alpha_blend || PABE)
+        {
+            for (int channel = 0; channel < 4; channel++)
+            {
+                REG_64 dest = channel ? XMM1 : XMM10;
+                emitter_dp.MOVAPS_REG((REG_64)(XMM2 + channel), dest);
+                emitter_dp.PMAXSD_XMM(XMM14, dest);
+                emitter_dp.PMINSD_XMM(XMM13, dest);
+                if (channel)
+                {
+                    emitter_dp.PSLLD(channel * 8, dest);
+                    emitter_dp.POR_XMM(dest, XMM10);
+                }
+            }
+        }
+
+        //XMM11 = colour to write
+        if (alpha_blend)
+        {
+            ALPHA& alpha = current_ctx->alpha;
+
+            //XMM12 = C
+            switch (alpha.spec_C)
+            {
+                case 0:
+                    //Source alpha
+                    emitter_dp.MOVAPS_REG(XMM5, XMM12);
+                    jit_broadcast_imm(0xFFFF, XMM7);
+                    emitter_dp.PAND_XMM(XMM7, XMM12);
+                    break;
+                case 1:
+                    //Frame alpha. RGB24 always uses 0x80.
+                    if (!(frame_format & 0x1))
+                    {
+                        emitter_dp.MOVAPS_REG(XMM9, XMM12);
+                        emitter_dp.PSRLD(24, XMM12);
+                    }
+                    else
+                        jit_broadcast_imm(0x80, XMM12);
+                    break;
+                case 2:
+                case 3:
+                    //Fixed alpha
+                    jit_broadcast_imm(alpha.fixed_alpha, XMM12);
+                    break;
+            }
+
+            //color component = (((A - B) * C) >> 7) + D, using the 16-bit arithmetic of the pixel JIT
+            for (int channel = 0; channel < 3; channel++)
+            {
+                recompile_span_blend_input(alpha.spec_A, (REG_64)(XMM2 + channel), channel, XMM1);
+                if (alpha.spec_B < 2)
+                {
+                    //Zero extended from 16 bits, and saturated back to 16 bits by PACKSSDW
+                    recompile_span_blend_input(alpha.spec_B, (REG_64)(XMM2 + channel), channel, XMM6);
+                    jit_broadcast_imm(0xFFFF, XMM7);
+                    emitter_dp.PAND_XMM(XMM7, XMM1);
+                    emitter_dp.PAND_XMM(XMM7, XMM6);
+                    emitter_dp.PSUBD(XMM6, XMM1);
+                    emitter_dp.PMULLD(XMM12, XMM1);
+                    emitter_dp.PSRAD(7, XMM1);
+                    jit_broadcast_imm(0x7FFF, XMM7);
+                    emitter_dp.PMINSD_XMM(XMM7, XMM1);
+                    jit_broadcast_imm(0xFFFF8000, XMM7);
+                    emitter_dp.PMAXSD_XMM(XMM7, XMM1);
+                }
+                else
+                {
+                    //PMULLW + PSRLW
+                    emitter_dp.PMULLD(XMM12, XMM1);
+                    jit_broadcast_imm(0xFFFF, XMM7);
+                    emitter_dp.PAND_XMM(XMM7, XMM1);
+                    emitter_dp.PSRLD(7, XMM1);
+                }
+
+                if (alpha.spec_D < 2)
+                {
+                    //PADDW wraps around at 16 bits
+                    recompile_span_blend_input(alpha.spec_D, (REG_64)(XMM2 + channel), channel, XMM6);
+                    emitter_dp.PADDD(XMM6, XMM1);
+                    emitter_dp.PSLLD(16, XMM1);
+                    emitter_dp.PSRAD(16, XMM1);
+                }
+
+                if (!COLCLAMP)
+                    emitter_dp.PAND_XMM(XMM13, XMM1);
+                emitter_dp.PMAXSD_XMM(XMM14, XMM1);
+                emitter_dp.PMINSD_XMM(XMM13, XMM1);
+
+                if (channel)
+                {
+                    emitter_dp.PSLLD(channel * 8, XMM1);
+                    emitter_dp.POR_XMM(XMM1, XMM11);
+                }
+                else
+                    emitter_dp.MOVAPS_REG(XMM1, XMM11);
+            }
+
+            //Alpha is the low byte of the source alpha
+            emitter_dp.MOVAPS_REG(XMM5, XMM1);
+            emitter_dp.PSLLD(24, XMM1);
+            emitter_dp.POR_XMM(XMM1, XMM11);
+
+            //PABE - lanes whose source alpha has the MSB clear take the unblended colour
+            if (PABE)
+            {
+                emitter_dp.MOVAPS_REG(XMM5, XMM1);
+                emitter_dp.PSLLD(24, XMM1);
+                emitter_dp.PSRAD(31, XMM1);
+                emitter_dp.PAND_XMM(XMM1, XMM11);
+                emitter_dp.PANDN_XMM(XMM10, XMM1);
+                emitter_dp.POR_XMM(XMM1, XMM11);
+            }
+        }
+        else
+            emitter_dp.MOVAPS_REG(XMM10, XMM11);
+
+        if (current_ctx->FBA && !(frame_format & 0x1))
+        {
+            jit_broadcast_imm(0x80000000, XMM1);
+            emitter_dp.POR_XMM(XMM1, XMM11);
+        }
+
+        //color = (color & ~mask) | (frame_color & mask)
+        if (current_ctx->frame.mask)
+        {
+            emitter_dp.load_addr((uint64_t)&current_ctx->frame.mask, RAX);
+            emitter_dp.MOV32_FROM_MEM(RAX, RAX);
+            emitter_dp.MOVD_TO_XMM(RAX, XMM1);
+            emitter_dp.PSHUFD(0, XMM1, XMM1);
+            emitter_dp.MOVAPS_REG(XMM9, XMM6);
+            emitter_dp.PAND_XMM(XMM1, XMM6);
+            emitter_dp.PANDN_XMM(XMM11, XMM1);
+            emitter_dp.POR_XMM(XMM6, XMM1);
+            emitter_dp.MOVAPS_REG(XMM1, XMM11);
+        }
+
+        //Lanes in XMM8 keep the framebuffer's alpha: color = (color & 0xFFFFFF) | (frame_color & 0xFF000000)
+        bool keeps_alpha = (frame_format & 0x1) || (alpha_tested && test.alpha_fail_method >= 2);
+        if (keeps_alpha)
+        {
+            emitter_dp.MOVAPS_REG(XMM11, XMM6);
+            jit_broadcast_imm(0xFFFFFF, XMM1);
+            emitter_dp.PAND_XMM(XMM1, XMM6);
+            emitter_dp.PANDN_XMM(XMM9, XMM1);
+            emitter_dp.POR_XMM(XMM1, XMM6);
+            if (frame_format & 0x1)
+                emitter_dp.MOVAPS_REG(XMM6, XMM11);
+            else
+            {
+                emitter_dp.PAND_XMM(XMM8, XMM6);
+                emitter_dp.PANDN_XMM(XMM11, XMM8);
+                emitter_dp.POR_XMM(XMM8, XMM6);
+                emitter_dp.MOVAPS_REG(XMM6, XMM11);
+            }
+        }
+
+        if (frame_format & 0x2)
+        {
+            //Pack to 16-bit: A at bit 15, then B, G, R in 5 bits each
+            const static uint32_t shifts[] = {16, 9, 6, 3};
+            const static uint32_t masks[] = {0x8000, 0x1F << 10, 0x1F << 5, 0x1F};
+            for (int i = 0; i < 4; i++)
+            {
+                REG_64 dest = i ? XMM6 : XMM10;
+                emitter_dp.MOVAPS_REG(XMM11, dest);
+                emitter_dp.PSRLD(shifts[i], dest);
+                jit_broadcast_imm(masks[i], XMM1);
+                emitter_dp.PAND_XMM(XMM1, dest);
+                if (i)
+                    emitter_dp.POR_XMM(dest, XMM10);
+            }
+            emitter_dp.MOVAPS_REG(XMM10, XMM11);
+        }
+
+        emitter_dp.MOVMSKPS(XMM15, RDX);
+        recompile_span_scatter(frame_format, 0xA0, XMM11, RDX);
+
+        //Next group of four pixels
+        emitter_dp.set_jump_dest(nothing_to_draw);
+        emitter_dp.ADD64_REG_IMM(4 * sizeof(GSSpanPixel), RSI);
+        emitter_dp.CMP64_REG(RDI, RSI);
+        emitter_dp.set_jump_dest(emitter_dp.JCC_NEAR_DEFERRED(ConditionCode::B), loop_start);
+    }
+
+    if (scanmsk_fail)
+        emitter_dp.set_jump_dest(scanmsk_fail);
+
+#ifdef _WIN32
+    for (int i = 0; i < 10; i++)
+        emitter_dp.MOVAPS_FROM_MEM(RBP, (REG_64)(XMM6 + i), i * 0x10);
+#endif
+    emitter_dp.ADD64_REG_IMM(0x108, RSP);
+    emitter_dp.POP(R15);
+    emitter_dp.POP(R14);
+    emitter_dp.POP(R13);
+    emitter_dp.POP(R12);
+    emitter_dp.POP(RDI);
+    emitter_dp.POP(RSI);
+    emitter_dp.POP(RBP);
+    emitter_dp.POP(RBX);
+    emitter_dp.RET();
+
+    return jit_draw_pixel_heap.insert_block(state, &jit_draw_pixel_block);
+}
+
+//page_row = the page holding column 0 of the span's row, table_row = that row of the page's swizzle table
+void GraphicsSynthesizerThread::recompile_span_row(uint32_t format, uint32_t* base_pointer, REG_64 page_row,
+                                                   REG_64 table_row)
+{
+    bool is_16bit = format & 0x2;
+
+    //RAX = base block, RCX = block within the page
+    emitter_dp.load_addr((uint64_t)base_pointer, RAX);
+    emitter_dp.MOV32_FROM_MEM(RAX, RAX);
+    emitter_dp.SHR32_REG_IMM(8, RAX);
+    emitter_dp.MOV32_REG(RAX, RCX);
+    emitter_dp.AND32_REG_IMM(0x1F, RCX);
+
+    //page_row = (block >> 5) + (y >> 5) * width
+    emitter_dp.SHR32_REG_IMM(5, RAX);
+    emitter_dp.MOV32_REG(RAX, page_row);
+    emitter_dp.load_addr((uint64_t)&current_ctx->frame.width, RDX);
+    emitter_dp.MOV32_FROM_MEM(RDX, RDX);
+    emitter_dp.SHR32_REG_IMM(6, RDX);
+    emitter_dp.MOV32_REG(RBX, RAX);
+    emitter_dp.SHR32_REG_IMM(is_16bit ? 6 : 5, RAX);
+    emitter_dp.MUL32(RDX);
+    emitter_dp.ADD32_REG(RAX, page_row);
+
+    //table_row = &table[block & 0x1F][y within the page][0]
+    emitter_dp.SHL32_REG_IMM(is_16bit ? 12 : 11, RCX);
+    emitter_dp.MOV32_REG(RBX, RAX);
+    emitter_dp.AND32_REG_IMM(is_16bit ? 0x3F : 0x1F, RAX);
+    emitter_dp.SHL32_REG_IMM(6, RAX);
+    emitter_dp.ADD32_REG(RCX, RAX);
+    emitter_dp.SHL32_REG_IMM(2, RAX);
+    emitter_dp.load_addr((uint64_t)span_page_table(format), table_row);
+    emitter_dp.ADD64_REG(RAX, table_row);
+}
+
+//Same calculation as addr_PSMCT32 and friends, for each lane. The host pointers are kept at [RBP + addr_slot].
+void GraphicsSynthesizerThread::recompile_span_gather(uint32_t format, REG_64 page_row, REG_64 table_row,
+                                                      uint32_t addr_slot, REG_64 xmm_dest)
+{
+    bool is_16bit = format & 0x2;
+    for (int lane = 0; lane < 4; lane++)
+    {
+        emitter_dp.MOV32_FROM_MEM(RSI, RAX, lane * sizeof(GSSpanPixel) + offsetof(GSSpanPixel, x));
+        emitter_dp.SAR32_REG_IMM(4, RAX);
+
+        //RCX = page << 11 (or 12)
+        emitter_dp.MOV32_REG(RAX, RCX);
+        emitter_dp.SHR32_REG_IMM(6, RCX);
+        emitter_dp.ADD32_REG(page_row, RCX);
+        emitter_dp.SHL32_REG_IMM(is_16bit ? 12 : 11, RCX);
+
+        //RAX = table_row[x & 0x3F]
+        emitter_dp.AND32_REG_IMM(0x3F, RAX);
+        emitter_dp.SHL32_REG_IMM(2, RAX);
+        emitter_dp.ADD64_REG(table_row, RAX);
+        emitter_dp.MOV32_FROM_MEM(RAX, RAX);
+
+        emitter_dp.ADD32_REG(RAX, RCX);
+        if (is_16bit)
+        {
+            emitter_dp.SHL32_REG_IMM(1, RCX);
+            emitter_dp.AND32_REG_IMM(0x003FFFFE, RCX);
+        }
+        else
+        {
+            emitter_dp.SHL32_REG_IMM(2, RCX);
+            emitter_dp.AND32_REG_IMM(0x003FFFFC, RCX);
+        }
+        emitter_dp.ADD64_REG(R8, RCX);
+        emitter_dp.MOV64_TO_MEM(RCX, RBP, addr_slot + lane * 8);
+
+        if (is_16bit)
+        {
+            emitter_dp.XOR32_REG(RAX, RAX);
+            emitter_dp.MOV16_FROM_MEM(RCX, RAX);
+        }
+        else
+            emitter_dp.MOV32_FROM_MEM(RCX, RAX);
+        emitter_dp.PINSRD_XMM(lane, RAX, xmm_dest);
+    }
+}
+
+//Writes each lane whose bit is set in lane_mask to the address gathered for it
+void GraphicsSynthesizerThread::recompile_span_scatter(uint32_t format, uint32_t addr_slot, REG_64 xmm_source,
+                                                       REG_64 lane_mask)
+{
+    for (int lane = 0; lane < 4; lane++)
+    {
+        emitter_dp.TEST32_REG_IMM(1 << lane, lane_mask);
+        uint8_t* skip_lane = emitter_dp.JCC_NEAR_DEFERRED(ConditionCode::E);
+
+        emitter_dp.MOV64_FROM_MEM(RBP, RCX, addr_slot + lane * 8);
+        emitter_dp.PEXTRD_XMM(lane, xmm_source, RAX);
+        if (format & 0x2)
+            emitter_dp.MOV16_TO_MEM(RAX, RCX);
+        else
+            emitter_dp.MOV32_TO_MEM(RAX, RCX);
+
+        emitter_dp.set_jump_dest(skip_lane);
+    }
+}
+
+//Loads one colour channel of blend input A, B or D. Expects XMM9 = frame colour and XMM13 = 0xFF.
+void GraphicsSynthesizerThread::recompile_span_blend_input(uint8_t spec, REG_64 source_color, int channel,
+                                                           REG_64 xmm_dest)
+{
+    switch (spec)
+    {
+        case 0:
+            //Source color
+            emitter_dp.MOVAPS_REG(source_color, xmm_dest);
+            break;
+        case 1:
+            //Frame color
+            emitter_dp.MOVAPS_REG(XMM9, xmm_dest);
+            if (channel)
+                emitter_dp.PSRLD(channel * 8, xmm_dest);
+            emitter_dp.PAND_XMM(XMM13, xmm_dest);
+            break;
+        case 2:
+        case 3:
+            //Zero
+            emitter_dp.PXOR_XMM(xmm_dest, xmm_dest);
+            break;
+    }
+}
+
+void GraphicsSynthesizerThread::jit_broadcast_imm(uint32_t value, REG_64 xmm_dest)
+{
+    emitter_dp.MOV32_REG_IMM(value, RAX);
+    emitter_dp.MOVD_TO_XMM(RAX, xmm_dest);
+    emitter_dp.PSHUFD(0, xmm_dest, xmm_dest);
+}
+
 void GraphicsSynthesizerThread::jit_call_func(Emitter64& emitter, uint64_t addr)
 {
 #ifdef _MSC_VER
@@ -4989,6 +7343,41 @@ GSTextureJitBlockRecord* GraphicsSynthesizerThread::recompile_tex_lookup(uint64_
             Errors::die("[GS JIT] Unrecognized wrap t mode $%02X", current_ctx->clamp.wrap_t);
     }
 
+    //Textures in the decoded texture cache are a linear RGBA8888 load, if the texel lies inside the base level
+    emitter_tex.load_addr((uint64_t)&tex_cache_texels, RAX);
+    emitter_tex.MOV64_FROM_MEM(RAX, RAX);
+    emitter_tex.TEST64_REG(RAX, RAX);
+    uint8_t* not_cached = emitter_tex.JCC_NEAR_DEFERRED(ConditionCode::E);
+
+    emitter_tex.MOV32_FROM_MEM(R14, RCX, offsetof(TexLookupInfo, mipmap_level));
+    emitter_tex.TEST32_REG(RCX, RCX);
+    uint8_t* not_base_level = emitter_tex.JCC_NEAR_DEFERRED(ConditionCode::NE);
+
+    //RCX = width, R8 = height. Unsigned compares also send negative region clamp coordinates to the slow path
+    emitter_tex.MOV32_FROM_MEM(R14, RCX, offsetof(TexLookupInfo, tex_width));
+    emitter_tex.MOV32_REG(RCX, R8);
+    emitter_tex.AND32_REG_IMM(0xFFFF, RCX);
+    emitter_tex.SHR32_REG_IMM(16, R8);
+    emitter_tex.CMP32_REG(RCX, R12);
+    uint8_t* u_outside = emitter_tex.JCC_NEAR_DEFERRED(ConditionCode::AE);
+    emitter_tex.CMP32_REG(R8, R13);
+    uint8_t* v_outside = emitter_tex.JCC_NEAR_DEFERRED(ConditionCode::AE);
+
+    //RAX = texels[(v << width_shift) + u]
+    emitter_tex.load_addr((uint64_t)&tex_cache_width_shift, RCX);
+    emitter_tex.MOV32_FROM_MEM(RCX, RCX);
+    emitter_tex.MOV32_REG(R13, RDX);
+    emitter_tex.SHL32_CL(RDX);
+    emitter_tex.ADD32_REG(R12, RDX);
+    emitter_tex.LEA64_REG(RDX, RAX, RAX, 0, 2);
+    emitter_tex.MOV32_FROM_MEM(RAX, RAX);
+    uint8_t* cached_end = emitter_tex.JMP_NEAR_DEFERRED();
+
+    emitter_tex.set_jump_dest(not_cached);
+    emitter_tex.set_jump_dest(not_base_level);
+    emitter_tex.set_jump_dest(u_outside);
+    emitter_tex.set_jump_dest(v_outside);
+
     //Load the texture pixel
     //TODO: bilinear filtering
     emitter_tex.MOV32_FROM_MEM(R14, abi_args[0], (sizeof(RGBAQ_REG) * 3) + (4 * 2));
@@ -5131,6 +7520,8 @@ GSTextureJitBlockRecord* GraphicsSynthesizerThread::recompile_tex_lookup(uint64_
             Errors::die("[GS JIT] Unrecognized texture format $%02X", current_ctx->tex0.format);
     }
 
+    emitter_tex.set_jump_dest(cached_end);
+
     //Expand the texture color to 64-bit (16 bits for each color)
     emitter_tex.MOVD_TO_XMM(RAX, XMM0);
     emitter_tex.PMOVZX8_TO_16(XMM0, XMM0);
@@ -5350,6 +7741,12 @@ void GraphicsSynthesizerThread::recompile_convert_16bit_tex(REG_64 color, REG_64
 
 void GraphicsSynthesizerThread::load_state(ifstream *state)
 {
+    invalidate_tex_cache();
+    crt_write_pages.set();
+    render_hazard_dirty = true;
+    hwreg_bulk = false;
+    hwreg_buffer_used = 0;
+
     state->read((char*)local_mem, 1024 * 1024 * 4);
     state->read((char*)&IMR, sizeof(IMR));
     state->read((char*)&context1, sizeof(context1));
@@ -6,9 +6,14 @@
 #include <condition_variable>
 #include <cstdint>
 #include <memory>
+#include <atomic>
+#include <string>
+#include <bitset>
+#include <vector>
 #include "gscontext.hpp"
 #include "gsregisters.hpp"
 #include "circularFIFO.hpp"
+#include "commandFIFO.hpp"
 #include "int128.hpp"
 
 #include "jitcommon/emitter64.hpp"
@@ -35,7 +40,7 @@ enum GSCommand:uint8_t
     write64_t, write64_privileged_t, write32_privileged_t,
     set_rgba_t, set_st_t, set_uv_t, set_xyz_t, set_xyzf_t, set_crt_t,
     render_crt_t, assert_finish_t, assert_vsync_t, set_vblank_t, memdump_t, die_t,
-    save_state_t, load_state_t, gsdump_t, request_local_host_tx,
+    save_state_t, load_state_t, gsdump_t, request_local_host_tx, set_render_threads_t, write64_batch_t,
 };
 
 union GSMessagePayload 
@@ -97,6 +102,14 @@ union GSMessagePayload
     {
         std::ifstream* state;
     } load_state_payload;
+    struct
+    {
+        int count;
+    } render_threads_payload;
+    struct
+    {
+        uint16_t count;
+    } write64_batch_payload;
     struct 
     {
         uint8_t BLANK; 
@@ -147,9 +160,19 @@ struct GSReturnMessage
     GSReturnMessagePayload payload;
 };
 
-typedef CircularFifo<GSMessage, 1024 * 1024 * 16> gs_fifo;
+//Messages are packed into a byte stream, most of them are far smaller than a GSMessage
+typedef CommandFifo<1024 * 1024 * 4> gs_fifo;
 typedef CircularFifo<GSReturnMessage, 1024> gs_return_fifo;
 
+//Largest encoded message, a type byte followed by the whole payload
+#define GS_MAX_MESSAGE_SIZE (1 + sizeof(GSMessagePayload))
+//Pending bytes after which send_message makes its messages visible without waiting for wake_thread
+#define GS_PUBLISH_THRESHOLD (1024 * 4)
+
+//GIF register writes are sent in batches of up to this many, each an address byte and 64-bit value
+#define GS_WRITE64_BATCH_MAX 512
+#define GS_WRITE64_BATCH_ENTRY_SIZE 9
+#define GS_WRITE64_BATCH_HEADER_SIZE 3
 struct PRMODE_REG
 {
     bool gourand_shading;
@@ -336,7 +359,123 @@ struct VertexF
     }
 };
 
+//Primitives are binned into horizontal bands of 1 << GS_RENDER_BAND_SHIFT scanlines.
+//Each render worker owns every count-th band, so a pixel is always drawn by the same worker
+//and sees primitives in submission order.
+#define GS_RENDER_BAND_SHIFT 3
+#define GS_RENDER_MAX_THREADS 16
+
+struct GSRenderBand
+{
+    int index, count;
+
+    bool owns(int32_t y) const
+    {
+        return count == 1 || ((y >> GS_RENDER_BAND_SHIFT) % count) == index;
+    }
+};
+
+//A primitive handed to a render worker.
+//All GS state it depends on is frozen until the workers have been flushed.
+struct GSRenderCommand
+{
+    Vertex vtx[3];
+    uint8_t prim_type;
+};
+
+typedef CircularFifo<GSRenderCommand, 1024 * 4> gs_render_fifo;
+
+struct GSRenderWorker
+{
+    std::thread thread;
+    std::unique_ptr<gs_render_fifo> queue;
+
+    std::mutex mutex;
+    std::condition_variable notifier;
+    std::atomic<bool> sleeping{ false };
+    std::atomic<uint32_t> pending{ 0 };
+    bool quit = false;
+
+    std::string error;
+};
+
+//One pixel of a GSSpan. The layout is read directly by the span prologue.
+struct GSSpanPixel
+{
+    int32_t x;
+    uint32_t z;
+    RGBAQ_REG color;
+};
+
+//Horizontally adjacent pixels of one scanline, drawn with a single call into the span JIT
+struct GSSpan
+{
+    constexpr static int MAX_PIXELS = 8;
+
+    int32_t y;
+    int count;
+    GSSpanPixel pixels[MAX_PIXELS];
+};
+
+//Decoded texture cache. A texture is expanded once to linear RGBA8888, so a fetch is a single load.
+//Entries are keyed on TEX0, TEXA and the CLUT contents, and dropped when a page of local memory they cover is written.
+#define GS_TEX_CACHE_ENTRIES 16
+
+struct GSTextureCacheKey
+{
+    uint64_t tex;
+    uint64_t clut;
+    uint32_t clut_crc;
+
+    bool operator==(const GSTextureCacheKey& other) const
+    {
+        return tex == other.tex && clut == other.clut && clut_crc == other.clut_crc;
+    }
+};
+
+struct GSTextureCacheEntry
+{
+    GSTextureCacheKey key;
+    std::bitset<512> pages;
+    uint64_t last_used;
+
+    //Pixels drawn with this texture since it was last written.
+    //Decoding is deferred until it covers the texture once, so it never costs more than the lookups it replaces.
+    uint64_t drawn_area;
+
+    bool valid = false;
+    bool decoded = false;
+    uint32_t width, height, width_shift;
+    std::vector<uint32_t> texels;
+};
+
+//render_CRT skips frames whose output would be identical to what the target buffer already holds.
+//Everything besides local memory that the output depends on is compared between frames.
+struct GSCRTState
+{
+    PMODE_REG PMODE;
+    SMODE2_REG SMODE2;
+    DISPFB DISPFB1, DISPFB2;
+    DISPLAY DISPLAY1, DISPLAY2;
+    uint32_t BGCOLOR;
+    DeinterlaceMethod deinterlace_method;
+
+    bool operator==(const GSCRTState& other) const;
+};
+
+//A buffer render_CRT has written to, and the generation of the display contents it holds
+struct GSCRTOutput
+{
+    uint32_t* target = nullptr;
+    uint64_t generation = 0;
+
+    //Deinterlacing by field also pulls in the lines of the other field from screen_buffer
+    bool odd_frame = false;
+    uint64_t other_field_generation = 0;
+};
+
 typedef void (*GSDrawPixelPrologue)(int32_t x, int32_t y, uint32_t z, RGBAQ_REG& color);
+typedef void (*GSDrawSpanPrologue)(int32_t y, const GSSpanPixel* pixels, const GSSpanPixel* end);
 typedef void (*GSTexLookupPrologue)(int16_t u, int16_t v, TexLookupInfo* info);
 
 class GraphicsSynthesizerThread
@@ -355,15 +494,50 @@ class GraphicsSynthesizerThread
 
         bool send_data = false;
         bool recieve_data = false;
+        std::atomic<bool> thread_exited{ false };
+
+        //Register writes waiting to be sent as one write64_batch_t, stored in stream format after the header
+        uint8_t write64_batch[GS_WRITE64_BATCH_HEADER_SIZE + GS_WRITE64_BATCH_MAX * GS_WRITE64_BATCH_ENTRY_SIZE];
+        uint16_t write64_batch_count = 0;
 
         std::unique_ptr<gs_fifo> message_queue{ nullptr };
         std::unique_ptr<gs_return_fifo> return_queue{ nullptr };
 
+        //Tile-binned rasterizer workers. With none running, primitives are drawn on the GS thread.
+        int render_thread_count = 0;
+        std::unique_ptr<GSRenderWorker[]> render_workers;
+        bool render_workers_busy = false;
+
+        //Pages of local memory touched by the current FRAME/ZBUF/TEX0 setup.
+        //Primitives that read memory another band may write are drawn serially.
+        bool render_hazard_dirty = true;
+        bool render_hazard;
+        bool tex_feedback;
+        std::bitset<512> draw_pages;
+
+        //Pages written by primitives and transfers since the texture cache was last checked
+        std::bitset<512> pending_write_pages, transfer_pages;
+        GSTextureCacheEntry tex_cache[GS_TEX_CACHE_ENTRIES];
+        uint64_t tex_cache_clock = 0;
+        uint32_t clut_crc = 0;
+
+        //Read by the texture JIT. Null when the current texture has not been decoded
+        const uint32_t* tex_cache_texels = nullptr;
+        uint32_t tex_cache_width_shift = 0;
+
         bool frame_complete;
         int frame_count;
         uint8_t* local_mem;
         uint8_t CRT_mode;
         uint32_t screen_buffer[2048 * 2048];
+
+        //Bumped whenever the CRT registers or a displayed page change
+        std::bitset<512> crt_write_pages;
+        GSCRTState crt_state;
+        uint64_t crt_generation = 1;
+        uint64_t crt_field_generation[2] = {};
+        GSCRTOutput crt_outputs[2];
+        std::vector<uint32_t> crt_line1, crt_line2, crt_row;
         uint8_t clut_cache[1024];
         uint32_t CBP0, CBP1;
 
@@ -385,6 +559,10 @@ class GraphicsSynthesizerThread
 
         GSTexLookupPrologue jit_tex_lookup_prologue;
         GSDrawPixelPrologue jit_draw_pixel_prologue;
+        GSDrawSpanPrologue jit_draw_span_prologue;
+
+        //Lane-parallel span function for the current state. Null when spans go through the pixel JIT instead.
+        GSDrawSpanPrologue jit_draw_span_func;
 
         uint8_t prim_type;
         uint16_t FOG;
@@ -419,6 +597,14 @@ class GraphicsSynthesizerThread
         uint32_t PSMCT24_color;
         int PSMCT24_unpacked_count;
 
+        //Host->local transfers are buffered one row of blocks at a time, so full blocks are swizzled in one go.
+        //Anything else that arrives mid-row replays the buffer through the per-pixel path first.
+        bool hwreg_bulk = false;
+        std::vector<uint8_t> hwreg_buffer;
+        uint32_t hwreg_buffer_used = 0;
+        uint32_t hwreg_buffer_target = 0;
+        uint32_t hwreg_row_bytes = 0;
+
         GS_REGISTERS reg;
 
         Vertex current_vtx;
@@ -435,6 +621,19 @@ class GraphicsSynthesizerThread
         void soft_reset();
         void event_loop();
 
+        void start_render_workers(int count);
+        void stop_render_workers();
+        void flush_render_workers();
+        void render_worker_loop(int index);
+        void dispatch_primitive();
+        bool check_render_hazard();
+        uint64_t primitive_area();
+
+        void invalidate_tex_cache();
+        void commit_tex_cache_writes();
+        void bind_tex_cache(uint64_t area);
+        void decode_texture(GSTextureCacheEntry& entry);
+
         //Swizzling routines
         uint32_t blockid_PSMCT32(uint32_t block, uint32_t width, uint32_t x, uint32_t y);
         uint32_t blockid_PSMCT32Z(uint32_t block, uint32_t width, uint32_t x, uint32_t y);
@@ -466,10 +665,12 @@ class GraphicsSynthesizerThread
         void write_PSMCT4_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint8_t value);
 
         uint8_t get_16bit_alpha(uint16_t color);
+        uint32_t convert_16bit_tex(uint16_t color);
         int16_t multiply_tex_color(int16_t tex_color, int16_t frag_color);
         void calculate_LOD(TexLookupInfo& info);
         void tex_lookup(int16_t u, int16_t v, TexLookupInfo& info);
         void tex_lookup_int(int16_t u, int16_t v, TexLookupInfo& info, bool forced_lookup = false);
+        uint32_t read_texel(uint32_t tex_base, uint32_t width, uint32_t u, uint32_t v);
         void clut_lookup(uint8_t entry, RGBAQ_REG& tex_color);
         void clut_CSM2_lookup(uint8_t entry, RGBAQ_REG& tex_color);
         void reload_clut(GSContext& context);
@@ -478,10 +679,18 @@ class GraphicsSynthesizerThread
         uint8_t* get_jitted_draw_pixel(uint64_t state);
 
         void recompile_draw_pixel_prologue();
+        void recompile_draw_span_prologue();
         GSPixelJitBlockRecord* recompile_draw_pixel(uint64_t state);
         void recompile_alpha_test();
         void recompile_depth_test();
         void recompile_alpha_blend();
+        uint8_t* get_jitted_draw_span(uint64_t state);
+        GSPixelJitBlockRecord* recompile_draw_span(uint64_t state);
+        void recompile_span_row(uint32_t format, uint32_t* base_pointer, REG_64 page_row, REG_64 table_row);
+        void recompile_span_gather(uint32_t format, REG_64 page_row, REG_64 table_row, uint32_t addr_slot, REG_64 xmm_dest);
+        void recompile_span_scatter(uint32_t format, uint32_t addr_slot, REG_64 xmm_source, REG_64 lane_mask);
+        void recompile_span_blend_input(uint8_t spec, REG_64 source_color, int channel, REG_64 xmm_dest);
+        void jit_broadcast_imm(uint32_t value, REG_64 xmm_dest);
         void jit_call_func(Emitter64& emitter, uint64_t addr);
         void jit_epilogue_draw_pixel();
 
@@ -495,26 +704,41 @@ class GraphicsSynthesizerThread
         void vertex_kick(bool drawing_kick);
         bool depth_test(int32_t x, int32_t y, uint32_t z);
         void draw_pixel(int32_t x, int32_t y, uint32_t z, RGBAQ_REG& color);
+        void begin_span(GSSpan& span, int32_t y);
+        void add_span_pixel(GSSpan& span, int32_t x, uint32_t z, const RGBAQ_REG& color);
+        void draw_span(GSSpan& span);
         uint32_t lookup_frame_color(int32_t x, int32_t y);
         void render_primitive();
-        void render_point();
-        void render_line();
+        void rasterize(uint8_t prim, const Vertex* vtx, const GSRenderBand& band);
+        void render_point(const Vertex* vtx, const GSRenderBand& band);
+        void render_line(const Vertex* vtx, const GSRenderBand& band);
         void render_triangle();
-        void render_triangle2();
+        void render_triangle2(const Vertex* vtx, const GSRenderBand& band);
         void render_half_triangle(float x0, float x1, int y0, int y1, VertexF& x_step, VertexF& y_step, VertexF& init,
-                float step_x0, float step_x1, float scx1, float scx2, TexLookupInfo& tex_info);
-        void render_sprite();
+                float step_x0, float step_x1, float scx1, float scx2, TexLookupInfo& tex_info, const GSRenderBand& band);
+        void render_sprite(const Vertex* vtx, const GSRenderBand& band);
+        bool sprite_is_fill(const RGBAQ_REG& color);
+        void fill_sprite(const RGBAQ_REG& color, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2,
+                         const GSRenderBand& band);
         void write_HWREG(uint64_t data);
+        void write_HWREG_pixels(uint64_t data);
+        void write_HWREG_pixel(uint32_t x, uint32_t y, const uint8_t* row, uint32_t index);
+        void write_HWREG_rows();
+        void start_HWREG_transfer();
+        void flush_HWREG_buffer();
         uint128_t local_to_host();
         void unpack_PSMCT24(uint64_t data, int offset, bool z_format);
         uint64_t pack_PSMCT24(bool z_format);
         void local_to_local();
+        bool local_to_local_blocks();
 
         int32_t orient2D(const Vertex &v1, const Vertex &v2, const Vertex &v3);
         void memdump(uint32_t* target, uint16_t& width, uint16_t& height);
 
         bool is_in_display(DISPLAY& display, int32_t x_start, int32_t y_start, int32_t x, int32_t y);
         uint32_t get_CRT_color(DISPFB& dispfb, int32_t x, int32_t y);
+        void read_CRT_line(DISPFB& dispfb, int32_t x, int32_t y, int32_t count, uint32_t* out);
+        bool CRT_output_current(uint32_t* target, bool weave);
         void render_CRT(uint32_t* target);
 
         void write64(uint32_t addr, uint64_t value);
@@ -527,12 +751,19 @@ class GraphicsSynthesizerThread
 
         void load_state(std::ifstream* state);
         void save_state(std::ofstream* state);
+
+        void push_record(const uint8_t* record, size_t size);
+        void flush_write64_batch();
+        bool read_message(GSMessage& message);
+        void read_batched_write64(GSMessage& message);
+        void publish_messages();
     public:
         GraphicsSynthesizerThread();
         ~GraphicsSynthesizerThread();
         
         // safe to access from emu thread
         void send_message(GSMessage message);
+        void send_write64(uint32_t addr, uint64_t value);
         void wake_thread();
         void wait_for_return(GSReturn type, GSReturnMessage &data);
         void reset();
@@ -4,6 +4,7 @@
 #include <cstring>
 #include "iop.hpp"
 #include "iop_interpreter.hpp"
+#include "iop_jit.hpp"
 
 #include "../emulator.hpp"
 #include "../ee/emotiondisasm.hpp"
@@ -11,7 +12,7 @@
 
 IOP::IOP(Emulator* e) : e(e)
 {
-
+    run_func = &IOP::run_interpreter;
 }
 
 const char* IOP::REG(int id)
@@ -62,36 +63,7 @@ void IOP::run(int cycles)
     if (!wait_for_IRQ)
     {
         cycles_to_run += cycles;
-        while (cycles_to_run > 0)
-        {
-            cycles_to_run--;
-            if (muldiv_delay > 0)
-                muldiv_delay--;
-            uint32_t instr = read_instr(PC);
-            if (can_disassemble)
-            {
-                printf("[IOP] [$%08X] $%08X - %s\n", PC, instr, EmotionDisasm::disasm_instr(instr, PC).c_str());
-                //print_state();
-            }
-            IOP_Interpreter::interpret(*this, instr);
-
-            PC += 4;
-
-            if (will_branch)
-            {
-                if (!branch_delay)
-                {
-                    will_branch = false;
-                    PC = new_PC;
-                    if (PC & 0x3)
-                    {
-                        Errors::die("[IOP] Invalid PC address $%08X!\n", PC);
-                    }
-                }
-                else
-                    branch_delay--;
-            }
-        }
+        run_func(*this);
     }
     else if (muldiv_delay)
         muldiv_delay--;
@@ -100,6 +72,54 @@ void IOP::run(int cycles)
         interrupt();
 }
 
+void IOP::run_interpreter()
+{
+    while (cycles_to_run > 0)
+        step();
+}
+
+void IOP::run_jit()
+{
+    while (cycles_to_run > 0)
+    {
+        //Blocks always end after a delay slot. A pending branch only happens when the interpreter was
+        //running before, or when the JIT can't take the block (a branch in a delay slot)
+        if (will_branch || !IOP_JIT::run(this))
+            step();
+    }
+}
+
+void IOP::step()
+{
+    cycles_to_run--;
+    if (muldiv_delay > 0)
+        muldiv_delay--;
+    uint32_t instr = read_instr(PC);
+    if (can_disassemble)
+    {
+        printf("[IOP] [$%08X] $%08X - %s\n", PC, instr, EmotionDisasm::disasm_instr(instr, PC).c_str());
+        //print_state();
+    }
+    IOP_Interpreter::interpret(*this, instr);
+
+    PC += 4;
+
+    if (will_branch)
+    {
+        if (!branch_delay)
+        {
+            will_branch = false;
+            PC = new_PC;
+            if (PC & 0x3)
+            {
+                Errors::die("[IOP] Invalid PC address $%08X!\n", PC);
+            }
+        }
+        else
+            branch_delay--;
+    }
+}
+
 void IOP::print_state()
 {
     printf("pc:$%08X\n", PC);
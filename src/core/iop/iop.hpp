@@ -4,6 +4,7 @@
 #include <cstdlib>
 #include <cstdio>
 #include <fstream>
+#include <functional>
 #include "iop_cop0.hpp"
 
 class Emulator;
@@ -37,12 +38,20 @@ class IOP
         int cycles_to_run;
 
         uint32_t translate_addr(uint32_t addr);
+        void step();
+
+        friend class IOP_JIT64;
+        friend class IOP_JitTranslator;
     public:
         IOP(Emulator* e);
         static const char* REG(int id);
 
+        std::function<void(IOP&)> run_func;
+
         void reset();
         void run(int cycles);
+        void run_interpreter();
+        void run_jit();
         void halt();
         void unhalt();
         void print_state();
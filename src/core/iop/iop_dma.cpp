@@ -21,9 +21,10 @@ const char* IOP_DMA::CHAN(int index)
     return borp[index];
 }
 
-void IOP_DMA::reset(uint8_t* RAM)
+void IOP_DMA::reset(uint8_t* RAM, uint8_t* RAM_modified)
 {
     this->RAM = RAM;
+    this->RAM_modified = RAM_modified;
     active_channel = nullptr;
     queued_channels.clear();
     for (int i = 0; i < 16; i++)
@@ -51,6 +52,17 @@ void IOP_DMA::reset(uint8_t* RAM)
     set_DMA_request(IOP_SIF0);
 }
 
+//Flags the pages for the IOP JIT, so code loaded by DMA gets recompiled
+void IOP_DMA::mark_RAM_modified(uint32_t addr, uint32_t size)
+{
+    if (!size)
+        return;
+
+    uint32_t last = (addr + size - 1) >> 12;
+    for (uint32_t page = addr >> 12; page <= last; page++)
+        RAM_modified[page & 0x1FF] = 1;
+}
+
 void IOP_DMA::run(int cycles)
 {
     while (cycles--)
@@ -67,6 +79,7 @@ void IOP_DMA::process_CDVD()
     uint32_t count = channels[IOP_CDVD].word_count * channels[IOP_CDVD].block_size * 4;
     printf("[IOP DMA] CDVD bytes: $%08X\n", count);
     uint32_t bytes_read = cdvd->read_to_RAM(RAM + channels[IOP_CDVD].addr, count);
+    mark_RAM_modified(channels[IOP_CDVD].addr, bytes_read);
     if (count <= bytes_read)
     {
         transfer_end(IOP_CDVD);
@@ -103,6 +116,7 @@ void IOP_DMA::process_SPU()
             {
                 uint32_t value = spu->read_DMA();
                 *(uint32_t*)&RAM[channels[IOP_SPU].addr] = value;
+                mark_RAM_modified(channels[IOP_SPU].addr, 4);
             }
             channels[IOP_SPU].size--;
             channels[IOP_SPU].addr += 4;
@@ -147,6 +161,7 @@ void IOP_DMA::process_SPU2()
             {
                 uint32_t value = spu2->read_DMA();
                 *(uint32_t*)&RAM[channels[IOP_SPU2].addr] = value;
+                mark_RAM_modified(channels[IOP_SPU2].addr, 4);
             }
             channels[IOP_SPU2].size--;
             channels[IOP_SPU2].addr += 4;
@@ -225,6 +240,7 @@ void IOP_DMA::process_SIF1()
         uint32_t data = sif->read_SIF1();
 
         *(uint32_t*)&RAM[channels[IOP_SIF1].addr] = data;
+        mark_RAM_modified(channels[IOP_SIF1].addr, 4);
         channels[IOP_SIF1].addr += 4;
         channels[IOP_SIF1].word_count--;
         if (!channels[IOP_SIF1].word_count && channels[IOP_SIF1].tag_end)
@@ -269,6 +285,7 @@ void IOP_DMA::process_SIO2out()
     while (size)
     {
         RAM[channels[IOP_SIO2out].addr] = sio2->read_serial();
+        mark_RAM_modified(channels[IOP_SIO2out].addr, 1);
         channels[IOP_SIO2out].addr++;
         size--;
     }
@@ -76,6 +76,7 @@ class IOP_DMA
 {
     private:
         uint8_t* RAM;
+        uint8_t* RAM_modified;
         IOP_INTC* intc;
         CDVD_Drive* cdvd;
         SubsystemInterface* sif;
@@ -89,6 +90,7 @@ class IOP_DMA
         DMA_DPCR DPCR;
         DMA_DICR DICR;
 
+        void mark_RAM_modified(uint32_t addr, uint32_t size);
         void transfer_end(int index);
         void process_CDVD();
         void process_SPU();
@@ -106,8 +108,9 @@ class IOP_DMA
         static const char* CHAN(int index);
         IOP_DMA(IOP_INTC* intc, CDVD_Drive* cdvd, SubsystemInterface* sif, SIO2* sio2, SPU* spu, SPU* spu2);
 
-        void reset(uint8_t* RAM);
+        void reset(uint8_t* RAM, uint8_t* RAM_modified);
         void run(int cycles);
+        bool is_idle();
 
         uint32_t get_DPCR();
         uint32_t get_DPCR2();
@@ -137,4 +140,9 @@ class IOP_DMA
         void save_state(std::ofstream& state);
 };
 
+inline bool IOP_DMA::is_idle()
+{
+    return !active_channel;
+}
+
 #endif // IOP_DMA_HPP
@@ -0,0 +1,20 @@
+#include "iop_jit.hpp"
+#include "iop_jit64.hpp"
+#include "iop.hpp"
+
+namespace IOP_JIT
+{
+
+IOP_JIT64 jit64;
+
+bool run(IOP *iop)
+{
+    return jit64.run(*iop);
+}
+
+void reset()
+{
+    jit64.reset();
+}
+
+};
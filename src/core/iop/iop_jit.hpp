@@ -0,0 +1,13 @@
+#ifndef IOP_JIT_HPP
+#define IOP_JIT_HPP
+#include <cstdint>
+
+class IOP;
+
+namespace IOP_JIT
+{
+    bool run(IOP* iop);
+    void reset();
+};
+
+#endif // IOP_JIT_HPP
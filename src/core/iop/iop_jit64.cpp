@@ -0,0 +1,611 @@
+#include <cstddef>
+#include <cstring>
+#include "iop_jit64.hpp"
+#include "iop.hpp"
+#include "iop_interpreter.hpp"
+#include "../emulator.hpp"
+#include "../errors.hpp"
+
+#ifdef _WIN32
+const static REG_64 ABI_ARGS[] = { RCX, RDX, R8 };
+#else
+const static REG_64 ABI_ARGS[] = { RDI, RSI, RDX };
+#endif
+
+//Register usage
+//R15: IOP object
+//RAX, RCX, RDX and the ABI argument registers: scratch, never live across IR instructions
+//The stack is kept 16-byte aligned with 0x20 bytes of shadow space for Win64 calls
+
+static uint32_t iop_read8(IOP& iop, uint32_t addr)
+{
+    return iop.read8(addr);
+}
+
+static uint32_t iop_read16(IOP& iop, uint32_t addr)
+{
+    return iop.read16(addr);
+}
+
+static uint32_t iop_read32(IOP& iop, uint32_t addr)
+{
+    return iop.read32(addr);
+}
+
+static void iop_write8(IOP& iop, uint32_t addr, uint32_t value)
+{
+    iop.write8(addr, value & 0xFF);
+}
+
+static void iop_write16(IOP& iop, uint32_t addr, uint32_t value)
+{
+    iop.write16(addr, value & 0xFFFF);
+}
+
+static void iop_write32(IOP& iop, uint32_t addr, uint32_t value)
+{
+    iop.write32(addr, value);
+}
+
+static void iop_halt(IOP& iop)
+{
+    iop.halt();
+}
+
+static void iop_syscall(IOP& iop)
+{
+    iop.syscall_exception();
+}
+
+static void iop_interpret(IOP& iop, uint32_t opcode)
+{
+    IOP_Interpreter::interpret(iop, opcode);
+}
+
+IOP_JIT64::IOP_JIT64() : jit_block("IOP"), jit_heap(1024 * 1024 * 32), emitter(&jit_block)
+{
+    memset(lookup_cache, 0, sizeof(lookup_cache));
+}
+
+//Page of IOP RAM backing a virtual address, with RAM mirrored every 2 MB up to 8 MB, or -1 if it isn't RAM
+static int get_RAM_page(uint32_t addr)
+{
+    addr &= 0x1FFFFFFF;
+    if (addr >= 0x00800000)
+        return -1;
+    return (addr & 0x1FFFFF) >> 12;
+}
+
+void IOP_JIT64::reset()
+{
+    jit_heap.flush_all_blocks();
+    blocks.clear();
+    memset(lookup_cache, 0, sizeof(lookup_cache));
+    for (int i = 0; i < IOP_RAM_PAGES; i++)
+        page_blocks[i].clear();
+}
+
+//Drops every block compiled from a page. The code stays in the heap until it's flushed
+void IOP_JIT64::invalidate_page(int page)
+{
+    for (uint64_t key : page_blocks[page])
+    {
+        auto it = blocks.find(key);
+        if (it == blocks.end())
+            continue;
+
+        IOPBlockInfo*& cache_entry = lookup_cache[((uint32_t)key >> 2) & 0x3FFF];
+        if (cache_entry == &it->second)
+            cache_entry = nullptr;
+
+        jit_heap.invalidate_block(key);
+        blocks.erase(it);
+    }
+    page_blocks[page].clear();
+}
+
+//Returns true if the page had been written since blocks were last compiled from it
+bool IOP_JIT64::flush_modified_page(uint8_t* modified, int page)
+{
+    if (page < 0 || !modified[page])
+        return false;
+
+    invalidate_page(page);
+    modified[page] = 0;
+    return true;
+}
+
+bool IOP_JIT64::run(IOP& iop)
+{
+    uint64_t key = iop.PC | ((uint64_t)((iop.cache_control >> 11) & 0x1) << 32);
+    IOPBlockInfo*& cache_entry = lookup_cache[(iop.PC >> 2) & 0x3FFF];
+    IOPBlockInfo* block = cache_entry;
+
+    if (!block || block->key != key)
+    {
+        auto it = blocks.find(key);
+        block = (it != blocks.end()) ? &it->second : nullptr;
+    }
+
+    if (block)
+    {
+        uint8_t* modified = iop.e->get_IOP_RAM_modified();
+        bool first_modified = flush_modified_page(modified, block->first_page);
+        bool last_modified = flush_modified_page(modified, block->last_page);
+        if (first_modified || last_modified)
+            block = nullptr;
+    }
+
+    if (!block)
+    {
+        if (jit_heap.heap_is_full())
+        {
+            printf("[IOP_JIT64] Not enough room for new blocks, clearing cache\n");
+            reset();
+        }
+
+        block = recompile_block(iop, key);
+        if (!block)
+            return false;
+    }
+
+    cache_entry = block;
+    block->code(iop);
+
+    if (iop.PC & 0x3)
+        Errors::die("[IOP] Invalid PC address $%08X!\n", iop.PC);
+    return true;
+}
+
+IOPBlockInfo* IOP_JIT64::recompile_block(IOP& iop, uint64_t key)
+{
+    std::vector<uint32_t> opcodes;
+    IR::Block block = ir.translate(iop, opcodes);
+
+    if (!block.get_instruction_count())
+        return nullptr;
+
+    //Blocks left over from older code in these pages have to go before the flags are cleared
+    int first_page = get_RAM_page(iop.PC);
+    int last_page = get_RAM_page(iop.PC + (opcodes.size() - 1) * 4);
+    flush_modified_page(iop.e->get_IOP_RAM_modified(), first_page);
+    flush_modified_page(iop.e->get_IOP_RAM_modified(), last_page);
+
+    jit_block.clear();
+
+    pending_cycles = 0;
+    branch_taken = false;
+    exception_raised = false;
+
+    //Prologue
+    emitter.PUSH(REG_64::R15);
+    emitter.SUB64_REG_IMM(0x20, REG_64::RSP);
+    emitter.MOV64_MR(ABI_ARGS[0], REG_64::R15);
+
+    while (block.get_instruction_count() > 0)
+    {
+        IR::Instruction instr = block.get_next_instr();
+        emit_instruction(instr);
+    }
+
+    flush_cycles();
+
+    if (exception_raised)
+    {
+        //Same as the interpreter: handle_exception leaves PC one instruction before the vector
+        emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, offsetof(IOP, PC));
+        emitter.ADD32_REG_IMM(4, REG_64::RAX);
+        emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsetof(IOP, PC));
+    }
+    else if (branch_taken)
+    {
+        emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, offsetof(IOP, new_PC));
+        emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsetof(IOP, PC));
+    }
+    else
+        emitter.MOV32_IMM_MEM(iop.PC + (opcodes.size() * 4), REG_64::R15, offsetof(IOP, PC));
+
+    //Epilogue
+    emitter.ADD64_REG_IMM(0x20, REG_64::RSP);
+    emitter.POP(REG_64::R15);
+    emitter.RET();
+
+    IOPJitBlockRecord* record = jit_heap.insert_block(key, &jit_block);
+
+    IOPBlockInfo& info = blocks[key];
+    info.key = key;
+    info.code = (IOPJitBlock)record->code_start;
+    info.first_page = first_page;
+    info.last_page = last_page;
+    if (first_page >= 0)
+        page_blocks[first_page].push_back(key);
+    if (last_page >= 0 && last_page != first_page)
+        page_blocks[last_page].push_back(key);
+    return &info;
+}
+
+void IOP_JIT64::emit_instruction(IR::Instruction& instr)
+{
+    pending_cycles += instr.get_cycle_count();
+
+    switch (instr.op)
+    {
+        case IR::Opcode::Nop:
+            break;
+        case IR::Opcode::LoadConst:
+            load_const(instr);
+            break;
+        case IR::Opcode::AddWordImm:
+            add_word_imm(instr);
+            break;
+        case IR::Opcode::AndImm:
+            and_imm(instr);
+            break;
+        case IR::Opcode::OrImm:
+            or_imm(instr);
+            break;
+        case IR::Opcode::XorImm:
+            xor_imm(instr);
+            break;
+        case IR::Opcode::SetOnLessThanImmediate:
+            set_on_less_than_imm(instr, ConditionCode::L);
+            break;
+        case IR::Opcode::SetOnLessThanImmediateUnsigned:
+            set_on_less_than_imm(instr, ConditionCode::B);
+            break;
+        case IR::Opcode::ShiftLeftLogical:
+        case IR::Opcode::ShiftRightLogical:
+        case IR::Opcode::ShiftRightArithmetic:
+            shift_imm(instr);
+            break;
+        case IR::Opcode::ShiftLeftLogicalVariable:
+        case IR::Opcode::ShiftRightLogicalVariable:
+        case IR::Opcode::ShiftRightArithmeticVariable:
+            shift_variable(instr);
+            break;
+        case IR::Opcode::AddWordReg:
+        case IR::Opcode::SubWordReg:
+        case IR::Opcode::AndReg:
+        case IR::Opcode::OrReg:
+        case IR::Opcode::XorReg:
+        case IR::Opcode::NorReg:
+            alu_reg(instr);
+            break;
+        case IR::Opcode::SetOnLessThan:
+            set_on_less_than(instr, ConditionCode::L);
+            break;
+        case IR::Opcode::SetOnLessThanUnsigned:
+            set_on_less_than(instr, ConditionCode::B);
+            break;
+        case IR::Opcode::LoadByte:
+        case IR::Opcode::LoadByteUnsigned:
+        case IR::Opcode::LoadHalfword:
+        case IR::Opcode::LoadHalfwordUnsigned:
+        case IR::Opcode::LoadWord:
+            load(instr);
+            break;
+        case IR::Opcode::StoreByte:
+        case IR::Opcode::StoreHalfword:
+        case IR::Opcode::StoreWord:
+            store(instr);
+            break;
+        case IR::Opcode::Jump:
+            jump(instr);
+            break;
+        case IR::Opcode::JumpIndirect:
+            jump_indirect(instr);
+            break;
+        case IR::Opcode::BranchEqual:
+            branch(instr, ConditionCode::E, false);
+            break;
+        case IR::Opcode::BranchNotEqual:
+            branch(instr, ConditionCode::NE, false);
+            break;
+        case IR::Opcode::BranchLessThanZero:
+            branch(instr, ConditionCode::L, true);
+            break;
+        case IR::Opcode::BranchGreaterThanZero:
+            branch(instr, ConditionCode::G, true);
+            break;
+        case IR::Opcode::BranchLessThanOrEqualZero:
+            branch(instr, ConditionCode::LE, true);
+            break;
+        case IR::Opcode::BranchGreaterThanOrEqualZero:
+            branch(instr, ConditionCode::GE, true);
+            break;
+        case IR::Opcode::Stop:
+            halt(instr);
+            break;
+        case IR::Opcode::SystemCall:
+            system_call(instr);
+            break;
+        case IR::Opcode::FallbackInterpreter:
+            fallback_interpreter(instr);
+            break;
+        default:
+            Errors::die("[IOP_JIT64] Unknown IR instruction %d", instr.op);
+    }
+}
+
+uint32_t IOP_JIT64::get_gpr_offset(int index)
+{
+    return offsetof(IOP, gpr) + (index * sizeof(uint32_t));
+}
+
+void IOP_JIT64::load_gpr(int index, REG_64 dest)
+{
+    //$zero is never written, so it can be read like any other register
+    emitter.MOV32_FROM_MEM(REG_64::R15, dest, get_gpr_offset(index));
+}
+
+void IOP_JIT64::store_gpr(REG_64 source, int index)
+{
+    if (index)
+        emitter.MOV32_TO_MEM(source, REG_64::R15, get_gpr_offset(index));
+}
+
+/**
+ * Charges the cycles of every instruction emitted so far to the IOP, the same way IOP::run would have.
+ * This must be done before anything that reads the cycle counters, i.e. the interpreter.
+ */
+void IOP_JIT64::flush_cycles()
+{
+    if (!pending_cycles)
+        return;
+
+    emitter.SUB32_MEM_IMM(pending_cycles, REG_64::R15, offsetof(IOP, cycles_to_run));
+
+    //muldiv_delay = max(muldiv_delay - pending_cycles, 0)
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, offsetof(IOP, muldiv_delay));
+    emitter.XOR32_REG(REG_64::RCX, REG_64::RCX);
+    emitter.ADD32_REG_IMM(-pending_cycles, REG_64::RAX);
+    emitter.CMOVCC32_REG(ConditionCode::L, REG_64::RCX, REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsetof(IOP, muldiv_delay));
+
+    pending_cycles = 0;
+}
+
+void IOP_JIT64::call_iop_func(uint64_t func)
+{
+    emitter.MOV64_MR(REG_64::R15, ABI_ARGS[0]);
+    emitter.MOV64_OI(func, REG_64::RAX);
+    emitter.CALL_INDIR(REG_64::RAX);
+}
+
+void IOP_JIT64::load_const(IR::Instruction& instr)
+{
+    emitter.MOV32_IMM_MEM(instr.get_source(), REG_64::R15, get_gpr_offset(instr.get_dest()));
+}
+
+void IOP_JIT64::add_word_imm(IR::Instruction& instr)
+{
+    load_gpr(instr.get_source(), REG_64::RAX);
+    emitter.ADD32_REG_IMM(instr.get_source2(), REG_64::RAX);
+    store_gpr(REG_64::RAX, instr.get_dest());
+}
+
+void IOP_JIT64::and_imm(IR::Instruction& instr)
+{
+    load_gpr(instr.get_source(), REG_64::RAX);
+    emitter.AND32_REG_IMM(instr.get_source2(), REG_64::RAX);
+    store_gpr(REG_64::RAX, instr.get_dest());
+}
+
+void IOP_JIT64::or_imm(IR::Instruction& instr)
+{
+    load_gpr(instr.get_source(), REG_64::RAX);
+    emitter.OR32_REG_IMM(instr.get_source2(), REG_64::RAX);
+    store_gpr(REG_64::RAX, instr.get_dest());
+}
+
+void IOP_JIT64::xor_imm(IR::Instruction& instr)
+{
+    load_gpr(instr.get_source(), REG_64::RAX);
+    emitter.MOV32_REG_IMM(instr.get_source2(), REG_64::RCX);
+    emitter.XOR32_REG(REG_64::RCX, REG_64::RAX);
+    store_gpr(REG_64::RAX, instr.get_dest());
+}
+
+void IOP_JIT64::set_on_less_than_imm(IR::Instruction& instr, ConditionCode cc)
+{
+    load_gpr(instr.get_source(), REG_64::RAX);
+    emitter.CMP32_IMM(instr.get_source2(), REG_64::RAX);
+    emitter.SETCC_REG(cc, REG_64::RAX);
+    emitter.MOVZX8_TO_32(REG_64::RAX, REG_64::RAX);
+    store_gpr(REG_64::RAX, instr.get_dest());
+}
+
+void IOP_JIT64::shift_imm(IR::Instruction& instr)
+{
+    uint8_t shift = instr.get_source2();
+
+    load_gpr(instr.get_source(), REG_64::RAX);
+    switch (instr.op)
+    {
+        case IR::Opcode::ShiftLeftLogical:
+            emitter.SHL32_REG_IMM(shift, REG_64::RAX);
+            break;
+        case IR::Opcode::ShiftRightLogical:
+            emitter.SHR32_REG_IMM(shift, REG_64::RAX);
+            break;
+        default:
+            emitter.SAR32_REG_IMM(shift, REG_64::RAX);
+            break;
+    }
+    store_gpr(REG_64::RAX, instr.get_dest());
+}
+
+void IOP_JIT64::shift_variable(IR::Instruction& instr)
+{
+    //x86 masks the shift amount to five bits, same as MIPS
+    load_gpr(instr.get_source(), REG_64::RAX);
+    load_gpr(instr.get_source2(), REG_64::RCX);
+    switch (instr.op)
+    {
+        case IR::Opcode::ShiftLeftLogicalVariable:
+            emitter.SHL32_CL(REG_64::RAX);
+            break;
+        case IR::Opcode::ShiftRightLogicalVariable:
+            emitter.SHR32_CL(REG_64::RAX);
+            break;
+        default:
+            emitter.SAR32_CL(REG_64::RAX);
+            break;
+    }
+    store_gpr(REG_64::RAX, instr.get_dest());
+}
+
+void IOP_JIT64::alu_reg(IR::Instruction& instr)
+{
+    load_gpr(instr.get_source(), REG_64::RAX);
+    load_gpr(instr.get_source2(), REG_64::RCX);
+    switch (instr.op)
+    {
+        case IR::Opcode::AddWordReg:
+            emitter.ADD32_REG(REG_64::RCX, REG_64::RAX);
+            break;
+        case IR::Opcode::SubWordReg:
+            emitter.SUB32_REG(REG_64::RCX, REG_64::RAX);
+            break;
+        case IR::Opcode::AndReg:
+            emitter.AND32_REG(REG_64::RCX, REG_64::RAX);
+            break;
+        case IR::Opcode::OrReg:
+            emitter.OR32_REG(REG_64::RCX, REG_64::RAX);
+            break;
+        case IR::Opcode::XorReg:
+            emitter.XOR32_REG(REG_64::RCX, REG_64::RAX);
+            break;
+        default:
+            emitter.OR32_REG(REG_64::RCX, REG_64::RAX);
+            emitter.NOT32(REG_64::RAX);
+            break;
+    }
+    store_gpr(REG_64::RAX, instr.get_dest());
+}
+
+void IOP_JIT64::set_on_less_than(IR::Instruction& instr, ConditionCode cc)
+{
+    load_gpr(instr.get_source(), REG_64::RAX);
+    load_gpr(instr.get_source2(), REG_64::RCX);
+    emitter.CMP32_REG(REG_64::RCX, REG_64::RAX);
+    emitter.SETCC_REG(cc, REG_64::RAX);
+    emitter.MOVZX8_TO_32(REG_64::RAX, REG_64::RAX);
+    store_gpr(REG_64::RAX, instr.get_dest());
+}
+
+void IOP_JIT64::load(IR::Instruction& instr)
+{
+    load_gpr(instr.get_source(), ABI_ARGS[1]);
+    emitter.ADD32_REG_IMM(instr.get_source2(), ABI_ARGS[1]);
+
+    switch (instr.op)
+    {
+        case IR::Opcode::LoadByte:
+            call_iop_func((uint64_t)&iop_read8);
+            emitter.MOVSX8_TO_64(REG_64::RAX, REG_64::RAX);
+            break;
+        case IR::Opcode::LoadByteUnsigned:
+            call_iop_func((uint64_t)&iop_read8);
+            break;
+        case IR::Opcode::LoadHalfword:
+            call_iop_func((uint64_t)&iop_read16);
+            emitter.MOVSX16_TO_32(REG_64::RAX, REG_64::RAX);
+            break;
+        case IR::Opcode::LoadHalfwordUnsigned:
+            call_iop_func((uint64_t)&iop_read16);
+            break;
+        default:
+            call_iop_func((uint64_t)&iop_read32);
+            break;
+    }
+
+    store_gpr(REG_64::RAX, instr.get_dest());
+}
+
+void IOP_JIT64::store(IR::Instruction& instr)
+{
+    load_gpr(instr.get_dest(), ABI_ARGS[1]);
+    emitter.ADD32_REG_IMM(instr.get_source2(), ABI_ARGS[1]);
+    load_gpr(instr.get_source(), ABI_ARGS[2]);
+
+    switch (instr.op)
+    {
+        case IR::Opcode::StoreByte:
+            call_iop_func((uint64_t)&iop_write8);
+            break;
+        case IR::Opcode::StoreHalfword:
+            call_iop_func((uint64_t)&iop_write16);
+            break;
+        default:
+            call_iop_func((uint64_t)&iop_write32);
+            break;
+    }
+}
+
+void IOP_JIT64::jump(IR::Instruction& instr)
+{
+    emitter.MOV32_IMM_MEM(instr.get_jump_dest(), REG_64::R15, offsetof(IOP, new_PC));
+    branch_taken = true;
+    link(instr);
+}
+
+void IOP_JIT64::jump_indirect(IR::Instruction& instr)
+{
+    load_gpr(instr.get_source(), REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsetof(IOP, new_PC));
+    branch_taken = true;
+    link(instr);
+}
+
+void IOP_JIT64::branch(IR::Instruction& instr, ConditionCode cc, bool compare_zero)
+{
+    load_gpr(instr.get_source(), REG_64::RCX);
+    if (compare_zero)
+        emitter.CMP32_IMM(0, REG_64::RCX);
+    else
+    {
+        load_gpr(instr.get_source2(), REG_64::RDX);
+        emitter.CMP32_REG(REG_64::RDX, REG_64::RCX);
+    }
+
+    //Conditionally move the success or failure destination into new_PC
+    emitter.MOV32_REG_IMM(instr.get_jump_fail_dest(), REG_64::RAX);
+    emitter.MOV32_REG_IMM(instr.get_jump_dest(), REG_64::RDX);
+    emitter.CMOVCC32_REG(cc, REG_64::RDX, REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsetof(IOP, new_PC));
+    branch_taken = true;
+    link(instr);
+}
+
+void IOP_JIT64::link(IR::Instruction& instr)
+{
+    if (!instr.get_is_link())
+        return;
+
+    int dest = (instr.op == IR::Opcode::JumpIndirect) ? instr.get_dest() : 31;
+    if (dest)
+        emitter.MOV32_IMM_MEM(instr.get_return_addr(), REG_64::R15, get_gpr_offset(dest));
+}
+
+void IOP_JIT64::halt(IR::Instruction& instr)
+{
+    call_iop_func((uint64_t)&iop_halt);
+}
+
+void IOP_JIT64::system_call(IR::Instruction& instr)
+{
+    flush_cycles();
+    emitter.MOV32_IMM_MEM(instr.get_source2(), REG_64::R15, offsetof(IOP, PC));
+    call_iop_func((uint64_t)&iop_syscall);
+    exception_raised = true;
+}
+
+void IOP_JIT64::fallback_interpreter(IR::Instruction& instr)
+{
+    //The interpreter may look at the cycle counters (HI/LO stalls) or PC
+    flush_cycles();
+    emitter.MOV32_IMM_MEM(instr.get_source2(), REG_64::R15, offsetof(IOP, PC));
+    emitter.MOV32_REG_IMM(instr.get_source(), ABI_ARGS[1]);
+    call_iop_func((uint64_t)&iop_interpret);
+}
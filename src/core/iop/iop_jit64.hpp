@@ -0,0 +1,96 @@
+#ifndef IOP_JIT64_HPP
+#define IOP_JIT64_HPP
+#include <unordered_map>
+#include <vector>
+#include "../jitcommon/emitter64.hpp"
+#include "../jitcommon/ir_block.hpp"
+#include "../jitcommon/jitcache.hpp"
+#include "iop_jittrans.hpp"
+
+class IOP;
+
+typedef void(*IOPJitBlock)(IOP& iop);
+
+constexpr int IOP_RAM_PAGES = 0x200;
+
+struct IOPBlockInfo
+{
+    uint64_t key;
+    IOPJitBlock code;
+
+    //Pages of IOP RAM holding the first and last instruction, -1 outside of RAM.
+    //Blocks end at page boundaries, so only a delay slot can put them on different pages.
+    int first_page, last_page;
+};
+
+/**
+ * Recompiler for the IOP.
+ *
+ * Blocks are called directly from IOP::run_jit and return to it when done. Guest registers live in the IOP
+ * object (pointed to by R15) and are loaded and stored around every operation, which keeps fallbacks to the
+ * interpreter trivial. Loads and stores call into IOP::read/write.
+ *
+ * Modules are loaded into IOP RAM through CPU stores, DMA and the EE, which all flag the 4 KB pages they write
+ * (Emulator::get_IOP_RAM_modified). Before a block runs, the flags of its pages are checked and every block
+ * compiled from a flagged page is dropped. Pages are physical, so the KUSEG/KSEG0/KSEG1 views and the mirrors
+ * of RAM share their flags.
+ */
+class IOP_JIT64
+{
+    private:
+        JitBlock jit_block;
+        IOPJitHeap jit_heap;
+        Emitter64 emitter;
+        IOP_JitTranslator ir;
+
+        std::unordered_map<uint64_t, IOPBlockInfo> blocks;
+        IOPBlockInfo* lookup_cache[0x4000];
+
+        //Keys of the blocks compiled from each page of IOP RAM
+        std::vector<uint64_t> page_blocks[IOP_RAM_PAGES];
+
+        int pending_cycles;
+        bool branch_taken;
+        bool exception_raised;
+
+        uint32_t get_gpr_offset(int index);
+        void load_gpr(int index, REG_64 dest);
+        void store_gpr(REG_64 source, int index);
+        void flush_cycles();
+        void call_iop_func(uint64_t func);
+
+        void load_const(IR::Instruction& instr);
+        void add_word_imm(IR::Instruction& instr);
+        void and_imm(IR::Instruction& instr);
+        void or_imm(IR::Instruction& instr);
+        void xor_imm(IR::Instruction& instr);
+        void set_on_less_than_imm(IR::Instruction& instr, ConditionCode cc);
+        void shift_imm(IR::Instruction& instr);
+        void shift_variable(IR::Instruction& instr);
+        void alu_reg(IR::Instruction& instr);
+        void set_on_less_than(IR::Instruction& instr, ConditionCode cc);
+
+        void load(IR::Instruction& instr);
+        void store(IR::Instruction& instr);
+
+        void jump(IR::Instruction& instr);
+        void jump_indirect(IR::Instruction& instr);
+        void branch(IR::Instruction& instr, ConditionCode cc, bool compare_zero);
+        void link(IR::Instruction& instr);
+
+        void halt(IR::Instruction& instr);
+        void system_call(IR::Instruction& instr);
+        void fallback_interpreter(IR::Instruction& instr);
+
+        void emit_instruction(IR::Instruction& instr);
+        IOPBlockInfo* recompile_block(IOP& iop, uint64_t key);
+        void invalidate_page(int page);
+        bool flush_modified_page(uint8_t* modified, int page);
+    public:
+        IOP_JIT64();
+
+        void reset();
+        bool run(IOP& iop);
+};
+
+#endif // IOP_JIT64_HPP
@@ -0,0 +1,496 @@
+#include "iop_jittrans.hpp"
+#include "iop.hpp"
+
+static uint32_t branch_offset_iop(uint32_t instr, uint32_t PC)
+{
+    int32_t i = (int16_t)(instr);
+    i <<= 2;
+    return PC + i + 4;
+}
+
+static uint32_t jump_offset_iop(uint32_t instr, uint32_t PC)
+{
+    uint32_t addr = (instr & 0x3FFFFFF) << 2;
+    addr += (PC + 4) & 0xF0000000;
+    return addr;
+}
+
+IR::Block IOP_JitTranslator::translate(IOP &iop, std::vector<uint32_t>& opcodes)
+{
+    IR::Block block;
+    std::vector<IR::Instruction> instrs;
+    uint32_t pc = iop.get_PC();
+    int cycle_count = 0;
+
+    opcodes.clear();
+
+    while (true)
+    {
+        uint32_t opcode = iop.read32(pc);
+        int instr_count = 1;
+
+        if (is_branch(opcode))
+        {
+            //Compile the delay slot along with the branch, unless it would need a second pending branch
+            uint32_t delay_slot = iop.read32(pc + 4);
+            if (is_branch(delay_slot) || is_syscall(delay_slot))
+                break;
+            instr_count = 2;
+        }
+
+        for (int i = 0; i < instr_count; i++)
+        {
+            uint32_t instr_pc = pc + (i * 4);
+            uint32_t instr_opcode = iop.read32(instr_pc);
+            size_t first = instrs.size();
+
+            translate_op(instr_opcode, instr_pc, instrs);
+
+            //Same wait state as IOP::read_instr
+            int cycles = 1;
+            if (instr_pc >= 0xA0000000 || !(iop.cache_control & (1 << 11)))
+                cycles += 4;
+            instrs[first].set_cycle_count(cycles);
+            cycle_count += cycles;
+
+            opcodes.push_back(instr_opcode);
+        }
+        pc += instr_count * 4;
+
+        if (instr_count == 2 || is_syscall(opcode))
+            break;
+
+        if (opcodes.size() >= MAX_BLOCK_SIZE || !(pc & 0xFFF))
+            break;
+    }
+
+    for (auto instr : instrs)
+        block.add_instr(instr);
+
+    block.set_cycle_count(cycle_count);
+
+    return block;
+}
+
+bool IOP_JitTranslator::is_branch(uint32_t opcode)
+{
+    switch (opcode >> 26)
+    {
+        case 0x00:
+            // JR and JALR
+            return (opcode & 0x3E) == 0x08;
+        case 0x01:
+        case 0x02:
+        case 0x03:
+        case 0x04:
+        case 0x05:
+        case 0x06:
+        case 0x07:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool IOP_JitTranslator::is_syscall(uint32_t opcode)
+{
+    return (opcode >> 26) == 0x00 && (opcode & 0x3F) == 0x0C;
+}
+
+void IOP_JitTranslator::translate_op(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const
+{
+    uint8_t op = opcode >> 26;
+    IR::Instruction instr;
+
+    if (!opcode)
+    {
+        instr.op = IR::Opcode::Nop;
+        instrs.push_back(instr);
+        return;
+    }
+
+    switch (op)
+    {
+        case 0x00:
+            // Special Operation
+            translate_op_special(opcode, PC, instrs);
+            break;
+        case 0x01:
+            // Regimm Operation
+            translate_op_regimm(opcode, PC, instrs);
+            break;
+        case 0x02:
+            // J
+        {
+            uint32_t dest = jump_offset_iop(opcode, PC);
+
+            // A jump to itself is the idle loop, which halts the IOP until the next interrupt
+            if (dest == PC)
+            {
+                IR::Instruction halt(IR::Opcode::Stop);
+                instrs.push_back(halt);
+            }
+            instr.op = IR::Opcode::Jump;
+            instr.set_jump_dest(dest);
+            instr.set_is_link(false);
+            instrs.push_back(instr);
+            break;
+        }
+        case 0x03:
+            // JAL
+            instr.op = IR::Opcode::Jump;
+            instr.set_jump_dest(jump_offset_iop(opcode, PC));
+            instr.set_return_addr(PC + 8);
+            instr.set_is_link(true);
+            instrs.push_back(instr);
+            break;
+        case 0x04:
+            // BEQ
+        {
+            uint8_t source = (opcode >> 21) & 0x1F;
+            uint8_t source2 = (opcode >> 16) & 0x1F;
+
+            if (source == source2)
+            {
+                // B
+                instr.op = IR::Opcode::Jump;
+                instr.set_jump_dest(branch_offset_iop(opcode, PC));
+                instr.set_is_link(false);
+                instrs.push_back(instr);
+                break;
+            }
+            instr.op = IR::Opcode::BranchEqual;
+            instr.set_source(source);
+            instr.set_source2(source2);
+            instr.set_jump_dest(branch_offset_iop(opcode, PC));
+            instr.set_jump_fail_dest(PC + 8);
+            instrs.push_back(instr);
+            break;
+        }
+        case 0x05:
+            // BNE
+            instr.op = IR::Opcode::BranchNotEqual;
+            instr.set_source((opcode >> 21) & 0x1F);
+            instr.set_source2((opcode >> 16) & 0x1F);
+            instr.set_jump_dest(branch_offset_iop(opcode, PC));
+            instr.set_jump_fail_dest(PC + 8);
+            instrs.push_back(instr);
+            break;
+        case 0x06:
+            // BLEZ
+            instr.op = IR::Opcode::BranchLessThanOrEqualZero;
+            instr.set_source((opcode >> 21) & 0x1F);
+            instr.set_jump_dest(branch_offset_iop(opcode, PC));
+            instr.set_jump_fail_dest(PC + 8);
+            instrs.push_back(instr);
+            break;
+        case 0x07:
+            // BGTZ
+            instr.op = IR::Opcode::BranchGreaterThanZero;
+            instr.set_source((opcode >> 21) & 0x1F);
+            instr.set_jump_dest(branch_offset_iop(opcode, PC));
+            instr.set_jump_fail_dest(PC + 8);
+            instrs.push_back(instr);
+            break;
+        case 0x08:
+            // ADDI
+        case 0x09:
+            // ADDIU
+        {
+            // The IOP interpreter doesn't raise overflow exceptions, so ADDI is the same as ADDIU
+            uint8_t dest = (opcode >> 16) & 0x1F;
+            uint8_t source = (opcode >> 21) & 0x1F;
+            int16_t immediate = opcode & 0xFFFF;
+            if (!dest)
+            {
+                instr.op = IR::Opcode::Nop;
+                instrs.push_back(instr);
+                break;
+            }
+            if (!source)
+            {
+                instr.op = IR::Opcode::LoadConst;
+                instr.set_dest(dest);
+                instr.set_source((uint32_t)(int32_t)immediate);
+                instrs.push_back(instr);
+                break;
+            }
+            instr.op = IR::Opcode::AddWordImm;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2((uint32_t)(int32_t)immediate);
+            instrs.push_back(instr);
+            break;
+        }
+        case 0x0A:
+            // SLTI
+        case 0x0B:
+            // SLTIU
+        {
+            uint8_t dest = (opcode >> 16) & 0x1F;
+            if (!dest)
+            {
+                instr.op = IR::Opcode::Nop;
+                instrs.push_back(instr);
+                break;
+            }
+            // SLTIU compares against the sign-extended immediate as well
+            if (op == 0x0A)
+                instr.op = IR::Opcode::SetOnLessThanImmediate;
+            else
+                instr.op = IR::Opcode::SetOnLessThanImmediateUnsigned;
+            instr.set_dest(dest);
+            instr.set_source((opcode >> 21) & 0x1F);
+            instr.set_source2((uint32_t)(int32_t)(int16_t)(opcode & 0xFFFF));
+            instrs.push_back(instr);
+            break;
+        }
+        case 0x0C:
+            // ANDI
+        case 0x0D:
+            // ORI
+        case 0x0E:
+            // XORI
+        {
+            uint8_t dest = (opcode >> 16) & 0x1F;
+            if (!dest)
+            {
+                instr.op = IR::Opcode::Nop;
+                instrs.push_back(instr);
+                break;
+            }
+            if (op == 0x0C)
+                instr.op = IR::Opcode::AndImm;
+            else if (op == 0x0D)
+                instr.op = IR::Opcode::OrImm;
+            else
+                instr.op = IR::Opcode::XorImm;
+            instr.set_dest(dest);
+            instr.set_source((opcode >> 21) & 0x1F);
+            instr.set_source2(opcode & 0xFFFF);
+            instrs.push_back(instr);
+            break;
+        }
+        case 0x0F:
+            // LUI
+        {
+            uint8_t dest = (opcode >> 16) & 0x1F;
+            if (!dest)
+            {
+                instr.op = IR::Opcode::Nop;
+                instrs.push_back(instr);
+                break;
+            }
+            instr.op = IR::Opcode::LoadConst;
+            instr.set_dest(dest);
+            instr.set_source((opcode & 0xFFFF) << 16);
+            instrs.push_back(instr);
+            break;
+        }
+        case 0x20:
+            // LB
+        case 0x21:
+            // LH
+        case 0x23:
+            // LW
+        case 0x24:
+            // LBU
+        case 0x25:
+            // LHU
+        {
+            // Loads into $zero are still performed, as reading some IOP registers has side effects
+            const static IR::Opcode load_ops[] =
+            {
+                IR::Opcode::LoadByte, IR::Opcode::LoadHalfword, IR::Opcode::Null, IR::Opcode::LoadWord,
+                IR::Opcode::LoadByteUnsigned, IR::Opcode::LoadHalfwordUnsigned
+            };
+            instr.op = load_ops[op - 0x20];
+            instr.set_dest((opcode >> 16) & 0x1F);
+            instr.set_source((opcode >> 21) & 0x1F);
+            instr.set_source2((uint32_t)(int32_t)(int16_t)(opcode & 0xFFFF));
+            instrs.push_back(instr);
+            break;
+        }
+        case 0x28:
+            // SB
+        case 0x29:
+            // SH
+        case 0x2B:
+            // SW
+        {
+            if (op == 0x28)
+                instr.op = IR::Opcode::StoreByte;
+            else if (op == 0x29)
+                instr.op = IR::Opcode::StoreHalfword;
+            else
+                instr.op = IR::Opcode::StoreWord;
+            instr.set_dest((opcode >> 21) & 0x1F);
+            instr.set_source((opcode >> 16) & 0x1F);
+            instr.set_source2((uint32_t)(int32_t)(int16_t)(opcode & 0xFFFF));
+            instrs.push_back(instr);
+            break;
+        }
+        default:
+            // COP0, LWL, LWR, SWL, SWR
+            fallback_interpreter(instr, opcode, PC);
+            instrs.push_back(instr);
+    }
+}
+
+void IOP_JitTranslator::translate_op_special(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const
+{
+    uint8_t op = opcode & 0x3F;
+    uint8_t dest = (opcode >> 11) & 0x1F;
+    IR::Instruction instr;
+
+    switch (op)
+    {
+        case 0x00:
+            // SLL
+        case 0x02:
+            // SRL
+        case 0x03:
+            // SRA
+            if (!dest)
+            {
+                instr.op = IR::Opcode::Nop;
+                break;
+            }
+            if (op == 0x00)
+                instr.op = IR::Opcode::ShiftLeftLogical;
+            else if (op == 0x02)
+                instr.op = IR::Opcode::ShiftRightLogical;
+            else
+                instr.op = IR::Opcode::ShiftRightArithmetic;
+            instr.set_dest(dest);
+            instr.set_source((opcode >> 16) & 0x1F);
+            instr.set_source2((opcode >> 6) & 0x1F);
+            break;
+        case 0x04:
+            // SLLV
+        case 0x06:
+            // SRLV
+        case 0x07:
+            // SRAV
+            if (!dest)
+            {
+                instr.op = IR::Opcode::Nop;
+                break;
+            }
+            if (op == 0x04)
+                instr.op = IR::Opcode::ShiftLeftLogicalVariable;
+            else if (op == 0x06)
+                instr.op = IR::Opcode::ShiftRightLogicalVariable;
+            else
+                instr.op = IR::Opcode::ShiftRightArithmeticVariable;
+            instr.set_dest(dest);
+            instr.set_source((opcode >> 16) & 0x1F);
+            instr.set_source2((opcode >> 21) & 0x1F);
+            break;
+        case 0x08:
+            // JR
+            instr.op = IR::Opcode::JumpIndirect;
+            instr.set_source((opcode >> 21) & 0x1F);
+            instr.set_is_link(false);
+            break;
+        case 0x09:
+            // JALR
+            instr.op = IR::Opcode::JumpIndirect;
+            instr.set_source((opcode >> 21) & 0x1F);
+            instr.set_dest(dest);
+            instr.set_return_addr(PC + 8);
+            instr.set_is_link(true);
+            break;
+        case 0x0C:
+            // SYSCALL
+            instr.op = IR::Opcode::SystemCall;
+            instr.set_source2(PC);
+            break;
+        case 0x20:
+            // ADD
+        case 0x21:
+            // ADDU
+        case 0x22:
+            // SUB
+        case 0x23:
+            // SUBU
+        case 0x24:
+            // AND
+        case 0x25:
+            // OR
+        case 0x26:
+            // XOR
+        case 0x27:
+            // NOR
+        case 0x2A:
+            // SLT
+        case 0x2B:
+            // SLTU
+        {
+            // As with ADDI, the interpreter doesn't trap on ADD/SUB overflow
+            const static IR::Opcode reg_ops[] =
+            {
+                IR::Opcode::AddWordReg, IR::Opcode::AddWordReg, IR::Opcode::SubWordReg, IR::Opcode::SubWordReg,
+                IR::Opcode::AndReg, IR::Opcode::OrReg, IR::Opcode::XorReg, IR::Opcode::NorReg,
+                IR::Opcode::Null, IR::Opcode::Null, IR::Opcode::SetOnLessThan, IR::Opcode::SetOnLessThanUnsigned
+            };
+            if (!dest)
+            {
+                instr.op = IR::Opcode::Nop;
+                break;
+            }
+            instr.op = reg_ops[op - 0x20];
+            instr.set_dest(dest);
+            instr.set_source((opcode >> 21) & 0x1F);
+            instr.set_source2((opcode >> 16) & 0x1F);
+            break;
+        }
+        default:
+            // MFHI, MTHI, MFLO, MTLO, MULT, MULTU, DIV, DIVU
+            fallback_interpreter(instr, opcode, PC);
+    }
+
+    instrs.push_back(instr);
+}
+
+void IOP_JitTranslator::translate_op_regimm(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const
+{
+    uint8_t op = (opcode >> 16) & 0x1F;
+    IR::Instruction instr;
+
+    switch (op)
+    {
+        case 0x00:
+            // BLTZ
+        case 0x10:
+            // BLTZAL
+            instr.op = IR::Opcode::BranchLessThanZero;
+            break;
+        case 0x01:
+            // BGEZ
+        case 0x11:
+            // BGEZAL
+            instr.op = IR::Opcode::BranchGreaterThanOrEqualZero;
+            break;
+        default:
+            fallback_interpreter(instr, opcode, PC);
+            instrs.push_back(instr);
+            return;
+    }
+
+    instr.set_source((opcode >> 21) & 0x1F);
+    instr.set_jump_dest(branch_offset_iop(opcode, PC));
+    instr.set_jump_fail_dest(PC + 8);
+
+    // The link register is written whether or not the branch is taken
+    instr.set_is_link(op & 0x10);
+    instr.set_return_addr(PC + 8);
+    instrs.push_back(instr);
+}
+
+void IOP_JitTranslator::fallback_interpreter(IR::Instruction& instr, uint32_t opcode, uint32_t PC) const
+{
+    instr.op = IR::Opcode::FallbackInterpreter;
+    instr.set_source(opcode);
+    instr.set_source2(PC);
+}
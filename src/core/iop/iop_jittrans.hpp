@@ -0,0 +1,36 @@
+#ifndef IOP_JITTRANS_HPP
+#define IOP_JITTRANS_HPP
+#include <cstdint>
+#include <vector>
+#include "../jitcommon/ir_block.hpp"
+
+class IOP;
+
+/**
+ * Translates a run of IOP instructions into IR for IOP_JIT64.
+ *
+ * A block ends after a branch's delay slot, after a syscall, at a page boundary, or after MAX_BLOCK_SIZE
+ * instructions, so no branch is ever pending when a block returns. A branch with a branch or syscall in its
+ * delay slot is left to the interpreter.
+ *
+ * Every IOP instruction produces at least one IR instruction, and the first one carries the instruction's
+ * cycle cost. Operations without an IR equivalent (mult/div, HI/LO, COP0, unaligned loads/stores)
+ * become FallbackInterpreter, with the opcode in source and its address in source2.
+ */
+class IOP_JitTranslator
+{
+    private:
+        void translate_op(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const;
+        void translate_op_special(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const;
+        void translate_op_regimm(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const;
+        void fallback_interpreter(IR::Instruction& instr, uint32_t opcode, uint32_t PC) const;
+
+        static bool is_branch(uint32_t opcode);
+        static bool is_syscall(uint32_t opcode);
+    public:
+        constexpr static int MAX_BLOCK_SIZE = 128;
+
+        IR::Block translate(IOP& iop, std::vector<uint32_t>& opcodes);
+};
+
+#endif // IOP_JITTRANS_HPP
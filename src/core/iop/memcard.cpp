@@ -1,3 +1,11 @@
+#ifdef _WIN32
+#include <Windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include "../errors.hpp"
@@ -19,10 +27,13 @@ Memcard::Memcard()
 {
     mem = nullptr;
     file_opened = false;
+    is_dirty = false;
 }
 
 Memcard::~Memcard()
 {
+    save_if_dirty();
+    stop_writer();
     delete[] mem;
 }
 
@@ -38,6 +49,10 @@ void Memcard::reset()
 
 bool Memcard::open(std::string file_name)
 {
+    //Finish saving the previous card before replacing it
+    save_if_dirty();
+    stop_writer();
+
     std::ifstream file(file_name, std::ios::binary);
 
     if (mem)
@@ -62,6 +77,10 @@ bool Memcard::open(std::string file_name)
         file.close();
 
         this->file_name = file_name;
+
+        dirty_pages.assign(specs.page_count, 0);
+        writer_image.assign(mem, mem + memcard_size);
+        start_writer();
     }
     else
     {
@@ -89,15 +108,122 @@ void Memcard::start_transfer()
     memset(response_buffer, 0, sizeof(response_buffer));
 }
 
+uint32_t Memcard::get_raw_page_size()
+{
+    return specs.page_size + 16;
+}
+
+void Memcard::mark_dirty(uint32_t addr, uint32_t size)
+{
+    uint32_t page_size = get_raw_page_size();
+    uint32_t last_page = (addr + size - 1) / page_size;
+    for (uint32_t page = addr / page_size; page <= last_page && page < dirty_pages.size(); page++)
+        dirty_pages[page] = 1;
+    is_dirty = true;
+}
+
 void Memcard::save_if_dirty()
 {
-    if (is_dirty && file_opened)
+    if (!is_dirty || !file_opened)
+        return;
+
+    uint32_t page_size = get_raw_page_size();
     {
-        std::ofstream file(file_name, std::ios::binary);
-        file.write((char*)mem, 0x840000);
-        file.close();
-        is_dirty = false;
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        for (uint32_t page = 0; page < specs.page_count; page++)
+        {
+            if (!dirty_pages[page])
+                continue;
+
+            uint8_t* data = &mem[page * page_size];
+            staged_pages.push_back(page);
+            staged_data.insert(staged_data.end(), data, data + page_size);
+            dirty_pages[page] = 0;
+        }
+    }
+    writer_notifier.notify_one();
+    is_dirty = false;
+}
+
+void Memcard::start_writer()
+{
+    writer_quit = false;
+    writer_thread = std::thread(&Memcard::writer_loop, this);
+}
+
+//Anything already staged is written out before the thread exits
+void Memcard::stop_writer()
+{
+    if (!writer_thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        writer_quit = true;
+    }
+    writer_notifier.notify_one();
+    writer_thread.join();
+}
+
+void Memcard::writer_loop()
+{
+    uint32_t page_size = get_raw_page_size();
+    std::vector<uint32_t> pages;
+    std::vector<uint8_t> data;
+
+    std::unique_lock<std::mutex> lock(writer_mutex);
+    while (true)
+    {
+        writer_notifier.wait(lock, [this] { return staged_pages.size() || writer_quit; });
+        if (!staged_pages.size())
+            return;
+
+        pages.swap(staged_pages);
+        data.swap(staged_data);
+        lock.unlock();
+
+        //Pages staged by several saves are applied in order, so the latest copy of each wins
+        for (size_t i = 0; i < pages.size(); i++)
+            memcpy(&writer_image[pages[i] * page_size], &data[i * page_size], page_size);
+        write_file(writer_image);
+
+        pages.clear();
+        data.clear();
+        lock.lock();
+    }
+}
+
+bool Memcard::write_file(const std::vector<uint8_t>& image)
+{
+    std::string temp_name = file_name + ".tmp";
+    FILE* file = fopen(temp_name.c_str(), "wb");
+    if (!file)
+    {
+        Errors::print_warning("[Memcard] Failed to open %s for writing\n", temp_name.c_str());
+        return false;
+    }
+
+    //The data must be on disk before the rename, otherwise a crash could still leave an empty card
+    bool written = fwrite(image.data(), 1, image.size(), file) == image.size() && !fflush(file);
+#ifdef _WIN32
+    written = written && !_commit(_fileno(file));
+#else
+    written = written && !fsync(fileno(file));
+#endif
+    fclose(file);
+
+#ifdef _WIN32
+    bool replaced = written && MoveFileExA(temp_name.c_str(), file_name.c_str(),
+                                           MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    bool replaced = written && !rename(temp_name.c_str(), file_name.c_str());
+#endif
+    if (!replaced)
+    {
+        Errors::print_warning("[Memcard] Failed to save %s\n", file_name.c_str());
+        remove(temp_name.c_str());
     }
+    return replaced;
 }
 
 uint8_t Memcard::write_serial(uint8_t data)
@@ -194,7 +320,7 @@ uint8_t Memcard::write_serial(uint8_t data)
                 cmd_length = 2;
                 response_end();
 
-                is_dirty = true;
+                mark_dirty(mem_addr, 528 * 16);
 
                 for (unsigned int i = 0; i < 528 * 16; i++)
                     mem[mem_addr + i] = 0xFF;
@@ -375,7 +501,7 @@ void Memcard::write_mem(uint8_t data)
     }
     else if (cmd_params - 1 < mem_write_size)
     {
-        is_dirty = true;
+        mark_dirty(mem_addr, 1);
         mem[mem_addr] = data;
         mem_addr++;
     }
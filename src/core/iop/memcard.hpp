@@ -1,7 +1,11 @@
 #ifndef MEMCARD_HPP
 #define MEMCARD_HPP
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 struct MemcardSpecs
 {
@@ -25,6 +29,29 @@ class Memcard
         bool file_opened;
         bool is_dirty;
 
+        /**
+         * Saving happens on a writer thread so that autosaves don't stall the emulator.
+         * Writes only mark their pages dirty. At save time the emulator thread copies those pages into the staging
+         * buffer, and the writer applies them to its own copy of the card. It then writes that copy to a temporary
+         * file and renames it over the original, so a crash mid-save never leaves a half-written card behind.
+         */
+        std::vector<uint8_t> dirty_pages;
+        std::vector<uint32_t> staged_pages;
+        std::vector<uint8_t> staged_data;
+        std::vector<uint8_t> writer_image;
+
+        std::thread writer_thread;
+        std::mutex writer_mutex;
+        std::condition_variable writer_notifier;
+        bool writer_quit;
+
+        uint32_t get_raw_page_size();
+        void mark_dirty(uint32_t addr, uint32_t size);
+        void start_writer();
+        void stop_writer();
+        void writer_loop();
+        bool write_file(const std::vector<uint8_t>& image);
+
         uint8_t response_buffer[1024];
         unsigned int response_read_pos;
         unsigned int response_write_pos;
@@ -1,12 +1,79 @@
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
 #include "emitter64.hpp"
 
 #define DISP32 0b101
 
+struct HostFeatures
+{
+    bool avx, avx2;
+
+    HostFeatures();
+};
+
+HostFeatures::HostFeatures() : avx(false), avx2(false)
+{
+    uint32_t regs[4] = {};
+#ifdef _MSC_VER
+    __cpuid((int*)regs, 0);
+    uint32_t max_leaf = regs[0];
+    __cpuid((int*)regs, 1);
+#else
+    uint32_t max_leaf = __get_cpuid_max(0, nullptr);
+    __cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+
+    //AVX also needs the OS to save the YMM state, which XGETBV reports
+    bool osxsave = regs[2] & (1 << 27);
+    if (!osxsave || !(regs[2] & (1 << 28)))
+        return;
+
+#ifdef _MSC_VER
+    uint64_t xcr0 = _xgetbv(0);
+#else
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    uint64_t xcr0 = ((uint64_t)xcr0_hi << 32) | xcr0_lo;
+#endif
+    if ((xcr0 & 0x6) != 0x6)
+        return;
+    avx = true;
+
+    if (max_leaf >= 7)
+    {
+#ifdef _MSC_VER
+        __cpuidex((int*)regs, 7, 0);
+#else
+        __cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        avx2 = regs[1] & (1 << 5);
+    }
+}
+
+static const HostFeatures& host_features()
+{
+    static HostFeatures features;
+    return features;
+}
+
 Emitter64::Emitter64(JitBlock* cache) : block(cache)
 {
 
 }
 
+bool Emitter64::host_has_avx()
+{
+    return host_features().avx;
+}
+
+bool Emitter64::host_has_avx2()
+{
+    return host_features().avx2;
+}
+
 void Emitter64::rex_r(REG_64 reg)
 {
     if (reg & 0x8)
@@ -57,38 +124,48 @@ void Emitter64::rexw_r_rm(REG_64 reg, REG_64 rm)
     block->write<uint8_t>(rex);
 }
 
-void Emitter64::vex(REG_64 source, REG_64 source2, REG_64 dest, bool packed)
+//map: 1 = 0F, 2 = 0F 38, 3 = 0F 3A. prefix: 0 = none, 1 = 66, 2 = F3, 3 = F2
+//Only VEX.128 is emitted, which zeroes the upper YMM lanes and so never mixes badly with legacy SSE
+void Emitter64::vex(uint8_t map, uint8_t prefix, bool wide, REG_64 reg, REG_64 vvvv, REG_64 rm)
 {
-    if (source2 & 0x8)
-        vex3(source, source2, dest, packed);
+    uint8_t last = ((~vvvv & 0xF) << 3) | (prefix & 0x3);
+    if (wide)
+        last |= 0x80;
+
+    uint8_t inv_r = (reg & 0x8) ? 0 : 0x80;
+    if (map == 1 && !wide && !(rm & 0x8))
+    {
+        block->write<uint8_t>(0xC5);
+        block->write<uint8_t>(inv_r | last);
+    }
     else
-        vex2(source, dest, packed);
+    {
+        block->write<uint8_t>(0xC4);
+        block->write<uint8_t>(inv_r | 0x40 | ((rm & 0x8) ? 0 : 0x20) | map);
+        block->write<uint8_t>(last);
+    }
 }
 
-void Emitter64::vex2(REG_64 source, REG_64 dest, bool packed)
+void Emitter64::vex_op(uint8_t map, uint8_t prefix, uint8_t opcode, REG_64 source, REG_64 source2, REG_64 dest)
 {
-    block->write<uint8_t>(0xC5);
-    uint8_t result = 0xF8;
-    if (!packed)
-        result |= 0x2;
-    if (dest & 0x8)
-        result -= 0x80;
-    result += -(source << 3);
-    block->write<uint8_t>(result);
+    vex(map, prefix, false, dest, source, source2);
+    block->write<uint8_t>(opcode);
+    modrm(0b11, dest, source2);
 }
 
-void Emitter64::vex3(REG_64 source, REG_64 source2, REG_64 dest, bool packed)
+void Emitter64::vex_op_mem(uint8_t map, uint8_t prefix, uint8_t opcode, REG_64 source, REG_64 indir_source2,
+                           REG_64 dest, uint32_t offset)
 {
-    block->write<uint8_t>(0xC4);
-    uint8_t result = 0xC1;
-    if (dest & 0x8)
-        result -= 0x80;
-    block->write<uint8_t>(result);
-    result = 0x78;
-    if (!packed)
-        result |= 0x2;
-    result += -(source << 3);
-    block->write<uint8_t>(result);
+    vex(map, prefix, false, dest, source, indir_source2);
+    block->write<uint8_t>(opcode);
+
+    //RBP/R13 have no displacement-free form
+    bool disp = offset || (indir_source2 & 7) == 5;
+    modrm(disp ? 0b10 : 0, dest, indir_source2);
+    if ((indir_source2 & 7) == 4)
+        block->write<uint8_t>(0x24);
+    if (disp)
+        block->write<uint32_t>(offset);
 }
 
 void Emitter64::modrm(uint8_t mode, uint8_t reg, uint8_t rm)
@@ -998,6 +1075,9 @@ void Emitter64::MOV8_REG_IMM(uint8_t imm, REG_64 dest)
 
 void Emitter64::MOV8_TO_MEM(REG_64 source, REG_64 indir_dest, uint32_t offset)
 {
+    //Without a REX prefix, sources 4-7 would encode AH/CH/DH/BH instead of SPL/BPL/SIL/DIL
+    if (source >= 4 && source < 8 && !(indir_dest & 0x8))
+        block->write<uint8_t>(0x40);
     rex_r_rm(source, indir_dest);
     block->write<uint8_t>(0x88);
 
@@ -1475,6 +1555,18 @@ void Emitter64::set_jump_dest(uint8_t *jump)
     block->set_code_pos(jump_dest_addr);
 }
 
+//For jumps back to code that was already emitted, such as loops
+void Emitter64::set_jump_dest(uint8_t *jump, uint8_t *dest)
+{
+    uint8_t* code_pos = block->get_code_pos();
+
+    block->set_code_pos(jump);
+    int jump_offset = dest - jump - 4;
+    block->write<uint32_t>(jump_offset);
+
+    block->set_code_pos(code_pos);
+}
+
 void Emitter64::PUSH(REG_64 reg)
 {
     rex_rm(reg);
@@ -2586,23 +2678,157 @@ void Emitter64::CVTTPS2DQ(REG_64 xmm_source, REG_64 xmm_dest)
     modrm(0b11, xmm_dest, xmm_source);
 }
 
+void Emitter64::VADDPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 0, 0x58, xmm_source, xmm_source2, xmm_dest);
+}
+
 void Emitter64::VADDSS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
 {
-    vex(xmm_source, xmm_source2, xmm_dest, false);
-    block->write<uint8_t>(0x58);
-    modrm(0b11, 0, xmm_source2);
+    vex_op(1, 2, 0x58, xmm_source, xmm_source2, xmm_dest);
 }
 
-void Emitter64::VMINPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+void Emitter64::VANDPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
 {
-    vex(xmm_source, xmm_source2, xmm_dest, true);
-    block->write<uint8_t>(0x5D);
-    modrm(0b11, 0, xmm_source2);
+    vex_op(1, 0, 0x54, xmm_source, xmm_source2, xmm_dest);
+}
+
+//Lanes set in imm come from source2, the rest from source
+void Emitter64::VBLENDPS(uint8_t imm, REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(3, 1, 0x0C, xmm_source, xmm_source2, xmm_dest);
+    block->write<uint8_t>(imm);
+}
+
+//Lanes with the sign bit set in mask come from source2, the rest from source
+void Emitter64::VBLENDVPS(REG_64 xmm_mask, REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(3, 1, 0x4A, xmm_source, xmm_source2, xmm_dest);
+    block->write<uint8_t>(xmm_mask << 4);
+}
+
+void Emitter64::VDIVPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 0, 0x5E, xmm_source, xmm_source2, xmm_dest);
 }
 
 void Emitter64::VMAXPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
 {
-    vex(xmm_source, xmm_source2, xmm_dest, true);
-    block->write<uint8_t>(0x5F);
-    modrm(0b11, 0, xmm_source2);
+    vex_op(1, 0, 0x5F, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VMINPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 0, 0x5D, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VMULPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 0, 0x59, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPERMILPS(uint8_t imm, REG_64 xmm_source, REG_64 xmm_dest)
+{
+    //vvvv is unused and must be all ones, which is what XMM0 encodes to
+    vex_op(3, 1, 0x04, REG_64::XMM0, xmm_source, xmm_dest);
+    block->write<uint8_t>(imm);
+}
+
+void Emitter64::VSHUFPS(uint8_t imm, REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 0, 0xC6, xmm_source, xmm_source2, xmm_dest);
+    block->write<uint8_t>(imm);
+}
+
+void Emitter64::VSUBPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 0, 0x5C, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VXORPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 0, 0x57, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPADDD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 1, 0xFE, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPAND(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 1, 0xDB, xmm_source, xmm_source2, xmm_dest);
+}
+
+//dest = ~source & source2
+void Emitter64::VPANDN(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 1, 0xDF, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPMAXSD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(2, 1, 0x3D, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPMINSD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(2, 1, 0x39, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPMINSD_FROM_MEM(REG_64 xmm_source, REG_64 indir_source2, REG_64 xmm_dest, uint32_t offset)
+{
+    vex_op_mem(2, 1, 0x39, xmm_source, indir_source2, xmm_dest, offset);
+}
+
+void Emitter64::VPMINUD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(2, 1, 0x3B, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPMINUD_FROM_MEM(REG_64 xmm_source, REG_64 indir_source2, REG_64 xmm_dest, uint32_t offset)
+{
+    vex_op_mem(2, 1, 0x3B, xmm_source, indir_source2, xmm_dest, offset);
+}
+
+void Emitter64::VPOR(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 1, 0xEB, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPSUBD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 1, 0xFA, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPXOR(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(1, 1, 0xEF, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPBLENDD(uint8_t imm, REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(3, 1, 0x02, xmm_source, xmm_source2, xmm_dest);
+    block->write<uint8_t>(imm);
+}
+
+void Emitter64::VPBROADCASTD(REG_64 xmm_source, REG_64 xmm_dest)
+{
+    vex_op(2, 1, 0x58, REG_64::XMM0, xmm_source, xmm_dest);
+}
+
+//Per-lane shifts, source shifted by the counts in source2
+void Emitter64::VPSLLVD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(2, 1, 0x47, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPSRAVD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(2, 1, 0x46, xmm_source, xmm_source2, xmm_dest);
+}
+
+void Emitter64::VPSRLVD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex_op(2, 1, 0x45, xmm_source, xmm_source2, xmm_dest);
 }
@@ -61,14 +61,19 @@ class Emitter64
         void rexw_rm(REG_64 rm);
         void rexw_r_rm(REG_64 reg, REG_64 rm);
         void modrm(uint8_t mode, uint8_t reg, uint8_t rm);
-        void vex(REG_64 source, REG_64 source2, REG_64 dest, bool packed);
-        void vex2(REG_64 source, REG_64 dest, bool packed);
-        void vex3(REG_64 source, REG_64 source2, REG_64 dest, bool packed);
+        void vex(uint8_t map, uint8_t prefix, bool wide, REG_64 reg, REG_64 vvvv, REG_64 rm);
+        void vex_op(uint8_t map, uint8_t prefix, uint8_t opcode, REG_64 source, REG_64 source2, REG_64 dest);
+        void vex_op_mem(uint8_t map, uint8_t prefix, uint8_t opcode, REG_64 source, REG_64 indir_source2,
+                        REG_64 dest, uint32_t offset);
 
         int get_rip_offset(uint64_t addr);
     public:
         Emitter64(JitBlock* cache);
 
+        //Checked once through CPUID/XGETBV. The V* emitters below must only be used when these return true
+        static bool host_has_avx();
+        static bool host_has_avx2();
+
         void load_addr(uint64_t addr, REG_64 dest);
 
         void ADD16_REG(REG_64 source, REG_64 dest);
@@ -232,6 +237,7 @@ class Emitter64
         uint8_t* JCC_NEAR_DEFERRED(ConditionCode cc);
 
         void set_jump_dest(uint8_t* jump);
+        void set_jump_dest(uint8_t* jump, uint8_t* dest);
 
         void PUSH(REG_64 reg);
         void POP(REG_64 reg);
@@ -355,9 +361,39 @@ class Emitter64
         //Convert truncated floats into 32-bit signed integers
         void CVTTPS2DQ(REG_64 xmm_source, REG_64 xmm_dest);
 
+        //VEX encoded, 128-bit only. dest = source OP source2, and neither source is modified
+        void VADDPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
         void VADDSS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
-        void VMINPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VANDPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VBLENDPS(uint8_t imm, REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VBLENDVPS(REG_64 xmm_mask, REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VDIVPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
         void VMAXPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VMINPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VMULPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPERMILPS(uint8_t imm, REG_64 xmm_source, REG_64 xmm_dest);
+        void VSHUFPS(uint8_t imm, REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VSUBPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VXORPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+
+        void VPADDD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPAND(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPANDN(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPMAXSD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPMINSD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPMINSD_FROM_MEM(REG_64 xmm_source, REG_64 indir_source2, REG_64 xmm_dest, uint32_t offset = 0);
+        void VPMINUD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPMINUD_FROM_MEM(REG_64 xmm_source, REG_64 indir_source2, REG_64 xmm_dest, uint32_t offset = 0);
+        void VPOR(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPSUBD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPXOR(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+
+        //AVX2
+        void VPBLENDD(uint8_t imm, REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPBROADCASTD(REG_64 xmm_source, REG_64 xmm_dest);
+        void VPSLLVD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPSRAVD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VPSRLVD(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
 };
 
 #endif // EMITTER64_HPP
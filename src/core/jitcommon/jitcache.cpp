@@ -3,6 +3,11 @@
 #include <algorithm>
 #else
 #include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#define JIT_DUAL_MAPPING
 #endif
 
 #include <limits>
@@ -108,23 +113,54 @@ void JitBlock::print_literal_pool()
 ///////////////////
 
 
-void* JitHeap::rwx_alloc(std::size_t size)
+void* JitHeap::exec_alloc(std::size_t size)
 {
     void* result;
+    exec_offset = 0;
 #ifdef _WIN32
     result = (void *)VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
 #else
+#ifdef JIT_DUAL_MAPPING
+    int fd = memfd_create("jit_heap", MFD_CLOEXEC);
+    if(fd >= 0)
+    {
+        void* rw = MAP_FAILED;
+        void* rx = MAP_FAILED;
+        if(ftruncate(fd, size) == 0)
+        {
+            rw = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            rx = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+        }
+        // the mappings keep the memory alive
+        close(fd);
+
+        if(rw != MAP_FAILED && rx != MAP_FAILED)
+        {
+            exec_offset = (uint8_t*)rx - (uint8_t*)rw;
+            return rw;
+        }
+        if(rw != MAP_FAILED)
+            munmap(rw, size);
+        if(rx != MAP_FAILED)
+            munmap(rx, size);
+    }
+    Errors::print_warning("[JIT Heap] Unable to map a separate executable view, falling back to RWX memory\n");
+#endif
     result = (void*)mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(result == MAP_FAILED)
+        result = nullptr;
 #endif
     return result;
 }
 
-void JitHeap::rwx_free(void* mem, std::size_t size)
+void JitHeap::exec_free(void* mem, std::size_t size)
 {
 #ifdef _WIN32
     VirtualFree(mem, 0, MEM_RELEASE);
 #else
     munmap(mem, size);
+    if(exec_offset)
+        munmap(to_exec(mem), size);
 #endif
 }
 
@@ -476,7 +512,7 @@ EEJitHeap::EEJitHeap()
     _heap_size = EE_JIT_HEAP_SIZE;
 
     // allocate heap
-    _heap = rwx_alloc(_heap_size);
+    _heap = exec_alloc(_heap_size);
 
     if(!_heap)
         Errors::die("[EE JIT Heap] Unable to allocate heap");
@@ -487,11 +523,13 @@ EEJitHeap::EEJitHeap()
     // lookup cache setup
     ee_page_lookup_cache = nullptr;
     ee_page_lookup_idx = -1;
+
+    return_stack.clear();
 }
 
 EEJitHeap::~EEJitHeap()
 {
-    rwx_free(_heap, _heap_size);
+    exec_free(_heap, _heap_size);
 }
 
 EEPageRecord* EEJitHeap::lookup_ee_page(uint32_t page)
@@ -524,11 +562,25 @@ void EEJitHeap::invalidate_ee_page(uint32_t page)
     if(kv != ee_page_record_map.end()) {
         // kill all PCs in the page.
         if(kv->second.block_array) {
+            EEJitBlockRecord* block_array = kv->second.block_array;
             for(uint32_t idx = 0; idx < 1024; idx++) {
-                if(kv->second.block_array[idx].literals_start) {
-                    jit_free(kv->second.block_array[idx].literals_start);
+                if(block_array[idx].literals_start) {
+                    erase_fastmem_sites(block_array[idx]);
+                    erase_block_links(block_array[idx]);
                 }
             }
+
+            // blocks elsewhere must stop jumping into the page before its code goes away
+            for(uint32_t idx = 0; idx < 1024; idx++) {
+                if(block_array[idx].literals_start) {
+                    uint32_t PC = block_array[idx].block_data.pc;
+                    unlink_block(PC);
+                    if(lookup_cache[(PC >> 2) & 0x7FFF] == &block_array[idx])
+                        lookup_cache[(PC >> 2) & 0x7FFF] = nullptr;
+                    jit_free(to_writable(block_array[idx].literals_start));
+                }
+            }
+            return_stack.clear();
         }
         // erase PC array
         delete[] kv->second.block_array;
@@ -573,16 +625,24 @@ void EEJitHeap::flush_all_blocks()
 {
     for(auto& page : ee_page_record_map)
     {
+        // find_block leaves empty records for pages without code
+        if(!page.second.block_array)
+            continue;
+
         for(uint32_t idx = 0; idx < 1024; idx++)
         {
             if(page.second.block_array[idx].literals_start) {
-                jit_free(page.second.block_array[idx].literals_start);
+                jit_free(to_writable(page.second.block_array[idx].literals_start));
             }
         }
         delete[] page.second.block_array;
     }
     memset(lookup_cache, 0, sizeof(lookup_cache));
     ee_page_record_map.clear();
+    fastmem_sites.clear();
+    link_sites.clear();
+    incoming_links.clear();
+    return_stack.clear();
     ee_page_lookup_cache = nullptr;
     ee_page_lookup_idx = -1;
 }
@@ -590,7 +650,8 @@ void EEJitHeap::flush_all_blocks()
 /*!
  * Add a completed block to the JIT heap
  */
-EEJitBlockRecord* EEJitHeap::insert_block(uint32_t PC, JitBlock *block)
+EEJitBlockRecord* EEJitHeap::insert_block(uint32_t PC, JitBlock *block, const std::vector<EEFastmemSite>& sites,
+                                          const std::vector<EEBlockLink>& links)
 {
     // compute block size
     uint8_t *code_start = block->get_code_start();
@@ -621,11 +682,14 @@ EEJitBlockRecord* EEJitHeap::insert_block(uint32_t PC, JitBlock *block)
     EEJitBlockRecord record;
     std::size_t literal_size = code_start - literals_start;
     std::size_t code_size = code_end - code_start;
-    record.literals_start = (uint8_t*)dest;
-    record.code_start = (uint8_t*)dest + literal_size;
-    record.code_end = (uint8_t*)dest + literal_size + code_size;
+    record.literals_start = to_exec((uint8_t*)dest);
+    record.code_start = to_exec((uint8_t*)dest + literal_size);
+    record.code_end = to_exec((uint8_t*)dest + literal_size + code_size);
     record.block_data.pc = PC;
 
+    for (const EEFastmemSite& site : sites)
+        fastmem_sites[(uint8_t*)record.code_start + site.fault] = site;
+
     uint32_t page = PC / 4096;
     EEPageRecord* page_record = lookup_ee_page(page);
 
@@ -639,5 +703,298 @@ EEJitBlockRecord* EEJitHeap::insert_block(uint32_t PC, JitBlock *block)
     uint64_t idx = (PC - 4096*page)/4;
     assert(idx < 1024);
     page_record->block_array[idx] = record;
+
+    // hook up the exits of the new block to blocks that already exist...
+    uint8_t* new_code = (uint8_t*)record.code_start;
+    for (const EEBlockLink& link : links)
+    {
+        uint8_t* site = new_code + link.offset;
+        LinkSite link_site;
+        link_site.target = link.target;
+        link_site.fallback = link.absolute ? nullptr : new_code + link.fallback;
+        link_site.absolute = link.absolute;
+
+        link_sites[site] = link_site;
+        incoming_links.insert({link.target, site});
+
+        EEJitBlockRecord* target = find_block(link.target);
+        if (target)
+            write_link(site, link_site, target->code_start);
+    }
+
+    // ...and the exits of existing blocks to the new one
+    auto range = incoming_links.equal_range(PC);
+    for (auto it = range.first; it != range.second; it++)
+        write_link(it->second, link_sites[it->second], new_code);
+
     return &page_record->block_array[idx];
 }
+
+/*!
+ * Point a link at dest, or back at its fallback if dest is nullptr
+ */
+void EEJitHeap::write_link(uint8_t* site, const LinkSite& link, void* dest)
+{
+    if (link.absolute)
+    {
+        uint64_t addr = (uint64_t)dest;
+        std::memcpy(to_writable(site), &addr, sizeof(addr));
+    }
+    else
+    {
+        uint8_t* jump_dest = dest ? (uint8_t*)dest : link.fallback;
+        int32_t offset = (int32_t)(jump_dest - (site + 4));
+        std::memcpy(to_writable(site), &offset, sizeof(offset));
+    }
+}
+
+/*!
+ * Forget the links out of a block that is being freed
+ */
+void EEJitHeap::erase_block_links(const EEJitBlockRecord& record)
+{
+    auto first = link_sites.lower_bound((uint8_t*)record.code_start);
+    auto last = link_sites.lower_bound((uint8_t*)record.code_end);
+
+    for (auto it = first; it != last; it++)
+    {
+        auto range = incoming_links.equal_range(it->second.target);
+        for (auto in = range.first; in != range.second; in++)
+        {
+            if (in->second == it->first)
+            {
+                incoming_links.erase(in);
+                break;
+            }
+        }
+    }
+    link_sites.erase(first, last);
+}
+
+/*!
+ * Restore the fallbacks of every link into the block at PC
+ */
+void EEJitHeap::unlink_block(uint32_t PC)
+{
+    auto range = incoming_links.equal_range(PC);
+    for (auto it = range.first; it != range.second; it++)
+        write_link(it->second, link_sites[it->second], nullptr);
+}
+
+/*!
+ * Forget the fastmem sites of a block that is being freed
+ */
+void EEJitHeap::erase_fastmem_sites(const EEJitBlockRecord& record)
+{
+    auto first = fastmem_sites.lower_bound((uint8_t*)record.code_start);
+    auto last = fastmem_sites.lower_bound((uint8_t*)record.code_end);
+    fastmem_sites.erase(first, last);
+}
+
+/*!
+ * Redirect a faulting fastmem access to its slow path.
+ * Returns where execution should resume, or nullptr if fault_pc isn't a fastmem access.
+ */
+uint8_t* EEJitHeap::patch_fastmem_site(uint8_t* fault_pc)
+{
+    auto kv = fastmem_sites.find(fault_pc);
+    if(kv == fastmem_sites.end())
+        return nullptr;
+
+    uint8_t* code_start = fault_pc - kv->second.fault;
+    uint8_t* patch = code_start + kv->second.patch;
+    uint8_t* slow_path = code_start + kv->second.slow_path;
+
+    // JMP rel32. The site begins with a 10 byte MOV, so this never spills into the access itself.
+    int32_t offset = (int32_t)(slow_path - (patch + 5));
+    uint8_t* patch_rw = to_writable(patch);
+    patch_rw[0] = 0xE9;
+    std::memcpy(patch_rw + 1, &offset, sizeof(offset));
+
+    fastmem_sites.erase(kv);
+    return slow_path;
+}
+
+
+//////////////////
+// VU JIT Heap
+//////////////////
+
+
+VUJitHeap::VUJitHeap()
+{
+    heap = (uint8_t*)exec_alloc(VU_JIT_HEAP_SIZE);
+
+    if(!heap)
+        Errors::die("[VU JIT Heap] Unable to allocate heap");
+
+    flush_all_blocks();
+}
+
+VUJitHeap::~VUJitHeap()
+{
+    exec_free(heap, VU_JIT_HEAP_SIZE);
+}
+
+VUJitHeap::Program& VUJitHeap::get_program(uint32_t crc)
+{
+    auto kv = programs.find(crc);
+    if(kv != programs.end())
+        return kv->second;
+
+    Program& program = programs[crc];
+    lru.push_front(crc);
+    program.lru_pos = lru.begin();
+    return program;
+}
+
+/*!
+ * Find count free chunks in a row. Returns the first one, or -1 if there's no room.
+ */
+int VUJitHeap::find_free_chunks(int count)
+{
+    int run = 0;
+    for(int i = 0; i < CHUNK_COUNT; i++)
+    {
+        run = chunk_used[i] ? 0 : run + 1;
+        if(run == count)
+            return i - count + 1;
+    }
+    return -1;
+}
+
+/*!
+ * Throw out every block of the least recently used program other than the current one.
+ */
+bool VUJitHeap::evict_lru_program()
+{
+    for(auto it = lru.rbegin(); it != lru.rend(); it++)
+    {
+        uint32_t crc = *it;
+        if(crc == current_crc)
+            continue;
+
+        Program& program = programs[crc];
+        if(program.chunks.empty())
+            continue;
+
+        free_program(program);
+        lru.erase(program.lru_pos);
+        programs.erase(crc);
+        return true;
+    }
+    return false;
+}
+
+void VUJitHeap::free_program(Program& program)
+{
+    for(auto& run : program.chunks)
+    {
+        for(int i = 0; i < run.second; i++)
+            chunk_used[run.first + i] = false;
+    }
+    program.chunks.clear();
+    program.block_map.clear();
+    program.alloc_cur = nullptr;
+    program.alloc_end = nullptr;
+}
+
+void* VUJitHeap::jit_alloc(Program& program, std::size_t size)
+{
+    size = aligned_size(size);
+
+    if(program.alloc_cur && program.alloc_cur + size <= program.alloc_end)
+    {
+        void* result = program.alloc_cur;
+        program.alloc_cur += size;
+        return result;
+    }
+
+    int count = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if(count > CHUNK_COUNT)
+        return nullptr;
+
+    int first = find_free_chunks(count);
+    while(first < 0 && evict_lru_program())
+        first = find_free_chunks(count);
+
+    // the current program has the whole heap to itself and still doesn't fit, so start it over
+    if(first < 0 && &program != &resident)
+    {
+        fprintf(stderr, "[VU JIT Heap] Heap is full. Flushing program %08X\n", current_crc);
+        free_program(program);
+        first = find_free_chunks(count);
+    }
+
+    if(first < 0)
+        return nullptr;
+
+    for(int i = 0; i < count; i++)
+        chunk_used[first + i] = true;
+    program.chunks.push_back({first, count});
+
+    // whatever was left of the old chunk is abandoned
+    program.alloc_cur = heap + first * CHUNK_SIZE + size;
+    program.alloc_end = heap + (first + count) * CHUNK_SIZE;
+    return heap + first * CHUNK_SIZE;
+}
+
+VUJitBlockRecord* VUJitHeap::insert(Program& program, const VUBlockState& state, JitBlock* block)
+{
+    uint8_t *code_start = block->get_code_start();
+    uint8_t *code_end = block->get_code_pos();
+    uint8_t *literals_start = block->get_literals_start();
+    std::size_t block_size = code_end - literals_start;
+    if(block_size <= 0) Errors::die("block size invalid");
+
+    void* dest = jit_alloc(program, block_size);
+    if(!dest)
+    {
+        Errors::die("Tried to insert a Jit block of size %ld bytes, but the entire JIT heap is only %ld bytes!",
+            aligned_size(block_size), VU_JIT_HEAP_SIZE);
+    }
+
+    std::memcpy(dest, literals_start, block_size);
+
+    VUJitBlockRecord record;
+    std::size_t literal_size = code_start - literals_start;
+    std::size_t code_size = code_end - code_start;
+    record.literals_start = to_exec((uint8_t*)dest);
+    record.code_start = to_exec((uint8_t*)dest + literal_size);
+    record.code_end = to_exec((uint8_t*)dest + literal_size + code_size);
+    record.block_data = state;
+
+    auto it = program.block_map.insert({state, record}).first;
+    return &it->second;
+}
+
+/*!
+ * Switch the table find_block looks in, creating it if the program hasn't been seen (or was evicted)
+ */
+void VUJitHeap::set_current_program(uint32_t crc)
+{
+    current = &get_program(crc);
+    current_crc = crc;
+    lru.splice(lru.begin(), lru, current->lru_pos);
+}
+
+VUJitBlockRecord* VUJitHeap::insert_block(const VUBlockState& state, JitBlock* block)
+{
+    return insert(*current, state, block);
+}
+
+VUJitBlockRecord* VUJitHeap::insert_resident_block(const VUBlockState& state, JitBlock* block)
+{
+    return insert(resident, state, block);
+}
+
+void VUJitHeap::flush_all_blocks()
+{
+    programs.clear();
+    lru.clear();
+    free_program(resident);
+    for(int i = 0; i < CHUNK_COUNT; i++)
+        chunk_used[i] = false;
+
+    current = &get_program(current_crc);
+}
@@ -1,7 +1,11 @@
 #ifndef JITCACHE_HPP
 #define JITCACHE_HPP
 
+#include <list>
+#include <map>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <cstring>
 #include <cstdlib>
 #include <string>
@@ -91,12 +95,29 @@ inline void JitBlock::write(T value) {
 
 /*!
  * Common jit Heap functions shared by all jit heaps
+ * Where the host allows it, heap memory is mapped twice, so no page is ever writable and executable at once.
+ * exec_alloc returns the writable view, which the allocators work in and code is copied/patched through.
+ * Records point into the executable view, exec_offset bytes away. Without a second view the offset is 0.
  */
 class JitHeap
 {
 protected:
-    void* rwx_alloc(std::size_t size);
-    void rwx_free(void* mem, std::size_t size);
+    std::ptrdiff_t exec_offset = 0;
+
+    void* exec_alloc(std::size_t size);
+    void exec_free(void* mem, std::size_t size);
+
+    template<typename T>
+    T* to_exec(T* mem) const
+    {
+        return (T*)((uint8_t*)mem + exec_offset);
+    }
+
+    template<typename T>
+    T* to_writable(T* mem) const
+    {
+        return (T*)((uint8_t*)mem - exec_offset);
+    }
 };
 
 /*!
@@ -150,14 +171,16 @@ public:
             heap_size = size;
         }
 
-        heap = (uint8_t*)rwx_alloc(heap_size);
+        heap = (uint8_t*)exec_alloc(heap_size);
+        if(!heap)
+            Errors::die("[JIT Heap] Unable to allocate heap");
         heap_cur = heap;
         heap_top = heap + heap_size;
     }
 
     ~JitUnorderedMapHeap()
     {
-        rwx_free(heap, heap_size);
+        exec_free(heap, heap_size);
     }
 
     JitBlockRecord<DataType>* insert_block(DataType data, JitBlock* block)
@@ -201,9 +224,9 @@ public:
         JitBlockRecord<DataType> record;
         std::size_t literal_size = code_start - literals_start;
         std::size_t code_size = code_end - code_start;
-        record.literals_start = (uint8_t*)dest;
-        record.code_start = (uint8_t*)dest + literal_size;
-        record.code_end = (uint8_t*)dest + literal_size + code_size;
+        record.literals_start = to_exec((uint8_t*)dest);
+        record.code_start = to_exec((uint8_t*)dest + literal_size);
+        record.code_end = to_exec((uint8_t*)dest + literal_size + code_size);
         record.block_data = data;
 
         // add to hash table
@@ -218,6 +241,12 @@ public:
         block_map.clear();
     }
 
+    // forget a single block. Its memory is only reclaimed by the next flush
+    void invalidate_block(DataType data)
+    {
+        block_map.erase(data);
+    }
+
     bool heap_is_full()
     {
         if (heap_top - heap_cur < (JitBlock::JIT_MAX_BLOCK_CODESIZE + JitBlock::JIT_MAX_BLOCK_LITERALSIZE)) //Check we have 5mb spare (max block size)
@@ -295,7 +324,73 @@ struct VUBlockStateHash
 };
 
 using VUJitBlockRecord = JitBlockRecord<VUBlockState>;
-using VUJitHeap = JitUnorderedMapHeap<VUBlockState, VUBlockStateHash>;
+
+/*!
+ * Holds the blocks of many microprograms at once, as games tend to switch between several programs every frame.
+ * Switching program only swaps the lookup table that find_block uses.
+ * The heap is split into chunks which each belong to a single program, and when it fills up the least recently
+ * used program is evicted as a whole. Resident blocks (the prologue) belong to no program and are never evicted.
+ */
+class VUJitHeap : public JitHeap
+{
+private:
+    constexpr static std::size_t VU_JIT_HEAP_SIZE = 64 * 1024 * 1024; // 64 MB heap size
+    constexpr static std::size_t CHUNK_SIZE = 256 * 1024;
+    constexpr static int CHUNK_COUNT = VU_JIT_HEAP_SIZE / CHUNK_SIZE;
+    constexpr static int JIT_HEAP_ALIGN = 16;
+
+    struct Program {
+        std::unordered_map<VUBlockState, VUJitBlockRecord, VUBlockStateHash> block_map;
+        std::vector<std::pair<int, int>> chunks; // first chunk and length of each run of chunks owned
+        uint8_t* alloc_cur = nullptr;
+        uint8_t* alloc_end = nullptr;
+        std::list<uint32_t>::iterator lru_pos;
+    };
+
+    uint8_t* heap = nullptr;
+    bool chunk_used[CHUNK_COUNT];
+
+    std::unordered_map<uint32_t, Program> programs;
+    std::list<uint32_t> lru; // most recently used first
+    Program resident;
+    Program* current = nullptr;
+    uint32_t current_crc = 0;
+
+    Program& get_program(uint32_t crc);
+    int find_free_chunks(int count);
+    bool evict_lru_program();
+    void free_program(Program& program);
+    void* jit_alloc(Program& program, std::size_t size);
+    VUJitBlockRecord* insert(Program& program, const VUBlockState& state, JitBlock* block);
+
+public:
+    VUJitHeap();
+    ~VUJitHeap();
+
+    void set_current_program(uint32_t crc);
+    VUJitBlockRecord* insert_block(const VUBlockState& state, JitBlock* block);
+    VUJitBlockRecord* insert_resident_block(const VUBlockState& state, JitBlock* block);
+    void flush_all_blocks();
+
+    VUJitBlockRecord* find_block(const VUBlockState& state);
+};
+
+inline VUJitBlockRecord* VUJitHeap::find_block(const VUBlockState& state)
+{
+    auto kv = current->block_map.find(state);
+    if (kv != current->block_map.end())
+        return &(kv->second);
+    return nullptr;
+}
+
+///////////////////////
+// IOP Implementation
+///////////////////////
+
+//Blocks are keyed by PC in the lower 32 bits and the instruction cache enable bit of cache_control above them,
+//as the uncached wait states are baked into the block's cycle count
+using IOPJitBlockRecord = JitBlockRecord<uint64_t>;
+using IOPJitHeap = JitUnorderedMapHeap<uint64_t, GSU64Hash>;
 
 
 ////////////////////////
@@ -320,6 +415,54 @@ struct EEPageRecord {
 
 using EEJitBlockRecord = JitBlockRecord<EEJitBlockRecordData>;
 
+/*!
+ * A guest load/store emitted as a direct access into the fastmem arena. Offsets are from the block's code start.
+ * When the access at fault traps, a jump to slow_path is written over patch so the site never traps again.
+ */
+struct EEFastmemSite {
+    uint32_t patch;
+    uint32_t fault;
+    uint32_t slow_path;
+};
+
+/*!
+ * A patchable exit of a block. Offsets are from the block's code start.
+ * A direct link is the rel32 of a JMP, which points to fallback while target isn't compiled.
+ * An absolute link is a 64-bit code pointer (the immediate of a MOV64_OI), which is zero while target isn't compiled.
+ */
+struct EEBlockLink {
+    uint32_t target;
+    uint32_t offset;
+    uint32_t fallback;
+    bool absolute;
+};
+
+/*!
+ * Return address stack for JAL/JALR and JR $ra pairs. Calls push the return PC along with the code of the block
+ * there (or nullptr), and returns pop an entry and jump straight to the code when the PC matches.
+ * Code pointers are only valid as long as the blocks exist, so the stack is cleared whenever blocks are freed.
+ */
+struct EEReturnStack {
+    constexpr static int SIZE = 16;
+
+    struct Entry {
+        uint32_t pc;
+        uint32_t pad;
+        void *code;
+    };
+
+    Entry entries[SIZE];
+    uint32_t top;
+
+    void clear()
+    {
+        memset(entries, 0, sizeof(entries));
+        top = 0;
+    }
+};
+
+static_assert(sizeof(EEReturnStack::Entry) == 16, "Recompiled code indexes the return stack with a shift of 4");
+
 struct FreeList {
     FreeList *next;
     FreeList *prev;
@@ -361,16 +504,36 @@ private:
     uint64_t page_lookups = 0;
     uint64_t cached_page_lookups = 0;
 
+    // fastmem sites, keyed by the address of the faulting instruction
+    std::map<uint8_t*, EEFastmemSite> fastmem_sites;
+    void erase_fastmem_sites(const EEJitBlockRecord& record);
+
+    // block links, keyed by the address that gets patched, and the link addresses of each target PC
+    struct LinkSite {
+        uint32_t target;
+        uint8_t *fallback;
+        bool absolute;
+    };
+    std::map<uint8_t*, LinkSite> link_sites;
+    std::unordered_multimap<uint32_t, uint8_t*> incoming_links;
+    void write_link(uint8_t* site, const LinkSite& link, void* dest);
+    void erase_block_links(const EEJitBlockRecord& record);
+    void unlink_block(uint32_t PC);
+
 public:
     EEJitHeap();
     ~EEJitHeap();
 
     EEJitBlockRecord* lookup_cache[1024 * 32];
+    EEReturnStack return_stack;
 
-    EEJitBlockRecord *insert_block(uint32_t PC, JitBlock* block);
+    EEJitBlockRecord *insert_block(uint32_t PC, JitBlock* block,
+                                   const std::vector<EEFastmemSite>& sites = std::vector<EEFastmemSite>(),
+                                   const std::vector<EEBlockLink>& links = std::vector<EEBlockLink>());
     void flush_all_blocks();
     void invalidate_ee_page(uint32_t page);
     EEJitBlockRecord *find_block(uint32_t PC);
+    uint8_t *patch_fastmem_site(uint8_t* fault_pc);
 };
 
 
@@ -6,7 +6,10 @@
 
 using TimestampLimit = std::numeric_limits<int64_t>;
 
-Scheduler::Scheduler()
+constexpr uint32_t Scheduler::NO_HEAP_POS;
+constexpr int Scheduler::DEFAULT_RUN_CYCLES;
+
+Scheduler::Scheduler() : max_run_cycles(DEFAULT_RUN_CYCLES)
 {
 
 }
@@ -26,19 +29,24 @@ void Scheduler::reset()
 
     closest_event_time = TimestampLimit::max();
 
-    events.clear();
+    event_heap.clear();
+    event_slots.clear();
+    event_heap_pos.clear();
+    free_event_slots.clear();
     timers.clear();
 
     timer_event_id = register_function([this] (uint64_t param) { timer_event(param);});
 }
 
-unsigned int Scheduler::calculate_run_cycles()
+//When nothing but the CPUs has work, the slice may run up to max_run_cycles, or to the next event if that is sooner.
+//Subsystems woken up in the middle of a long slice start late, which is why it is capped.
+unsigned int Scheduler::calculate_run_cycles(bool subsystems_idle)
 {
-    if (!events.size())
+    if (!event_heap.size())
         Errors::die("[Scheduler] No events registered");
-    const static int MAX_CYCLES = 32;
-    if (ee_cycles.count + MAX_CYCLES <= closest_event_time)
-        run_cycles = MAX_CYCLES;
+    int max_cycles = subsystems_idle ? max_run_cycles : DEFAULT_RUN_CYCLES;
+    if (ee_cycles.count + max_cycles <= closest_event_time)
+        run_cycles = max_cycles;
     else
     {
         int64_t delta = closest_event_time - ee_cycles.count;
@@ -69,6 +77,11 @@ unsigned int Scheduler::get_iop_run_cycles()
     return iop_run_cycles;
 }
 
+void Scheduler::set_max_run_cycles(int cycles)
+{
+    max_run_cycles = std::max(cycles, DEFAULT_RUN_CYCLES);
+}
+
 int Scheduler::register_function(std::function<void (uint64_t)> func)
 {
     int id = registered_funcs.size();
@@ -89,31 +102,144 @@ uint64_t Scheduler::add_event(int func_id, uint64_t delta, uint64_t param)
         Errors::die("[Scheduler] Out-of-bounds func_id given in add_event");
     SchedulerEvent event;
     event.func_id = func_id;
-    event.time_to_run = ee_cycles.count + delta;
     event.param = param;
-    event.event_id = next_event_id;
+    event.pulse = false;
+
+    //Timers park their events at the maximum delta, which must not wrap around to the past
+    if (delta >= (uint64_t)(TimestampLimit::max() - ee_cycles.count))
+        event.time_to_run = TimestampLimit::max();
+    else
+        event.time_to_run = ee_cycles.count + delta;
+
+    return insert_event(event);
+}
 
+void Scheduler::delete_event(uint64_t event_id)
+{
+    remove_event(event_heap_pos[get_event_slot(event_id)]);
+    closest_event_time = event_heap.size() ? event_heap[0].time_to_run : TimestampLimit::max();
+}
+
+uint64_t Scheduler::insert_event(SchedulerEvent event)
+{
+    uint32_t slot;
+    if (free_event_slots.size())
+    {
+        slot = free_event_slots.back();
+        free_event_slots.pop_back();
+        event.event_id = ((event_slots[slot].event_id >> 32) + 1) << 32 | slot;
+        event_slots[slot] = event;
+    }
+    else
+    {
+        slot = event_slots.size();
+        event.event_id = slot;
+        event_slots.push_back(event);
+        event_heap_pos.push_back(NO_HEAP_POS);
+    }
+
+    EventNode node;
+    node.time_to_run = event.time_to_run;
+    node.order = next_event_id;
+    node.slot = slot;
     next_event_id++;
 
+    event_heap.push_back(node);
+    event_heap_pos[slot] = event_heap.size() - 1;
+    sift_up(event_heap.size() - 1);
+
     closest_event_time = std::min(event.time_to_run, closest_event_time);
+    return event.event_id;
+}
 
-    events.push_back(event);
+uint32_t Scheduler::get_event_slot(uint64_t event_id)
+{
+    uint32_t slot = event_id & 0xFFFFFFFF;
+    if (slot >= event_slots.size() || event_heap_pos[slot] == NO_HEAP_POS ||
+        event_slots[slot].event_id != event_id)
+        Errors::die("[Scheduler] No event ID $%llX found", event_id);
+    return slot;
+}
 
-    return event.event_id;
+void Scheduler::set_event_time(uint64_t event_id, int64_t time)
+{
+    uint32_t slot = get_event_slot(event_id);
+    uint32_t pos = event_heap_pos[slot];
+    int64_t old_time = event_heap[pos].time_to_run;
+
+    event_slots[slot].time_to_run = time;
+    event_heap[pos].time_to_run = time;
+    if (time < old_time)
+        sift_up(pos);
+    else
+        sift_down(pos);
+
+    closest_event_time = std::min(time, closest_event_time);
 }
 
-void Scheduler::delete_event(uint64_t event_id)
+void Scheduler::remove_event(uint32_t heap_pos)
 {
-    for (auto it = events.begin(); it != events.end(); it++)
+    uint32_t slot = event_heap[heap_pos].slot;
+    event_heap_pos[slot] = NO_HEAP_POS;
+    free_event_slots.push_back(slot);
+
+    EventNode last = event_heap.back();
+    event_heap.pop_back();
+    if (heap_pos == event_heap.size())
+        return;
+
+    //Fill the hole with the last node, which can belong either above or below it
+    move_event(heap_pos, last);
+    sift_up(heap_pos);
+    sift_down(event_heap_pos[last.slot]);
+}
+
+bool Scheduler::event_before(uint32_t a, uint32_t b)
+{
+    if (event_heap[a].time_to_run != event_heap[b].time_to_run)
+        return event_heap[a].time_to_run < event_heap[b].time_to_run;
+    return event_heap[a].order < event_heap[b].order;
+}
+
+void Scheduler::move_event(uint32_t heap_pos, const EventNode& node)
+{
+    event_heap[heap_pos] = node;
+    event_heap_pos[node.slot] = heap_pos;
+}
+
+void Scheduler::sift_up(uint32_t heap_pos)
+{
+    while (heap_pos > 0)
     {
-        if (it->event_id == event_id)
-        {
-            events.erase(it);
-            return;
-        }
+        uint32_t parent = (heap_pos - 1) >> 1;
+        if (!event_before(heap_pos, parent))
+            break;
+
+        EventNode node = event_heap[heap_pos];
+        move_event(heap_pos, event_heap[parent]);
+        move_event(parent, node);
+        heap_pos = parent;
     }
+}
 
-    Errors::die("[Scheduler] No event ID %lld found in delete_event", event_id);
+void Scheduler::sift_down(uint32_t heap_pos)
+{
+    uint32_t size = event_heap.size();
+    while (true)
+    {
+        uint32_t child = (heap_pos << 1) + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && event_before(child + 1, child))
+            child++;
+        if (!event_before(child, heap_pos))
+            break;
+
+        EventNode node = event_heap[heap_pos];
+        move_event(heap_pos, event_heap[child]);
+        move_event(child, node);
+        heap_pos = child;
+    }
 }
 
 uint64_t Scheduler::convert_to_ee_cycles(uint64_t cycles, uint64_t clockrate)
@@ -148,9 +274,7 @@ int64_t Scheduler::calculate_timer_event_delta(uint64_t timer_id)
 void Scheduler::update_timer_event_time(uint64_t timer_id)
 {
     int64_t time = ee_cycles.count + calculate_timer_event_delta(timer_id);
-    SchedulerEvent* event = get_event_ptr(timers[timer_id].event_id);
-    event->time_to_run = time;
-    closest_event_time = std::min(time, closest_event_time);
+    set_event_time(timers[timer_id].event_id, time);
 }
 
 void Scheduler::update_timer_counter(uint64_t timer_id)
@@ -177,6 +301,10 @@ void Scheduler::update_timer_counter(uint64_t timer_id)
 
 void Scheduler::timer_event(uint64_t index)
 {
+    //process_events has already removed the event that got us here.
+    //Give the timer a new one first, as the callbacks may reset the counter or target, which reschedules it.
+    timers[index].event_id = add_event(timer_event_id, TimestampLimit::max(), index);
+
     uint32_t old_counter = timers[index].counter;
     timers[index].counter = get_timer_counter(index);
 
@@ -199,18 +327,7 @@ void Scheduler::timer_event(uint64_t index)
             timer_callbacks[cb_id](timers[index].param, true);
     }
 
-    restart_timer(index);
-}
-
-SchedulerEvent* Scheduler::get_event_ptr(uint64_t event_id)
-{
-    for (auto it = events.begin(); it != events.end(); it++)
-    {
-        if (it->event_id == event_id)
-            return &(*it);
-    }
-
-    Errors::die("[Scheduler] No event ID %lld found in get_event_ptr", event_id);
+    update_timer_event_time(index);
 }
 
 uint64_t Scheduler::create_timer(int callback_id, uint64_t overflow_mask, uint64_t param)
@@ -235,13 +352,6 @@ uint64_t Scheduler::create_timer(int callback_id, uint64_t overflow_mask, uint64
     return timers.size() - 1;
 }
 
-void Scheduler::restart_timer(uint64_t timer_id)
-{
-    SchedulerTimer* t = &timers[timer_id];
-    t->event_id = add_event(timer_event_id, TimestampLimit::max(), timer_id);
-    update_timer_event_time(timer_id);
-}
-
 uint64_t Scheduler::get_timer_counter(uint64_t timer_id)
 {
     if (!timers[timer_id].paused)
@@ -258,8 +368,7 @@ void Scheduler::set_timer_pause(uint64_t timer_id, bool paused)
     if (paused)
     {
         update_timer_counter(timer_id);
-        SchedulerEvent* event = get_event_ptr(timers[timer_id].event_id);
-        event->time_to_run = TimestampLimit::max();
+        set_event_time(timers[timer_id].event_id, TimestampLimit::max());
     }
     else
     {
@@ -329,21 +438,19 @@ void Scheduler::process_events()
 {
     if (ee_cycles.count >= closest_event_time)
     {
-        int64_t new_time = 0x7FFFFFFFULL << 32ULL;
-        for (auto it = events.begin(); it != events.end(); )
+        //Events added by the callbacks also run here if they are already due
+        int64_t limit = closest_event_time;
+        while (event_heap.size() && event_heap[0].time_to_run <= limit)
         {
-            if (it->time_to_run <= closest_event_time)
-            {
-                std::function<void(uint64_t)> func = registered_funcs[it->func_id];
-                func(it->param);
-                it = events.erase(it);
-            }
-            else
-            {
-                new_time = std::min(it->time_to_run, new_time);
-                it++;
-            }
+            //Remove the event first so that the callback is free to add more
+            SchedulerEvent event = event_slots[event_heap[0].slot];
+            remove_event(0);
+            registered_funcs[event.func_id](event.param);
         }
-        closest_event_time = new_time;
+
+        if (event_heap.size())
+            closest_event_time = event_heap[0].time_to_run;
+        else
+            closest_event_time = 0x7FFFFFFFULL << 32ULL;
     }
 }
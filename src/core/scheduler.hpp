@@ -1,8 +1,8 @@
 #ifndef SCHEDULER_HPP
 #define SCHEDULER_HPP
 #include <cstdint>
+#include <fstream>
 #include <functional>
-#include <list>
 #include <vector>
 
 struct CycleCount
@@ -38,6 +38,7 @@ class Scheduler
         CycleCount iop_cycles;
 
         unsigned int run_cycles;
+        int max_run_cycles;
         uint64_t next_event_id;
 
         uint64_t timer_event_id;
@@ -45,7 +46,23 @@ class Scheduler
         std::vector<std::function<void(uint64_t)> > registered_funcs;
         std::vector<std::function<void(uint64_t, bool)> > timer_callbacks;
         std::vector<SchedulerTimer> timers;
-        std::list<SchedulerEvent> events;
+
+        //Pending events live in slots, and a binary min-heap on (time_to_run, order) indexes the slots.
+        //An event ID is its slot in the low 32 bits and the slot's generation above them, so IDs of finished
+        //events never match an event that later reuses the slot.
+        struct EventNode
+        {
+            int64_t time_to_run;
+            uint64_t order; //Events due at the same time run in the order they were added
+            uint32_t slot;
+        };
+
+        constexpr static uint32_t NO_HEAP_POS = 0xFFFFFFFF;
+
+        std::vector<EventNode> event_heap;
+        std::vector<SchedulerEvent> event_slots;
+        std::vector<uint32_t> event_heap_pos; //NO_HEAP_POS if the slot is free
+        std::vector<uint32_t> free_event_slots;
 
         int64_t closest_event_time;
 
@@ -57,20 +74,33 @@ class Scheduler
 
         void timer_event(uint64_t index);
 
-        SchedulerEvent* get_event_ptr(uint64_t event_id);
+        uint64_t insert_event(SchedulerEvent event);
+        uint32_t get_event_slot(uint64_t event_id);
+        void set_event_time(uint64_t event_id, int64_t time);
+        void remove_event(uint32_t heap_pos);
+        bool event_before(uint32_t a, uint32_t b);
+        void move_event(uint32_t heap_pos, const EventNode& node);
+        void sift_up(uint32_t heap_pos);
+        void sift_down(uint32_t heap_pos);
     public:
         constexpr static uint64_t EE_CLOCKRATE = 294912000; //294.912 MHz
         constexpr static uint64_t BUS_CLOCKRATE = EE_CLOCKRATE / 2;
         constexpr static uint64_t IOP_CLOCKRATE = EE_CLOCKRATE / 8;
 
+        //Slice length while any subsystem besides the CPUs has work, and the most accurate setting overall
+        constexpr static int DEFAULT_RUN_CYCLES = 32;
+
         Scheduler();
 
         void reset();
 
-        unsigned int calculate_run_cycles();
+        unsigned int calculate_run_cycles(bool subsystems_idle);
         unsigned int get_bus_run_cycles();
         unsigned int get_iop_run_cycles();
 
+        int get_max_run_cycles();
+        void set_max_run_cycles(int cycles);
+
         int64_t get_ee_cycles();
         int64_t get_iop_cycles();
 
@@ -81,7 +111,6 @@ class Scheduler
         void delete_event(uint64_t event_id);
 
         uint64_t create_timer(int func_id, uint64_t overflow_mask, uint64_t param = 0);
-        void restart_timer(uint64_t timer_id);
 
         uint64_t get_timer_counter(uint64_t timer_id);
         void set_timer_counter(uint64_t timer_id, uint64_t counter);
@@ -97,6 +126,11 @@ class Scheduler
         void save_state(std::ofstream& state);
 };
 
+inline int Scheduler::get_max_run_cycles()
+{
+    return max_run_cycles;
+}
+
 inline int64_t Scheduler::get_ee_cycles()
 {
     return ee_cycles.count;
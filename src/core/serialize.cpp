@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <fstream>
 #include <cstring>
+#include <unordered_map>
 #include "emulator.hpp"
 
 #define VER_MAJOR 0
@@ -72,6 +74,7 @@ void Emulator::load_state(const char *file_name)
     //RAM
     state.read((char*)RDRAM, 1024 * 1024 * 32);
     state.read((char*)IOP_RAM, 1024 * 1024 * 2);
+    memset(IOP_RAM_modified, 1, sizeof(IOP_RAM_modified));
     state.read((char*)SPU_RAM, 1024 * 1024 * 2);
     state.read((char*)scratchpad, 1024 * 16);
     state.read((char*)iop_scratchpad, 1024);
@@ -326,6 +329,9 @@ void IOP::save_state(ofstream &state)
 
 void VectorUnit::load_state(ifstream &state)
 {
+    //XGKICK packets still queued from threaded mode are not part of the state
+    wait_for_thread();
+
     for (int i = 0; i < 32; i++)
         state.read((char*)&gpr[i].u, sizeof(uint32_t) * 4);
     state.read((char*)&int_gpr, sizeof(int_gpr));
@@ -378,8 +384,11 @@ void VectorUnit::load_state(ifstream &state)
         state.read((char*)&instr_mem, 1024 * 16);
         state.read((char*)&data_mem, 1024 * 16);
     }
+    set_micromem_dirty();
 
-    state.read((char*)&running, sizeof(running));
+    bool was_running;
+    state.read((char*)&was_running, sizeof(was_running));
+    running = was_running;
     state.read((char*)&PC, sizeof(PC));
     state.read((char*)&new_PC, sizeof(new_PC));
     state.read((char*)&secondbranch_PC, sizeof(secondbranch_PC));
@@ -393,6 +402,8 @@ void VectorUnit::load_state(ifstream &state)
 
 void VectorUnit::save_state(ofstream &state)
 {
+    wait_for_thread();
+
     for (int i = 0; i < 32; i++)
         state.write((char*)&gpr[i].u, sizeof(uint32_t) * 4);
     state.write((char*)&int_gpr, sizeof(int_gpr));
@@ -445,7 +456,8 @@ void VectorUnit::save_state(ofstream &state)
         state.write((char*)&data_mem, 1024 * 16);
     }
 
-    state.write((char*)&running, sizeof(running));
+    bool still_running = running;
+    state.write((char*)&still_running, sizeof(still_running));
     state.write((char*)&PC, sizeof(PC));
     state.write((char*)&new_PC, sizeof(new_PC));
     state.write((char*)&secondbranch_PC, sizeof(secondbranch_PC));
@@ -912,8 +924,15 @@ void Scheduler::load_state(ifstream &state)
     state.read((char*)&run_cycles, sizeof(run_cycles));
     state.read((char*)&closest_event_time, sizeof(closest_event_time));
 
-    events.clear();
+    event_heap.clear();
+    event_slots.clear();
+    event_heap_pos.clear();
+    free_event_slots.clear();
 
+    //Events are stored in the order they run, so reinserting them keeps that order. They get new IDs along the way,
+    //which the timers referencing them must be updated with.
+    int64_t saved_closest_time = closest_event_time;
+    std::unordered_map<uint64_t, uint64_t> new_ids;
     int event_size = 0;
     state.read((char*)&event_size, sizeof(event_size));
 
@@ -922,10 +941,14 @@ void Scheduler::load_state(ifstream &state)
         SchedulerEvent event;
         state.read((char*)&event, sizeof(event));
 
-        events.push_back(event);
+        uint64_t old_id = event.event_id;
+        new_ids[old_id] = insert_event(event);
     }
+    closest_event_time = saved_closest_time;
 
-    state.read((char*)&next_event_id, sizeof(next_event_id));
+    uint64_t saved_next_id;
+    state.read((char*)&saved_next_id, sizeof(saved_next_id));
+    next_event_id = std::max(next_event_id, saved_next_id);
 
     int timer_size = 0;
     state.read((char*)&timer_size, sizeof(timer_size));
@@ -937,6 +960,9 @@ void Scheduler::load_state(ifstream &state)
         SchedulerTimer timer;
         state.read((char*)&timer, sizeof(timer));
 
+        auto id = new_ids.find(timer.event_id);
+        if (id != new_ids.end())
+            timer.event_id = id->second;
         timers.push_back(timer);
     }
 }
@@ -949,12 +975,19 @@ void Scheduler::save_state(ofstream &state)
     state.write((char*)&run_cycles, sizeof(run_cycles));
     state.write((char*)&closest_event_time, sizeof(closest_event_time));
 
-    int event_size = events.size();
+    std::vector<EventNode> sorted_events = event_heap;
+    std::sort(sorted_events.begin(), sorted_events.end(), [] (const EventNode& a, const EventNode& b) {
+        if (a.time_to_run != b.time_to_run)
+            return a.time_to_run < b.time_to_run;
+        return a.order < b.order;
+    });
+
+    int event_size = sorted_events.size();
     state.write((char*)&event_size, sizeof(event_size));
 
-    for (auto it = events.begin(); it != events.end(); it++)
+    for (EventNode& node : sorted_events)
     {
-        SchedulerEvent event = *it;
+        SchedulerEvent event = event_slots[node.slot];
         state.write((char*)&event, sizeof(event));
     }
 
@@ -0,0 +1,83 @@
+#include "../../emulator.hpp"
+#include <iomanip>
+
+using namespace std;
+
+//Steps a scheduler the way the main loop does, with no CPUs attached
+static void run_scheduler(Scheduler& scheduler, int64_t cycles)
+{
+    int64_t end = scheduler.get_ee_cycles() + cycles;
+    while (scheduler.get_ee_cycles() < end)
+    {
+        scheduler.calculate_run_cycles(false);
+        scheduler.update_cycle_counts();
+        scheduler.process_events();
+    }
+}
+
+//A timer that clears its counter on reaching its target, from its own callback, like the EE and IOP timers do
+static void test_timer_clear_on_target(ofstream& test_output)
+{
+    Scheduler scheduler;
+    scheduler.reset();
+
+    uint64_t timer = 0;
+    int hits = 0;
+    int callback = scheduler.register_timer_callback([&] (uint64_t param, bool overflow) {
+        hits++;
+        test_output << "  " << (overflow ? "overflow" : "target") << " at cycle " << dec
+                    << scheduler.get_ee_cycles() << "\n";
+        if (!overflow)
+            scheduler.set_timer_counter(timer, 0);
+    });
+
+    timer = scheduler.create_timer(callback, 0xFFFF);
+    scheduler.set_timer_clockrate(timer, Scheduler::EE_CLOCKRATE);
+    scheduler.set_timer_int_mask(timer, true, true);
+    scheduler.set_timer_pause(timer, false);
+    scheduler.set_timer_target(timer, 100);
+
+    test_output << "clear_on_target:\n";
+    run_scheduler(scheduler, 1000);
+    test_output << "  hits: " << hits << ", counter: " << scheduler.get_timer_counter(timer) << "\n\n";
+}
+
+//A timer that moves its own target from its callback
+static void test_timer_move_target(ofstream& test_output)
+{
+    Scheduler scheduler;
+    scheduler.reset();
+
+    uint64_t timer = 0;
+    int64_t target = 100;
+    int callback = scheduler.register_timer_callback([&] (uint64_t param, bool overflow) {
+        test_output << "  " << (overflow ? "overflow" : "target") << " at cycle " << dec
+                    << scheduler.get_ee_cycles() << "\n";
+        if (!overflow)
+        {
+            target += 100;
+            scheduler.set_timer_target(timer, target);
+        }
+    });
+
+    timer = scheduler.create_timer(callback, 0xFFFF);
+    scheduler.set_timer_clockrate(timer, Scheduler::EE_CLOCKRATE);
+    scheduler.set_timer_int_mask(timer, true, true);
+    scheduler.set_timer_pause(timer, false);
+    scheduler.set_timer_target(timer, target);
+
+    test_output << "move_target:\n";
+    run_scheduler(scheduler, 1000);
+    test_output << "  counter: " << dec << scheduler.get_timer_counter(timer) << "\n\n";
+}
+
+void Emulator::test_scheduler()
+{
+    ofstream test_output("test_log.txt");
+
+    test_output << "-- TEST BEGIN\n";
+    test_timer_clear_on_target(test_output);
+    test_timer_move_target(test_output);
+    test_output << "-- TEST END\n";
+    test_output.flush();
+}
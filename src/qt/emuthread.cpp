@@ -62,6 +62,46 @@ void EmuThread::set_vu1_mode(CPU_MODE mode)
     wait_for_lock([=]() { e.set_vu1_mode(mode); } );
 }
 
+void EmuThread::set_vu1_threaded(bool enabled)
+{
+    wait_for_lock([=]() { e.set_vu1_threaded(enabled); } );
+}
+
+void EmuThread::set_vu_jit_cache_directory(const QString& directory)
+{
+    wait_for_lock([=]() { e.set_vu_jit_cache_directory(directory.toStdString()); } );
+}
+
+void EmuThread::set_iop_mode(CPU_MODE mode)
+{
+    wait_for_lock([=]() { e.set_iop_mode(mode); } );
+}
+
+void EmuThread::set_reference_IDCT(bool enabled)
+{
+    wait_for_lock([=]() { e.set_reference_IDCT(enabled); } );
+}
+
+void EmuThread::set_gs_render_threads(int count)
+{
+    wait_for_lock([=]() { e.set_gs_render_threads(count); } );
+}
+
+void EmuThread::set_max_timeslice(int cycles)
+{
+    wait_for_lock([=]() { e.set_max_timeslice(cycles); } );
+}
+
+void EmuThread::set_game_timeslice(const QString& serial, int cycles)
+{
+    wait_for_lock([=]() { e.set_game_timeslice(serial.toStdString(), cycles); } );
+}
+
+void EmuThread::clear_game_timeslice(const QString& serial)
+{
+    wait_for_lock([=]() { e.clear_game_timeslice(serial.toStdString()); } );
+}
+
 void EmuThread::load_BIOS(const uint8_t *BIOS)
 {
     wait_for_lock([=]() { e.load_BIOS(BIOS); } );
@@ -164,20 +204,21 @@ void EmuThread::gsdump_run()
         while (true)
         {
             GSMessage& data = get_next_gsdump_message();
+            bool drawing_kick = false;
 
             switch (data.type)
             {
                 case set_xyz_t:
                     e.get_gs().send_message(data);
                     e.get_gs().wake_gs_thread();
-                    if (frame_advance && data.payload.xyz_payload.drawing_kick && --draws_sent <= 0)
-                    {
-                        uint16_t w, h;
-                        uint32_t* frame = e.get_gs().render_partial_frame(w, h);
-                        emit completed_frame(frame, w, h, w, h);
-                        pause(PAUSE_EVENT::FRAME_ADVANCE);
-                        return;
-                    }
+                    drawing_kick = data.payload.xyz_payload.drawing_kick;
+                    break;
+                case write64_t:
+                    //Newer dumps record GIF vertices as XYZ2/XYZF2 register writes
+                    e.get_gs().send_message(data);
+                    drawing_kick = data.payload.write64_payload.addr == 0x4 || data.payload.write64_payload.addr == 0x5;
+                    if (drawing_kick)
+                        e.get_gs().wake_gs_thread();
                     break;
                 case render_crt_t:
                 {
@@ -205,6 +246,14 @@ void EmuThread::gsdump_run()
                     e.get_gs().send_message(data);
                     //e.get_gs().wake_gs_thread();
             }
+            if (frame_advance && drawing_kick && --draws_sent <= 0)
+            {
+                uint16_t w, h;
+                uint32_t* frame = e.get_gs().render_partial_frame(w, h);
+                emit completed_frame(frame, w, h, w, h);
+                pause(PAUSE_EVENT::FRAME_ADVANCE);
+                return;
+            }
             if (gsdump_eof())
                 Errors::die("gs dump unexpectedly ended");
         }
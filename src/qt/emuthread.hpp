@@ -50,6 +50,14 @@ class EmuThread : public QThread
         void set_ee_mode(CPU_MODE mode);
         void set_vu0_mode(CPU_MODE mode);
         void set_vu1_mode(CPU_MODE mode);
+        void set_vu1_threaded(bool enabled);
+        void set_vu_jit_cache_directory(const QString& directory);
+        void set_iop_mode(CPU_MODE mode);
+        void set_reference_IDCT(bool enabled);
+        void set_gs_render_threads(int count);
+        void set_max_timeslice(int cycles);
+        void set_game_timeslice(const QString& serial, int cycles);
+        void clear_game_timeslice(const QString& serial);
         void load_BIOS(const uint8_t* BIOS);
         void load_ELF(QString name, const uint8_t* ELF, uint64_t ELF_size);
         void load_CDVD(const char* name, CDVD_CONTAINER type);
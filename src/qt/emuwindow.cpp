@@ -66,6 +66,7 @@ EmuWindow::EmuWindow(QWidget *parent) : QMainWindow(parent)
     ee_mode = new QLabel;
     vu0_mode = new QLabel;
     vu1_mode = new QLabel;
+    iop_mode = new QLabel;
 
     frametime = new QLabel;
     avg_framerate = new QLabel;
@@ -76,9 +77,21 @@ EmuWindow::EmuWindow(QWidget *parent) : QMainWindow(parent)
         update_status();
     });
 
+    emu_thread.set_vu_jit_cache_directory(Settings::instance().vu_jit_cache_directory);
+
+    //The emulator picks the one matching the serial of the disc it loads
+    QVariantMap game_timeslices = Settings::instance().game_timeslices;
+    for (auto game = game_timeslices.begin(); game != game_timeslices.end(); game++)
+        emu_thread.set_game_timeslice(game.key(), game.value().toInt());
+
+    connect(&Settings::instance(), &Settings::vu_jit_cache_directory_changed, [=](QString directory) {
+        emu_thread.set_vu_jit_cache_directory(directory);
+    });
+
     statusBar()->addPermanentWidget(ee_mode);
     statusBar()->addPermanentWidget(vu0_mode);
     statusBar()->addPermanentWidget(vu1_mode);
+    statusBar()->addPermanentWidget(iop_mode);
 
     create_menu();
 
@@ -390,6 +403,30 @@ void EmuWindow::create_menu()
     });
 
 
+    //For games that break when the EE runs ahead of idle subsystems. Needs a disc with a serial
+    auto game_timeslice_action = new QAction(tr("Accurate &Timeslice for This Game"), this);
+    game_timeslice_action->setCheckable(true);
+    game_timeslice_action->setEnabled(false);
+    connect(game_timeslice_action, &QAction::triggered, this, [=] (bool checked) {
+        QString serial = game_timeslice_action->data().toString();
+        if (checked)
+        {
+            Settings::instance().set_game_timeslice(serial, Scheduler::DEFAULT_RUN_CYCLES);
+            emu_thread.set_game_timeslice(serial, Scheduler::DEFAULT_RUN_CYCLES);
+        }
+        else
+        {
+            Settings::instance().clear_game_timeslice(serial);
+            emu_thread.clear_game_timeslice(serial);
+        }
+    });
+
+    connect(&emu_thread, &EmuThread::rom_loaded, this, [=](QString name, QString serial) {
+        game_timeslice_action->setData(serial);
+        game_timeslice_action->setEnabled(!serial.isEmpty());
+        game_timeslice_action->setChecked(Settings::instance().game_timeslices.contains(serial));
+    });
+
     auto shutdown_action = new QAction(tr("&Shutdown"), this);
     connect(shutdown_action, &QAction::triggered, this, [=]() {
         emu_thread.pause(PAUSE_EVENT::GAME_NOT_LOADED);
@@ -404,6 +441,7 @@ void EmuWindow::create_menu()
     emulation_menu->addSeparator();
     emulation_menu->addAction(frame_action);
     emulation_menu->addAction(wavoutput_action);
+    emulation_menu->addAction(game_timeslice_action);
     emulation_menu->addSeparator();
     emulation_menu->addAction(shutdown_action);
 
@@ -805,6 +843,11 @@ void EmuWindow::update_status()
         mode = CPU_MODE::JIT;
         ee_mode->setText("EE: JIT");
     }
+    else if (Settings::instance().ee_cached_interpreter_enabled)
+    {
+        mode = CPU_MODE::CACHED_INTERPRETER;
+        ee_mode->setText("EE: Cached Interpreter");
+    }
     else
     {
         mode = CPU_MODE::INTERPRETER;
@@ -836,4 +879,21 @@ void EmuWindow::update_status()
         vu1_mode->setText("VU1: Interpreter");
     }
     emu_thread.set_vu1_mode(mode);
+    emu_thread.set_vu1_threaded(Settings::instance().vu1_threaded);
+
+    if (Settings::instance().iop_jit_enabled)
+    {
+        mode = CPU_MODE::JIT;
+        iop_mode->setText("IOP: JIT");
+    }
+    else
+    {
+        mode = CPU_MODE::INTERPRETER;
+        iop_mode->setText("IOP: Interpreter");
+    }
+    emu_thread.set_iop_mode(mode);
+
+    emu_thread.set_reference_IDCT(Settings::instance().reference_idct_enabled);
+    emu_thread.set_gs_render_threads(Settings::instance().gs_render_threads);
+    emu_thread.set_max_timeslice(Settings::instance().max_timeslice);
 }
@@ -24,6 +24,7 @@ class EmuWindow : public QMainWindow
         QLabel* ee_mode;
         QLabel* vu0_mode;
         QLabel* vu1_mode;
+        QLabel* iop_mode;
         QLabel* frametime;
         QLabel* avg_framerate;
 
@@ -1,4 +1,5 @@
 #include "settings.hpp"
+#include "../core/scheduler.hpp"
 
 Settings::Settings()
 {
@@ -30,8 +31,15 @@ void Settings::reset()
     rom_directories = qsettings().value("rom_directories", {}).toStringList();
     recent_roms = qsettings().value("recent_roms", {}).toStringList();
     ee_jit_enabled = qsettings().value("ee_jit_enabled", true).toBool();
+    ee_cached_interpreter_enabled = qsettings().value("ee_cached_interpreter_enabled", false).toBool();
     vu0_jit_enabled = qsettings().value("vu0_jit_enabled", true).toBool();
     vu1_jit_enabled = qsettings().value("vu1_jit_enabled", true).toBool();
+    vu1_threaded = qsettings().value("vu1_threaded", false).toBool();
+    iop_jit_enabled = qsettings().value("iop_jit_enabled", true).toBool();
+    reference_idct_enabled = qsettings().value("reference_idct_enabled", false).toBool();
+    gs_render_threads = qsettings().value("gs_render_threads", 0).toInt();
+    max_timeslice = qsettings().value("max_timeslice", Scheduler::DEFAULT_RUN_CYCLES).toInt();
+    game_timeslices = qsettings().value("game_timeslices", {}).toMap();
     last_used_directory = qsettings().value("last_used_dir", QDir::homePath()).toString();
     screenshot_directory = qsettings().value("screenshot_directory", QDir::homePath()).toString();
 
@@ -39,6 +47,8 @@ void Settings::reset()
     rom_directories_to_remove = QStringList();
 
     memcard_path = qsettings().value("memcard_path", "").toString();
+    //Goes through the setter so the emulator follows a cancelled change
+    set_vu_jit_cache_directory(qsettings().value("vu_jit_cache_directory", "").toString());
     scaling_factor = qsettings().value("ui_scaling_factor", 1).toInt();
 
     emit reload();
@@ -69,10 +79,17 @@ void Settings::save()
     qsettings().setValue("rom_directories", rom_directories);
     qsettings().setValue("bios_path", bios_path);
     qsettings().setValue("ee_jit_enabled", ee_jit_enabled);
+    qsettings().setValue("ee_cached_interpreter_enabled", ee_cached_interpreter_enabled);
     qsettings().setValue("vu0_jit_enabled", vu0_jit_enabled);
     qsettings().setValue("vu1_jit_enabled", vu1_jit_enabled);
+    qsettings().setValue("vu1_threaded", vu1_threaded);
+    qsettings().setValue("iop_jit_enabled", iop_jit_enabled);
+    qsettings().setValue("reference_idct_enabled", reference_idct_enabled);
+    qsettings().setValue("gs_render_threads", gs_render_threads);
+    qsettings().setValue("max_timeslice", max_timeslice);
     qsettings().setValue("screenshot_directory", screenshot_directory);
     qsettings().setValue("memcard_path", memcard_path);
+    qsettings().setValue("vu_jit_cache_directory", vu_jit_cache_directory);
     qsettings().setValue("ui_scaling_factor", scaling_factor);
     qsettings().sync();
     reset();
@@ -135,6 +152,19 @@ void Settings::add_rom_path(const QString& path)
     emit rom_path_added(path);
 }
 
+//Per-game limits are set from the Emulation menu while a game runs, so they are saved right away
+void Settings::set_game_timeslice(const QString& serial, int cycles)
+{
+    game_timeslices[serial] = cycles;
+    qsettings().setValue("game_timeslices", game_timeslices);
+}
+
+void Settings::clear_game_timeslice(const QString& serial)
+{
+    game_timeslices.remove(serial);
+    qsettings().setValue("game_timeslices", game_timeslices);
+}
+
 void Settings::clear_rom_paths()
 {
     recent_roms = QStringList();
@@ -167,3 +197,13 @@ void Settings::set_memcard_path(const QString &path)
     memcard_path = path;
     emit memcard_changed(path);
 }
+
+//An empty directory turns the cache off
+void Settings::set_vu_jit_cache_directory(const QString &directory)
+{
+    if (directory == vu_jit_cache_directory)
+        return;
+
+    vu_jit_cache_directory = directory;
+    emit vu_jit_cache_directory_changed(directory);
+}
@@ -32,10 +32,24 @@ class Settings final : public QObject
 
         bool vu0_jit_enabled;
         bool vu1_jit_enabled;
+        bool vu1_threaded;
         bool ee_jit_enabled;
+        bool ee_cached_interpreter_enabled;
+        bool iop_jit_enabled;
+        bool reference_idct_enabled;
+
+        //0, the default, draws on the GS thread only. -1 picks a count from the number of host cores
+        int gs_render_threads;
+
+        //Longest EE timeslice while everything but the CPUs is idle, and the per-game limits that override it
+        int max_timeslice;
+        QVariantMap game_timeslices;
 
         QString memcard_path;
 
+        //Empty when translated VU microprograms aren't kept between sessions
+        QString vu_jit_cache_directory;
+
         void save();
         void reset();
         void update_last_used_directory(const QString& path);
@@ -44,6 +58,9 @@ class Settings final : public QObject
         void set_bios_path(const QString& path);
         void set_screenshot_directory(const QString& directory);
         void set_memcard_path(const QString& path);
+        void set_vu_jit_cache_directory(const QString& directory);
+        void set_game_timeslice(const QString& serial, int cycles);
+        void clear_game_timeslice(const QString& serial);
 
         void remove_rom_directory(const QString& directory);
         void clear_rom_paths();
@@ -58,6 +75,7 @@ class Settings final : public QObject
         void bios_changed(const QString& path);
         void screenshot_directory_changed(const QString& directory);
         void memcard_changed(const QString& path);
+        void vu_jit_cache_directory_changed(const QString& directory);
         void reload();
 };
 #endif
@@ -11,9 +11,11 @@
 #include <QWidget>
 #include <QGroupBox>
 #include <QRadioButton>
+#include <QCheckBox>
 
 #include "settingswindow.hpp"
 #include "settings.hpp"
+#include "../core/scheduler.hpp"
 
 GeneralTab::GeneralTab(QWidget* parent)
     : QWidget(parent)
@@ -21,21 +23,36 @@ GeneralTab::GeneralTab(QWidget* parent)
     QRadioButton* ee_jit_checkbox = new QRadioButton(tr("JIT"));
     QRadioButton* vu0_jit_checkbox = new QRadioButton(tr("JIT - Experimental"));
     QRadioButton* vu1_jit_checkbox = new QRadioButton(tr("JIT"));
+    QRadioButton* iop_jit_checkbox = new QRadioButton(tr("JIT"));
     QRadioButton* ee_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
+    QRadioButton* ee_cached_interpreter_checkbox = new QRadioButton(tr("Cached Interpreter"));
     QRadioButton* vu0_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
     QRadioButton* vu1_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
+    QCheckBox* vu1_threaded_checkbox = new QCheckBox(tr("Separate thread - Experimental, applies on boot"));
+    QRadioButton* iop_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
+    QRadioButton* ipu_fast_idct_checkbox = new QRadioButton(tr("Fast IDCT"));
+    QRadioButton* ipu_reference_idct_checkbox = new QRadioButton(tr("Reference IDCT - Slow"));
 
 
     bool ee_jit = Settings::instance().ee_jit_enabled;
+    bool ee_cached_interpreter = Settings::instance().ee_cached_interpreter_enabled;
     bool vu0_jit = Settings::instance().vu0_jit_enabled;
     bool vu1_jit = Settings::instance().vu1_jit_enabled;
+    bool iop_jit = Settings::instance().iop_jit_enabled;
+    bool reference_idct = Settings::instance().reference_idct_enabled;
 
     ee_jit_checkbox->setChecked(ee_jit);
-    ee_interpreter_checkbox->setChecked(!ee_jit);
+    ee_interpreter_checkbox->setChecked(!ee_jit && !ee_cached_interpreter);
+    ee_cached_interpreter_checkbox->setChecked(!ee_jit && ee_cached_interpreter);
     vu0_jit_checkbox->setChecked(vu0_jit);
     vu0_interpreter_checkbox->setChecked(!vu0_jit);
     vu1_jit_checkbox->setChecked(vu1_jit);
     vu1_interpreter_checkbox->setChecked(!vu1_jit);
+    vu1_threaded_checkbox->setChecked(Settings::instance().vu1_threaded);
+    iop_jit_checkbox->setChecked(iop_jit);
+    iop_interpreter_checkbox->setChecked(!iop_jit);
+    ipu_fast_idct_checkbox->setChecked(!reference_idct);
+    ipu_reference_idct_checkbox->setChecked(reference_idct);
 
     connect(ee_jit_checkbox, &QRadioButton::clicked, this, [=]() {
         Settings::instance().ee_jit_enabled = true;
@@ -43,6 +60,12 @@ GeneralTab::GeneralTab(QWidget* parent)
 
     connect(ee_interpreter_checkbox, &QRadioButton::clicked, this, [=]() {
         Settings::instance().ee_jit_enabled = false;
+        Settings::instance().ee_cached_interpreter_enabled = false;
+    });
+
+    connect(ee_cached_interpreter_checkbox, &QRadioButton::clicked, this, [=]() {
+        Settings::instance().ee_jit_enabled = false;
+        Settings::instance().ee_cached_interpreter_enabled = true;
     });
 
     connect(vu0_jit_checkbox, &QRadioButton::clicked, this, [=]() {
@@ -61,16 +84,90 @@ GeneralTab::GeneralTab(QWidget* parent)
         Settings::instance().vu1_jit_enabled = false;
     });
 
+    connect(vu1_threaded_checkbox, &QCheckBox::clicked, this, [=](bool checked) {
+        Settings::instance().vu1_threaded = checked;
+    });
+
+    connect(iop_jit_checkbox, &QRadioButton::clicked, this, [=]() {
+        Settings::instance().iop_jit_enabled = true;
+    });
+
+    connect(iop_interpreter_checkbox, &QRadioButton::clicked, this, [=]() {
+        Settings::instance().iop_jit_enabled = false;
+    });
+
+    connect(ipu_fast_idct_checkbox, &QRadioButton::clicked, this, [=]() {
+        Settings::instance().reference_idct_enabled = false;
+    });
+
+    connect(ipu_reference_idct_checkbox, &QRadioButton::clicked, this, [=]() {
+        Settings::instance().reference_idct_enabled = true;
+    });
+
+    QComboBox* gs_threads_combobox = new QComboBox;
+    gs_threads_combobox->addItem(tr("Off"), 0);
+    gs_threads_combobox->addItem(tr("Auto"), -1);
+    for (int count : { 2, 3, 4, 6, 8 })
+        gs_threads_combobox->addItem(QString::number(count), count);
+
+    auto select_gs_threads = [=](int count) {
+        int index = gs_threads_combobox->findData(count);
+        if (index < 0)
+        {
+            gs_threads_combobox->addItem(QString::number(count), count);
+            index = gs_threads_combobox->count() - 1;
+        }
+        gs_threads_combobox->setCurrentIndex(index);
+    };
+    select_gs_threads(Settings::instance().gs_render_threads);
+
+    QComboBox* timeslice_combobox = new QComboBox;
+    timeslice_combobox->addItem(tr("%1 cycles - Accurate").arg(Scheduler::DEFAULT_RUN_CYCLES), Scheduler::DEFAULT_RUN_CYCLES);
+    for (int cycles : { 256, 1024 })
+        timeslice_combobox->addItem(tr("%1 cycles").arg(cycles), cycles);
+    timeslice_combobox->addItem(tr("%1 cycles - Fastest").arg(4096), 4096);
+
+    auto select_timeslice = [=](int cycles) {
+        int index = timeslice_combobox->findData(cycles);
+        if (index < 0)
+        {
+            timeslice_combobox->addItem(tr("%1 cycles").arg(cycles), cycles);
+            index = timeslice_combobox->count() - 1;
+        }
+        timeslice_combobox->setCurrentIndex(index);
+    };
+    select_timeslice(Settings::instance().max_timeslice);
+
+    connect(timeslice_combobox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, [=](int index) {
+        Settings::instance().max_timeslice = timeslice_combobox->itemData(index).toInt();
+    });
+
+    connect(gs_threads_combobox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, [=](int index) {
+        Settings::instance().gs_render_threads = gs_threads_combobox->itemData(index).toInt();
+    });
+
     connect(&Settings::instance(), &Settings::reload, this, [=]() {
+        select_gs_threads(Settings::instance().gs_render_threads);
+        select_timeslice(Settings::instance().max_timeslice);
+
         bool ee_jit_enabled = Settings::instance().ee_jit_enabled;
+        bool ee_cached_interpreter_enabled = Settings::instance().ee_cached_interpreter_enabled;
         bool vu0_jit_enabled = Settings::instance().vu0_jit_enabled;
         bool vu1_jit_enabled = Settings::instance().vu1_jit_enabled;
+        bool iop_jit_enabled = Settings::instance().iop_jit_enabled;
+        bool reference_idct_enabled = Settings::instance().reference_idct_enabled;
         ee_jit_checkbox->setChecked(ee_jit_enabled);
-        ee_interpreter_checkbox->setChecked(!ee_jit_enabled);
+        ee_interpreter_checkbox->setChecked(!ee_jit_enabled && !ee_cached_interpreter_enabled);
+        ee_cached_interpreter_checkbox->setChecked(!ee_jit_enabled && ee_cached_interpreter_enabled);
         vu0_jit_checkbox->setChecked(vu0_jit_enabled);
         vu0_interpreter_checkbox->setChecked(!vu0_jit_enabled);
         vu1_jit_checkbox->setChecked(vu1_jit_enabled);
         vu1_interpreter_checkbox->setChecked(!vu1_jit_enabled);
+        vu1_threaded_checkbox->setChecked(Settings::instance().vu1_threaded);
+        iop_jit_checkbox->setChecked(iop_jit_enabled);
+        iop_interpreter_checkbox->setChecked(!iop_jit_enabled);
+        ipu_fast_idct_checkbox->setChecked(!reference_idct_enabled);
+        ipu_reference_idct_checkbox->setChecked(reference_idct_enabled);
     });
 
 
@@ -84,22 +181,55 @@ GeneralTab::GeneralTab(QWidget* parent)
     QVBoxLayout* vu1_layout = new QVBoxLayout;
     vu1_layout->addWidget(vu1_jit_checkbox);
     vu1_layout->addWidget(vu1_interpreter_checkbox);
+    vu1_layout->addWidget(vu1_threaded_checkbox);
 
     QGroupBox* vu1_groupbox = new QGroupBox(tr("VU1"));
     vu1_groupbox->setLayout(vu1_layout);
 
+    QVBoxLayout* iop_layout = new QVBoxLayout;
+    iop_layout->addWidget(iop_jit_checkbox);
+    iop_layout->addWidget(iop_interpreter_checkbox);
+
+    QGroupBox* iop_groupbox = new QGroupBox(tr("IOP"));
+    iop_groupbox->setLayout(iop_layout);
+
+    QVBoxLayout* ipu_layout = new QVBoxLayout;
+    ipu_layout->addWidget(ipu_fast_idct_checkbox);
+    ipu_layout->addWidget(ipu_reference_idct_checkbox);
+
+    QGroupBox* ipu_groupbox = new QGroupBox(tr("IPU"));
+    ipu_groupbox->setLayout(ipu_layout);
+
     QVBoxLayout* ee_layout = new QVBoxLayout;
     ee_layout->addWidget(ee_jit_checkbox);
     ee_layout->addWidget(ee_interpreter_checkbox);
+    ee_layout->addWidget(ee_cached_interpreter_checkbox);
+
+    QHBoxLayout* timeslice_layout = new QHBoxLayout;
+    timeslice_layout->addWidget(new QLabel(tr("Timeslice while idle:")));
+    timeslice_layout->addWidget(timeslice_combobox);
+    timeslice_layout->addStretch(1);
+    ee_layout->addLayout(timeslice_layout);
 
     QGroupBox* ee_groupbox = new QGroupBox(tr("EE"));
     ee_groupbox->setLayout(ee_layout);
 
 
+    QHBoxLayout* gs_layout = new QHBoxLayout;
+    gs_layout->addWidget(new QLabel(tr("Render threads:")));
+    gs_layout->addWidget(gs_threads_combobox);
+    gs_layout->addStretch(1);
+
+    QGroupBox* gs_groupbox = new QGroupBox(tr("GS"));
+    gs_groupbox->setLayout(gs_layout);
+
     QVBoxLayout* layout = new QVBoxLayout;
     layout->addWidget(ee_groupbox);
     layout->addWidget(vu0_groupbox);
     layout->addWidget(vu1_groupbox);
+    layout->addWidget(iop_groupbox);
+    layout->addWidget(ipu_groupbox);
+    layout->addWidget(gs_groupbox);
     layout->addStretch(1);
 
     setLayout(layout);
@@ -193,6 +323,33 @@ PathTab::PathTab(QWidget* parent)
         screenshot_label->setText(directory);
     });
 
+    QPushButton* vu_jit_cache_button = new QPushButton(tr("Browse"));
+    connect(vu_jit_cache_button, &QAbstractButton::clicked, [=]() {
+        QString directory = QFileDialog::getExistingDirectory(
+            this, tr("Choose VU JIT Cache Directory"),
+            Settings::instance().last_used_directory
+        );
+
+        if (!directory.isEmpty())
+            Settings::instance().set_vu_jit_cache_directory(directory);
+    });
+
+    QPushButton* vu_jit_cache_disable_button = new QPushButton(tr("Disable"));
+    connect(vu_jit_cache_disable_button, &QAbstractButton::clicked, [=]() {
+        Settings::instance().set_vu_jit_cache_directory("");
+    });
+
+    auto vu_jit_cache_text = [](const QString& directory) {
+        return directory.isEmpty() ? tr("Disabled") : directory;
+    };
+
+    auto vu_jit_cache_label =
+        new QLabel(vu_jit_cache_text(Settings::instance().vu_jit_cache_directory));
+
+    connect(&Settings::instance(), &Settings::vu_jit_cache_directory_changed, [=](QString directory) {
+        vu_jit_cache_label->setText(vu_jit_cache_text(directory));
+    });
+
     QGridLayout* other_layout = new QGridLayout;
     other_layout->addWidget(new QLabel(tr("Bios:"), 0, 0));
     other_layout->addWidget(bios_info, 0, 2);
@@ -200,6 +357,10 @@ PathTab::PathTab(QWidget* parent)
     other_layout->addWidget(new QLabel("Screenshots:"), 1, 0);
     other_layout->addWidget(screenshot_label, 1, 2);
     other_layout->addWidget(screenshot_button, 1, 3);
+    other_layout->addWidget(new QLabel("VU JIT cache:"), 2, 0);
+    other_layout->addWidget(vu_jit_cache_label, 2, 2);
+    other_layout->addWidget(vu_jit_cache_button, 2, 3);
+    other_layout->addWidget(vu_jit_cache_disable_button, 2, 4);
 
     other_layout->setColumnStretch(1, 1);
     other_layout->setAlignment(Qt::AlignTop);